@@ -39,6 +39,11 @@ FILE(GLOB AvsCore_Sources RELATIVE "${CMAKE_CURRENT_SOURCE_DIR}"
 )
 
 IF(ENABLE_INTEL_SIMD)
+  FILE(GLOB Core_Cpu_Sources RELATIVE "${CMAKE_CURRENT_SOURCE_DIR}"
+    "core/intel/*.cpp"
+    "core/intel/*.h")
+  LIST(APPEND AvsCore_Sources "${Core_Cpu_Sources}")
+
   FILE(GLOB Conditional_Filter_Cpu_Sources RELATIVE "${CMAKE_CURRENT_SOURCE_DIR}"
     "filters/conditional/intel/*.cpp"
     "filters/conditional/intel/*.h")
@@ -38,6 +38,8 @@
 #include "intel/convert_bits_avx2.h"
 #endif
 #include "convert_helper.h"
+#include "../core/internal.h"
+#include "../core/InternalEnvironment.h"
 
 #include <avs/alignment.h>
 #include <avs/minmax.h>
@@ -46,6 +48,7 @@
 #include <map>
 #include <algorithm>
 #include <vector>
+#include <cmath>
 
 #ifdef AVS_WINDOWS
 #include <avs/win.h>
@@ -327,6 +330,202 @@ static void convert_ordered_dither_uint_c(const BYTE* srcp8, BYTE* dstp8, int sr
   }
 }
 
+// 64x64 blue noise threshold matrix, ranks 0..4095. Made once with the void-and-cluster
+// method (Ulichney) on a torus; integer energies keep it identical on every platform.
+static const uint16_t* GetBlueNoiseMatrix()
+{
+  static const std::vector<uint16_t> matrix = []() {
+    constexpr int N = BLUE_NOISE_SIZE;
+    constexpr int SIZE = N * N;
+
+    // gaussian energy of a point by toroidal distance, sigma = 1.5
+    std::vector<int> kernel(SIZE);
+    for (int dy = 0; dy < N; dy++) {
+      for (int dx = 0; dx < N; dx++) {
+        const int ddx = min(dx, N - dx);
+        const int ddy = min(dy, N - dy);
+        kernel[dy * N + dx] = (int)(exp(-(ddx * ddx + ddy * ddy) / (2.0 * 1.5 * 1.5)) * 65536.0 + 0.5);
+      }
+    }
+
+    std::vector<char> pattern(SIZE, 0);
+    std::vector<int> energy(SIZE, 0);
+    auto set_point = [&](int pos, bool on) {
+      pattern[pos] = on;
+      const int sign = on ? 1 : -1;
+      const int py = pos / N, px = pos % N;
+      for (int y = 0; y < N; y++) {
+        const int* krow = &kernel[((y - py) & (N - 1)) * N];
+        int* erow = &energy[y * N];
+        for (int x = 0; x < N; x++)
+          erow[x] += sign * krow[(x - px) & (N - 1)];
+      }
+    };
+    auto tightest_cluster = [&]() {
+      int best = -1;
+      for (int i = 0; i < SIZE; i++)
+        if (pattern[i] && (best < 0 || energy[i] > energy[best]))
+          best = i;
+      return best;
+    };
+    auto largest_void = [&]() {
+      int best = -1;
+      for (int i = 0; i < SIZE; i++)
+        if (!pattern[i] && (best < 0 || energy[i] < energy[best]))
+          best = i;
+      return best;
+    };
+
+    // initial binary pattern: a tenth of the points, placed by a fixed LCG
+    uint32_t seed = 0x2545F491u;
+    int ones = 0;
+    while (ones < SIZE / 10) {
+      seed = seed * 1664525u + 1013904223u;
+      const int pos = (int)((seed >> 8) % SIZE);
+      if (!pattern[pos]) {
+        set_point(pos, true);
+        ones++;
+      }
+    }
+    // move the point of the tightest cluster into the largest void until it is stable
+    for (int iter = 0; iter < SIZE; iter++) {
+      const int c = tightest_cluster();
+      set_point(c, false);
+      const int v = largest_void();
+      set_point(v, true);
+      if (v == c)
+        break;
+    }
+
+    std::vector<uint16_t> rank(SIZE);
+    const std::vector<char> prototype_pattern = pattern;
+    const std::vector<int> prototype_energy = energy;
+    // ranks of the initial points: remove the tightest clusters first
+    for (int r = ones - 1; r >= 0; r--) {
+      const int c = tightest_cluster();
+      set_point(c, false);
+      rank[c] = (uint16_t)r;
+    }
+    pattern = prototype_pattern;
+    energy = prototype_energy;
+    // ranks of the others: fill the largest voids
+    for (int r = ones; r < SIZE; r++) {
+      const int v = largest_void();
+      set_point(v, true);
+      rank[v] = (uint16_t)r;
+    }
+    return rank;
+  }();
+  return matrix.data();
+}
+
+// Ordered dither with the blue noise matrix: no visible pattern like Bayer, no
+// dependency between pixels like error diffusion, any bit depth difference.
+template<typename pixel_t_s, typename pixel_t_d, bool chroma, bool fulls, bool fulld, bool TEMPLATE_NEED_BACKSCALE, bool TEMPLATE_LOW_DITHER_BITDEPTH>
+static void do_convert_blue_noise_dither_uint_c(const BYTE* srcp8, BYTE* dstp8, int src_rowsize, int src_height, int src_pitch, int dst_pitch, int source_bitdepth, int target_bitdepth, int dither_target_bitdepth)
+{
+  const pixel_t_s* srcp = reinterpret_cast<const pixel_t_s*>(srcp8);
+  pixel_t_d* dstp = reinterpret_cast<pixel_t_d*>(dstp8);
+  dst_pitch = dst_pitch / sizeof(pixel_t_d);
+
+  src_pitch = src_pitch / sizeof(pixel_t_s);
+  const int src_width = src_rowsize / sizeof(pixel_t_s);
+
+  // helps compiler optimization
+  if constexpr (sizeof(pixel_t_s) == 1)
+    source_bitdepth = 8;
+  if constexpr (sizeof(pixel_t_d) == 1) {
+    target_bitdepth = 8;
+    if (!TEMPLATE_NEED_BACKSCALE) {
+      dither_target_bitdepth = 8;
+    }
+  }
+
+  const int max_pixel_value_target = (1 << target_bitdepth) - 1;
+  const int max_pixel_value_dithered = (1 << dither_target_bitdepth) - 1;
+  const int dither_bit_diff = (source_bitdepth - dither_target_bitdepth);
+  const int bitdiff_between_dither_and_target = target_bitdepth - dither_target_bitdepth;
+  assert(TEMPLATE_NEED_BACKSCALE == (target_bitdepth != dither_target_bitdepth));  // dither to x, target to y
+  assert(TEMPLATE_LOW_DITHER_BITDEPTH == (dither_target_bitdepth < 8));
+
+  // ranks scaled to the 0..2^dither_bit_diff-1 correction range, centers of equal intervals
+  constexpr int N = BLUE_NOISE_SIZE;
+  const uint16_t* ranks = GetBlueNoiseMatrix();
+  std::vector<int> matrix(N * N);
+  for (int i = 0; i < N * N; i++)
+    matrix[i] = (int)(((2 * (int64_t)ranks[i] + 1) << dither_bit_diff) / (2 * N * N));
+
+  // e.g. instead of 0,1 => -0.5,+0.5;  0,1,2,3 => -1.5,-0.5,0.5,1.5
+  const float half_maxcorr_value = ((1 << dither_bit_diff) - 1) / 2.0f;
+
+  const int source_max = (1 << source_bitdepth) - 1;
+  //-----------------------
+  // When calculating src_pixel, src and dst are of the same bit depth
+  bits_conv_constants d;
+  get_bits_conv_constants(d, chroma, fulls, fulld, source_bitdepth, source_bitdepth);
+
+  auto dst_offset_plus_round = d.dst_offset + 0.5f;
+  constexpr auto src_pixel_min = 0;
+  const auto src_pixel_max = source_max;
+  const float mul_factor_backfromlowdither = (float)max_pixel_value_target / max_pixel_value_dithered;
+  //-----------------------
+
+  for (int y = 0; y < src_height; y++)
+  {
+    const int* matrix_row = &matrix[(y & (N - 1)) * N];
+    for (int x = 0; x < src_width; x++)
+    {
+      const int corr = matrix_row[x & (N - 1)];
+
+      int src_pixel = srcp[x];
+
+      if constexpr (fulls != fulld) {
+        const float val = (srcp[x] - d.src_offset_i) * d.mul_factor + dst_offset_plus_round;
+        src_pixel = clamp((int)val, src_pixel_min, src_pixel_max);
+      }
+
+      int new_pixel;
+      if (TEMPLATE_LOW_DITHER_BITDEPTH) {
+        // accurate dither: +/-
+        const float corr_f = corr - half_maxcorr_value;
+        new_pixel = (int)(src_pixel + corr_f) >> dither_bit_diff;
+      }
+      else
+        new_pixel = ((src_pixel + corr) >> dither_bit_diff);
+
+      // scale back to the required bit depth
+      if constexpr (TEMPLATE_NEED_BACKSCALE) { // dither to x, target to y
+        new_pixel = min(new_pixel, max_pixel_value_dithered);
+        if (TEMPLATE_LOW_DITHER_BITDEPTH) {
+          new_pixel = (int)(new_pixel * mul_factor_backfromlowdither + 0.5f);
+        }
+        else {
+          new_pixel = new_pixel << bitdiff_between_dither_and_target;
+        }
+      }
+      dstp[x] = (pixel_t_d)(max(min((int)new_pixel, max_pixel_value_target), 0));
+    }
+    dstp += dst_pitch;
+    srcp += src_pitch;
+  }
+}
+
+template<typename pixel_t_s, typename pixel_t_d, bool chroma, bool fulls, bool fulld>
+static void convert_blue_noise_dither_uint_c(const BYTE* srcp8, BYTE* dstp8, int src_rowsize, int src_height, int src_pitch, int dst_pitch, int source_bitdepth, int target_bitdepth, int dither_target_bitdepth)
+{
+  const bool need_backscale = target_bitdepth != dither_target_bitdepth; // dither to x, target to y
+  const bool low_dither_bitdepth = dither_target_bitdepth < 8;
+  if (need_backscale) {
+    if (low_dither_bitdepth)
+      do_convert_blue_noise_dither_uint_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, true, true>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth);
+    else
+      do_convert_blue_noise_dither_uint_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, true, false>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth);
+  }
+  else {
+    do_convert_blue_noise_dither_uint_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, false, false>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth);
+  }
+}
+
 // idea borrowed from fmtConv
 #define FS_OPTIMIZED_SERPENTINE_COEF
 
@@ -375,8 +574,11 @@ static AVS_FORCEINLINE void diffuse_floyd_f(float err, float& nextError, float*
 // optimization helper: TEMPLATE_DITHER_BIT_DIFF if not <0 then hold value for frequently used differences from 16->8
 // 2nd helper: TEMPLATE_LOW_DITHER_BITDEPTH
 // 3rd helper: source_bitdepth_special
+// Works on a band of lines: the first priming_rows source lines only build up the error buffer and are
+// not written (dstp points to the line after them), first_row is the plane line number of the first
+// source line, it keeps the serpentine direction of the band in step with the whole plane.
 template<typename pixel_t_s, typename pixel_t_d, bool chroma, bool fulls, bool fulld, int TEMPLATE_DITHER_BIT_DIFF, bool TEMPLATE_LOW_DITHER_BITDEPTH, int SOURCE_BITDEPTH_SPECIAL>
-static void do_convert_uint_floyd_c(const BYTE* srcp8, BYTE* dstp8, int src_rowsize, int src_height, int src_pitch, int dst_pitch, int source_bitdepth, int target_bitdepth, int dither_target_bitdepth)
+static void do_convert_uint_floyd_c(const BYTE* srcp8, BYTE* dstp8, int src_rowsize, int src_height, int src_pitch, int dst_pitch, int source_bitdepth, int target_bitdepth, int dither_target_bitdepth, int priming_rows, int first_row)
 {
   if constexpr (SOURCE_BITDEPTH_SPECIAL > 0) {
     // called with >0 values only for special cases like 16 to 8, 16 to 10 and 10 to 8
@@ -415,6 +617,9 @@ static void do_convert_uint_floyd_c(const BYTE* srcp8, BYTE* dstp8, int src_rows
   std::vector<int> error_ptr_safe(1 + src_width + 1); // accumulated errors
   int *error_ptr = &error_ptr_safe[1];
 
+  // Priming lines are quantized into a scratch line
+  std::vector<pixel_t_d> priming_line(priming_rows > 0 ? src_width : 0);
+
   const int ROUNDER = 1 << (DITHER_BIT_DIFF - 1); // rounding
   const int source_max = (1 << source_bitdepth) - 1;
   //-----------------------
@@ -426,43 +631,59 @@ static void do_convert_uint_floyd_c(const BYTE* srcp8, BYTE* dstp8, int src_rows
   const auto src_pixel_max = source_max;
   const float mul_factor_backfromlowdither = (float)max_pixel_value_target / max_pixel_value_dithered;
 
+  // The range conversion does not depend on the diffused error: it is done for the whole
+  // line before the serial part, in a loop the compiler can vectorize.
+  std::vector<int> converted_line(fulls != fulld ? src_width : 0);
+
+  // quantizes one pixel, err: error carried in, then the quantization error to diffuse
+  auto dither_pixel = [&](int src_pixel, int& err) -> pixel_t_d {
+    if (TEMPLATE_LOW_DITHER_BITDEPTH) {
+      // accurate dither: +/-
+      // accurately positioned to the center
+      err = err - (1 << (DITHER_BIT_DIFF - 1)); // signed
+    }
+    int sum = src_pixel + err;
+
+    int quantized = (sum + ROUNDER) >> (DITHER_BIT_DIFF);
+    err = sum - (quantized << DITHER_BIT_DIFF);
+    // Interesting problem of dither_bits==1 (or in general at small dither_bits)
+    // After simple slli 0,1 becomes 0,128, we'd expect 0,255 instead. So we make cosmetics.
+    if (TEMPLATE_LOW_DITHER_BITDEPTH) {
+      quantized = min(quantized, max_pixel_value_dithered);
+      quantized = (int)(quantized * mul_factor_backfromlowdither + 0.5f);
+    }
+    else {
+      quantized <<= BITDIFF_BETWEEN_DITHER_AND_TARGET;
+    }
+    return (pixel_t_d)max(min(max_pixel_value_target, quantized), 0); // clamp to target bit
+  };
+
   int nextError = 0; // zero
 
   for (int y = 0; y < src_height; y++)
   {
+    pixel_t_d* out = y < priming_rows ? priming_line.data() : dstp;
+
+    if constexpr (fulls != fulld) {
+      int* conv = converted_line.data();
+      for (int x = 0; x < src_width; x++) {
+        const float val = (srcp[x] - d.src_offset_i) * d.mul_factor + dst_offset_plus_round;
+        conv[x] = clamp((int)val, src_pixel_min, src_pixel_max);
+      }
+    }
+
     // serpentine forward
-    if ((y & 1) == 0)
+    if (((first_row + y) & 1) == 0)
     {
       for (int x = 0; x < src_width; x++)
       {
+        int src_pixel;
+        if constexpr (fulls != fulld)
+          src_pixel = converted_line[x];
+        else
+          src_pixel = srcp[x];
         int err = nextError;
-        int src_pixel = srcp[x];
-
-        if constexpr (fulls != fulld) {
-          const float val = (src_pixel - d.src_offset_i) * d.mul_factor + dst_offset_plus_round;
-          src_pixel = clamp((int)val, src_pixel_min, src_pixel_max);
-        }
-
-        if (TEMPLATE_LOW_DITHER_BITDEPTH) {
-          // accurate dither: +/-
-          // accurately positioned to the center
-          err = err - (1 << (DITHER_BIT_DIFF - 1)); // signed
-        }
-        int sum = src_pixel + err;
-
-        int quantized = (sum + ROUNDER) >> (DITHER_BIT_DIFF);
-        err = sum - (quantized << DITHER_BIT_DIFF);
-        // Interesting problem of dither_bits==1 (or in general at small dither_bits)
-        // After simple slli 0,1 becomes 0,128, we'd expect 0,255 instead. So we make cosmetics.
-        if (TEMPLATE_LOW_DITHER_BITDEPTH) {
-          quantized = min(quantized, max_pixel_value_dithered);
-          quantized = (int)(quantized * mul_factor_backfromlowdither + 0.5f);
-        }
-        else {
-          quantized <<= BITDIFF_BETWEEN_DITHER_AND_TARGET;
-        }
-        int pix = max(min(max_pixel_value_target, quantized), 0); // clamp to target bit
-        dstp[x] = (pixel_t_d)pix;
+        out[x] = dither_pixel(src_pixel, err);
         diffuse_floyd<1>(err, nextError, &error_ptr[x]);
       }
     }
@@ -470,52 +691,32 @@ static void do_convert_uint_floyd_c(const BYTE* srcp8, BYTE* dstp8, int src_rows
       // serpentine backward
       for (int x = src_width - 1; x >= 0; --x)
       {
+        int src_pixel;
+        if constexpr (fulls != fulld)
+          src_pixel = converted_line[x];
+        else
+          src_pixel = srcp[x];
         int err = nextError;
-        int src_pixel = srcp[x];
-
-        if constexpr (fulls != fulld) {
-          const float val = (src_pixel - d.src_offset_i) * d.mul_factor + dst_offset_plus_round;
-          src_pixel = clamp((int)val, src_pixel_min, src_pixel_max);
-        }
-
-        if (TEMPLATE_LOW_DITHER_BITDEPTH) {
-          // accurate dither: +/-
-          // accurately positioned to the center
-          err = err - (1 << (DITHER_BIT_DIFF - 1)); // signed
-        }
-        int sum = src_pixel + err;
-
-        int quantized = (sum + ROUNDER) >> (DITHER_BIT_DIFF);
-        err = sum - (quantized << DITHER_BIT_DIFF);
-        // Interesting problem of dither_bits==1 (or in general at small dither_bits)
-        // After simple slli 0,1 becomes 0,128, we'd expect 0,255 instead. So we make cosmetics.
-        if (TEMPLATE_LOW_DITHER_BITDEPTH) {
-          quantized = min(quantized, max_pixel_value_dithered);
-          quantized = (int)(quantized * mul_factor_backfromlowdither + 0.5f);
-        }
-        else {
-          quantized <<= BITDIFF_BETWEEN_DITHER_AND_TARGET;
-        }
-        int pix = max(min(max_pixel_value_target, quantized), 0); // clamp to target bit
-        dstp[x] = (pixel_t_d)pix;
+        out[x] = dither_pixel(src_pixel, err);
         diffuse_floyd<-1>(err, nextError, &error_ptr[x]);
       }
     }
-    dstp += dst_pitch;
+    if (y >= priming_rows)
+      dstp += dst_pitch;
     srcp += src_pitch;
   }
 }
 
 
 template<typename pixel_t_s, typename pixel_t_d, bool chroma, bool fulls, bool fulld>
-static void convert_uint_floyd_c(const BYTE* srcp8, BYTE* dstp8, int src_rowsize, int src_height, int src_pitch, int dst_pitch, int source_bitdepth, int target_bitdepth, int dither_target_bitdepth)
+static void convert_uint_floyd_c(const BYTE* srcp8, BYTE* dstp8, int src_rowsize, int src_height, int src_pitch, int dst_pitch, int source_bitdepth, int target_bitdepth, int dither_target_bitdepth, int priming_rows, int first_row)
 {
   const int dither_bit_diff = source_bitdepth - dither_target_bitdepth;
   const bool low_dither_bitdepth = dither_target_bitdepth < 8;
   // extra internal template makes it quicker for ordinary non-artistic cases
   // do not make templates for all 1-16 target bit combinations
   if (low_dither_bitdepth) {
-    do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, -1, true, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth);
+    do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, -1, true, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth, priming_rows, first_row);
   }
   else {
     if (target_bitdepth == dither_target_bitdepth) {
@@ -524,36 +725,36 @@ static void convert_uint_floyd_c(const BYTE* srcp8, BYTE* dstp8, int src_rowsize
       switch (dither_bit_diff) {
       case 2: // e.g. 10->8
         if (source_bitdepth == 10)
-          do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 2, false, 10>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth);
+          do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 2, false, 10>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth, priming_rows, first_row);
         else
-          do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 2, false, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth);
+          do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 2, false, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth, priming_rows, first_row);
         break;
       case 4: // e.g. 12->8
-        do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 4, false, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth);
+        do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 4, false, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth, priming_rows, first_row);
         break;
       case 6: // e.g. 16->10, 14->8
         // prevent invalid templates to generate
         // like do_convert_uint_floyd_c<unsigned short,unsigned char,0,0,1,6,0,16> which would do 16->8 but dither to 10 bit.
         if constexpr (sizeof(pixel_t_s) == 2 && sizeof(pixel_t_d) == 2) {
           if (source_bitdepth == 16)
-            do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 6, false, 16>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth);
+            do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 6, false, 16>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth, priming_rows, first_row);
           else
-            do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 6, false, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth);
+            do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 6, false, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth, priming_rows, first_row);
         } else
-          do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 6, false, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth);
+          do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 6, false, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth, priming_rows, first_row);
         break;
       case 8: // e.g. 16->8
         if (sizeof(pixel_t_s) == 2 && source_bitdepth == 16)
-          do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 8, false, 16>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth);
+          do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 8, false, 16>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth, priming_rows, first_row);
         else
-          do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 8, false, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth);
+          do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, 8, false, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth, priming_rows, first_row);
         break;
       default: // difference is more than 8 or exotic dither to less than 8 bits, we accept 10-15% speed minus
-        do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, -1, false, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth);
+        do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, -1, false, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth, priming_rows, first_row);
       }
     }
     else {
-      do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, -1, false, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth);
+      do_convert_uint_floyd_c<pixel_t_s, pixel_t_d, chroma, fulls, fulld, -1, false, -1>(srcp8, dstp8, src_rowsize, src_height, src_pitch, dst_pitch, source_bitdepth, target_bitdepth, dither_target_bitdepth, priming_rows, first_row);
     }
   }
 }
@@ -939,7 +1140,7 @@ static void get_convert_uintN_to_uintN_ordered_dither_functions(int source_bitde
 }
 
 static void get_convert_uintN_to_uintN_floyd_dither_functions(int source_bitdepth, int target_bitdepth, bool fulls, bool fulld,
-  BitDepthConvFuncPtr& conv_function, BitDepthConvFuncPtr& conv_function_chroma)
+  FloydConvFuncPtr& conv_function, FloydConvFuncPtr& conv_function_chroma)
 {
   // 8-16->8-16 bits support any fulls fulld combination
   // dither has no "conv_function_a"
@@ -982,6 +1183,49 @@ static void get_convert_uintN_to_uintN_floyd_dither_functions(int source_bitdept
 #undef convert_uintN_to_uintN_floyd_dither_functions
 }
 
+static void get_convert_uintN_to_uintN_blue_noise_dither_functions(int source_bitdepth, int target_bitdepth, bool fulls, bool fulld,
+  BitDepthConvFuncPtr& conv_function, BitDepthConvFuncPtr& conv_function_chroma)
+{
+  // 8-16->8-16 bits support any fulls fulld combination
+  // dither has no "conv_function_a"
+  // pure C, the loop is vectorized by the compiler
+#define convert_uintN_to_uintN_blue_noise_dither_functions(uint_X_t, uint_X_dest_t) \
+      if (fulls && fulld) { \
+        conv_function = convert_blue_noise_dither_uint_c<uint_X_t, uint_X_dest_t, false, true, true>; \
+        conv_function_chroma = convert_blue_noise_dither_uint_c<uint_X_t, uint_X_dest_t, true, true, true>; \
+      } \
+      else if (fulls && !fulld) { \
+        conv_function = convert_blue_noise_dither_uint_c<uint_X_t, uint_X_dest_t, false, true, false>; \
+        conv_function_chroma = convert_blue_noise_dither_uint_c<uint_X_t, uint_X_dest_t, true, true, false>; \
+      } \
+      else if (!fulls && fulld) { \
+        conv_function = convert_blue_noise_dither_uint_c<uint_X_t, uint_X_dest_t, false, false, true>; \
+        conv_function_chroma = convert_blue_noise_dither_uint_c<uint_X_t, uint_X_dest_t, true, false, true>; \
+      } \
+      else if (!fulls && !fulld) { \
+        conv_function = convert_blue_noise_dither_uint_c<uint_X_t, uint_X_dest_t, false, false, false>; \
+        conv_function_chroma = convert_blue_noise_dither_uint_c<uint_X_t, uint_X_dest_t, true, false, false>; \
+      }
+
+  switch (target_bitdepth)
+  {
+  case 8:
+    if (source_bitdepth == 8) {
+      convert_uintN_to_uintN_blue_noise_dither_functions(uint8_t, uint8_t);
+    }
+    else {
+      convert_uintN_to_uintN_blue_noise_dither_functions(uint16_t, uint8_t);
+    }
+    break;
+  default:
+    // uint16_t target is always uint16_t source
+    convert_uintN_to_uintN_blue_noise_dither_functions(uint16_t, uint16_t);
+    break;
+  }
+
+#undef convert_uintN_to_uintN_blue_noise_dither_functions
+}
+
 
 static void get_convert_uintN_to_uintN_functions(int source_bitdepth, int target_bitdepth, bool fulls, bool fulld,
 #ifdef INTEL_INTRINSICS
@@ -1064,6 +1308,7 @@ ConvertBits::ConvertBits(PClip _child, const int _dither_mode, const int _target
   int _dither_bitdepth, IScriptEnvironment* env) :
   GenericVideoFilter(_child),
   conv_function(nullptr), conv_function_chroma(nullptr), conv_function_a(nullptr),
+  floyd_function(nullptr), floyd_function_chroma(nullptr),
   target_bitdepth(_target_bitdepth), dither_mode(_dither_mode), dither_bitdepth(_dither_bitdepth),
   fulls(false), fulld(false), truerange(_truerange)
 {
@@ -1114,9 +1359,13 @@ ConvertBits::ConvertBits(PClip _child, const int _dither_mode, const int _target
         get_convert_uintN_to_uintN_ordered_dither_functions(bits_per_pixel, target_bitdepth, fulls, fulld, conv_function, conv_function_chroma);
 #endif
       }
-      else if (dither_mode == 1) {
-        // Floyd, no SIMD there
-        get_convert_uintN_to_uintN_floyd_dither_functions(bits_per_pixel, target_bitdepth, fulls, fulld, conv_function, conv_function_chroma);
+      else if (dither_mode == 1 || dither_mode == 2) {
+        // Floyd, whole planes (1) or primed strips (2), see GetFrame
+        get_convert_uintN_to_uintN_floyd_dither_functions(bits_per_pixel, target_bitdepth, fulls, fulld, floyd_function, floyd_function_chroma);
+      }
+      else if (dither_mode == 3) {
+        // blue noise
+        get_convert_uintN_to_uintN_blue_noise_dither_functions(bits_per_pixel, target_bitdepth, fulls, fulld, conv_function, conv_function_chroma);
       }
     }
   }
@@ -1279,8 +1528,8 @@ AVSValue __cdecl ConvertBits::Create(AVSValue args, void* user_data, IScriptEnvi
 
   int dither_type = args[3].AsInt(-1);
   bool dither_defined = args[3].Defined();
-  if(dither_defined && dither_type != 1 && dither_type != 0 && dither_type != -1)
-    env->ThrowError("ConvertBits: invalid dither type parameter. Only -1 (disabled), 0 (ordered dither) or 1 (Floyd-S) is allowed");
+  if(dither_defined && (dither_type < -1 || dither_type > 3))
+    env->ThrowError("ConvertBits: invalid dither type parameter. Only -1 (disabled), 0 (ordered dither), 1 (Floyd-S), 2 (Floyd-S in strips) or 3 (blue noise) is allowed");
 
   if (dither_type >= 0) {
     if (source_bitdepth < target_bitdepth)
@@ -1294,7 +1543,7 @@ AVSValue __cdecl ConvertBits::Create(AVSValue args, void* user_data, IScriptEnvi
   // 3.7.1 t25
   // Unfortunately 32 bit float dithering is not implemented, thus we convert to 16 bit 
   // intermediate clip
-  if (source_bitdepth == 32 && (dither_type == 0 || dither_type == 1)) {
+  if (source_bitdepth == 32 && dither_type >= 0) {
     // c[bits]i[truerange]b[dither]i[dither_bits]i[fulls]b[fulld]b
 
     source_bitdepth = 16;
@@ -1345,11 +1594,17 @@ AVSValue __cdecl ConvertBits::Create(AVSValue args, void* user_data, IScriptEnvi
   }
 
   // floyd
-  if (dither_type == 1) {
+  if (dither_type == 1 || dither_type == 2) {
     if (dither_bitdepth < 1 || dither_bitdepth > 16)
       env->ThrowError("ConvertBits: Floyd-S: invalid dither_bits specified (1-16 allowed)");
   }
 
+  // blue noise
+  if (dither_type == 3) {
+    if (dither_bitdepth < 1 || dither_bitdepth > 16)
+      env->ThrowError("ConvertBits: blue noise dither: invalid dither_bits specified (1-16 allowed)");
+  }
+
   // no change -> return unmodified if no transform required
   if (source_bitdepth == target_bitdepth) { // 10->10 .. 16->16
     if((dither_type < 0 || dither_bitdepth == target_bitdepth) && fulls == fulld)
@@ -1428,6 +1683,23 @@ AVSValue __cdecl ConvertBits::Create(AVSValue args, void* user_data, IScriptEnvi
 }
 
 
+struct FloydJob {
+  FloydConvFuncPtr floyd_function;
+  const BYTE* srcp;
+  BYTE* dstp;
+  int src_rowsize, src_height, src_pitch, dst_pitch;
+  int source_bitdepth, target_bitdepth, dither_target_bitdepth;
+  int priming_rows, first_row;
+};
+
+static AVSValue __cdecl floyd_job(IScriptEnvironment2*, void* data)
+{
+  const FloydJob* job = static_cast<const FloydJob*>(data);
+  job->floyd_function(job->srcp, job->dstp, job->src_rowsize, job->src_height, job->src_pitch, job->dst_pitch,
+    job->source_bitdepth, job->target_bitdepth, job->dither_target_bitdepth, job->priming_rows, job->first_row);
+  return AVSValue();
+}
+
 PVideoFrame __stdcall ConvertBits::GetFrame(int n, IScriptEnvironment* env) {
   PVideoFrame src = child->GetFrame(n, env);
 
@@ -1449,8 +1721,52 @@ PVideoFrame __stdcall ConvertBits::GetFrame(int n, IScriptEnvironment* env) {
     int planes_y[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
     int planes_r[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
     int *planes = (vi.IsYUV() || vi.IsYUVA()) ? planes_y : planes_r;
+
+    // Error diffusion: one job per plane (dither=1, identical to a serial run),
+    // or per strip of FLOYD_STRIP_HEIGHT lines primed with the lines above (dither=2).
+    // Outside of Prefetch the jobs go to the thread pool, like in Turn.
+    std::vector<FloydJob> floyd_jobs;
+    if (floyd_function != nullptr) {
+      for (int p = 0; p < vi.NumComponents(); ++p) {
+        const int plane = planes[p];
+        if (plane == PLANAR_A)
+          continue;
+        const bool chroma = (plane == PLANAR_U || plane == PLANAR_V);
+        const FloydConvFuncPtr func = chroma ? floyd_function_chroma : floyd_function;
+        const BYTE* srcp = src->GetReadPtr(plane);
+        BYTE* dstp = dst->GetWritePtr(plane);
+        const int src_pitch = src->GetPitch(plane);
+        const int dst_pitch = dst->GetPitch(plane);
+        const int height = src->GetHeight(plane);
+        const int strip_height = dither_mode == 2 ? FLOYD_STRIP_HEIGHT : height;
+        for (int start = 0; start < height; start += strip_height) {
+          const int src_start = max(0, start - FLOYD_STRIP_PRIMING);
+          const int priming_rows = dither_mode == 2 ? start - src_start : 0;
+          const int first_row = start - priming_rows;
+          floyd_jobs.push_back({ func, srcp + first_row * src_pitch, dstp + start * dst_pitch,
+            src->GetRowSize(plane), min(strip_height, height - start) + priming_rows, src_pitch, dst_pitch,
+            bits_per_pixel, target_bitdepth, dither_bitdepth, priming_rows, first_row });
+        }
+      }
+
+      InternalEnvironment* IEnv = GetAndRevealCamouflagedEnv(env);
+      if (floyd_jobs.size() > 1 && IEnv->GetEnvProperty(AEP_THREAD_ID) == 0 && IEnv->GetEnvProperty(AEP_THREADPOOL_THREADS) > 1) {
+        IJobCompletion* completion = IEnv->NewCompletion(floyd_jobs.size());
+        for (auto& job : floyd_jobs)
+          IEnv->ParallelJob(floyd_job, &job, completion);
+        completion->Wait();
+        completion->Destroy();
+      }
+      else {
+        for (auto& job : floyd_jobs)
+          floyd_job(nullptr, &job);
+      }
+    }
+
     for (int p = 0; p < vi.NumComponents(); ++p) {
       const int plane = planes[p];
+      if (floyd_function != nullptr && plane != PLANAR_A)
+        continue; // done above
       if (plane == PLANAR_A) {
         if (conv_function_a == nullptr)
           env->BitBlt(dst->GetWritePtr(plane), dst->GetPitch(plane), src->GetReadPtr(plane), src->GetPitch(plane), src->GetRowSize(plane), src->GetHeight(plane));
@@ -72,8 +72,17 @@ extern const BYTE dither16x16a_data[16][16];
 // 16->8
 // cycle: 16x. No special 16 byte sse2
 extern const BYTE dither16x16_data[16][16];
+// blue noise ordered dither (dither=3): 64x64, ranks 0..4095, generated on first use
+constexpr int BLUE_NOISE_SIZE = 64;
 
 typedef void (*BitDepthConvFuncPtr)(const BYTE *srcp, BYTE *dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch, int source_bitdepth, int target_bitdepth, int dither_target_bitdepth);
+// Floyd-Steinberg on a horizontal band of a plane. The first priming_rows lines only feed the
+// error buffer and are not written; first_row is the absolute line index of srcp (serpentine parity).
+typedef void (*FloydConvFuncPtr)(const BYTE *srcp, BYTE *dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch, int source_bitdepth, int target_bitdepth, int dither_target_bitdepth, int priming_rows, int first_row);
+
+// dither=2 band layout: depends only on the plane height, so output does not depend on thread count
+constexpr int FLOYD_STRIP_HEIGHT = 128;
+constexpr int FLOYD_STRIP_PRIMING = 16;
 
 class ConvertBits : public GenericVideoFilter
 {
@@ -91,6 +100,8 @@ private:
   BitDepthConvFuncPtr conv_function;
   BitDepthConvFuncPtr conv_function_chroma; // 32bit float YUV chroma
   BitDepthConvFuncPtr conv_function_a;
+  FloydConvFuncPtr floyd_function; // dither=1 and 2
+  FloydConvFuncPtr floyd_function_chroma;
   int target_bitdepth;
   int dither_mode;
   int dither_bitdepth;
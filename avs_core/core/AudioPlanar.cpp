@@ -0,0 +1,122 @@
+// Avisynth+
+// https://avs-plus.net
+//
+// This file is part of Avisynth+ which is released under GPL2+ with exception.
+
+// Planar (non-interleaved) audio requests and the interleaved fallback
+
+#include "AudioPlanar.h"
+#include <avs/config.h>
+#ifdef INTEL_INTRINSICS
+#include "intel/audio_sse.h"
+#endif
+#include <cstdint>
+
+
+bool HasAudioPlanar(const PClip& clip)
+{
+  return (clip->GetVersion() >= 5) && (clip->SetCacheHints(CACHE_GET_AUDIO_PLANAR_REQ, 0) == CACHE_GET_AUDIO_PLANAR_ANS);
+}
+
+void GetAudioPlanar(const PClip& clip, void** bufs, int64_t start, int64_t count, IScriptEnvironment* env)
+{
+  if (count <= 0)
+    return;
+  // a plugin forwarding SetCacheHints to a core child answers too: only the cast tells, fall back when it fails
+  IAudioPlanar* planar = HasAudioPlanar(clip) ? dynamic_cast<IAudioPlanar*>(clip.operator->()) : nullptr;
+  if (planar)
+    planar->GetAudioPlanar(bufs, start, count, env);
+  else
+    GetAudioPlanarFromInterleaved(clip.operator->(), bufs, start, count, env);
+}
+
+void GetAudioPlanarFromInterleaved(IClip* clip, void** bufs, int64_t start, int64_t count, IScriptEnvironment* env)
+{
+  if (count <= 0)
+    return;
+  const VideoInfo& vi = clip->GetVideoInfo();
+  void* buf = env->Allocate((size_t)vi.BytesFromAudioSamples(count), 16, AVS_POOLED_ALLOC);
+  if (!buf)
+    env->ThrowError("GetAudio: Could not reserve memory.");
+  clip->GetAudio(buf, start, count, env);
+  DeinterleaveAudio(buf, bufs, vi.AudioChannels(), vi.BytesPerChannelSample(), (int)count, env);
+  env->Free(buf);
+}
+
+struct sample24_t { uint8_t b[3]; };
+
+template<typename sample_t>
+static void deinterleave_c(const void* _src, void** bufs, int channels, int count)
+{
+  const sample_t* src = reinterpret_cast<const sample_t*>(_src);
+  for (int c = 0; c < channels; c++) {
+    sample_t* dst = reinterpret_cast<sample_t*>(bufs[c]);
+    if (!dst)
+      continue;
+    const sample_t* s = src + c;
+    for (int i = 0; i < count; i++) {
+      dst[i] = *s;
+      s += channels;
+    }
+  }
+}
+
+template<typename sample_t>
+static void interleave_c(const void* const* bufs, void* _dst, int channels, int count)
+{
+  sample_t* dst = reinterpret_cast<sample_t*>(_dst);
+  for (int c = 0; c < channels; c++) {
+    const sample_t* src = reinterpret_cast<const sample_t*>(bufs[c]);
+    sample_t* d = dst + c;
+    for (int i = 0; i < count; i++) {
+      *d = src[i];
+      d += channels;
+    }
+  }
+}
+
+void DeinterleaveAudio(const void* buf, void** bufs, int channels, int bpcs, int count, IScriptEnvironment* env)
+{
+#ifdef INTEL_INTRINSICS
+  if (channels == 2 && (bpcs == 2 || bpcs == 4) && (env->GetCPUFlags() & CPUF_SSE2)) {
+    for (int c = 0; c < 2; c++) {
+      if (!bufs[c])
+        continue;
+      if (bpcs == 2)
+        extract_stereo_channel_16_sse2((const int16_t*)buf, (int16_t*)bufs[c], c, count);
+      else
+        extract_stereo_channel_32_sse2((const int32_t*)buf, (int32_t*)bufs[c], c, count);
+    }
+    return;
+  }
+#else
+  AVS_UNUSED(env);
+#endif
+  switch (bpcs) {
+  case 1: deinterleave_c<uint8_t>(buf, bufs, channels, count); break;
+  case 2: deinterleave_c<uint16_t>(buf, bufs, channels, count); break;
+  case 3: deinterleave_c<sample24_t>(buf, bufs, channels, count); break;
+  case 4: deinterleave_c<uint32_t>(buf, bufs, channels, count); break;
+  }
+}
+
+void InterleaveAudio(const void* const* bufs, void* buf, int channels, int bpcs, int count, IScriptEnvironment* env)
+{
+#ifdef INTEL_INTRINSICS
+  if (channels == 2 && (bpcs == 2 || bpcs == 4) && (env->GetCPUFlags() & CPUF_SSE2)) {
+    if (bpcs == 2)
+      interleave_mono2_16_sse2((const int16_t*)bufs[0], (const int16_t*)bufs[1], (int16_t*)buf, count);
+    else
+      interleave_mono2_32_sse2((const int32_t*)bufs[0], (const int32_t*)bufs[1], (int32_t*)buf, count);
+    return;
+  }
+#else
+  AVS_UNUSED(env);
+#endif
+  switch (bpcs) {
+  case 1: interleave_c<uint8_t>(bufs, buf, channels, count); break;
+  case 2: interleave_c<uint16_t>(bufs, buf, channels, count); break;
+  case 3: interleave_c<sample24_t>(bufs, buf, channels, count); break;
+  case 4: interleave_c<uint32_t>(bufs, buf, channels, count); break;
+  }
+}
@@ -0,0 +1,43 @@
+// Avisynth+
+// https://avs-plus.net
+//
+// This file is part of Avisynth+ which is released under GPL2+ with exception.
+
+// IAudioPlanar and the planar audio request helpers
+
+#ifndef _AVS_AUDIOPLANAR_H
+#define _AVS_AUDIOPLANAR_H
+
+#include <avisynth.h>
+
+// Non-interleaved (planar) audio path, core-internal.
+//
+// A filter which can deliver its audio channel by channel implements IAudioPlanar
+// and answers CACHE_GET_AUDIO_PLANAR_ANS to CACHE_GET_AUDIO_PLANAR_REQ.
+// bufs[c] receives 'count' samples of channel c, vi.BytesPerChannelSample() each.
+// A nullptr in bufs[c] means channel c is not needed by the caller, the filter may skip it.
+// Cache, CacheGuard, MTGuard and FilterGraphNode pass planar requests through.
+class IAudioPlanar
+{
+public:
+  virtual void __stdcall GetAudioPlanar(void** bufs, int64_t start, int64_t count, IScriptEnvironment* env) = 0;
+
+protected:
+  ~IAudioPlanar() {}
+};
+
+// true if clip answers the planar audio negotiation
+bool HasAudioPlanar(const PClip& clip);
+
+// Planar audio from any clip. Clips without native support are read by GetAudio
+// and deinterleaved (the adapter at the boundary of the planar chain).
+void GetAudioPlanar(const PClip& clip, void** bufs, int64_t start, int64_t count, IScriptEnvironment* env);
+
+// The adapter alone: GetAudio, then deinterleave into the non-null bufs
+void GetAudioPlanarFromInterleaved(IClip* clip, void** bufs, int64_t start, int64_t count, IScriptEnvironment* env);
+
+// Conversion helpers, bpcs: bytes per channel sample. nullptr in bufs is skipped by DeinterleaveAudio.
+void DeinterleaveAudio(const void* buf, void** bufs, int channels, int bpcs, int count, IScriptEnvironment* env);
+void InterleaveAudio(const void* const* bufs, void* buf, int channels, int bpcs, int count, IScriptEnvironment* env);
+
+#endif  // _AVS_AUDIOPLANAR_H
@@ -7,8 +7,10 @@
 #include <map>
 #include <mutex>
 #include <sstream>
+#include <cstdlib>
 #include "LruCache.h"
 #include "ThreadPool.h"
+#include "NumaTopology.h"
 #include "AVSMap.h"
 #include "parser/scriptparser.h"
 
@@ -18,6 +20,12 @@
 
 #define ENABLE_CUDA_COMPUTE_STREAM 0
 
+#if defined(AVS_WINDOWS)
+#include <avs/win.h>
+#elif defined(AVS_LINUX)
+#include <sys/mman.h>
+#endif
+
 #ifdef ENABLE_CUDA
 
 #include <cuda_runtime_api.h>
@@ -141,10 +149,144 @@ size_t GetFrameTail(const PVideoFrame& vf)
 }
 
 class CPUDevice : public Device {
+  static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+  // 0: off, 1: transparent huge pages, 2: explicit huge pages, falling back to transparent ones.
+  // Default from the AVS_HUGEPAGES environment variable, SetHugePages/DEV_HUGE_PAGES changes it.
+  std::atomic<int> huge_pages;
+  struct HugeBlock {
+    size_t mapped;   // requested size rounded up to whole pages
+    size_t rounding; // mapped - counted, added to memory_used here
+    bool huge;       // backed by huge pages
+  };
+  std::mutex huge_mutex;
+  std::map<BYTE*, HugeBlock> huge_blocks;
+  std::atomic<int> huge_block_count;
+
+  // Buffers of at least one huge page are mapped directly with 2 MB alignment.
+  // Returns nullptr when it is not possible, the caller falls back to the heap.
+  // counted: the part of size the caller adds to memory_used (the frame size).
+  BYTE* AllocateHugePages(size_t size, size_t counted)
+  {
+    const int mode = huge_pages;
+    if (size < HUGE_PAGE_SIZE)
+      return nullptr;
+    size_t mapped = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    BYTE* data = nullptr;
+    bool huge = false;
+#if defined(AVS_LINUX)
+#ifdef MAP_HUGETLB
+    if (mode == 2) {
+      // needs pages reserved in /proc/sys/vm/nr_hugepages
+      void* p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (p != MAP_FAILED) {
+        data = (BYTE*)p;
+        huge = true;
+      }
+    }
+#endif
+    if (data == nullptr) {
+      // transparent: 2 MB aligned anonymous mapping, over-allocated by one page to be able to align it
+      void* p = mmap(nullptr, mapped + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p == MAP_FAILED)
+        return nullptr;
+      BYTE* raw = (BYTE*)p;
+      data = (BYTE*)(((uintptr_t)raw + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+      if (data > raw)
+        munmap(raw, data - raw);
+      if (raw + HUGE_PAGE_SIZE > data)
+        munmap(data + mapped, (raw + HUGE_PAGE_SIZE) - data);
+#ifdef MADV_HUGEPAGE
+      huge = madvise(data, mapped, MADV_HUGEPAGE) == 0;
+#endif
+    }
+    NumaTopology::Get().PlaceMemory(data, mapped, NumaTopology::Get().CurrentThreadNode());
+#elif defined(AVS_WINDOWS)
+    // No transparent huge pages on Windows, only large pages, which need the
+    // "Lock pages in memory" user right
+    if (mode != 2)
+      return nullptr;
+    static const size_t large_page = EnableLargePages();
+    if (large_page == 0)
+      return nullptr;
+    mapped = (size + large_page - 1) & ~(large_page - 1);
+    data = (BYTE*)VirtualAlloc(nullptr, mapped, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (data == nullptr)
+      return nullptr;
+    huge = true;
+#else
+    return nullptr;
+#endif
+    {
+      std::lock_guard<std::mutex> lock(huge_mutex);
+      huge_blocks[data] = HugeBlock{ mapped, mapped - counted, huge };
+    }
+    ++huge_block_count;
+    // the whole mapping counts against SetMemoryMax
+    memory_used += mapped - counted;
+    if (huge)
+      memory_huge_pages += mapped;
+    return data;
+  }
+
+  // true if ptr was mapped by AllocateHugePages and is released now
+  bool FreeHugePages(BYTE* ptr)
+  {
+    if (huge_block_count == 0)
+      return false;
+    HugeBlock block;
+    {
+      std::lock_guard<std::mutex> lock(huge_mutex);
+      auto it = huge_blocks.find(ptr);
+      if (it == huge_blocks.end())
+        return false;
+      block = it->second;
+      huge_blocks.erase(it);
+    }
+    --huge_block_count;
+    memory_used -= block.rounding;
+    if (block.huge)
+      memory_huge_pages -= block.mapped;
+#if defined(AVS_LINUX)
+    munmap(ptr, block.mapped);
+#elif defined(AVS_WINDOWS)
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#endif
+    return true;
+  }
+
+#if defined(AVS_WINDOWS)
+  // SeLockMemoryPrivilege for the process, returns the large page size or 0
+  static size_t EnableLargePages()
+  {
+    typedef SIZE_T(WINAPI* LPFN_GLPM)(void);
+    LPFN_GLPM get_large_page_minimum = (LPFN_GLPM)GetProcAddress(GetModuleHandle(TEXT("kernel32")), "GetLargePageMinimum");
+    if (get_large_page_minimum == nullptr)
+      return 0;
+    HANDLE token;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+      return 0;
+    TOKEN_PRIVILEGES tp = {};
+    tp.PrivilegeCount = 1;
+    tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    const bool ok = LookupPrivilegeValue(nullptr, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid)
+      && AdjustTokenPrivileges(token, FALSE, &tp, 0, nullptr, nullptr)
+      && GetLastError() == ERROR_SUCCESS; // ERROR_NOT_ALL_ASSIGNED: the user does not have the right
+    CloseHandle(token);
+    return ok ? get_large_page_minimum() : 0;
+  }
+#endif
+
 public:
   CPUDevice(InternalEnvironment* env)
-    : Device(DEV_TYPE_CPU, 0, 0, env)
-  { }
+    : Device(DEV_TYPE_CPU, 0, 0, env),
+    huge_pages(0),
+    huge_block_count(0)
+  {
+    const char* env_huge = getenv("AVS_HUGEPAGES");
+    if (env_huge != nullptr)
+      huge_pages = clamp(atoi(env_huge), 0, 2);
+  }
 
   virtual int SetMemoryMax(int mem)
   {
@@ -155,9 +297,11 @@ public:
 
   virtual BYTE* Allocate(size_t size, int margin)
   {
+    const size_t counted = size;
     size += margin;
+    BYTE* huge_data = huge_pages > 0 ? AllocateHugePages(size + 16, counted) : nullptr;
 #ifdef _DEBUG
-    BYTE* data = new BYTE[size + 16];
+    BYTE* data = huge_data != nullptr ? huge_data : new BYTE[size + 16];
     int *pInt = (int *)(data + size);
     pInt[0] = 0xDEADBEEF;
     pInt[1] = 0xDEADBEEF;
@@ -177,13 +321,18 @@ public:
     }
     return data;
 #else
-    return new BYTE[size + 16];
+    if (huge_data != nullptr)
+      return huge_data;
+    BYTE* data = new BYTE[size + 16];
+    // buffers are reused by threads of the same node (see GetFrameFromRegistry)
+    NumaTopology::Get().PlaceMemory(data, size, NumaTopology::Get().CurrentThreadNode());
+    return data;
 #endif
   }
 
   virtual void Free(BYTE* ptr)
   {
-    if (ptr != nullptr) {
+    if (ptr != nullptr && !FreeHugePages(ptr)) {
       delete[] ptr;
     }
   }
@@ -213,7 +362,10 @@ public:
 
   virtual void SetDeviceOpt(DeviceOpt opt, int val, InternalEnvironment* env)
   {
-    // do nothing
+    if (opt == DEV_HUGE_PAGES) {
+      // applies to new buffers, existing ones are freed the way they were allocated
+      huge_pages = clamp(val, 0, 2);
+    }
   }
 
   virtual void GetAlignmentRequirement(int* memoryAlignment, int* pitchAlignment)
@@ -302,6 +454,9 @@ public:
     if (opt == DEV_FREE_THRESHOLD) {
       free_thresh = val;
     }
+    if (opt == DEV_HUGE_PAGES) {
+      CPUDevice::SetDeviceOpt(opt, val, env);
+    }
   }
 
   virtual void GetAlignmentRequirement(int* memoryAlignment, int* pitchAlignment)
@@ -1211,8 +1366,9 @@ public:
     }
 
     if (downstreamDevice == upstreamDevice) {
-      // shortcut
-      return child->GetFrame(n, env);
+      // no transfer; with num_prefetch >= 2 the next frame is still fetched ahead
+      // by the prefetcher thread, a pipelining boundary without copy
+      return prefetcher.GetFrame(n, env);
     }
 
     // Get frame via transfer engine
@@ -24,6 +24,7 @@ public:
 
     uint64_t memory_max;
     std::atomic<uint64_t> memory_used;
+    std::atomic<uint64_t> memory_huge_pages; // part of the allocated buffers backed by huge pages
 
     int  free_thresh;
 
@@ -34,6 +35,7 @@ public:
       device_index(index),
       memory_max(0),
       memory_used(0),
+      memory_huge_pages(0),
       free_thresh(0)
     { }
 
@@ -2,6 +2,7 @@
 #define _AVS_FILTER_GRAPH_H
 
 #include "internal.h"
+#include "AudioPlanar.h"
 #include <vector>
 #include <map>
 #include <memory>
@@ -48,7 +49,7 @@ private:
   void Release() { if (e) e->Release(); }
 };
 
-class FilterGraphNode : public IClip
+class FilterGraphNode : public IClip, public IAudioPlanar
 {
 	IScriptEnvironment* Env;
   PClip child;
@@ -73,6 +74,10 @@ public:
   {
     return child->GetAudio(buf, start, count, env);
   }
+  virtual void __stdcall GetAudioPlanar(void** bufs, int64_t start, int64_t count, IScriptEnvironment* env)
+  {
+    ::GetAudioPlanar(child, bufs, start, count, env);
+  }
   virtual int __stdcall SetCacheHints(int cachehints, int frame_range)
   {
     return child->SetCacheHints(cachehints, frame_range);
@@ -46,6 +46,7 @@ enum CacheMode {
 enum DeviceOpt: int {
     DEV_CUDA_PINNED_HOST, // allocate CPU frame with CUDA pinned host memory
     DEV_FREE_THRESHOLD,   // free request count threshold to free frame
+    DEV_HUGE_PAGES,       // CPU frame buffers in 2 MB pages: 0 off, 1 transparent, 2 explicit (hugetlb / large pages)
 };
 
 class OneTimeLogTicket
@@ -63,6 +64,7 @@ public:
 
 class Device;
 class ThreadPool;
+class PerformanceCounters;
 class ConcurrentVarStringFrame;
 class FilterGraphNode;
 
@@ -77,10 +79,29 @@ public:
 	}
 };
 
+// Clears the counter for the scope and restores it after.
+// Functions rendering a whole clip from apply (RenderToFile, SharedMemoryServer) run
+// under the suppressThreadCount of Invoke, this lets Prefetch use its threads again.
+// Thread pool workers are runtime and never wait for the invoke_mutex held meanwhile.
+class ScopedCounterReset {
+	int& counter;
+	const int saved;
+public:
+	ScopedCounterReset(int& counter) : counter(counter), saved(counter) {
+		counter = 0;
+	}
+	~ScopedCounterReset() {
+		counter = saved;
+	}
+};
+
 // Interface fransformation hack
 class InternalEnvironment; // forward
 InternalEnvironment* GetAndRevealCamouflagedEnv(IScriptEnvironment* env);
 
+// VideoFrame::Release: the last frame of a NewVideoFrameFromBuffer buffer is gone
+void ExternalFrameBufferReleased(VideoFrameBuffer* vfb);
+
 // Strictly for Avisynth core only.
 // Neither host applications nor plugins should use
 // these interfaces.
@@ -96,6 +117,7 @@ public:
 
   typedef IScriptEnvironment::NotFound NotFound;
   typedef IScriptEnvironment::ApplyFunc ApplyFunc;
+  typedef IScriptEnvironment::ExternalReleaseFunc ExternalReleaseFunc;
 
   // IScriptEnvironment
   virtual int __stdcall GetCPUFlags() = 0;
@@ -202,6 +224,10 @@ public:
   virtual int __stdcall propGetDataTypeHint(const AVSMap* map, const char* key, int index, int* error) = 0; /* returns AVSPropDataTypeHint */
   virtual int __stdcall propSetDataH(AVSMap* map, const char* key, const char* d, int length, int type, int append) = 0;
 
+  // V11.2
+  virtual PVideoFrame __stdcall NewVideoFrameFromBuffer(const VideoInfo& vi, BYTE* const* planes, const int* pitches,
+    ExternalReleaseFunc release, void* user_data, bool writable) = 0;
+
   // IScriptEnvironment2
   virtual bool __stdcall LoadPlugin(const char* filePath, bool throwOnError, AVSValue *result) = 0;
   virtual void __stdcall AddAutoloadDir(const char* dirPath, bool toFront) = 0;
@@ -300,7 +326,7 @@ public:
   // Nekopanda: support multiple prefetcher //
   // to allow thread to submit with their env
   virtual void __stdcall ParallelJob(ThreadWorkerFuncPtr jobFunc, void* jobData, IJobCompletion* completion, InternalEnvironment *env) = 0;
-  virtual ThreadPool* __stdcall NewThreadPool(size_t nThreads) = 0;
+  virtual ThreadPool* __stdcall NewThreadPool(size_t nThreads, int numa_node = -1) = 0;
   virtual void __stdcall AddRef() = 0;
   virtual void __stdcall Release() = 0;
 
@@ -310,6 +336,7 @@ public:
   virtual void __stdcall SetCacheMode(CacheMode mode) = 0;
   virtual CacheMode __stdcall GetCacheMode() = 0;
 	virtual bool& __stdcall GetSupressCaching() = 0;
+  virtual PerformanceCounters& __stdcall GetPerformanceCounters() = 0;
 
   virtual void __stdcall SetDeviceOpt(DeviceOpt mode, int val) = 0;
 
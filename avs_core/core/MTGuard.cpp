@@ -37,8 +37,15 @@
 #include "internal.h"
 #include "FilterConstructor.h"
 #include "InternalEnvironment.h"
+#include "ThreadPool.h"
 #include <cassert>
 #include <mutex>
+#include <map>
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <condition_variable>
+#include <algorithm>
 
 #ifdef X86_32
 #include <mmintrin.h>
@@ -49,6 +56,87 @@ struct MTGuardChildFilter {
   std::mutex mutex;
 };
 
+// A frame request waiting for the serialized filter, lives on the stack of the requesting thread
+struct MTGuardSerialRequest {
+  int n;
+  std::promise<PVideoFrame> promise;
+};
+
+// MT_SERIALIZED filters in MT mode: instead of worker threads sleeping on the filter mutex
+// and entering in whatever order the OS wakes them, requests are queued and a single
+// dedicated thread serves them in frame order, continuing from the last served frame.
+// Sequential-only source decoders thus see increasing frame numbers instead of
+// seeking back and forth between the prefetched frames.
+struct MTGuardSerialQueue {
+  std::mutex mutex;
+  std::multimap<int, MTGuardSerialRequest*> pending; // by frame number
+  int last_frame;
+  size_t thread_id;
+  std::unique_ptr<ThreadPool> executor;
+
+  MTGuardSerialQueue() : last_frame(-1), thread_id(0) {}
+};
+
+// MT_MULTI_INSTANCE: a thread borrows an idle instance for the duration of one call,
+// preferably the one it used last. Extra instances are made on demand, up to nThreads:
+// a thread finding none idle records the demand and waits for a busy one. Filter
+// constructors may Invoke and register caches and guards, they must not run from worker
+// threads in the middle of GetFrame, so the instances are created (and destroyed) by
+// ServiceInstances, called on the host thread when it requests its next frame.
+// Instances idle for longer than MULTI_INSTANCE_REAP_SECONDS are released there as well;
+// a filter reached by two threads at a time keeps about two instances, not Prefetch(N)
+// ones, and after a pause the instances are made again as the demand returns.
+// The first instance (the one created by the script) is kept for the lifetime of the guard.
+static constexpr int MULTI_INSTANCE_REAP_SECONDS = 10;
+
+struct MTGuardInstance {
+  PClip filter;
+  size_t last_thread;
+  std::chrono::steady_clock::time_point last_used;
+  bool pinned;
+};
+
+struct MTGuardInstancePool {
+  std::mutex mutex;
+  std::condition_variable idle_cond;
+  std::vector<std::unique_ptr<MTGuardInstance>> idle; // most recently released at the back
+  size_t count;     // instances alive, busy or idle
+  size_t wanted;    // instances to create in ServiceInstances, count + wanted <= nThreads
+  std::chrono::steady_clock::time_point next_reap;
+
+  MTGuardInstancePool() : count(0), wanted(0), next_reap(std::chrono::steady_clock::now()) {}
+
+  // moves the instances idle for too long to 'reaped', to be destroyed outside the lock
+  void Reap(std::chrono::steady_clock::time_point now, std::vector<std::unique_ptr<MTGuardInstance>>& reaped)
+  {
+    for (auto it = idle.begin(); it != idle.end(); ) {
+      if (!(*it)->pinned && now - (*it)->last_used > std::chrono::seconds(MULTI_INSTANCE_REAP_SECONDS)) {
+        reaped.push_back(std::move(*it));
+        it = idle.erase(it);
+        --count;
+      }
+      else
+        ++it;
+    }
+  }
+};
+
+class MTGuardInstanceLease
+{
+  MTGuard* guard;
+  size_t thread_id;
+public:
+  MTGuardInstance* const instance;
+
+  MTGuardInstanceLease(MTGuard* _guard, size_t _thread_id) :
+    guard(_guard), thread_id(_thread_id), instance(_guard->AcquireInstance(_thread_id)) {}
+  ~MTGuardInstanceLease() { guard->ReleaseInstance(instance, thread_id); }
+};
+
+// Executor thread ids are kept apart from the Prefetch thread ids (1..nTotalThreads-1),
+// they are used only for mapping MT_MULTI_INSTANCE instances.
+static std::atomic<size_t> SerialExecutorThreadId(1 << 16);
+
 MTGuard::MTGuard(PClip firstChild, MtMode mtmode, std::unique_ptr<const FilterConstructor>&& funcCtor, InternalEnvironment* env) :
   Env(env),
   nThreads(1),
@@ -64,6 +152,12 @@ MTGuard::MTGuard(PClip firstChild, MtMode mtmode, std::unique_ptr<const FilterCo
   ChildFilters[0].filter = firstChild;
   vi = ChildFilters[0].filter->GetVideoInfo();
 
+  if (MTMode == MT_MULTI_INSTANCE) {
+    InstancePool = std::unique_ptr<MTGuardInstancePool>(new MTGuardInstancePool());
+    InstancePool->idle.emplace_back(new MTGuardInstance{ firstChild, 0, std::chrono::steady_clock::now(), true });
+    InstancePool->count = 1;
+  }
+
   Env->ManageCache(MC_RegisterMTGuard, reinterpret_cast<void*>(this));
 }
 
@@ -93,29 +187,16 @@ void MTGuard::EnableMT(size_t nThreads)
     }
     case MT_MULTI_INSTANCE:
     {
-      // creates the extra filter instances needed for the actual thread count
-#ifdef OLD_PREFETCH
-      if (this->nThreads < nThreads) {
-#else
-      // set only when unset
-      if (!this->mt_enabled) {
-#endif
-        auto newchilds = std::unique_ptr<MTGuardChildFilter[]>(new MTGuardChildFilter[nThreads]);
-        // copy existing
-        for (size_t i = 0; i < this->nThreads; ++i) {
-          newchilds[i].filter = ChildFilters[i].filter;
-        }
-        // create the rest
-        for (size_t i = this->nThreads; i < nThreads; ++i) {
-          newchilds[i].filter = FilterCtor->InstantiateFilter().AsClip();
-        }
-        ChildFilters = std::move(newchilds);
-      }
+      // extra filter instances up to nThreads (set below) are made on demand, see ServiceInstances
       break;
     }
     case MT_SERIALIZED:
     {
-      // Nothing to do
+      if (!SerialQueue) {
+        SerialQueue = std::unique_ptr<MTGuardSerialQueue>(new MTGuardSerialQueue());
+        SerialQueue->thread_id = SerialExecutorThreadId++;
+        SerialQueue->executor = std::unique_ptr<ThreadPool>(new ThreadPool(1, SerialQueue->thread_id, static_cast<InternalEnvironment*>(Env)));
+      }
       break;
     }
     default:
@@ -165,32 +246,21 @@ PVideoFrame __stdcall MTGuard::GetFrame(int n, IScriptEnvironment* env_)
   }
   case MT_MULTI_INSTANCE:
   {
-    // When called from thread pool then thread IDs are one-to-one mapped to ChildFilters array.
-    // 'binary and' mask (old method) or 'modulo' method ensures that no over-addressing can happen.
-    // The number of filter instances are created in EnableMT as such.
-    // Thread pool thread IDs are consecutive numbers, starting with 1.
-    // Prefetch threads are consecutive numbers, starting with 0.
-    // Here we cannot differentiate from where was the filter called.
-    // Note: 
-    //   when called from Prefetcher (which has 'num_of_logical_processors' threads instead of nThreads)
-    //   the mapping is not ideal. It can be less or more than the actual instance count.
-    //   E.g. when mapping a thread on a CPU with 8 logical cores 
-    //   to a instance count of 3 (nThread=3) the mapping is uneven (modulo example): [0,3,6]->[0] [1,4,7]->[1] [2,5]->[2]
-    // Resolution: do not use OLD_PREFETCH source part (kept just for knowledge)
-#ifdef OLD_PREFETCH
-    auto myThreadID = IEnv->GetThreadId();
-    assert((nThreads & (nThreads - 1)) == 0); // must be 2^n
-    size_t clipIndex = myThreadID & (nThreads - 1);
-#else
-    size_t clipIndex = IEnv->GetThreadId() % nThreads;
-#endif
-    auto& child = ChildFilters[clipIndex];
-    std::lock_guard<std::mutex> lock(child.mutex);
-    frame = child.filter->GetFrame(n, env);
+    // Formerly thread IDs were mapped to a fixed instance (ThreadId % nThreads), which was uneven
+    // when the calling pool had a different thread count. Now any idle instance is borrowed,
+    // preferably the one this thread used last.
+    MTGuardInstanceLease lease(this, IEnv->GetThreadId());
+    frame = lease.instance->filter->GetFrame(n, env);
     break;
   }
   case MT_SERIALIZED:
   {
+    // no executor hand-off while an Invoke is running (it may hold locks the executor needs),
+    // or when the executor itself gets here again
+    if (SerialQueue && IEnv->GetSuppressThreadCount() == 0 && (size_t)IEnv->GetThreadId() != SerialQueue->thread_id) {
+      frame = GetFrameSerialized(n, IEnv);
+      break;
+    }
     std::lock_guard<std::mutex> lock(ChildFilters[0].mutex);
     /*
     // Debug lines left here intentionally: allow maximum of 4000ms for obtaining the lock.
@@ -233,6 +303,147 @@ PVideoFrame __stdcall MTGuard::GetFrame(int n, IScriptEnvironment* env_)
   return frame;
 }
 
+MTGuardInstance* MTGuard::AcquireInstance(size_t thread_id)
+{
+  MTGuardInstancePool* pool = InstancePool.get();
+  std::unique_lock<std::mutex> lock(pool->mutex);
+  if (pool->idle.empty() && pool->count + pool->wanted < nThreads) {
+    // no instance is created on a worker thread: ask for one, the host thread makes it
+    // in ServiceInstances. Meanwhile wait for a busy one.
+    ++pool->wanted;
+  }
+  pool->idle_cond.wait(lock, [pool] { return !pool->idle.empty(); });
+
+  // prefer the instance this thread released last: its buffers are likely still cache-hot
+  auto it = std::find_if(pool->idle.rbegin(), pool->idle.rend(),
+    [thread_id](const std::unique_ptr<MTGuardInstance>& inst) { return inst->last_thread == thread_id; });
+  auto pos = (it != pool->idle.rend()) ? std::next(it).base() : std::prev(pool->idle.end());
+  MTGuardInstance* instance = pos->release();
+  pool->idle.erase(pos);
+  lock.unlock();
+  return instance;
+}
+
+void MTGuard::ReleaseInstance(MTGuardInstance* instance, size_t thread_id)
+{
+  MTGuardInstancePool* pool = InstancePool.get();
+  {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    instance->last_thread = thread_id;
+    instance->last_used = std::chrono::steady_clock::now();
+    pool->idle.emplace_back(instance);
+  }
+  pool->idle_cond.notify_one();
+}
+
+void MTGuard::ServiceInstances()
+{
+  if (!InstancePool || nThreads <= 1)
+    return;
+  MTGuardInstancePool* pool = InstancePool.get();
+  std::vector<std::unique_ptr<MTGuardInstance>> reaped; // destroyed outside of the pool lock
+  size_t wanted;
+  {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    wanted = pool->wanted;
+    const auto now = std::chrono::steady_clock::now();
+    if (wanted == 0 && now >= pool->next_reap) {
+      pool->Reap(now, reaped);
+      pool->next_reap = now + std::chrono::seconds(1);
+    }
+  }
+  reaped.clear();
+  if (wanted == 0)
+    return;
+
+  const auto now = std::chrono::steady_clock::now();
+  std::vector<std::unique_ptr<MTGuardInstance>> created;
+  try {
+    for (size_t i = 0; i < wanted; ++i)
+      created.emplace_back(new MTGuardInstance{ FilterCtor->InstantiateFilter().AsClip(), 0, now, false });
+  }
+  catch (...) {
+    // keep the ones made so far, the waiting threads still have the existing instances
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    pool->wanted = 0;
+    for (auto& inst : created)
+      pool->idle.insert(pool->idle.begin(), std::move(inst));
+    pool->count += created.size();
+    pool->idle_cond.notify_all();
+    throw;
+  }
+  {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    pool->wanted -= wanted;
+    // the released instances stay at the back, threads prefer them
+    pool->idle.insert(pool->idle.begin(),
+      std::make_move_iterator(created.begin()), std::make_move_iterator(created.end()));
+    pool->count += created.size();
+  }
+  pool->idle_cond.notify_all();
+}
+
+PVideoFrame MTGuard::GetFrameSerialized(int n, InternalEnvironment* env)
+{
+  MTGuardSerialRequest request;
+  request.n = n;
+  std::future<PVideoFrame> result = request.promise.get_future();
+
+  std::multimap<int, MTGuardSerialRequest*>::iterator it;
+  {
+    std::lock_guard<std::mutex> lock(SerialQueue->mutex);
+    it = SerialQueue->pending.emplace(n, &request);
+  }
+
+  // one job per request, the job itself picks the request to serve
+  try {
+    SerialQueue->executor->QueueJob(SerialWorker, this, env, nullptr);
+  }
+  catch (...) {
+    std::lock_guard<std::mutex> lock(SerialQueue->mutex);
+    SerialQueue->pending.erase(it);
+    throw;
+  }
+
+  return result.get(); // rethrows the exception of the filter
+}
+
+AVSValue MTGuard::SerialWorker(IScriptEnvironment2* env, void* data)
+{
+  MTGuard* guard = static_cast<MTGuard*>(data);
+  MTGuardSerialQueue* queue = guard->SerialQueue.get();
+
+  MTGuardSerialRequest* request;
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    assert(!queue->pending.empty());
+    // continue forward from the last served frame, wrap around to the lowest one
+    auto it = queue->pending.lower_bound(queue->last_frame);
+    if (it == queue->pending.end())
+      it = queue->pending.begin();
+    request = it->second;
+    queue->pending.erase(it);
+    queue->last_frame = request->n;
+  }
+
+  try {
+    PVideoFrame frame;
+    {
+      std::lock_guard<std::mutex> lock(guard->ChildFilters[0].mutex);
+      frame = guard->ChildFilters[0].filter->GetFrame(request->n, env);
+#ifdef X86_32
+      _mm_empty();
+#endif
+    }
+    // the requester may return and release the guard from here on
+    request->promise.set_value(frame);
+  }
+  catch (...) {
+    request->promise.set_exception(std::current_exception());
+  }
+  return AVSValue();
+}
+
 void __stdcall MTGuard::GetAudio(void* buf, int64_t start, int64_t count, IScriptEnvironment* env_)
 {
   assert(nThreads > 0);
@@ -257,16 +468,8 @@ void __stdcall MTGuard::GetAudio(void* buf, int64_t start, int64_t count, IScrip
     }
   case MT_MULTI_INSTANCE:
     {
-#ifdef OLD_PREFETCH
-      auto myThreadID = envI->GetThreadId();
-      assert((nThreads & (nThreads - 1)) == 0); // must be 2^n
-      size_t clipIndex = myThreadID & (nThreads - 1);
-#else
-      size_t clipIndex = IEnv->GetThreadId() % nThreads;
-#endif
-      auto& child = ChildFilters[clipIndex];
-      std::lock_guard<std::mutex> lock(child.mutex);
-      child.filter->GetAudio(buf, start, count, env);
+      MTGuardInstanceLease lease(this, IEnv->GetThreadId());
+      lease.instance->filter->GetAudio(buf, start, count, env);
       break;
     }
   case MT_SERIALIZED:
@@ -288,6 +491,45 @@ void __stdcall MTGuard::GetAudio(void* buf, int64_t start, int64_t count, IScrip
 #endif
 }
 
+void __stdcall MTGuard::GetAudioPlanar(void** bufs, int64_t start, int64_t count, IScriptEnvironment* env_)
+{
+  assert(nThreads > 0);
+
+  InternalEnvironment* IEnv = GetAndRevealCamouflagedEnv(env_);
+  IScriptEnvironment* env = static_cast<IScriptEnvironment*>(IEnv);
+
+  switch (MTMode)
+  {
+  case MT_NICE_FILTER:
+    {
+      ::GetAudioPlanar(ChildFilters[0].filter, bufs, start, count, env);
+      break;
+    }
+  case MT_MULTI_INSTANCE:
+    {
+      MTGuardInstanceLease lease(this, IEnv->GetThreadId());
+      ::GetAudioPlanar(lease.instance->filter, bufs, start, count, env);
+      break;
+    }
+  case MT_SERIALIZED:
+    {
+      std::lock_guard<std::mutex> lock(ChildFilters[0].mutex);
+      ::GetAudioPlanar(ChildFilters[0].filter, bufs, start, count, env);
+      break;
+    }
+  default:
+    {
+      assert(0);
+      env->ThrowError("Invalid Avisynth logic.");
+      break;
+    }
+  } // switch
+
+#ifdef X86_32
+  _mm_empty();
+#endif
+}
+
 const VideoInfo& __stdcall MTGuard::GetVideoInfo()
 {
   return vi;
@@ -315,6 +557,8 @@ int __stdcall MTGuard::SetCacheHints(int cachehints, int frame_range)
   if (CACHE_GET_DEV_TYPE == cachehints || CACHE_GET_CHILD_DEV_TYPE == cachehints) {
     return (ChildFilters[0].filter->GetVersion() >= 5) ? ChildFilters[0].filter->SetCacheHints(cachehints, 0) : 0;
   }
+  if (CACHE_GET_AUDIO_PLANAR_REQ == cachehints)
+    return HasAudioPlanar(ChildFilters[0].filter) ? CACHE_GET_AUDIO_PLANAR_ANS : 0;
 
   return 0;
 }
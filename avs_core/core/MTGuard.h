@@ -4,6 +4,7 @@
 // #define OLD_PREFETCH
 
 #include "internal.h"
+#include "AudioPlanar.h"
 #include <vector>
 #include <memory>
 #include <mutex>
@@ -12,12 +13,19 @@ class InternalEnvironment;
 
 class FilterConstructor;
 struct MTGuardChildFilter;
-class MTGuard : public IClip
+struct MTGuardSerialQueue;
+struct MTGuardInstancePool;
+struct MTGuardInstance;
+class MTGuard : public IClip, public IAudioPlanar
 {
 private:
   IScriptEnvironment2* Env;
 
 	std::unique_ptr<MTGuardChildFilter[]> ChildFilters;
+  // MT_MULTI_INSTANCE: nThreads instances borrowed by the callers, idle ones reaped
+  std::unique_ptr<MTGuardInstancePool> InstancePool;
+  // MT_SERIALIZED in MT mode: frame requests executed by a dedicated thread
+  std::unique_ptr<MTGuardSerialQueue> SerialQueue;
   size_t nThreads;
 #ifndef OLD_PREFETCH
   bool mt_enabled;
@@ -27,13 +35,23 @@ private:
   std::unique_ptr<const FilterConstructor> FilterCtor;
   const MtMode MTMode;
 
+  static AVSValue SerialWorker(IScriptEnvironment2* env, void* data);
+  MTGuardInstance* AcquireInstance(size_t thread_id);
+  void ReleaseInstance(MTGuardInstance* instance, size_t thread_id);
+  friend class MTGuardInstanceLease;
+  PVideoFrame GetFrameSerialized(int n, InternalEnvironment* env);
+
 public:
   ~MTGuard();
   MTGuard(PClip firstChild, MtMode mtmode, std::unique_ptr<const FilterConstructor> &&funcCtor, InternalEnvironment* env);
   void EnableMT(size_t nThreads);
+  // MT_MULTI_INSTANCE: creates the instances asked for by the worker threads and frees the
+  // ones unused for a while. Host thread only, outside of GetFrame.
+  void ServiceInstances();
 
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
   void __stdcall GetAudio(void* buf, int64_t start, int64_t count, IScriptEnvironment* env);
+  void __stdcall GetAudioPlanar(void** bufs, int64_t start, int64_t count, IScriptEnvironment* env);
   const VideoInfo& __stdcall GetVideoInfo();
   bool __stdcall GetParity(int n);
   int __stdcall SetCacheHints(int cachehints,int frame_range);
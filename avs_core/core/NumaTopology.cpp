@@ -0,0 +1,242 @@
+#include "NumaTopology.h"
+#include <avs/config.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <string>
+
+#if defined(AVS_WINDOWS)
+#include <avs/win.h>
+#elif defined(AVS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+// home node of a pinned thread, -1 when not pinned
+static thread_local int pinned_node = -1;
+
+#if defined(AVS_WINDOWS)
+// Windows 7 API, looked up at runtime (we still build for XP)
+struct AvsGroupAffinity {
+  ULONG_PTR Mask;
+  WORD Group;
+  WORD Reserved[3];
+};
+struct AvsProcessorNumber {
+  WORD Group;
+  BYTE Number;
+  BYTE Reserved;
+};
+typedef BOOL(WINAPI* LPFN_GNHNN)(PULONG);
+typedef BOOL(WINAPI* LPFN_GNNPME)(USHORT, AvsGroupAffinity*);
+typedef BOOL(WINAPI* LPFN_STGA)(HANDLE, const AvsGroupAffinity*, AvsGroupAffinity*);
+typedef void(WINAPI* LPFN_GCPNE)(AvsProcessorNumber*);
+
+static FARPROC GetKernel32Proc(const char* name)
+{
+  return GetProcAddress(GetModuleHandle(TEXT("kernel32")), name);
+}
+#endif
+
+#if defined(AVS_LINUX)
+// "0-3,8-11" list format of /sys/devices/system/node
+static std::vector<int> ParseCpuList(const char* s)
+{
+  std::vector<int> list;
+  while (*s) {
+    char* end;
+    const long first = strtol(s, &end, 10);
+    if (end == s)
+      break;
+    long last = first;
+    s = end;
+    if (*s == '-') {
+      last = strtol(s + 1, &end, 10);
+      s = end;
+    }
+    for (long i = first; i <= last; i++)
+      list.push_back((int)i);
+    while (*s == ',' || *s == '\n' || *s == ' ')
+      s++;
+  }
+  return list;
+}
+
+static std::string ReadSysFile(const std::string& path)
+{
+  std::string content;
+  FILE* f = fopen(path.c_str(), "r");
+  if (f) {
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+      content.append(buf, n);
+    fclose(f);
+  }
+  return content;
+}
+
+// not in every libc, the syscall is there since 2.6.7
+#define AVS_MPOL_PREFERRED 1
+#endif
+
+NumaTopology::NumaTopology()
+{
+  const char* env_numa = getenv("AVS_NUMA");
+  const bool disabled = env_numa != nullptr && strcmp(env_numa, "0") == 0;
+
+#if defined(AVS_LINUX)
+  if (!disabled) {
+    // pinning must not widen the affinity the user gave the process
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool has_allowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    const std::vector<int> online = ParseCpuList(ReadSysFile("/sys/devices/system/node/online").c_str());
+    for (int node_id : online) {
+      Node node;
+      for (int cpu : ParseCpuList(ReadSysFile("/sys/devices/system/node/node" + std::to_string(node_id) + "/cpulist").c_str()))
+        if (!has_allowed || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)))
+          node.cpus.push_back(cpu);
+      node.group = node_id; // kernel node number, for mbind
+      node.mask = 0;
+      if (node.cpus.empty())
+        continue; // memory-only node, or none of its processors allowed
+      for (int cpu : node.cpus) {
+        if (cpu >= (int)cpu_to_node.size())
+          cpu_to_node.resize(cpu + 1, 0);
+        cpu_to_node[cpu] = (int)nodes.size();
+      }
+      nodes.push_back(node);
+    }
+  }
+#elif defined(AVS_WINDOWS)
+  LPFN_GNHNN get_highest = (LPFN_GNHNN)GetKernel32Proc("GetNumaHighestNodeNumber");
+  LPFN_GNNPME get_mask = (LPFN_GNNPME)GetKernel32Proc("GetNumaNodeProcessorMaskEx");
+  LPFN_GCPNE get_processor = (LPFN_GCPNE)GetKernel32Proc("GetCurrentProcessorNumberEx");
+  // pinning must not widen the affinity the user gave the process. The process mask is
+  // known only for a process in a single processor group (zero otherwise).
+  DWORD_PTR process_mask = 0, system_mask = 0;
+  WORD process_group = 0;
+  if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) && process_mask != 0 && get_processor) {
+    AvsProcessorNumber number = {};
+    get_processor(&number);
+    process_group = number.Group;
+  }
+  else
+    process_mask = 0;
+  ULONG highest = 0;
+  if (!disabled && get_highest && get_mask && get_highest(&highest)) {
+    for (ULONG node_id = 0; node_id <= highest; node_id++) {
+      AvsGroupAffinity affinity = {};
+      if (!get_mask((USHORT)node_id, &affinity))
+        continue;
+      if (process_mask != 0)
+        affinity.Mask = affinity.Group == process_group ? (affinity.Mask & process_mask) : 0;
+      if (affinity.Mask == 0)
+        continue;
+      Node node;
+      node.group = affinity.Group;
+      node.mask = affinity.Mask;
+      for (int bit = 0; bit < (int)sizeof(ULONG_PTR) * 8; bit++) {
+        if (affinity.Mask & ((ULONG_PTR)1 << bit)) {
+          const int cpu = node.group * 64 + bit;
+          node.cpus.push_back(cpu);
+          if (cpu >= (int)cpu_to_node.size())
+            cpu_to_node.resize(cpu + 1, 0);
+          cpu_to_node[cpu] = (int)nodes.size();
+        }
+      }
+      nodes.push_back(node);
+    }
+  }
+#endif
+
+  if (nodes.empty() || disabled) {
+    nodes.clear();
+    cpu_to_node.clear();
+    nodes.push_back(Node{ std::vector<int>(), 0, 0 });
+  }
+}
+
+const NumaTopology& NumaTopology::Get()
+{
+  static const NumaTopology topology;
+  return topology;
+}
+
+void NumaTopology::PinCurrentThread(int node) const
+{
+  if (!Enabled() || node < 0) {
+    pinned_node = -1;
+    return;
+  }
+  node %= NumNodes();
+  pinned_node = node;
+
+#if defined(AVS_LINUX)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : nodes[node].cpus)
+    if (cpu < CPU_SETSIZE)
+      CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#elif defined(AVS_WINDOWS)
+  static const LPFN_STGA set_affinity = (LPFN_STGA)GetKernel32Proc("SetThreadGroupAffinity");
+  if (set_affinity) {
+    AvsGroupAffinity affinity = {};
+    affinity.Mask = (ULONG_PTR)nodes[node].mask;
+    affinity.Group = (WORD)nodes[node].group;
+    set_affinity(GetCurrentThread(), &affinity, nullptr);
+  }
+#endif
+}
+
+int NumaTopology::CurrentThreadNode() const
+{
+  if (!Enabled())
+    return 0;
+  if (pinned_node >= 0)
+    return pinned_node;
+
+  int cpu = -1;
+#if defined(AVS_LINUX)
+  cpu = sched_getcpu();
+#elif defined(AVS_WINDOWS)
+  static const LPFN_GCPNE get_processor = (LPFN_GCPNE)GetKernel32Proc("GetCurrentProcessorNumberEx");
+  if (get_processor) {
+    AvsProcessorNumber number = {};
+    get_processor(&number);
+    cpu = number.Group * 64 + number.Number;
+  }
+#endif
+  if (cpu >= 0 && cpu < (int)cpu_to_node.size())
+    return cpu_to_node[cpu];
+  return 0;
+}
+
+void NumaTopology::PlaceMemory(void* ptr, size_t size, int node) const
+{
+  if (!Enabled() || node < 0 || node >= NumNodes())
+    return;
+#if defined(AVS_LINUX) && defined(SYS_mbind)
+  // whole pages inside the buffer only, the rest may belong to other heap blocks
+  const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  const uintptr_t start = ((uintptr_t)ptr + page - 1) & ~(uintptr_t)(page - 1);
+  const uintptr_t end = ((uintptr_t)ptr + size) & ~(uintptr_t)(page - 1);
+  if (end <= start)
+    return;
+  const int kernel_node = nodes[node].group;
+  unsigned long nodemask[16] = {};
+  if (kernel_node >= (int)(sizeof(nodemask) * 8))
+    return;
+  nodemask[kernel_node / (sizeof(unsigned long) * 8)] |= 1UL << (kernel_node % (sizeof(unsigned long) * 8));
+  // best effort: pages already touched stay where they are
+  syscall(SYS_mbind, (void*)start, (unsigned long)(end - start), AVS_MPOL_PREFERRED, nodemask, (unsigned long)(sizeof(nodemask) * 8), 0u);
+#else
+  (void)ptr;
+  (void)size;
+#endif
+}
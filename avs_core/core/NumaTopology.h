@@ -0,0 +1,44 @@
+#ifndef _AVS_NUMATOPOLOGY_H
+#define _AVS_NUMATOPOLOGY_H
+
+#include <cstddef>
+#include <vector>
+
+// NUMA nodes of the machine, and the thread and memory placement used by the
+// CPU device and the thread pools. Read once per process, restricted to the
+// processors the process may run on (taskset, cpuset, start /affinity).
+// On single node machines, on systems without NUMA support and with the
+// environment variable AVS_NUMA=0 there is one node and everything is a no-op.
+class NumaTopology
+{
+private:
+  struct Node {
+    std::vector<int> cpus; // processor numbers (Windows: group * 64 + bit)
+    int group;             // Linux: kernel node number, Windows: processor group
+    unsigned long long mask; // Windows: processors in the group
+  };
+  std::vector<Node> nodes;
+  std::vector<int> cpu_to_node;
+
+  NumaTopology();
+
+public:
+  static const NumaTopology& Get();
+
+  int NumNodes() const { return (int)nodes.size(); }
+  bool Enabled() const { return nodes.size() > 1; }
+
+  // Pins the calling thread to the processors of a node and makes the node
+  // its home node. node < 0 is only remembered as "not pinned".
+  void PinCurrentThread(int node) const;
+
+  // Node whose frame buffers the calling thread should use: the node it was
+  // pinned to, else the node of the processor it is running on. 0 if not enabled.
+  int CurrentThreadNode() const;
+
+  // Prefer the node for the pages of a fresh allocation which are not touched yet.
+  // Without a memory policy API the first touch by the (pinned) writer decides.
+  void PlaceMemory(void* ptr, size_t size, int node) const;
+};
+
+#endif  // _AVS_NUMATOPOLOGY_H
@@ -0,0 +1,69 @@
+// Avisynth+
+// https://avs-plus.net
+//
+// This file is part of Avisynth+ which is released under GPL2+ with exception.
+
+// Script environment performance counters
+
+#include "PerformanceCounters.h"
+
+PerformanceCounters::PerformanceCounters() :
+  frames_delivered(0),
+  cache_hits(0),
+  cache_misses(0)
+{
+  for (auto& bucket : histogram)
+    bucket.store(0, std::memory_order_relaxed);
+}
+
+int PerformanceCounters::BucketIndex(uint64_t us)
+{
+  if (us < SUB_BUCKETS)
+    return (int)us;
+  int exponent = 63;
+  while (!(us >> exponent))
+    --exponent;
+  // exponent >= SUB_BITS here; keep the SUB_BITS bits below the leading one
+  const int sub = (int)(us >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1);
+  const int index = (exponent - SUB_BITS + 1) * SUB_BUCKETS + sub;
+  return index < NUM_BUCKETS ? index : NUM_BUCKETS - 1;
+}
+
+uint64_t PerformanceCounters::BucketValue(int index)
+{
+  if (index < SUB_BUCKETS)
+    return (uint64_t)index;
+  const int exponent = index / SUB_BUCKETS + SUB_BITS - 1;
+  const uint64_t sub = (uint64_t)(index & (SUB_BUCKETS - 1));
+  const uint64_t lower = (SUB_BUCKETS + sub) << (exponent - SUB_BITS);
+  const uint64_t width = (uint64_t)1 << (exponent - SUB_BITS);
+  return lower + width / 2; // bucket midpoint
+}
+
+void PerformanceCounters::FrameDelivered(uint64_t microseconds)
+{
+  histogram[BucketIndex(microseconds)].fetch_add(1, std::memory_order_relaxed);
+  frames_delivered.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t PerformanceCounters::FrameTimePercentile(int percent) const
+{
+  uint64_t counts[NUM_BUCKETS];
+  uint64_t total = 0;
+  for (int i = 0; i < NUM_BUCKETS; ++i) {
+    counts[i] = histogram[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total == 0)
+    return 0;
+
+  // rank of the requested sample, 1-based, rounded up
+  const uint64_t rank = (total * (uint64_t)percent + 99) / 100;
+  uint64_t seen = 0;
+  for (int i = 0; i < NUM_BUCKETS; ++i) {
+    seen += counts[i];
+    if (seen >= rank)
+      return BucketValue(i);
+  }
+  return BucketValue(NUM_BUCKETS - 1);
+}
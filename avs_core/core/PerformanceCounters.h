@@ -0,0 +1,52 @@
+// Avisynth+
+// https://avs-plus.net
+//
+// This file is part of Avisynth+ which is released under GPL2+ with exception.
+
+// Counters behind the AEP_FRAMES_DELIVERED .. AEP_THREADPOOL_QUEUE queries
+
+#ifndef _AVS_PERFORMANCECOUNTERS_H
+#define _AVS_PERFORMANCECOUNTERS_H
+
+#include <atomic>
+#include <cstdint>
+
+// Lifetime work counters of a script environment, read back through
+// GetEnvProperty(AEP_FRAMES_DELIVERED ... AEP_THREADPOOL_QUEUE).
+// Updates are lock-free relaxed increments, cheap enough for every GetFrame.
+class PerformanceCounters
+{
+private:
+  // Log-linear frame time histogram in microseconds: values below
+  // SUB_BUCKETS are exact, above that each power of two is split into
+  // SUB_BUCKETS buckets (~9% resolution), up to 2^40 us.
+  static constexpr int SUB_BITS = 3;
+  static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+  static constexpr int NUM_BUCKETS = (40 - SUB_BITS + 1) * SUB_BUCKETS;
+
+  std::atomic<uint64_t> histogram[NUM_BUCKETS];
+  std::atomic<uint64_t> frames_delivered;
+  std::atomic<uint64_t> cache_hits;
+  std::atomic<uint64_t> cache_misses;
+
+  static int BucketIndex(uint64_t us);
+  static uint64_t BucketValue(int index);
+
+public:
+  PerformanceCounters();
+
+  // frame returned to the host (outermost GetFrame on the main thread)
+  void FrameDelivered(uint64_t microseconds);
+
+  void CacheHit() { cache_hits.fetch_add(1, std::memory_order_relaxed); }
+  void CacheMiss() { cache_misses.fetch_add(1, std::memory_order_relaxed); }
+
+  uint64_t FramesDelivered() const { return frames_delivered.load(std::memory_order_relaxed); }
+  uint64_t CacheHits() const { return cache_hits.load(std::memory_order_relaxed); }
+  uint64_t CacheMisses() const { return cache_misses.load(std::memory_order_relaxed); }
+
+  // frame time in microseconds below which 'percent' of the delivered frames fall
+  uint64_t FrameTimePercentile(int percent) const;
+};
+
+#endif  // _AVS_PERFORMANCECOUNTERS_H
@@ -7,6 +7,9 @@
 #include <cassert>
 #include "function.h"
 #include <avs/filesystem.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
 
 #ifdef AVS_WINDOWS
   #include <avs/win.h>
@@ -198,6 +201,120 @@ static bool IsValidParameterString(const char* p) {
   return state == 0 || state == 1;
 }
 
+// Stubs registered for a lazily autoloaded plugin carry its path but no entry point
+static bool IsLazyStub(const AVSFunction* func)
+{
+  return (func->apply == NULL) && (func->dll_path != NULL);
+}
+
+// Lazy autoload is on by default, AVS_LAZY_AUTOLOAD=0 in the environment turns it off
+static bool IsLazyAutoloadEnabled()
+{
+  const char* s = std::getenv("AVS_LAZY_AUTOLOAD");
+  return (s == NULL) || (strcmp(s, "0") != 0);
+}
+
+// Per-user cache location of the plugin manifest, empty if there is none
+static std::string GetManifestPath()
+{
+  std::string dir;
+#ifdef AVS_WINDOWS
+  const char* local = std::getenv("LOCALAPPDATA");
+  if (local == NULL || *local == 0)
+    return std::string();
+  dir = concat(local, "/AviSynth+");
+#else
+  const char* xdg = std::getenv("XDG_CACHE_HOME");
+  const char* home = std::getenv("HOME");
+  if (xdg != NULL && *xdg != 0)
+    dir = concat(xdg, "/avisynth");
+  else if (home != NULL && *home != 0)
+    dir = concat(home, "/.cache/avisynth");
+  else
+    return std::string();
+#endif
+  replace(dir, '\\', '/');
+  return dir + (sizeof(void*) == 8 ? "/plugin_manifest64.txt" : "/plugin_manifest32.txt");
+}
+
+static bool GetFileStamp(const std::string& path, int64_t& mtime, int64_t& size)
+{
+  std::error_code ec;
+  const auto t = fs::last_write_time(path, ec);
+  if (ec)
+    return false;
+  const auto s = fs::file_size(path, ec);
+  if (ec)
+    return false;
+  mtime = (int64_t)t.time_since_epoch().count();
+  size = (int64_t)s;
+  return true;
+}
+
+static bool HasManifestSeparator(const std::string& s)
+{
+  return s.find_first_of("\t\r\n") != std::string::npos;
+}
+
+// Type class of an argument, as far as TypeMatch can tell them apart
+static char LookupTypeClass(const AVSValue& arg)
+{
+  if (arg.IsArray()) return 'a';
+  if (!arg.Defined()) return 'v';
+  if (arg.IsClip()) return 'c';
+  if (arg.IsBool()) return 'b';
+  if (arg.IsInt()) return 'i';    // int or long
+  if (arg.IsFloat()) return 'f';  // float or double
+  if (arg.IsString()) return 's';
+  if (arg.IsFunction()) return 'n';
+  return '?';
+}
+
+// Builds the resolution cache key from everything TypeMatch and ArgNameMatch
+// depend on. Returns false for calls not worth caching (e.g. very long arrays).
+static bool MakeLookupKey(std::string& key, const char* search_name, const AVSValue* args, size_t num_args,
+  bool strict, size_t args_names_count, const char* const* arg_names)
+{
+  const size_t MAX_KEY_LENGTH = 256;
+
+  key.clear();
+  for (const char* p = search_name; *p; ++p)
+    key.push_back((char)tolower((unsigned char)*p));
+  key.push_back('\0');
+  key.push_back(strict ? '1' : '0');
+
+  for (size_t i = 0; i < num_args; ++i)
+  {
+    const char type = LookupTypeClass(args[i]);
+    key.push_back(type);
+    if (type == 'a')
+    {
+      // elements are checked one level deep by SingleTypeMatchArray
+      const int size = args[i].ArraySize();
+      if (size > (int)MAX_KEY_LENGTH)
+        return false;
+      key.push_back('(');
+      for (int j = 0; j < size; ++j)
+        key.push_back(LookupTypeClass(args[i][j]));
+      key.push_back(')');
+    }
+  }
+
+  for (size_t i = 0; i < args_names_count; ++i)
+  {
+    key.push_back('\0');
+    if (arg_names[i])
+      for (const char* p = arg_names[i]; *p; ++p)
+        key.push_back((char)tolower((unsigned char)*p));
+  }
+
+  return key.size() <= MAX_KEY_LENGTH;
+}
+
+// The manifest is invalidated by any other core build, the function set of a
+// plugin may depend on the interface it is loaded by.
+static const char ManifestHeader[] = "AviSynth+ plugin manifest 1\t" AVS_FULLVERSION;
+
 /*
 ---------------------------------------------------------------------------------
 ---------------------------------------------------------------------------------
@@ -545,7 +662,8 @@ PluginFile::PluginFile(const std::string &filePath) :
 */
 
 PluginManager::PluginManager(InternalEnvironment* env) :
-  Env(env), PluginInLoad(NULL), AutoloadExecuted(false), Autoloading(false)
+  Env(env), PluginInLoad(NULL), AutoloadExecuted(false), Autoloading(false),
+  LazyAutoload(IsLazyAutoloadEnabled()), ManifestDirty(false), ManifestInLoad(NULL), LazyPluginInLoad(NULL)
 {
   env->SetGlobalVar("$PluginFunctions$", AVSValue(""));
 }
@@ -662,6 +780,9 @@ void PluginManager::AutoloadPlugins()
   AutoloadExecuted = true;
   Autoloading = true;
 
+  if (LazyAutoload)
+    ReadManifest();
+
   // Load binary plugins
   for (const std::string& dir : AutoloadDirs)
   {
@@ -689,26 +810,68 @@ void PluginManager::AutoloadPlugins()
       {
         PluginFile p(concat(dir, file.path().filename().generic_string()));
 
-        // Search for loaded plugins with the same base name.
+        // Search for loaded (or lazily registered) plugins with the same base name.
         bool same_found = false;
-        for (size_t i = 0; i < AutoLoadedPlugins.size(); ++i)
+        for (const std::vector<PluginFile>* list : { &AutoLoadedPlugins, &LazyPlugins })
         {
+          for (size_t i = 0; i < list->size(); ++i)
+          {
 #ifdef AVS_POSIX
-          if (AutoLoadedPlugins[i].BaseName == p.BaseName) // case insentitive
+            if ((*list)[i].BaseName == p.BaseName) // case insentitive
 #else
-          if (streqi(AutoLoadedPlugins[i].BaseName.c_str(), p.BaseName.c_str()))
+            if (streqi((*list)[i].BaseName.c_str(), p.BaseName.c_str()))
 #endif
-          {
-            // Prevent loading a plugin with a basename that is
-            // already loaded (from another autoload folder).
-            same_found = true;
-            break;
+            {
+              // Prevent loading a plugin with a basename that is
+              // already loaded (from another autoload folder).
+              same_found = true;
+              break;
+            }
           }
         }
 
         if (same_found)
           continue;
 
+        int64_t mtime, size;
+        if (LazyAutoload && GetFileStamp(p.FilePath, mtime, size))
+        {
+          const auto it = Manifest.find(p.FilePath);
+          if (it != Manifest.end() && it->second.MTime == mtime && it->second.Size == size)
+          {
+            // Unchanged since the manifest entry was made
+            if (!it->second.IsPlugin)
+              continue;
+            if (!it->second.Functions.empty())
+            {
+              RegisterLazyPlugin(p, it->second);
+              continue;
+            }
+            // A plugin without functions is loaded as usual, its init has some other purpose
+            AVSValue dummy;
+            LoadPlugin(p, false, &dummy);
+            continue;
+          }
+
+          // New or changed: load it now and remember what it registers
+          PluginManifestEntry entry { mtime, size, false, {} };
+          ManifestInLoad = &entry;
+          try
+          {
+            AVSValue dummy;
+            entry.IsPlugin = LoadPlugin(p, false, &dummy);
+          }
+          catch (...)
+          {
+            ManifestInLoad = NULL;
+            throw;
+          }
+          ManifestInLoad = NULL;
+          Manifest[p.FilePath] = std::move(entry);
+          ManifestDirty = true;
+          continue;
+        }
+
         // Try to load plugin
         AVSValue dummy;
         LoadPlugin(p, false, &dummy);
@@ -758,9 +921,191 @@ void PluginManager::AutoloadPlugins()
     }
   }
 
+  if (ManifestDirty)
+    WriteManifest();
+
   Autoloading = false;
 }
 
+void PluginManager::ReadManifest()
+{
+  Manifest.clear();
+
+  const std::string path = GetManifestPath();
+  if (path.empty())
+    return;
+
+  std::ifstream file(path);
+  if (!file)
+    return;
+
+  std::string line;
+  if (!std::getline(file, line) || line != ManifestHeader)
+    return; // stale or foreign, rebuilt by this autoload
+
+  // P <tab> mtime <tab> size <tab> is_plugin <tab> path
+  // F <tab> name <tab> params   (functions of the preceding P line)
+  PluginManifestEntry* entry = NULL;
+  while (std::getline(file, line))
+  {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (;;)
+    {
+      const size_t tab = line.find('\t', start);
+      fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+      if (tab == std::string::npos)
+        break;
+      start = tab + 1;
+    }
+
+    if (fields.size() == 5 && fields[0] == "P")
+    {
+      PluginManifestEntry& e = Manifest[fields[4]];
+      e.MTime = strtoll(fields[1].c_str(), NULL, 10);
+      e.Size = strtoll(fields[2].c_str(), NULL, 10);
+      e.IsPlugin = fields[3] == "1";
+      e.Functions.clear();
+      entry = &e;
+    }
+    else if (fields.size() == 3 && fields[0] == "F" && entry != NULL && IsValidParameterString(fields[2].c_str()))
+    {
+      entry->Functions.emplace_back(fields[1], fields[2]);
+    }
+    else
+    {
+      // Damaged manifest: ignore all of it, it is rewritten after this autoload
+      Manifest.clear();
+      ManifestDirty = true;
+      return;
+    }
+  }
+}
+
+void PluginManager::WriteManifest()
+{
+  ManifestDirty = false;
+
+  const std::string path = GetManifestPath();
+  if (path.empty())
+    return;
+
+  std::error_code ec;
+  fs::create_directories(fs::path(path).parent_path(), ec);
+
+  // Write a private temporary and rename it, so that concurrent processes
+  // never read a half-written manifest.
+#ifdef AVS_WINDOWS
+  const unsigned long pid = GetCurrentProcessId();
+#else
+  const unsigned long pid = (unsigned long)getpid();
+#endif
+  const std::string tmp_path = path + "." + std::to_string(pid) + "." + std::to_string((uintptr_t)this) + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::trunc);
+    if (!file)
+      return;
+
+    file << ManifestHeader << '\n';
+    for (const auto& it : Manifest)
+    {
+      if (HasManifestSeparator(it.first) || !fs::exists(it.first, ec))
+        continue;
+      const PluginManifestEntry& e = it.second;
+      file << "P\t" << e.MTime << '\t' << e.Size << '\t' << (e.IsPlugin ? 1 : 0) << '\t' << it.first << '\n';
+
+      // A plugin with a name we cannot store is written without functions, it is then always loaded at autoload
+      bool storable = true;
+      for (const auto& f : e.Functions)
+        storable = storable && !HasManifestSeparator(f.first) && !HasManifestSeparator(f.second);
+      if (!storable)
+        continue;
+      for (const auto& f : e.Functions)
+        file << "F\t" << f.first << '\t' << f.second << '\n';
+    }
+    if (!file.flush())
+    {
+      file.close();
+      fs::remove(tmp_path, ec);
+      return;
+    }
+  }
+
+  fs::rename(tmp_path, path, ec);
+  if (ec)
+    fs::remove(tmp_path, ec);
+}
+
+void PluginManager::RegisterLazyPlugin(const PluginFile &plugin, const PluginManifestEntry &entry)
+{
+  LookupCache.clear();
+  LazyPlugins.push_back(plugin);
+
+  // Stubs get the same names, parameters and exports the plugin itself would register
+  for (const auto& f : entry.Functions)
+  {
+    AVSFunction* stub = new AVSFunction(f.first.c_str(), plugin.BaseName.c_str(), f.second.c_str(), NULL, NULL, plugin.FilePath.c_str(), false, false);
+    LazyStubs.push_back(stub);
+    RegisterFunction(AutoloadedFunctions, stub->name, stub, NULL);
+    RegisterFunction(AutoloadedFunctions, stub->canon_name, stub, NULL);
+  }
+}
+
+void PluginManager::LoadLazyPlugin(const char* dll_path)
+{
+  const std::string path(dll_path);
+
+  auto it = std::find_if(LazyPlugins.begin(), LazyPlugins.end(),
+    [&path](const PluginFile& p) { return streqi(p.FilePath.c_str(), path.c_str()); });
+
+  if (it != LazyPlugins.end())
+  {
+    PluginFile plugin = *it;
+    LazyPlugins.erase(it);
+
+    // May happen in the middle of a script, load it the way autoload would have
+    const bool oldAutoloading = Autoloading;
+    PluginFile* const oldPluginInLoad = PluginInLoad;
+    const PluginFile* const oldLazyPluginInLoad = LazyPluginInLoad;
+    PluginManifestEntry* const oldManifestInLoad = ManifestInLoad;
+    auto restore = [&]() {
+      Autoloading = oldAutoloading;
+      PluginInLoad = oldPluginInLoad;
+      LazyPluginInLoad = oldLazyPluginInLoad;
+      ManifestInLoad = oldManifestInLoad;
+    };
+
+    Autoloading = true;
+    LazyPluginInLoad = &plugin;
+    ManifestInLoad = NULL;
+    try
+    {
+      AVSValue dummy;
+      LoadPlugin(plugin, false, &dummy);
+    }
+    catch (...)
+    {
+      restore();
+      throw;
+    }
+    restore();
+  }
+
+  // Stubs the plugin did not replace are dropped, they would never resolve
+  LookupCache.clear();
+  for (auto list_it = AutoloadedFunctions.begin(); list_it != AutoloadedFunctions.end(); )
+  {
+    FunctionList& list = list_it->second;
+    list.erase(std::remove_if(list.begin(), list.end(),
+      [&path](const AVSFunction* f) { return IsLazyStub(f) && streqi(f->dll_path, path.c_str()); }),
+      list.end());
+    if (list.empty())
+      list_it = AutoloadedFunctions.erase(list_it);
+    else
+      ++list_it;
+  }
+}
+
 PluginManager::~PluginManager()
 {
   // Delete all AVSFunction objects that we created
@@ -777,6 +1122,8 @@ PluginManager::~PluginManager()
       for (const auto& func : funcList)
         function_set.insert(func);
   }
+  for (const auto& func : LazyStubs)
+    function_set.insert(func);
   for (const auto& func : function_set)
   {
       delete func;
@@ -973,7 +1320,33 @@ const AVSFunction* PluginManager::Lookup(const FunctionMap& map, const char* sea
 }
 
 const AVSFunction* PluginManager::Lookup(const char* search_name, const AVSValue* args, size_t num_args,
-                    bool strict, size_t args_names_count, const char* const* arg_names) const
+                    bool strict, size_t args_names_count, const char* const* arg_names)
+{
+  // Calls with the same name and argument types resolve the same way until
+  // a function is added, this also remembers the misses of builtin names.
+  std::string key;
+  const bool cacheable = MakeLookupKey(key, search_name, args, num_args, strict, args_names_count, arg_names);
+  if (cacheable)
+  {
+    const auto it = LookupCache.find(key);
+    if (it != LookupCache.end())
+      return it->second;
+  }
+
+  const AVSFunction* func = LookupUncached(search_name, args, num_args, strict, args_names_count, arg_names);
+
+  if (cacheable)
+  {
+    const size_t MAX_CACHE_ENTRIES = 4096;
+    if (LookupCache.size() >= MAX_CACHE_ENTRIES)
+      LookupCache.clear();
+    LookupCache.emplace(std::move(key), func);
+  }
+  return func;
+}
+
+const AVSFunction* PluginManager::LookupUncached(const char* search_name, const AVSValue* args, size_t num_args,
+                    bool strict, size_t args_names_count, const char* const* arg_names)
 {
   /* Lookup in non-autoloaded functions first, so that they take priority */
   const AVSFunction* func = Lookup(ExternalFunctions, search_name, args, num_args, strict, args_names_count, arg_names);
@@ -981,7 +1354,16 @@ const AVSFunction* PluginManager::Lookup(const char* search_name, const AVSValue
     return func;
 
   /* If not found, look amongst the autoloaded */
-  return Lookup(AutoloadedFunctions, search_name, args, num_args, strict, args_names_count, arg_names);
+  func = Lookup(AutoloadedFunctions, search_name, args, num_args, strict, args_names_count, arg_names);
+
+  /* A stub of a lazily autoloaded plugin: load the plugin, which replaces its stubs, and look again */
+  while (func != NULL && IsLazyStub(func))
+  {
+    LoadLazyPlugin(func->dll_path);
+    func = Lookup(AutoloadedFunctions, search_name, args, num_args, strict, args_names_count, arg_names);
+  }
+
+  return func;
 }
 
 bool PluginManager::FunctionExists(const char* name) const
@@ -1012,6 +1394,8 @@ void PluginManager::AddFunction(const char* name, const char* params, IScriptEnv
   if (!IsValidParameterString(params))
     Env->ThrowError("%s has an invalid parameter string (bug in filter)", name);
 
+  LookupCache.clear();
+
   FunctionMap& functions = Autoloading ? AutoloadedFunctions : ExternalFunctions;
 
   AVSFunction *newFunc = NULL;
@@ -1054,34 +1438,57 @@ void PluginManager::AddFunction(const char* name, const char* params, IScriptEnv
     );
   }
 
-  // Warn user if a function with the same name is already registered by another plugin
-  {
-      const auto &it = functions.find(newFunc->name);
-      if ( (functions.end() != it) && !FunctionListHasDll(it->second, newFunc->dll_path) )
-      {
-          OneTimeLogTicket ticket(LOGTICKET_W1008, newFunc->name);
-          Env->LogMsgOnce(ticket, LOGLEVEL_WARNING, "%s() is defined by multiple plugins. Calls to this filter might be ambiguous and could result in the wrong function being called.", newFunc->name);
-      }
-  }
+  if (ManifestInLoad != NULL && PluginInLoad != NULL)
+    ManifestInLoad->Functions.emplace_back(name, params);
 
-  functions[newFunc->name].push_back(newFunc);
-  UpdateFunctionExports(newFunc->name, newFunc->param_types, exportVar);
+  const bool replacingStubs = (LazyPluginInLoad != NULL) && (PluginInLoad != NULL) &&
+    streqi(LazyPluginInLoad->FilePath.c_str(), PluginInLoad->FilePath.c_str());
 
-  if (NULL != newFunc->canon_name)
+  for (const char* key : { newFunc->name, newFunc->canon_name })
   {
-      // Warn user if a function with the same name is already registered by another plugin
+    if (NULL == key)
+      continue;
+
+    if (replacingStubs)
+    {
+      // Take the place of the stub, so that the order of the autoload is kept.
+      // The stub was already exported under this name.
+      bool replaced = false;
+      const auto &it = functions.find(key);
+      if (functions.end() != it)
       {
-          const auto &it = functions.find(newFunc->canon_name);
-          if ((functions.end() != it) && !FunctionListHasDll(it->second, newFunc->dll_path))
+        for (auto &f : it->second)
+        {
+          if (IsLazyStub(f) && streqi(f->dll_path, newFunc->dll_path) && !strcmp(f->param_types, newFunc->param_types))
           {
-              OneTimeLogTicket ticket(LOGTICKET_W1008, newFunc->canon_name);
-              Env->LogMsgOnce(ticket, LOGLEVEL_WARNING, "%s() is defined by multiple plugins. Calls to this filter might be ambiguous and could result in the wrong function being called.", newFunc->name);
+            f = newFunc;
+            replaced = true;
+            break;
           }
+        }
       }
+      if (replaced)
+        continue;
+    }
+
+    RegisterFunction(functions, key, newFunc, exportVar);
+  }
+}
 
-      functions[newFunc->canon_name].push_back(newFunc);
-      UpdateFunctionExports(newFunc->canon_name, newFunc->param_types, exportVar);
+void PluginManager::RegisterFunction(FunctionMap& functions, const char* key, const AVSFunction* newFunc, const char *exportVar)
+{
+  // Warn user if a function with the same name is already registered by another plugin
+  {
+      const auto &it = functions.find(key);
+      if ( (functions.end() != it) && !FunctionListHasDll(it->second, newFunc->dll_path) )
+      {
+          OneTimeLogTicket ticket(LOGTICKET_W1008, key);
+          Env->LogMsgOnce(ticket, LOGLEVEL_WARNING, "%s() is defined by multiple plugins. Calls to this filter might be ambiguous and could result in the wrong function being called.", newFunc->name);
+      }
   }
+
+  functions[key].push_back(newFunc);
+  UpdateFunctionExports(key, newFunc->param_types, exportVar);
 }
 
 std::string PluginManager::PluginLoading() const
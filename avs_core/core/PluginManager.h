@@ -1,8 +1,10 @@
 #ifndef AVSCORE_PLUGINS_H
 #define AVSCORE_PLUGINS_H
 
+#include <cctype>
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include "internal.h"
 
@@ -21,8 +23,47 @@ struct StdStriComparer
   }
 };
 
+struct StdStriHash
+{
+  size_t operator() (const std::string& s) const
+  {
+    // FNV-1a over the lowercased name
+    size_t h = (size_t)14695981039346656037ull;
+    for (unsigned char c : s)
+    {
+      h ^= (size_t)tolower(c);
+      h *= (size_t)1099511628211ull;
+    }
+    return h;
+  }
+};
+
+struct StdStriEqual
+{
+  bool operator() (const std::string& lhs, const std::string& rhs) const
+  {
+#if defined(MSVC)
+    return (lhs.size() == rhs.size()) && (_strcmpi(lhs.c_str(), rhs.c_str()) == 0);
+#else
+    return (lhs.size() == rhs.size()) && (strcasecmp(lhs.c_str(), rhs.c_str()) == 0);
+#endif
+  }
+};
+
 typedef std::vector<const AVSFunction*> FunctionList;
-typedef std::map<std::string,FunctionList,StdStriComparer> FunctionMap;
+typedef std::unordered_map<std::string,FunctionList,StdStriHash,StdStriEqual> FunctionMap;
+
+// One autoloaded binary as remembered by the plugin manifest: the file identity
+// (mtime and size) and the functions its init entry point registered.
+struct PluginManifestEntry
+{
+  int64_t MTime;
+  int64_t Size;
+  bool IsPlugin;
+  std::vector<std::pair<std::string, std::string>> Functions; // name, params
+};
+typedef std::map<std::string,PluginManifestEntry,StdStriComparer> PluginManifest;
+
 class PluginManager
 {
 private:
@@ -37,6 +78,34 @@ private:
   bool AutoloadExecuted;
   bool Autoloading;
 
+  // Lazy autoload: plugins known from the manifest are registered with stub
+  // functions and only loaded when one of their functions is looked up.
+  bool LazyAutoload;
+  bool ManifestDirty;
+  PluginManifest Manifest;
+  PluginManifestEntry *ManifestInLoad;  // receives the AddFunction calls of an eagerly autoloaded plugin
+  const PluginFile *LazyPluginInLoad;   // stub owner currently being loaded on demand
+  std::vector<PluginFile> LazyPlugins;  // stub owners not loaded yet
+  std::vector<const AVSFunction*> LazyStubs;
+
+  // Results of the public Lookup (NULL included), keyed by name, strictness,
+  // argument type classes and argument names. Any change of the function
+  // maps drops it.
+  std::unordered_map<std::string, const AVSFunction*> LookupCache;
+
+  void ReadManifest();
+  void WriteManifest();
+  void RegisterFunction(FunctionMap& functions, const char* key, const AVSFunction* newFunc, const char *exportVar);
+  void RegisterLazyPlugin(const PluginFile &plugin, const PluginManifestEntry &entry);
+  void LoadLazyPlugin(const char* dll_path);
+
+  const AVSFunction* LookupUncached(const char* search_name,
+    const AVSValue* args,
+    size_t num_args,
+    bool strict,
+    size_t args_names_count,
+    const char* const* arg_names);
+
   int TryAsAvs26(PluginFile &plugin, AVSValue *result, std::string& avsexception_message);
   bool TryAsAvs25(PluginFile &plugin, AVSValue *result);
   bool TryAsAvsPreV11C(PluginFile& plugin, AVSValue* result);
@@ -78,7 +147,7 @@ public:
     size_t num_args,
     bool strict,
     size_t args_names_count,
-    const char* const* arg_names) const;
+    const char* const* arg_names);
 };
 
 #endif  // AVSCORE_PLUGINS_H
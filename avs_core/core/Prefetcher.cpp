@@ -11,7 +11,9 @@
 #include "ObjectPool.h"
 #include "LruCache.h"
 #include "InternalEnvironment.h"
+#include "PerformanceCounters.h"
 #include "internal.h"
+#include <chrono>
 
 struct PrefetcherJobParams
 {
@@ -61,7 +63,7 @@ struct PrefetcherPimpl
   bool worker_exception_present;
   InternalEnvironment *EnvI;
 
-  PrefetcherPimpl(const PClip& _child, int _nThreads, int _nPrefetchFrames, IScriptEnvironment2 *env2) :
+  PrefetcherPimpl(const PClip& _child, int _nThreads, int _nPrefetchFrames, int _numa_node, IScriptEnvironment2 *env2) :
     child(_child),
     vi(_child->GetVideoInfo()),
     nThreads(_nThreads),
@@ -78,7 +80,7 @@ struct PrefetcherPimpl
     worker_exception_present(0),
     EnvI(static_cast<InternalEnvironment*>(env2))
   {
-		thread_pool = EnvI->NewThreadPool(nThreads);
+		thread_pool = EnvI->NewThreadPool(nThreads, _numa_node >= 0 ? _numa_node : ThreadPool::NUMA_SPREAD);
   }
 
   ~PrefetcherPimpl()
@@ -131,10 +133,10 @@ AVSValue Prefetcher::ThreadWorker(IScriptEnvironment2* env, void* data)
   return AVSValue();
 }
 
-Prefetcher::Prefetcher(const PClip& _child, int _nThreads, int _nPrefetchFrames, IScriptEnvironment *env) :
+Prefetcher::Prefetcher(const PClip& _child, int _nThreads, int _nPrefetchFrames, int _numa_node, IScriptEnvironment *env) :
   _pimpl(NULL)
 {
-  _pimpl = new PrefetcherPimpl(_child, _nThreads, _nPrefetchFrames, static_cast<IScriptEnvironment2*>(env));
+  _pimpl = new PrefetcherPimpl(_child, _nThreads, _nPrefetchFrames, _numa_node, static_cast<IScriptEnvironment2*>(env));
   _pimpl->VideoCache = std::make_shared<LruCache<size_t, PVideoFrame> >(_pimpl->nPrefetchFrames*2, CACHE_NO_RESIZE);
 }
 
@@ -207,6 +209,19 @@ PVideoFrame __stdcall Prefetcher::GetFrame(int n, IScriptEnvironment* env_)
   InternalEnvironment* IEnv = GetAndRevealCamouflagedEnv(env_);
   IScriptEnvironment* env = static_cast<IScriptEnvironment*>(IEnv);
 
+  if (IEnv->GetFrameRecursiveCount() == 0 && IEnv->GetThreadId() == 0) {
+    // outermost request on the main thread: the host asks for a frame, time it.
+    // The CacheGuard below then sees a nested call and does not count it again.
+    // Before that, outside of GetFrame: the MT_MULTI_INSTANCE instances the workers asked for.
+    IEnv->ManageCache(MC_ServiceMTGuards, nullptr);
+    ScopedCounter getframe_counter(IEnv->GetFrameRecursiveCount());
+    const auto t_start = std::chrono::steady_clock::now();
+    PVideoFrame result = GetFrame(n, env);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t_start);
+    IEnv->GetPerformanceCounters().FrameDelivered((uint64_t)elapsed.count());
+    return result;
+  }
+
   if (IEnv->GetSuppressThreadCount() > 0) {
     // do not use thread when invoke running
     return _pimpl->child->GetFrame(n, env);
@@ -369,10 +384,15 @@ AVSValue Prefetcher::Create(AVSValue args, void*, IScriptEnvironment* env)
 
   int PrefetchThreads = args[1].AsInt((int)envi->GetEnvProperty(AEP_PHYSICAL_CPUS)+1);
   int PrefetchFrames = args[2].AsInt(PrefetchThreads * 2);
+  // -1: worker threads spread over the NUMA nodes; n: all on node n (wrapped),
+  // the frames made by this branch of the graph are then allocated on that node
+  int NumaNode = args[3].AsInt(-1);
+  if (NumaNode < -1)
+    env->ThrowError("Prefetch: numa_node must be -1 or a node number");
 
   if (PrefetchThreads > 0 && PrefetchFrames > 0)
   {
-    return new Prefetcher(child, PrefetchThreads, PrefetchFrames, env);
+    return new Prefetcher(child, PrefetchThreads, PrefetchFrames, NumaNode, env);
   }
   else
     return child;
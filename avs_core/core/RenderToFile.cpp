@@ -0,0 +1,525 @@
+// Avisynth+
+// https://avs-plus.net
+//
+// This file is part of Avisynth+ which is released under GPL2+ with exception.
+
+// RenderToFile(clip, file, ...): renders a clip into a Y4M, raw video, WAV or
+// Wave64 file without an external client, and reports the throughput.
+// The file is written in large aligned chunks by a writer thread (O_DIRECT where
+// the file system allows it), while this thread keeps requesting frames; with
+// Prefetch the frames themselves are made in parallel as well.
+
+#include "avs/config.h"
+#include <avisynth.h>
+#include <avs/alignment.h>
+#include "internal.h"
+#include "InternalEnvironment.h"
+
+#ifdef AVS_WINDOWS
+  #include <avs/win.h>
+#else
+  #include <avs/posix.h>
+  #include <fcntl.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cinttypes>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Sequential file output through a bounded queue of chunks served by one thread.
+class AsyncFileWriter
+{
+  struct Chunk {
+    BYTE* data;
+    size_t size;
+  };
+
+  static constexpr size_t chunk_size = 4 << 20;
+  static constexpr size_t direct_align = 4096; // O_DIRECT: buffer address, file offset and size
+
+#ifdef AVS_WINDOWS
+  HANDLE file;
+#else
+  int fd;
+#endif
+  bool direct;
+  std::vector<BYTE*> buffers;
+  std::deque<Chunk> jobs;    // filled chunks in file order
+  std::vector<BYTE*> free_buffers;
+  Chunk current;
+  bool stopping;
+  std::mutex jobs_mutex;
+  std::condition_variable jobs_cond;   // signals new chunks and stop
+  std::condition_variable space_cond;  // signals a free buffer
+  std::string pending_error;           // first write error of the thread
+  std::thread worker;
+  uint64_t bytes_written;
+
+  bool writeAll(const BYTE* data, size_t size)
+  {
+#ifdef AVS_WINDOWS
+    while (size > 0) {
+      DWORD written = 0;
+      const DWORD n = (DWORD)std::min(size, (size_t)(1u << 30));
+      if (!WriteFile(file, data, n, &written, nullptr) || written == 0)
+        return false;
+      data += written;
+      size -= written;
+    }
+#else
+    while (size > 0) {
+      const ssize_t written = write(fd, data, size);
+      if (written < 0 && errno == EINTR)
+        continue;
+      if (written <= 0)
+        return false;
+      data += written;
+      size -= written;
+    }
+#endif
+    return true;
+  }
+
+  void workerThread()
+  {
+    for (;;) {
+      Chunk chunk;
+      {
+        std::unique_lock<std::mutex> lock(jobs_mutex);
+        jobs_cond.wait(lock, [this] { return !jobs.empty() || stopping; });
+        if (jobs.empty())
+          return;
+        chunk = jobs.front();
+        jobs.pop_front();
+      }
+
+      bool ok = true;
+      if (pending_error.empty()) {
+        size_t size = chunk.size;
+#if !defined(AVS_WINDOWS) && defined(O_DIRECT)
+        // only the last chunk can have a partial block: the tail goes through the page cache
+        if (direct && (size % direct_align) != 0) {
+          const size_t aligned = size - size % direct_align;
+          ok = writeAll(chunk.data, aligned);
+          fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+          ok = ok && writeAll(chunk.data + aligned, size - aligned);
+          size = 0;
+        }
+#endif
+        ok = ok && writeAll(chunk.data, size);
+      }
+      const int error_code = ok ? 0 : errno;
+
+      std::lock_guard<std::mutex> lock(jobs_mutex);
+      if (!ok && pending_error.empty())
+        pending_error = std::string("write error: ") + strerror(error_code);
+      if (ok)
+        bytes_written += chunk.size;
+      free_buffers.push_back(chunk.data);
+      space_cond.notify_one();
+    }
+  }
+
+  void submit()
+  {
+    std::unique_lock<std::mutex> lock(jobs_mutex);
+    jobs.push_back(current);
+    jobs_cond.notify_one();
+    space_cond.wait(lock, [this] { return !free_buffers.empty(); });
+    current.data = free_buffers.back();
+    current.size = 0;
+    free_buffers.pop_back();
+  }
+
+public:
+  AsyncFileWriter(const char* filename, bool _direct, int queue, IScriptEnvironment* env) :
+    direct(false), stopping(false), bytes_written(0)
+  {
+#ifdef AVS_WINDOWS
+    (void)_direct;
+    file = CreateFileA(filename, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      env->ThrowError("RenderToFile: cannot create '%s'.", filename);
+#else
+    fd = -1;
+#ifdef O_DIRECT
+    if (_direct) {
+      fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+      direct = fd >= 0; // not supported by every file system (tmpfs)
+    }
+#else
+    (void)_direct;
+#endif
+    if (fd < 0)
+      fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+      env->ThrowError("RenderToFile: cannot create '%s': %s", filename, strerror(errno));
+#endif
+
+    for (int i = 0; i < std::max(queue, 1) + 1; i++) {
+      BYTE* buffer = (BYTE*)avs_malloc(chunk_size, direct_align);
+      if (buffer == nullptr)
+        break;
+      buffers.push_back(buffer);
+      free_buffers.push_back(buffer);
+    }
+    if (buffers.size() < 2) {
+      for (BYTE* buffer : buffers)
+        avs_free(buffer);
+#ifdef AVS_WINDOWS
+      CloseHandle(file);
+#else
+      close(fd);
+#endif
+      env->ThrowError("RenderToFile: out of memory for the write buffers.");
+    }
+    current.data = free_buffers.back();
+    current.size = 0;
+    free_buffers.pop_back();
+    worker = std::thread(&AsyncFileWriter::workerThread, this);
+  }
+
+  ~AsyncFileWriter()
+  {
+    Close();
+    for (BYTE* buffer : buffers)
+      avs_free(buffer);
+  }
+
+  // copies into the current chunk, hands full chunks to the writer thread
+  void Write(const void* data, size_t size)
+  {
+    const BYTE* src = (const BYTE*)data;
+    while (size > 0) {
+      const size_t n = std::min(size, chunk_size - current.size);
+      memcpy(current.data + current.size, src, n);
+      current.size += n;
+      src += n;
+      size -= n;
+      if (current.size == chunk_size)
+        submit();
+    }
+  }
+
+  // empty if there was no error
+  std::string Error()
+  {
+    std::lock_guard<std::mutex> lock(jobs_mutex);
+    return pending_error;
+  }
+
+  // writes the rest and waits for the thread, returns the first error
+  std::string Close()
+  {
+    if (!worker.joinable())
+      return Error();
+    {
+      std::lock_guard<std::mutex> lock(jobs_mutex);
+      if (current.size > 0)
+        jobs.push_back(current);
+      else
+        free_buffers.push_back(current.data);
+      current.data = nullptr;
+      current.size = 0;
+      stopping = true;
+      jobs_cond.notify_one();
+    }
+    worker.join();
+#ifdef AVS_WINDOWS
+    CloseHandle(file);
+#else
+    close(fd);
+#endif
+    return Error();
+  }
+
+  uint64_t BytesWritten() const { return bytes_written; }
+  bool Direct() const { return direct; }
+};
+
+
+enum RenderFormat { FORMAT_Y4M, FORMAT_RAW, FORMAT_WAV, FORMAT_W64 };
+
+static void PutLE(std::vector<BYTE>& out, uint64_t value, int bytes)
+{
+  for (int i = 0; i < bytes; i++)
+    out.push_back((BYTE)(value >> (i * 8)));
+}
+
+static void PutBytes(std::vector<BYTE>& out, const void* data, size_t size)
+{
+  out.insert(out.end(), (const BYTE*)data, (const BYTE*)data + size);
+}
+
+// WAVEFORMATEX or WAVEFORMATEXTENSIBLE
+static std::vector<BYTE> WaveFormat(const VideoInfo& vi)
+{
+  static const BYTE subtype_pcm[16] = { 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+  static const BYTE subtype_float[16] = { 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+
+  const int bits = vi.BytesPerChannelSample() * 8;
+  const bool is_float = vi.sample_type == SAMPLE_FLOAT;
+  const bool extensible = vi.AudioChannels() > 2 || bits > 16 || vi.IsChannelMaskKnown();
+
+  std::vector<BYTE> fmt;
+  PutLE(fmt, extensible ? 0xFFFE : is_float ? 3 : 1, 2); // wFormatTag
+  PutLE(fmt, vi.AudioChannels(), 2);
+  PutLE(fmt, vi.SamplesPerSecond(), 4);
+  PutLE(fmt, (uint64_t)vi.SamplesPerSecond() * vi.BytesPerAudioSample(), 4); // nAvgBytesPerSec
+  PutLE(fmt, vi.BytesPerAudioSample(), 2); // nBlockAlign
+  PutLE(fmt, bits, 2);
+  if (extensible) {
+    PutLE(fmt, 22, 2); // cbSize
+    PutLE(fmt, bits, 2); // wValidBitsPerSample
+    PutLE(fmt, vi.IsChannelMaskKnown() ? vi.GetChannelMask() : 0, 4);
+    PutBytes(fmt, is_float ? subtype_float : subtype_pcm, 16);
+  }
+  return fmt;
+}
+
+static std::vector<BYTE> WavHeader(const VideoInfo& vi, uint64_t data_size)
+{
+  const std::vector<BYTE> fmt = WaveFormat(vi);
+  std::vector<BYTE> header;
+  PutBytes(header, "RIFF", 4);
+  PutLE(header, 4 + 8 + fmt.size() + 8 + data_size + (data_size & 1), 4);
+  PutBytes(header, "WAVE", 4);
+  PutBytes(header, "fmt ", 4);
+  PutLE(header, fmt.size(), 4);
+  PutBytes(header, fmt.data(), fmt.size());
+  PutBytes(header, "data", 4);
+  PutLE(header, data_size, 4);
+  return header;
+}
+
+// Sony Wave64: GUID chunk ids, 64 bit sizes including the 24 byte chunk header, 8 byte aligned chunks
+static std::vector<BYTE> W64Header(const VideoInfo& vi, uint64_t data_size)
+{
+  static const BYTE guid_riff[16] = { 0x72, 0x69, 0x66, 0x66, 0x2E, 0x91, 0xCF, 0x11, 0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00 };
+  static const BYTE guid_wave[16] = { 0x77, 0x61, 0x76, 0x65, 0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A };
+  static const BYTE guid_fmt[16] = { 0x66, 0x6D, 0x74, 0x20, 0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A };
+  static const BYTE guid_data[16] = { 0x64, 0x61, 0x74, 0x61, 0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A };
+
+  std::vector<BYTE> fmt = WaveFormat(vi);
+  const uint64_t fmt_chunk = 24 + fmt.size();
+  fmt.resize((fmt.size() + 7) & ~(size_t)7);
+  const uint64_t data_chunk = 24 + data_size;
+
+  std::vector<BYTE> header;
+  PutBytes(header, guid_riff, 16);
+  PutLE(header, 16 + 8 + 16 + ((fmt_chunk + 7) & ~7ull) + ((data_chunk + 7) & ~7ull), 8);
+  PutBytes(header, guid_wave, 16);
+  PutBytes(header, guid_fmt, 16);
+  PutLE(header, fmt_chunk, 8);
+  PutBytes(header, fmt.data(), fmt.size());
+  PutBytes(header, guid_data, 16);
+  PutLE(header, data_chunk, 8);
+  return header;
+}
+
+// "YUV4MPEG2 ..." stream header, interlacing, aspect ratio and range from the first frame's properties
+static std::string Y4MHeader(const VideoInfo& vi, const PVideoFrame& first, IScriptEnvironment* env)
+{
+  std::string colorspace;
+  const int bits = vi.BitsPerComponent();
+  if (vi.IsY())
+    colorspace = bits == 8 ? "mono" : "mono" + std::to_string(bits);
+  else if (vi.IsYV411())
+    colorspace = "411";
+  else {
+    const bool is420 = vi.Is420();
+    colorspace = is420 ? "420" : vi.Is422() ? "422" : "444";
+    const AVSMap* props = env->getFramePropsRO(first);
+    int error;
+    if (bits > 8)
+      colorspace += "p" + std::to_string(bits);
+    else if (is420) {
+      const int64_t location = env->propGetInt(props, "_ChromaLocation", 0, &error);
+      colorspace += error ? "jpeg" : location == 0 ? "mpeg2" : location == 2 ? "paldv" : "jpeg";
+    }
+    if (vi.IsYUVA()) // 8 bit 4:4:4 only, checked by the caller
+      colorspace += "alpha";
+  }
+
+  const AVSMap* props = env->getFramePropsRO(first);
+  int error;
+  const int64_t field_based = env->propGetInt(props, "_FieldBased", 0, &error);
+  const char interlace = error ? (vi.IsTFF() ? 't' : vi.IsBFF() ? 'b' : 'p') : field_based == 2 ? 't' : field_based == 1 ? 'b' : 'p';
+  int64_t sar_num = env->propGetInt(props, "_SARNum", 0, &error);
+  int64_t sar_den = error ? 0 : env->propGetInt(props, "_SARDen", 0, &error);
+  if (error || sar_num <= 0 || sar_den <= 0)
+    sar_num = sar_den = 0;
+  const int64_t range = env->propGetInt(props, "_ColorRange", 0, &error);
+
+  std::string header = "YUV4MPEG2 W" + std::to_string(vi.width) + " H" + std::to_string(vi.height) +
+    " F" + std::to_string(vi.fps_numerator) + ":" + std::to_string(vi.fps_denominator) +
+    " I" + interlace + " A" + std::to_string(sar_num) + ":" + std::to_string(sar_den) + " C" + colorspace;
+  if (!error)
+    header += range == 0 ? " XCOLORRANGE=FULL" : " XCOLORRANGE=LIMITED";
+  return header + "\n";
+}
+
+static AVSValue __cdecl RenderToFile(AVSValue args, void*, IScriptEnvironment* env)
+{
+  PClip clip = args[0].AsClip();
+  const char* filename = args[1].AsString("");
+  std::string format = args[2].AsString("");
+  const int prefetch = args[5].AsInt(0);
+  const int queue = args[6].AsInt(4);
+  const bool direct = args[7].AsBool(true);
+
+  if (!*filename)
+    env->ThrowError("RenderToFile: file name must not be empty.");
+
+  if (format.empty()) {
+    const char* dot = strrchr(filename, '.');
+    format = dot ? dot + 1 : "";
+  }
+  std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+  RenderFormat output;
+  if (format == "y4m")
+    output = FORMAT_Y4M;
+  else if (format == "raw" || format == "yuv" || format == "rgb")
+    output = FORMAT_RAW;
+  else if (format == "wav")
+    output = FORMAT_WAV;
+  else if (format == "w64")
+    output = FORMAT_W64;
+  else
+    env->ThrowError("RenderToFile: unknown format '%s', use y4m, raw, wav or w64.", format.c_str());
+
+  if (prefetch > 0) {
+    AVSValue prefetch_args[2] = { clip, prefetch };
+    clip = env->Invoke("Prefetch", AVSValue(prefetch_args, 2)).AsClip();
+  }
+  const VideoInfo& vi = clip->GetVideoInfo();
+  const bool video_output = output == FORMAT_Y4M || output == FORMAT_RAW;
+
+  if (video_output && !vi.HasVideo())
+    env->ThrowError("RenderToFile: clip has no video.");
+  if (!video_output && !vi.HasAudio())
+    env->ThrowError("RenderToFile: clip has no audio.");
+  if (output == FORMAT_Y4M) {
+    if (!vi.IsYUV() && !vi.IsYUVA() && !vi.IsY())
+      env->ThrowError("RenderToFile: y4m needs YUV or Y input, use raw for RGB.");
+    if (vi.BitsPerComponent() == 32)
+      env->ThrowError("RenderToFile: y4m has no 32 bit float formats, use raw.");
+    if (vi.IsYUVA() && (vi.BitsPerComponent() != 8 || !vi.Is444()))
+      env->ThrowError("RenderToFile: y4m supports alpha for 8 bit 4:4:4 only.");
+    if (vi.IsYUY2())
+      env->ThrowError("RenderToFile: y4m needs planar input, convert YUY2 to YV16.");
+  }
+
+  int first = 0;
+  int last = vi.HasVideo() ? vi.num_frames - 1 : 0;
+  if (vi.HasVideo()) {
+    first = args[3].AsInt(0);
+    last = args[4].AsInt(vi.num_frames - 1);
+    if (first < 0 || last >= vi.num_frames || first > last)
+      env->ThrowError("RenderToFile: frame range %d to %d is not in the clip.", first, last);
+  }
+
+  int64_t audio_start = 0;
+  int64_t audio_end = vi.num_audio_samples;
+  if (!video_output && vi.HasVideo()) {
+    audio_start = std::min(vi.AudioSamplesFromFrames(first), vi.num_audio_samples);
+    audio_end = std::min(vi.AudioSamplesFromFrames(last + 1), vi.num_audio_samples);
+  }
+  const uint64_t audio_bytes = (uint64_t)vi.BytesFromAudioSamples(audio_end - audio_start);
+  if (output == FORMAT_WAV && audio_bytes > 0xFFFFFF00ull)
+    env->ThrowError("RenderToFile: audio is larger than 4GB, use w64.");
+
+  AsyncFileWriter writer(filename, direct, queue, env);
+  auto check = [&]() {
+    const std::string error = writer.Error();
+    if (!error.empty())
+      env->ThrowError("RenderToFile: '%s': %s", filename, error.c_str());
+  };
+
+  // render multithreaded, not as a single Invoke step
+  ScopedCounterReset suppressThreadCount_(GetAndRevealCamouflagedEnv(env)->GetSuppressThreadCount());
+  const auto started = std::chrono::steady_clock::now();
+
+  if (video_output) {
+    const int planesYUV[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
+    const int planesRGB[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
+    const int* planes = vi.IsPlanarRGB() || vi.IsPlanarRGBA() ? planesRGB : planesYUV;
+    const int num_planes = vi.IsPlanar() ? vi.NumComponents() : 1;
+
+    for (int n = first; n <= last; n++) {
+      PVideoFrame frame = clip->GetFrame(n, env);
+      if (output == FORMAT_Y4M) {
+        if (n == first) {
+          const std::string header = Y4MHeader(vi, frame, env);
+          writer.Write(header.data(), header.size());
+        }
+        writer.Write("FRAME\n", 6);
+      }
+      for (int p = 0; p < num_planes; p++) {
+        const int plane = num_planes > 1 ? planes[p] : 0;
+        const BYTE* src = frame->GetReadPtr(plane);
+        const int pitch = frame->GetPitch(plane);
+        const int row_size = frame->GetRowSize(plane);
+        const int height = frame->GetHeight(plane);
+        for (int y = 0; y < height; y++)
+          writer.Write(src + (size_t)y * pitch, row_size);
+      }
+      check();
+    }
+  }
+  else {
+    const std::vector<BYTE> header = output == FORMAT_WAV ? WavHeader(vi, audio_bytes) : W64Header(vi, audio_bytes);
+    writer.Write(header.data(), header.size());
+
+    const int64_t block = std::max<int64_t>(1, (1 << 20) / vi.BytesPerAudioSample());
+    std::vector<BYTE> buffer((size_t)vi.BytesFromAudioSamples(block));
+    for (int64_t start = audio_start; start < audio_end; start += block) {
+      const int64_t count = std::min(block, audio_end - start);
+      clip->GetAudio(buffer.data(), start, count, env);
+      writer.Write(buffer.data(), (size_t)vi.BytesFromAudioSamples(count));
+      check();
+    }
+    if (output == FORMAT_WAV && (audio_bytes & 1))
+      writer.Write("", 1); // RIFF chunks are word aligned
+    else if (output == FORMAT_W64 && (audio_bytes & 7)) {
+      const BYTE pad[8] = {};
+      writer.Write(pad, 8 - (audio_bytes & 7));
+    }
+  }
+
+  const std::string error = writer.Close();
+  if (!error.empty())
+    env->ThrowError("RenderToFile: '%s': %s", filename, error.c_str());
+
+  const double seconds = std::max(1e-6, std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+  const double megabytes = writer.BytesWritten() / 1048576.0;
+  double throughput;
+  if (video_output) {
+    throughput = (last - first + 1) / seconds;
+    GetAndRevealCamouflagedEnv(env)->LogMsg(LOGLEVEL_INFO, "RenderToFile: %d frames, %.1f MB in %.3f s: %.2f fps, %.1f MB/s%s",
+      last - first + 1, megabytes, seconds, throughput, megabytes / seconds, writer.Direct() ? " (direct I/O)" : "");
+  }
+  else {
+    // realtime factor
+    throughput = (double)(audio_end - audio_start) / vi.SamplesPerSecond() / seconds;
+    GetAndRevealCamouflagedEnv(env)->LogMsg(LOGLEVEL_INFO, "RenderToFile: %" PRId64 " samples, %.1f MB in %.3f s: %.1fx realtime, %.1f MB/s%s",
+      audio_end - audio_start, megabytes, seconds, throughput, megabytes / seconds, writer.Direct() ? " (direct I/O)" : "");
+  }
+  return throughput;
+}
+
+extern const AVSFunction RenderToFile_filters[] = {
+  { "RenderToFile", BUILTIN_FUNC_PREFIX, "cs[format]s[start]i[end]i[prefetch]i[queue]i[direct]b", RenderToFile, nullptr },
+  { 0 }
+};
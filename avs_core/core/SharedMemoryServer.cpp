@@ -0,0 +1,342 @@
+// Avisynth+
+// https://avs-plus.net
+//
+// This file is part of Avisynth+ which is released under GPL2+ with exception.
+
+// Shared memory frame server: SharedMemoryServer(clip, name, ...)
+// Renders the frames of a clip in order and publishes them into a single
+// producer / single consumer ring in a named shared memory block, so that
+// encoders in another process read the planes in place instead of through a pipe.
+// Layout and protocol are in avs/shmserver.h.
+
+#include "avs/config.h"
+#include <avisynth.h>
+#include <avs/shmserver.h>
+#include "internal.h"
+#include "InternalEnvironment.h"
+
+#ifdef AVS_WINDOWS
+  #include <avs/win.h>
+#else
+  #include <avs/posix.h>
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <thread>
+
+static_assert(offsetof(AVS_ShmHeader, read_index) == 64, "AVS_ShmHeader: index cache lines");
+static_assert(sizeof(AVS_ShmSlotHeader) == 64, "AVS_ShmSlotHeader size");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "lock-free 64 bit atomics needed across processes");
+
+// the indices live in memory shared with a process which is not ours, access them as atomics
+static std::atomic<uint64_t>& AtomicIndex(volatile uint64_t& v) { return *reinterpret_cast<std::atomic<uint64_t>*>(const_cast<uint64_t*>(&v)); }
+static std::atomic<int32_t>& AtomicState(volatile int32_t& v) { return *reinterpret_cast<std::atomic<int32_t>*>(const_cast<int32_t*>(&v)); }
+
+static size_t AlignUp(size_t n, size_t align) { return (n + align - 1) & ~(align - 1); }
+
+class SharedMemoryBlock
+{
+  void* base;
+  size_t size;
+  std::string name;
+#ifdef AVS_WINDOWS
+  HANDLE mapping;
+#endif
+
+public:
+  SharedMemoryBlock(const char* _name, size_t _size, IScriptEnvironment* env) : base(nullptr), size(_size)
+  {
+#ifdef AVS_WINDOWS
+    name = _name;
+    mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+      (DWORD)((uint64_t)size >> 32), (DWORD)(size & 0xFFFFFFFF), name.c_str());
+    if (mapping == nullptr)
+      env->ThrowError("SharedMemoryServer: cannot create shared memory '%s'.", name.c_str());
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+      CloseHandle(mapping);
+      env->ThrowError("SharedMemoryServer: shared memory '%s' is already in use.", name.c_str());
+    }
+    base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (base == nullptr) {
+      CloseHandle(mapping);
+      env->ThrowError("SharedMemoryServer: cannot map shared memory '%s'.", name.c_str());
+    }
+#else
+    // POSIX names are "/name"
+    name = (_name[0] == '/') ? _name : std::string("/") + _name;
+    // O_EXCL: never truncate the block of a server which is still running
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 && errno == EEXIST)
+      env->ThrowError("SharedMemoryServer: shared memory '%s' is already in use.", name.c_str());
+    if (fd < 0)
+      env->ThrowError("SharedMemoryServer: cannot create shared memory '%s'.", name.c_str());
+    if (ftruncate(fd, (off_t)size) != 0) {
+      close(fd);
+      shm_unlink(name.c_str());
+      env->ThrowError("SharedMemoryServer: cannot allocate %zu bytes of shared memory.", size);
+    }
+    base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+      shm_unlink(name.c_str());
+      env->ThrowError("SharedMemoryServer: cannot map shared memory '%s'.", name.c_str());
+    }
+#endif
+  }
+
+  ~SharedMemoryBlock()
+  {
+    // consumers which have it mapped keep reading it, the name is gone
+#ifdef AVS_WINDOWS
+    UnmapViewOfFile(base);
+    CloseHandle(mapping);
+#else
+    munmap(base, size);
+    shm_unlink(name.c_str());
+#endif
+  }
+
+  BYTE* Data() const { return (BYTE*)base; }
+};
+
+// Frame properties in the format described in avs/shmserver.h.
+// Returns the bytes used, stops at the first key which does not fit.
+static uint32_t SerializeProps(const AVSMap* map, BYTE* dst, uint32_t capacity, bool& truncated, IScriptEnvironment* env)
+{
+  uint32_t pos = sizeof(uint32_t);
+  uint32_t num_written = 0;
+  truncated = false;
+
+  auto put = [&](const void* src, size_t n) {
+    if (pos + n > capacity)
+      return false;
+    memcpy(dst + pos, src, n);
+    pos += (uint32_t)n;
+    return true;
+  };
+
+  const int num_keys = env->propNumKeys(map);
+  for (int k = 0; k < num_keys && !truncated; k++) {
+    const char* key = env->propGetKey(map, k);
+    const char type = env->propGetType(map, key);
+    if (type != 'i' && type != 'f' && type != 's')
+      continue; // clips and frames have no meaning in another process
+    const uint32_t record_start = pos;
+    const uint16_t key_length = (uint16_t)strlen(key);
+    const uint8_t type_byte = (uint8_t)type;
+    const uint32_t count = (uint32_t)env->propNumElements(map, key);
+    int error;
+    bool ok = put(&key_length, sizeof(key_length)) && put(key, key_length) && put(&type_byte, 1) && put(&count, sizeof(count));
+    if (ok && type == 'i')
+      ok = put(env->propGetIntArray(map, key, &error), count * sizeof(int64_t));
+    else if (ok && type == 'f')
+      ok = put(env->propGetFloatArray(map, key, &error), count * sizeof(double));
+    else {
+      for (uint32_t i = 0; ok && i < count; i++) {
+        const uint32_t length = (uint32_t)env->propGetDataSize(map, key, i, &error);
+        ok = put(&length, sizeof(length)) && put(env->propGetData(map, key, i, &error), length);
+      }
+    }
+    if (!ok) {
+      pos = record_start;
+      truncated = true;
+    }
+    else
+      num_written++;
+  }
+  memcpy(dst, &num_written, sizeof(num_written));
+  return pos;
+}
+
+// Spins a little, then sleeps. False on timeout (ms, 0: none) or if the consumer quit.
+template<typename Ready>
+static bool WaitForConsumer(Ready ready, AVS_ShmHeader* header, int timeout)
+{
+  const auto started = std::chrono::steady_clock::now();
+  for (int i = 0; ; i++) {
+    if (ready())
+      return true;
+    if (AtomicState(header->consumer_state).load(std::memory_order_acquire) == AVS_SHM_CONSUMER_CLOSED)
+      return false;
+    if (i < 64) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (timeout > 0 && std::chrono::steady_clock::now() - started > std::chrono::milliseconds(timeout))
+      return false;
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+}
+
+static AVSValue __cdecl SharedMemoryServer(AVSValue args, void*, IScriptEnvironment* env)
+{
+  PClip clip = args[0].AsClip();
+  const VideoInfo& vi = clip->GetVideoInfo();
+  const char* name = args[1].AsString("");
+  const int slot_count = args[2].AsInt(4);
+  const int first = args[3].AsInt(0);
+  const int last = args[4].AsInt(vi.num_frames - 1);
+  const int timeout = args[5].AsInt(0);
+  const bool audio = args[6].AsBool(true) && vi.HasAudio();
+
+  if (!vi.HasVideo())
+    env->ThrowError("SharedMemoryServer: clip has no video.");
+  if (!*name)
+    env->ThrowError("SharedMemoryServer: name must not be empty.");
+  if (slot_count < 1)
+    env->ThrowError("SharedMemoryServer: slots must be at least 1.");
+  if (first < 0 || last >= vi.num_frames || first > last)
+    env->ThrowError("SharedMemoryServer: frame range %d to %d is not in the clip.", first, last);
+  if (timeout < 0)
+    env->ThrowError("SharedMemoryServer: timeout must not be negative.");
+
+  // slot: slot header, planes, properties, audio, each 64 byte aligned
+  const int planesYUV[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
+  const int planesRGB[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
+  const int* planes = vi.IsPlanarRGB() || vi.IsPlanarRGBA() ? planesRGB : planesYUV;
+  const int num_planes = vi.IsPlanar() ? vi.NumComponents() : 1;
+
+  AVS_ShmHeader layout = {};
+  size_t pos = sizeof(AVS_ShmSlotHeader);
+  for (int p = 0; p < num_planes; p++) {
+    const int plane = num_planes > 1 ? planes[p] : 0;
+    layout.row_size[p] = vi.RowSize(plane);
+    layout.plane_height[p] = num_planes > 1 ? vi.height >> vi.GetPlaneHeightSubsampling(plane) : vi.height;
+    layout.pitch[p] = (int)AlignUp(layout.row_size[p], FRAME_ALIGN);
+    layout.plane_offset[p] = (uint32_t)pos;
+    pos = AlignUp(pos + (size_t)layout.pitch[p] * layout.plane_height[p], FRAME_ALIGN);
+  }
+  layout.props_offset = (uint32_t)pos;
+  layout.props_capacity = 65536;
+  pos += layout.props_capacity;
+  layout.audio_offset = (uint32_t)pos;
+  if (audio) {
+    // AudioSamplesFromFrames rounds down, a frame has at most one sample more than the average
+    const int64_t max_samples = (int64_t)vi.audio_samples_per_second * vi.fps_denominator / vi.fps_numerator + 1;
+    layout.audio_capacity = (uint32_t)AlignUp((size_t)vi.BytesFromAudioSamples(max_samples), FRAME_ALIGN);
+  }
+  pos += layout.audio_capacity;
+  const size_t slot_size = AlignUp(pos, 4096);
+  const size_t slots_offset = AlignUp(sizeof(AVS_ShmHeader), 4096);
+  if (pos > UINT32_MAX)
+    env->ThrowError("SharedMemoryServer: frame is too large.");
+
+  SharedMemoryBlock block(name, slots_offset + slot_size * slot_count, env);
+  AVS_ShmHeader* header = (AVS_ShmHeader*)block.Data();
+
+  memcpy(header, &layout, sizeof(layout));
+  header->version = AVS_SHM_VERSION;
+  header->header_size = sizeof(AVS_ShmHeader);
+  header->width = vi.width;
+  header->height = vi.height;
+  header->pixel_type = vi.pixel_type;
+  header->image_type = vi.image_type;
+  header->fps_numerator = vi.fps_numerator;
+  header->fps_denominator = vi.fps_denominator;
+  header->first_frame = first;
+  header->num_frames = last - first + 1;
+  if (audio) {
+    header->audio_samples_per_second = vi.audio_samples_per_second;
+    header->sample_type = vi.sample_type;
+    header->nchannels = vi.nchannels;
+    header->num_audio_samples = vi.num_audio_samples;
+  }
+  header->slot_count = slot_count;
+  header->num_planes = num_planes;
+  header->slots_offset = slots_offset;
+  header->slot_size = slot_size;
+  // consumers check the magic last
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(header->magic, AVS_SHM_MAGIC, sizeof(header->magic));
+
+  std::atomic<uint64_t>& write_index = AtomicIndex(header->write_index);
+  std::atomic<uint64_t>& read_index = AtomicIndex(header->read_index);
+
+  // the consumer sees the message, the published frames stay readable
+  auto set_error = [header](const char* msg) {
+    strncpy(header->error, msg, sizeof(header->error) - 1);
+    AtomicState(header->state).store(AVS_SHM_STATE_ERROR, std::memory_order_release);
+  };
+
+  // render multithreaded, not as a single Invoke step
+  ScopedCounterReset suppressThreadCount_(GetAndRevealCamouflagedEnv(env)->GetSuppressThreadCount());
+  int published = 0;
+  for (int n = first; n <= last; n++) {
+    PVideoFrame frame;
+    try {
+      frame = clip->GetFrame(n, env);
+    }
+    catch (const AvisynthError& err) {
+      set_error(err.msg);
+      throw;
+    }
+
+    // render first, then wait: the next frame is made while the consumer still reads
+    const uint64_t w = write_index.load(std::memory_order_relaxed);
+    if (!WaitForConsumer([&] { return w - read_index.load(std::memory_order_acquire) < (uint64_t)slot_count; }, header, timeout)) {
+      if (AtomicState(header->consumer_state).load(std::memory_order_acquire) == AVS_SHM_CONSUMER_CLOSED)
+        break;
+      set_error("timeout");
+      env->ThrowError("SharedMemoryServer: no consumer read frame %d within %d ms.", n, timeout);
+    }
+
+    BYTE* slot = block.Data() + slots_offset + (w % slot_count) * slot_size;
+    AVS_ShmSlotHeader* slot_header = (AVS_ShmSlotHeader*)slot;
+    memset(slot_header, 0, sizeof(AVS_ShmSlotHeader));
+    slot_header->frame_number = n;
+
+    for (int p = 0; p < num_planes; p++) {
+      const int plane = num_planes > 1 ? planes[p] : 0;
+      env->BitBlt(slot + layout.plane_offset[p], layout.pitch[p], frame->GetReadPtr(plane), frame->GetPitch(plane),
+        layout.row_size[p], layout.plane_height[p]);
+    }
+
+    bool truncated;
+    slot_header->props_size = SerializeProps(env->getFramePropsRO(frame), slot + layout.props_offset, layout.props_capacity, truncated, env);
+    slot_header->props_truncated = truncated ? 1 : 0;
+
+    if (audio) {
+      const int64_t start = vi.AudioSamplesFromFrames(n);
+      int64_t count = std::min(vi.AudioSamplesFromFrames(n + 1), vi.num_audio_samples) - start;
+      if (count < 0)
+        count = 0;
+      while (vi.BytesFromAudioSamples(count) > (int64_t)layout.audio_capacity)
+        count--;
+      try {
+        clip->GetAudio(slot + layout.audio_offset, start, count, env);
+      }
+      catch (const AvisynthError& err) {
+        set_error(err.msg);
+        throw;
+      }
+      slot_header->audio_start = start;
+      slot_header->audio_samples = count;
+      slot_header->audio_bytes = (uint32_t)vi.BytesFromAudioSamples(count);
+    }
+
+    write_index.store(w + 1, std::memory_order_release);
+    published++;
+  }
+
+  AtomicState(header->state).store(AVS_SHM_STATE_END, std::memory_order_release);
+  // keep the name until everything is read, a late consumer can still attach
+  const uint64_t w = write_index.load(std::memory_order_relaxed);
+  WaitForConsumer([&] { return read_index.load(std::memory_order_acquire) == w; }, header, timeout);
+
+  return published;
+}
+
+extern const AVSFunction SharedMemory_filters[] = {
+  { "SharedMemoryServer", BUILTIN_FUNC_PREFIX, "cs[slots]i[start]i[end]i[timeout]i[audio]b", SharedMemoryServer, nullptr },
+  { 0 }
+};
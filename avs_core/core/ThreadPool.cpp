@@ -1,5 +1,6 @@
 #include "ThreadPool.h"
 #include "internal.h"
+#include "NumaTopology.h"
 #include <cassert>
 #include <thread>
 
@@ -29,8 +30,11 @@ public:
   {}
 };
 
-void ThreadPool::ThreadFunc(size_t thread_id, ThreadPoolPimpl * const _pimpl, InternalEnvironment* env)
+void ThreadPool::ThreadFunc(size_t thread_id, int numa_node, ThreadPoolPimpl * const _pimpl, InternalEnvironment* env)
 {
+  // no-op on single node machines; frames this thread allocates are then node-local
+  NumaTopology::Get().PinCurrentThread(numa_node);
+
   auto EnvTLS = env->NewThreadScriptEnvironment((int)thread_id);
   PInternalEnvironment holder = PInternalEnvironment(EnvTLS);
 
@@ -79,7 +83,7 @@ void ThreadPool::ThreadFunc(size_t thread_id, ThreadPoolPimpl * const _pimpl, In
   } //while
 }
 
-ThreadPool::ThreadPool(size_t nThreads, size_t nStartId, InternalEnvironment* env) :
+ThreadPool::ThreadPool(size_t nThreads, size_t nStartId, InternalEnvironment* env, int numa_node) :
   _pimpl(new ThreadPoolPimpl(nThreads))
 {
   _pimpl->Threads.reserve(nThreads);
@@ -89,7 +93,7 @@ ThreadPool::ThreadPool(size_t nThreads, size_t nStartId, InternalEnvironment* en
   // i is used as the thread id. Skip id zero because that is reserved for the main thread.
   // CUDA: thread id is controled by caller
   for (size_t i = 0; i < nThreads; ++i)
-    _pimpl->Threads.emplace_back(ThreadFunc, i + nStartId, _pimpl, env);
+    _pimpl->Threads.emplace_back(ThreadFunc, i + nStartId, numa_node == NUMA_SPREAD ? (int)i : numa_node, _pimpl, env);
 
   _pimpl->NumRunning = nThreads;
 }
@@ -116,6 +120,11 @@ size_t ThreadPool::NumThreads() const
   return _pimpl->Threads.size();
 }
 
+size_t ThreadPool::QueueDepth() const
+{
+  return _pimpl->MsgQueue.size();
+}
+
 std::vector<void*> ThreadPool::Finish()
 {
   std::unique_lock<std::mutex> lock(_pimpl->Mutex);
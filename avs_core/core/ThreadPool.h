@@ -107,13 +107,17 @@ class ThreadPool
 private:
   ThreadPoolPimpl* const _pimpl;
 
-  static void ThreadFunc(size_t thread_id, ThreadPoolPimpl* const _pimpl, InternalEnvironment* env);
+  static void ThreadFunc(size_t thread_id, int numa_node, ThreadPoolPimpl* const _pimpl, InternalEnvironment* env);
 public:
-  ThreadPool(size_t nThreads, size_t nStartId, InternalEnvironment* env);
+  // numa_node: on NUMA machines the workers are pinned to this node, spread over
+  // the nodes round robin with NUMA_SPREAD, or left unpinned with -1
+  static constexpr int NUMA_SPREAD = -2;
+  ThreadPool(size_t nThreads, size_t nStartId, InternalEnvironment* env, int numa_node = -1);
   ~ThreadPool();
 
   void QueueJob(ThreadWorkerFuncPtr clb, void* params, InternalEnvironment* env, JobCompletion* tc);
   size_t NumThreads() const;
+  size_t QueueDepth() const; // jobs waiting for a free worker
 
   std::vector<void*> Finish();
   void Join();
@@ -45,8 +45,13 @@
 
 #include "audio.h"
 #include "../convert/convert_audio.h"
+#ifdef INTEL_INTRINSICS
+#include "intel/audio_sse.h"
+#include "intel/audio_avx2.h"
+#endif
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <new>
 #include <algorithm>
 
@@ -93,6 +98,23 @@ static int64_t signed_saturated_add64(int64_t x, int64_t y) {
   return ret;
 }
 
+// Per-thread pooled scratch buffer of a GetAudio call. Returned to the pool on
+// every exit path, also when a child GetAudio throws.
+class PooledAudioBuffer {
+  IScriptEnvironment* env;
+  char* ptr;
+public:
+  PooledAudioBuffer(size_t size, const char* name, IScriptEnvironment* _env) : env(_env) {
+    ptr = static_cast<char*>(env->Allocate(size, 16, AVS_POOLED_ALLOC));
+    if (!ptr)
+      env->ThrowError("%s: Could not reserve memory.", name);
+  }
+  ~PooledAudioBuffer() { env->Free(ptr); }
+  PooledAudioBuffer(const PooledAudioBuffer&) = delete;
+  PooledAudioBuffer& operator=(const PooledAudioBuffer&) = delete;
+  char* get() const { return ptr; }
+};
+
 // ----------- Channels
 // ffmpeg extras are not handled, only the first 18 bits
 // which is defined in WAVEFORMATEXTENSIBLE and Avisynth.h AvsChannelMask
@@ -431,30 +453,31 @@ AVSValue __cdecl AssumeRate::Create(AVSValue args, void*, IScriptEnvironment*) {
  *****************************************/
 
 ConvertToMono::ConvertToMono(PClip _clip) :
-  GenericVideoFilter(ConvertAudio::Create(_clip, SAMPLE_INT16 | SAMPLE_FLOAT, SAMPLE_FLOAT)),
-  tempbuffer(NULL)
+  GenericVideoFilter(ConvertAudio::Create(_clip, SAMPLE_INT16 | SAMPLE_FLOAT, SAMPLE_FLOAT))
 {
   channels = vi.AudioChannels();
   vi.nchannels = 1;
   vi.SetChannelMask(true, AvsChannelMask::MASK_SPEAKER_FRONT_CENTER);
-  tempbuffer_size = 0;
 }
 
 
 void __stdcall ConvertToMono::GetAudio(void* buf, int64_t start, int64_t count, IScriptEnvironment* env) {
-  if (tempbuffer_size) {
-    if (tempbuffer_size < count) {
-      delete[] tempbuffer;
-      tempbuffer = new char[(unsigned)(count * channels * vi.BytesPerChannelSample())];
-      tempbuffer_size = (int)count;
-    }
-  } else {
-    tempbuffer = new char[(unsigned)(count * channels * vi.BytesPerChannelSample())];
-    tempbuffer_size = (int)count;
-  }
+  // pooled buffers are per-thread and reused between calls
+  PooledAudioBuffer scratch((size_t)count * channels * vi.BytesPerChannelSample(), "ConvertToMono", env);
+  char* tempbuffer = scratch.get();
 
   child->GetAudio(tempbuffer, start, count, env);
 
+#ifdef INTEL_INTRINSICS
+  if (channels == 2 && (env->GetCPUFlags() & CPUF_SSE2)) {
+    if (vi.IsSampleType(SAMPLE_INT16))
+      downmix_stereo_int16_sse2((const int16_t*)tempbuffer, (int16_t*)buf, (int)count);
+    else
+      downmix_stereo_float_sse2((const SFLOAT*)tempbuffer, (SFLOAT*)buf, (int)count);
+    return;
+  }
+#endif
+
   if (vi.IsSampleType(SAMPLE_INT16)) {
     signed short* samples = (signed short*)buf;
     signed short* tempsamples = (signed short*)tempbuffer;
@@ -486,7 +509,7 @@ int __stdcall ConvertToMono::SetCacheHints(int cachehints, int frame_range) {
 
   switch (cachehints) {
   case CACHE_GET_MTMODE:
-    return MT_SERIALIZED;
+    return MT_NICE_FILTER;
   default:
     break;
   }
@@ -582,6 +605,59 @@ AVSValue __cdecl EnsureVBRMP3Sync::Create(AVSValue args, void*, IScriptEnvironme
 }
 
 
+/*******************************************
+ *******   Channel (de)interleave helpers ***
+ *******************************************/
+
+struct sample24_t { uint8_t b[3]; };
+
+// copies 'channels' adjacent channels from each audio sample of src to dst
+template<typename sample_t>
+static void copy_channels_strided_c(const void* _src, int src_channels, void* _dst, int dst_channels, int channels, int count)
+{
+  const sample_t* src = reinterpret_cast<const sample_t*>(_src);
+  sample_t* dst = reinterpret_cast<sample_t*>(_dst);
+  for (int i = 0; i < count; i++) {
+    for (int c = 0; c < channels; c++)
+      dst[c] = src[c];
+    src += src_channels;
+    dst += dst_channels;
+  }
+}
+
+static void copy_channels_strided(int bpcs, const void* src, int src_channels, void* dst, int dst_channels, int channels, int count)
+{
+  switch (bpcs) {
+  case 1: copy_channels_strided_c<uint8_t>(src, src_channels, dst, dst_channels, channels, count); break;
+  case 2: copy_channels_strided_c<uint16_t>(src, src_channels, dst, dst_channels, channels, count); break;
+  case 3: copy_channels_strided_c<sample24_t>(src, src_channels, dst, dst_channels, channels, count); break;
+  case 4: copy_channels_strided_c<uint32_t>(src, src_channels, dst, dst_channels, channels, count); break;
+  }
+}
+
+// gathers the listed channels of each audio sample in their given order
+template<typename sample_t>
+static void pick_channels_c(const void* _src, int src_channels, void* _dst, const int* channel, int numchannels, int count)
+{
+  const sample_t* src = reinterpret_cast<const sample_t*>(_src);
+  sample_t* dst = reinterpret_cast<sample_t*>(_dst);
+  for (int i = 0; i < count; i++) {
+    for (int k = 0; k < numchannels; k++)
+      *dst++ = src[channel[k]];
+    src += src_channels;
+  }
+}
+
+static void pick_channels(int bpcs, const void* src, int src_channels, void* dst, const int* channel, int numchannels, int count)
+{
+  switch (bpcs) {
+  case 1: pick_channels_c<uint8_t>(src, src_channels, dst, channel, numchannels, count); break;
+  case 2: pick_channels_c<uint16_t>(src, src_channels, dst, channel, numchannels, count); break;
+  case 3: pick_channels_c<sample24_t>(src, src_channels, dst, channel, numchannels, count); break;
+  case 4: pick_channels_c<uint32_t>(src, src_channels, dst, channel, numchannels, count); break;
+  }
+}
+
 /*******************************************
  *******   Mux 'N' sources, so the      ****
  *******   total channels is the sum of ****
@@ -589,10 +665,9 @@ AVSValue __cdecl EnsureVBRMP3Sync::Create(AVSValue args, void*, IScriptEnvironme
  *******************************************/
 
 MergeChannels::MergeChannels(PClip _clip, int _num_children, PClip* _child_array, IScriptEnvironment* env) :
-  GenericVideoFilter(_clip), tempbuffer(NULL), child_array(_child_array), num_children(_num_children)
+  GenericVideoFilter(_clip), child_array(_child_array), num_children(_num_children)
 {
   clip_channels = new int[num_children];
-  clip_offset = new signed char * [num_children];
   clip_channels[0] = vi.AudioChannels();
 
   for (int i = 1;i < num_children;i++) {
@@ -613,116 +688,59 @@ MergeChannels::MergeChannels(PClip _clip, int _num_children, PClip* _child_array
     vi.SetChannelMask(true, GetDefaultChannelLayout(vi.AudioChannels()));
   else
     vi.SetChannelMask(false, 0); // over 8: no guess
-
-  tempbuffer_size = 0;
 }
 
 MergeChannels::~MergeChannels() {
-  if (tempbuffer_size) {
-    delete[] tempbuffer;
-    tempbuffer_size=0;
-  }
   delete[] clip_channels;
-  delete[] clip_offset;
   delete[] child_array;
 }
 
 
 void __stdcall MergeChannels::GetAudio(void* buf, int64_t start, int64_t count, IScriptEnvironment* env) {
-  if (tempbuffer_size < count) {
-    if (tempbuffer_size) delete[] tempbuffer;
-    tempbuffer = new signed char[(unsigned)(count * vi.BytesPerAudioSample())];
-    tempbuffer_size = (int)count;
-  }
+  const int bpcs = vi.BytesPerChannelSample();
+  PooledAudioBuffer scratch((size_t)count * vi.BytesPerAudioSample(), "MergeChannels", env);
+  signed char* tempbuffer = reinterpret_cast<signed char*>(scratch.get());
+
   // Get audio:
-  const int channel_offset = (int)count * vi.BytesPerChannelSample();  // Offset per channel
+  const size_t channel_offset = (size_t)count * bpcs;  // Offset per channel
   int i, c_channel = 0;
 
   for (i = 0;i < num_children;i++) {
     child_array[i]->GetAudio(tempbuffer + (c_channel*channel_offset), start, count, env);
-    clip_offset[i] = tempbuffer + (c_channel * channel_offset);
     c_channel += clip_channels[i];
   }
 
+#ifdef INTEL_INTRINSICS
+  // mono + mono: the MonoToStereo case
+  if (num_children == 2 && clip_channels[0] == 1 && clip_channels[1] == 1 && (bpcs == 2 || bpcs == 4)
+    && (env->GetCPUFlags() & CPUF_SSE2)) {
+    if (bpcs == 2)
+      interleave_mono2_16_sse2((const int16_t*)tempbuffer, (const int16_t*)(tempbuffer + channel_offset), (int16_t*)buf, (int)count);
+    else
+      interleave_mono2_32_sse2((const int32_t*)tempbuffer, (const int32_t*)(tempbuffer + channel_offset), (int32_t*)buf, (int)count);
+    return;
+  }
+#endif
+
   // Interleave channels
   char* samples = (char*) buf;
-  const int bpcs = vi.BytesPerChannelSample();
-  const int bps = vi.BytesPerAudioSample();
-  int dst_offset = 0;
+  const int channels = vi.AudioChannels();
+  c_channel = 0;
   for (i = 0;i < num_children;i++) {
-    signed char* src_buf = clip_offset[i];
-  const int bpcc = bpcs*clip_channels[i];
-
-  switch (bpcc) {
+    copy_channels_strided(bpcs, tempbuffer + (c_channel * channel_offset), clip_channels[i],
+      samples + c_channel * bpcs, channels, clip_channels[i], (int)count);
+    c_channel += clip_channels[i];
+  }
+}
 
-  case 2: { // mono 16 bit
-        for (int l = 0, k=dst_offset; l < count; l++, k+=bps) {
-          *(short*)(samples+k) = ((short*)src_buf)[l];
-        }
-        break;
-      }
-  case 4: { // mono float/32 bit, stereo 16 bit
-        for (int l = 0, k=dst_offset; l < count; l++, k+=bps) {
-          *(int*)(samples+k) = ((int*)src_buf)[l];
-        }
-        break;
-      }
-  case 8: { // stereo float/32 bit
-#ifdef INTEL_INTRINSICS
-#if defined(X86_32) && defined(MSVC)
-    if (env->GetCPUFlags() & CPUF_MMX)
-    {
-      __asm
-      {
-        mov eax,[src_buf]
-        mov edi,[samples]
-        mov ecx,dword ptr[count]
-        add edi,[dst_offset]
-        test ecx,ecx
-        mov edx,[bps]    ; bytes per strip
-        jz done
-        shr ecx,1        ; CF=count&1, count>>=1
-        jnc label        ; count was even
-
-        movq mm1,[eax]    ; do 1 odd quad
-        add eax,8
-        movq [edi],mm1
-        add edi,edx
-        test ecx,ecx
-        jz done
-        align 16
-      label:
-        movq mm0,[eax]    ; do pairs of quads
-        movq mm1,[eax+8]
-        add eax,16
-        movq [edi],mm0
-        movq [edi+edx],mm1
-        lea edi,[edi+edx*2]
-        loop label
-      done:
-        emms
-      }
-    }
-    else
-#endif // X86_32
-#endif
-    {
-      for (int l = 0, k=dst_offset; l < count; l++, k+=bps)
-      {
-        *(int64_t*)(samples+k) = ((int64_t*)src_buf)[l];
-      }
-    }
-        break;
-      }
-  default: { // everything else, 1 byte at a time
-        for (int l = 0; l < count; l++) {
-          for (int k = 0; k < bpcc; k++) {
-            samples[dst_offset + (l*bps) + k] = src_buf[(l*bpcc) + k];
-          }
-        }
-      }
-    }
-    dst_offset += bpcc;
+void __stdcall MergeChannels::GetAudioPlanar(void** bufs, int64_t start, int64_t count, IScriptEnvironment* env) {
+  // route the channel buffers to the children, a child with no wanted channel is not asked
+  int c_channel = 0;
+  for (int i = 0; i < num_children; i++) {
+    void** child_bufs = bufs + c_channel;
+    c_channel += clip_channels[i];
+    if (std::any_of(child_bufs, child_bufs + clip_channels[i], [](void* p) { return p != nullptr; }))
+      ::GetAudioPlanar(child_array[i], child_bufs, start, count, env);
   }
 }
 
@@ -731,7 +749,9 @@ int __stdcall MergeChannels::SetCacheHints(int cachehints, int frame_range) {
 
   switch (cachehints) {
   case CACHE_GET_MTMODE:
-    return MT_SERIALIZED;
+    return MT_NICE_FILTER;
+  case CACHE_GET_AUDIO_PLANAR_REQ:
+    return CACHE_GET_AUDIO_PLANAR_ANS;
   default:
     break;
   }
@@ -771,13 +791,13 @@ AVSValue __cdecl MergeChannels::Create(AVSValue args, void*, IScriptEnvironment*
 
 
 GetChannel::GetChannel(PClip _clip, int* _channel, int _numchannels) :
-  GenericVideoFilter(_clip), tempbuffer(NULL), channel(_channel), numchannels(_numchannels)
+  GenericVideoFilter(_clip), channel(_channel), numchannels(_numchannels)
 {
   cbps = vi.BytesPerChannelSample();
   src_bps = vi.BytesPerAudioSample();
   vi.nchannels = numchannels;
-  tempbuffer_size = 0;
   dst_bps = vi.BytesPerAudioSample();
+  child_planar = HasAudioPlanar(child);
 
   if (vi.AudioChannels() <= 8)
     vi.SetChannelMask(true, GetDefaultChannelLayout(vi.AudioChannels()));
@@ -787,61 +807,56 @@ GetChannel::GetChannel(PClip _clip, int* _channel, int _numchannels) :
 
 
 void __stdcall GetChannel::GetAudio(void* buf, int64_t start, int64_t count, IScriptEnvironment* env) {
-  if (tempbuffer_size < count) {
-    if (tempbuffer_size) delete[] tempbuffer;
-    tempbuffer = new char[(unsigned)(count * src_bps)];
-    tempbuffer_size = (int)count;
+  if (child_planar) {
+    // fetch only the selected channels, then interleave them
+    PooledAudioBuffer scratch((size_t)count * dst_bps, "GetChannel", env);
+    char* tempbuffer = scratch.get();
+    std::vector<void*> bufs(numchannels);
+    for (int k = 0; k < numchannels; k++)
+      bufs[k] = tempbuffer + (size_t)k * count * cbps;
+    GetAudioPlanar(bufs.data(), start, count, env);
+    InterleaveAudio(bufs.data(), buf, numchannels, cbps, (int)count, env);
+    return;
   }
+
+  PooledAudioBuffer scratch((size_t)count * src_bps, "GetChannel", env);
+  char* tempbuffer = scratch.get();
   child->GetAudio(tempbuffer, start, count, env);
 
-  switch (cbps) {
-  case 1: {    // 8 bit
-      char* samples = (char*)buf;
-      char* tbuff = tempbuffer;
-      for (int i = 0; i < count; i++) {
-        for (int k = 0; k < numchannels; k++) {
-          *(samples++) = tbuff[channel[k]];
-        }
-        tbuff += src_bps;
-      }
-    break;
-    }
-  case 2: {    // 16 bit
-      short* samples = (short*)buf;
-      short* tbuff = (short*)tempbuffer;
-      for (int i = 0; i < count; i++) {
-        for (int k = 0; k < numchannels; k++) {
-          *(samples++) = tbuff[channel[k]];
-        }
-        tbuff += src_bps>>1;
-      }
-    break;
-    }
-  case 4: {    // float/32 bit
-      int* samples = (int*)buf;
-      int* tbuff = (int*)tempbuffer;
-      for (int i = 0; i < count; i++) {
-        for (int k = 0; k < numchannels; k++) {
-          *(samples++) = tbuff[channel[k]];
-        }
-        tbuff += src_bps>>2;
-      }
-    break;
-    }
-  default: {  // 24 bit, etc
-      char* samples = (char*)buf;
-      char* tbuff = tempbuffer;
-      for (int i = 0; i < count; i++) {
-        for (int k = 0; k < numchannels; k++) {
-          int src_o = channel[k] * cbps;
-          for (int j = src_o; j < src_o+cbps; j++)
-            *(samples++) = tbuff[j];
-        }
-        tbuff += src_bps;
-      }
-    break;
+  const int src_channels = src_bps / cbps;
+#ifdef INTEL_INTRINSICS
+  if (src_channels == 2 && numchannels == 1 && (cbps == 2 || cbps == 4) && (env->GetCPUFlags() & CPUF_SSE2)) {
+    if (cbps == 2)
+      extract_stereo_channel_16_sse2((const int16_t*)tempbuffer, (int16_t*)buf, channel[0], (int)count);
+    else
+      extract_stereo_channel_32_sse2((const int32_t*)tempbuffer, (int32_t*)buf, channel[0], (int)count);
+    return;
+  }
+#endif
+  pick_channels(cbps, tempbuffer, src_channels, buf, channel, numchannels, (int)count);
+}
+
+void __stdcall GetChannel::GetAudioPlanar(void** bufs, int64_t start, int64_t count, IScriptEnvironment* env) {
+  // Unselected source channels stay nullptr, the child may skip them.
+  // A source channel selected more than once is fetched once and copied.
+  const int src_channels = src_bps / cbps;
+  std::vector<void*> child_bufs(src_channels, nullptr);
+  bool any = false;
+  for (int k = 0; k < numchannels; k++) {
+    if (bufs[k] && !child_bufs[channel[k]]) {
+      child_bufs[channel[k]] = bufs[k];
+      any = true;
     }
   }
+  if (!any)
+    return;
+
+  ::GetAudioPlanar(child, child_bufs.data(), start, count, env);
+
+  for (int k = 0; k < numchannels; k++) {
+    if (bufs[k] && bufs[k] != child_bufs[channel[k]])
+      memcpy(bufs[k], child_bufs[channel[k]], (size_t)count * cbps);
+  }
 }
 
 int __stdcall GetChannel::SetCacheHints(int cachehints, int frame_range) {
@@ -849,7 +864,9 @@ int __stdcall GetChannel::SetCacheHints(int cachehints, int frame_range) {
 
   switch (cachehints) {
   case CACHE_GET_MTMODE:
-    return MT_SERIALIZED;
+    return MT_NICE_FILTER;
+  case CACHE_GET_AUDIO_PLANAR_REQ:
+    return CACHE_GET_AUDIO_PLANAR_ANS;
   default:
     break;
   }
@@ -879,6 +896,17 @@ PClip GetChannel::Create_right(PClip clip) {
 }
 
 PClip GetChannel::Create_n(PClip clip, int* n, int numchannels) {
+  const VideoInfo& vi_src = clip->GetVideoInfo();
+  bool identity = numchannels == vi_src.AudioChannels();
+  for (int k = 0; identity && k < numchannels; k++)
+    identity = n[k] == k;
+  if (identity) {
+    // all channels in their original order: no copy, only the channel mask is reset
+    delete[] n;
+    if (numchannels <= 8)
+      return new SetChannelMask(clip, true, GetDefaultChannelLayout(numchannels));
+    return new SetChannelMask(clip, false, 0); // over 8: no guess
+  }
   return new GetChannel(clip, n, numchannels);
 }
 
@@ -997,7 +1025,20 @@ AVSValue __cdecl DelayAudio::Create(AVSValue args, void*, IScriptEnvironment*) {
 
 Amplify::Amplify(PClip _child, float* _volumes, int* _i_v)
     : GenericVideoFilter(ConvertAudio::Create(_child, SAMPLE_INT16 | SAMPLE_FLOAT | SAMPLE_INT32, SAMPLE_FLOAT)),
-volumes(_volumes), i_v(_i_v) { }
+volumes(_volumes), i_v(_i_v)
+{
+  const int channels = vi.AudioChannels();
+  volumes_simd.resize(channels * 8);
+  i_v_simd.resize(channels * 8);
+  volumes_planar.resize(channels * 8);
+  i_v_planar.resize(channels * 8);
+  for (int k = 0; k < channels * 8; k++) {
+    volumes_simd[k] = volumes[k % channels];
+    i_v_simd[k] = (double)i_v[k % channels];
+    volumes_planar[k] = volumes[k / 8];
+    i_v_planar[k] = (double)i_v[k / 8];
+  }
+}
 
 
 Amplify::~Amplify()
@@ -1013,6 +1054,12 @@ void __stdcall Amplify::GetAudio(void* buf, int64_t start, int64_t count, IScrip
   int countXchannels = (int)count*channels;
 
   if (vi.SampleType() == SAMPLE_INT16) {
+#ifdef INTEL_INTRINSICS
+    if (env->GetCPUFlags() & CPUF_SSE2) {
+      amplify_int16_sse2((int16_t*)buf, i_v_simd.data(), channels, (int)count);
+      return;
+    }
+#endif
 #if defined(X86_32) && defined(MSVC)
     const short* endsample = (short*)buf + countXchannels;
     const int* iv = i_v;
@@ -1120,6 +1167,16 @@ saturate1:
     return ;
   }
   if (vi.SampleType() == SAMPLE_FLOAT) {
+#ifdef INTEL_INTRINSICS
+    if (env->GetCPUFlags() & CPUF_AVX2) {
+      amplify_float_avx2((SFLOAT*)buf, volumes_simd.data(), channels, (int)count);
+      return;
+    }
+    if (env->GetCPUFlags() & CPUF_SSE2) {
+      amplify_float_sse2((SFLOAT*)buf, volumes_simd.data(), channels, (int)count);
+      return;
+    }
+#endif
     SFLOAT* samples = (SFLOAT*)buf;
     for (int i = 0; i < countXchannels; i+=channels) {
       for (int j = 0;j < channels;j++) {				// Does not saturate, as other filters do.
@@ -1131,6 +1188,66 @@ saturate1:
 }
 
 
+void __stdcall Amplify::GetAudioPlanar(void** bufs, int64_t start, int64_t count, IScriptEnvironment* env) {
+  ::GetAudioPlanar(child, bufs, start, count, env);
+  const int channels = vi.AudioChannels();
+  const int icount = (int)count;
+
+  for (int c = 0; c < channels; c++) {
+    if (!bufs[c])
+      continue;
+    if (vi.SampleType() == SAMPLE_INT16) {
+#ifdef INTEL_INTRINSICS
+      if (env->GetCPUFlags() & CPUF_SSE2) {
+        amplify_int16_sse2((int16_t*)bufs[c], &i_v_planar[c * 8], 1, icount);
+        continue;
+      }
+#endif
+      short* samples = (short*)bufs[c];
+      for (int i = 0; i < icount; i++)
+        samples[i] = (short)clamp(
+          signed_saturated_add64(Int32x32To64(samples[i], i_v[c]), 65536) >> 17,
+          (int64_t)INT16_MIN,
+          (int64_t)INT16_MAX);
+    }
+    else if (vi.SampleType() == SAMPLE_INT32) {
+      int* samples = (int*)bufs[c];
+      for (int i = 0; i < icount; i++)
+        samples[i] = (int)clamp(
+          signed_saturated_add64(Int32x32To64(samples[i], i_v[c]), 65536) >> 17,
+          (int64_t)INT32_MIN,
+          (int64_t)INT32_MAX);
+    }
+    else if (vi.SampleType() == SAMPLE_FLOAT) {
+#ifdef INTEL_INTRINSICS
+      if (env->GetCPUFlags() & CPUF_AVX2) {
+        amplify_float_avx2((SFLOAT*)bufs[c], &volumes_planar[c * 8], 1, icount);
+        continue;
+      }
+      if (env->GetCPUFlags() & CPUF_SSE2) {
+        amplify_float_sse2((SFLOAT*)bufs[c], &volumes_planar[c * 8], 1, icount);
+        continue;
+      }
+#endif
+      SFLOAT* samples = (SFLOAT*)bufs[c];
+      for (int i = 0; i < icount; i++)
+        samples[i] = samples[i] * volumes[c];
+    }
+  }
+}
+
+int __stdcall Amplify::SetCacheHints(int cachehints, int frame_range) {
+  AVS_UNUSED(frame_range);
+
+  switch (cachehints) {
+  case CACHE_GET_AUDIO_PLANAR_REQ:
+    return CACHE_GET_AUDIO_PLANAR_ANS;
+  default:
+    break;
+  }
+  return 0;
+}
+
 AVSValue __cdecl Amplify::Create(AVSValue args, void*, IScriptEnvironment*) {
   if (!args[0].AsClip()->GetVideoInfo().AudioChannels())
     return args[0];
@@ -1409,7 +1526,6 @@ AVSValue __cdecl Normalize::Create(AVSValue args, void*, IScriptEnvironment*) {
 
 MixAudio::MixAudio(PClip _child, PClip _clip, double _track1_factor, double _track2_factor, IScriptEnvironment* env) :
   GenericVideoFilter(ConvertAudio::Create(_child, SAMPLE_INT16 | SAMPLE_FLOAT, SAMPLE_FLOAT)),
-  tempbuffer(NULL),
   track1_factor(int(_track1_factor*131072.0 + 0.5)),
   track2_factor(int(_track2_factor*131072.0 + 0.5)),
   t1factor(float(_track1_factor)),
@@ -1423,25 +1539,35 @@ MixAudio::MixAudio(PClip _child, PClip _clip, double _track1_factor, double _tra
 
   if (vi.AudioChannels() != vi2.AudioChannels())
     env->ThrowError("MixAudio: Clips must have same number of channels! Use ConvertToMono() or MergeChannels()!");
-
-  tempbuffer_size = 0;
 }
 
 
 void __stdcall MixAudio::GetAudio(void* buf, int64_t start, int64_t count, IScriptEnvironment* env) {
-  if (tempbuffer_size < count)
-  {
-    if (tempbuffer_size)
-      delete[] tempbuffer;
-
-    tempbuffer = new signed char[(size_t)(count * vi.BytesPerAudioSample())];
-    tempbuffer_size = (int)count;
-  }
+  PooledAudioBuffer scratch((size_t)count * vi.BytesPerAudioSample(), "MixAudio", env);
+  signed char* tempbuffer = reinterpret_cast<signed char*>(scratch.get());
 
   child->GetAudio(buf, start, count, env);
   clip->GetAudio(tempbuffer, start, count, env);
   unsigned channels = vi.AudioChannels();
 
+#ifdef INTEL_INTRINSICS
+  const int n = (int)count * channels;
+  if (vi.SampleType() & SAMPLE_FLOAT) {
+    if (env->GetCPUFlags() & CPUF_AVX2) {
+      mix_float_avx2((SFLOAT*)buf, (const SFLOAT*)tempbuffer, t1factor, t2factor, n);
+      return;
+    }
+    if (env->GetCPUFlags() & CPUF_SSE2) {
+      mix_float_sse2((SFLOAT*)buf, (const SFLOAT*)tempbuffer, t1factor, t2factor, n);
+      return;
+    }
+  }
+  else if ((vi.SampleType() & SAMPLE_INT16) && (env->GetCPUFlags() & CPUF_SSE2)) {
+    mix_int16_sse2((int16_t*)buf, (const int16_t*)tempbuffer, track1_factor, track2_factor, n);
+    return;
+  }
+#endif
+
   if (vi.SampleType()&SAMPLE_INT16) {
 #if defined(X86_32) && defined(MSVC)
     const short* tbuffer = (short*)tempbuffer;
@@ -1510,7 +1636,7 @@ int __stdcall MixAudio::SetCacheHints(int cachehints, int frame_range) {
 
   switch (cachehints) {
   case CACHE_GET_MTMODE:
-    return MT_SERIALIZED;
+    return MT_NICE_FILTER;
   default:
     break;
   }
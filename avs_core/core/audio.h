@@ -35,7 +35,9 @@
 #define __Audio_H__
 
 #include <avisynth.h>
+#include "AudioPlanar.h"
 #include <cmath>
+#include <vector>
 
 // ------- Channels, only 0..17, SPEAKER_ALL not handled here
 enum AVSChannel {
@@ -199,8 +201,6 @@ class ConvertToMono : public GenericVideoFilter
 {
 public:
   ConvertToMono(PClip _clip);
-  virtual ~ConvertToMono()
-  {if (tempbuffer_size) {delete[] tempbuffer;tempbuffer_size=0;}}
 
   void __stdcall GetAudio(void* buf, int64_t start, int64_t count, IScriptEnvironment* env);
   int __stdcall SetCacheHints(int cachehints, int frame_range);
@@ -208,8 +208,6 @@ public:
   static AVSValue __cdecl Create(AVSValue args, void*, IScriptEnvironment*);
 
 private:
-  char *tempbuffer;
-  int tempbuffer_size;
   int channels;
 };
 
@@ -229,7 +227,7 @@ private:
   int64_t last_end;
 };
 
-class MergeChannels : public GenericVideoFilter
+class MergeChannels : public GenericVideoFilter, public IAudioPlanar
 /**
   * Class to convert two mono sources to stereo
  **/
@@ -239,20 +237,18 @@ public:
   ~MergeChannels();
 
   void __stdcall GetAudio(void* buf, int64_t start, int64_t count, IScriptEnvironment* env);
+  void __stdcall GetAudioPlanar(void** bufs, int64_t start, int64_t count, IScriptEnvironment* env);
   int __stdcall SetCacheHints(int cachehints, int frame_range);
   static AVSValue __cdecl Create(AVSValue args, void*, IScriptEnvironment*);
 
 private:
   int* clip_channels;
-  signed char** clip_offset;
-  signed char *tempbuffer;
   PClip* child_array;
   const int num_children;
-  int tempbuffer_size;
 };
 
 
-class GetChannel : public GenericVideoFilter
+class GetChannel : public GenericVideoFilter, public IAudioPlanar
 /**
   * Class to get left or right channel from stereo source
  **/
@@ -261,11 +257,11 @@ public:
   GetChannel(PClip _clip, int* _channel, int numchannels);
   virtual ~GetChannel()
   {
-    if (tempbuffer_size) {delete[] tempbuffer;tempbuffer_size=0;}
     if (channel)         {delete[] channel;   channel=0;        }
   }
 
   void __stdcall GetAudio(void* buf, int64_t start, int64_t count, IScriptEnvironment* env);
+  void __stdcall GetAudioPlanar(void** bufs, int64_t start, int64_t count, IScriptEnvironment* env);
   int __stdcall SetCacheHints(int cachehints, int frame_range);
   static PClip Create_left(PClip clip);
   static PClip Create_right(PClip clip);
@@ -275,13 +271,12 @@ public:
   static AVSValue __cdecl Create_n(AVSValue args, void*, IScriptEnvironment* env);
 
 private:
-  char *tempbuffer;
   int* channel;
-  int tempbuffer_size;
   int numchannels;
   int cbps;
   int src_bps;
   int dst_bps;
+  bool child_planar;
 };
 
 class KillVideo : public GenericVideoFilter
@@ -334,7 +329,7 @@ private:
 
 
 
-class Amplify : public GenericVideoFilter
+class Amplify : public GenericVideoFilter, public IAudioPlanar
 /**
   * Amplify a clip's audio track
  **/
@@ -343,6 +338,8 @@ public:
   Amplify(PClip _child, float* _volumes, int* _i_v);
   ~Amplify();
   void __stdcall GetAudio(void* buf, int64_t start, int64_t count, IScriptEnvironment* env);
+  void __stdcall GetAudioPlanar(void** bufs, int64_t start, int64_t count, IScriptEnvironment* env);
+  int __stdcall SetCacheHints(int cachehints, int frame_range);
 
   static AVSValue __cdecl Create(AVSValue args, void*, IScriptEnvironment* env);
   static AVSValue __cdecl Create_dB(AVSValue args, void*, IScriptEnvironment* env);
@@ -351,6 +348,12 @@ public:
 private:
   const float* volumes;
   const int* i_v;
+  // per-channel gains repeated over 8 audio samples, for the SIMD kernels
+  std::vector<float> volumes_simd;
+  std::vector<double> i_v_simd;
+  // the same, but each channel's gain repeated 8 times, for single channel buffers
+  std::vector<float> volumes_planar;
+  std::vector<double> i_v_planar;
 
  static __inline float dBtoScaleFactorf(float dB)
  { return powf(10.0f, dB/20.0f);};
@@ -391,15 +394,12 @@ public:
   void __stdcall GetAudio(void* buf, int64_t start, int64_t count, IScriptEnvironment* env);
   int __stdcall SetCacheHints(int cachehints, int frame_range);
   static AVSValue __cdecl Create(AVSValue args, void*, IScriptEnvironment* env);
-  virtual ~MixAudio() {if (tempbuffer_size) delete[] tempbuffer;tempbuffer_size=0;}
 
 
 private:
   PClip clip;
-  signed char *tempbuffer;
   const int track1_factor, track2_factor;
   const float t1factor, t2factor;
-  int tempbuffer_size;
 };
 
 
@@ -92,6 +92,8 @@
 #include "FilterGraph.h"
 #include "DeviceManager.h"
 #include "AVSMap.h"
+#include "PerformanceCounters.h"
+#include "NumaTopology.h"
 
 #ifndef YieldProcessor // low power spin idle
   #define YieldProcessor() __nop(void)
@@ -128,7 +130,9 @@ extern const AVSFunction Audio_filters[],
                          Overlay_filters[],
                          Exprfilter_filters[],
                          FilterGraph_filters[],
-                         Device_filters[]
+                         Device_filters[],
+                         SharedMemory_filters[],
+                         RenderToFile_filters[]
 ;
 
 
@@ -164,9 +168,24 @@ const AVSFunction* const builtin_functions[] = {
                          Swap_filters,
                          FilterGraph_filters,
                          Device_filters,
-                         Exprfilter_filters
+                         Exprfilter_filters,
+                         SharedMemory_filters,
+                         RenderToFile_filters
 };
 
+// builtin_functions indexed by name, overloads kept in table order
+static const FunctionMap& GetBuiltinFunctionMap()
+{
+  static const FunctionMap map = []() {
+    FunctionMap m;
+    for (const AVSFunction* const functions : builtin_functions)
+      for (const AVSFunction* f = functions; !f->empty(); ++f)
+        m[f->name].push_back(f);
+    return m;
+  }();
+  return map;
+}
+
 #if 0
 // Global statistics counters
 struct {
@@ -507,7 +526,8 @@ VideoFrameBuffer::VideoFrameBuffer() :
   data_size(0),
   sequence_number(0),
   refcount(1),
-  device(nullptr)
+  device(nullptr),
+  external(0)
 { }
 
 
@@ -516,7 +536,8 @@ VideoFrameBuffer::VideoFrameBuffer(int size, int margin, Device* device) :
   data_size(size),
   sequence_number(0),
   refcount(0),
-  device(device)
+  device(device),
+  external(0)
 { }
 
 VideoFrameBuffer::~VideoFrameBuffer() { DESTRUCTOR(); }
@@ -864,7 +885,7 @@ public:
 
   PVideoFrame GetOnDeviceFrame(const PVideoFrame& src, Device* device);
   void ParallelJob(ThreadWorkerFuncPtr jobFunc, void* jobData, IJobCompletion* completion, InternalEnvironment *env);
-  ThreadPool* NewThreadPool(size_t nThreads);
+  ThreadPool* NewThreadPool(size_t nThreads, int numa_node);
   void SetGraphAnalysis(bool enable) { graphAnalysisEnable = enable; }
 
   char* ListAutoloadDirs();
@@ -875,6 +896,7 @@ public:
   ConcurrentVarStringFrame* GetTopFrame() { return &top_frame; }
   void SetCacheMode(CacheMode mode) { cacheMode = mode; }
   CacheMode GetCacheMode() { return cacheMode; }
+  PerformanceCounters& GetPerformanceCounters() { return perf_counters; }
   void SetDeviceOpt(DeviceOpt opt, int val);
 
   void UpdateFunctionExports(const char* funcName, const char* funcParams, const char* exportVar);
@@ -882,6 +904,11 @@ public:
   // public, AVSMap error should access
   void ThrowError(const char* fmt, ...);
 
+  PVideoFrame NewVideoFrameFromBuffer(const VideoInfo& vi, BYTE* const* planes, const int* pitches,
+    IScriptEnvironment::ExternalReleaseFunc release, void* user_data, bool writable);
+  // called from VideoFrame::Release when the last frame of a NewVideoFrameFromBuffer buffer is gone
+  static void ExternalBufferReleased(VideoFrameBuffer* vfb);
+
   ThreadScriptEnvironment* GetMainThreadEnv() { return threadEnv.get(); }
 
 private:
@@ -939,18 +966,21 @@ private:
   public:
     int free_count;
     int margin;
+    int numa_node; // node of the allocating thread, CPU buffers are reused on the same node first
     PGraphMemoryNode memory_node;
 
     VFBStorage()
       : VideoFrameBuffer(),
       free_count(0),
-      margin(0)
+      margin(0),
+      numa_node(0)
     { }
 
     VFBStorage(int size, int margin, Device* device)
       : VideoFrameBuffer(size, margin, device),
       free_count(0),
-      margin(margin)
+      margin(margin),
+      numa_node(device->device_type == DEV_TYPE_CPU ? NumaTopology::Get().CurrentThreadNode() : 0)
     { }
 
     void Attach(FilterGraphNode* node) {
@@ -985,6 +1015,42 @@ private:
     }
   };
 
+  // Host memory wrapped by NewVideoFrameFromBuffer. Never allocated, freed or
+  // recycled by us: the host's release callback is called when the refcount drops
+  // to zero, the object itself is deleted later by PurgeExternalFrames.
+  class ExternalVFB : public VideoFrameBuffer {
+  public:
+    IScriptEnvironment::ExternalReleaseFunc release;
+    void* release_data;
+    std::atomic<bool> released;
+
+    ExternalVFB(BYTE* buffer, int size, Device* cpu_device, bool writable,
+      IScriptEnvironment::ExternalReleaseFunc release, void* release_data)
+      : VideoFrameBuffer(),
+      release(release),
+      release_data(release_data),
+      released(false)
+    {
+      data = buffer;
+      data_size = size;
+      refcount = 0;
+      device = cpu_device;
+      external = writable ? 1 : 2;
+    }
+
+    void Release() {
+      // once released is set PurgeExternalFrames may delete us, take copies first
+      IScriptEnvironment::ExternalReleaseFunc func = release;
+      void* user_data = release_data;
+      if (!released.exchange(true) && func != nullptr)
+        func(user_data);
+    }
+
+    ~ExternalVFB() {
+      data = nullptr; // not ours, keep ~VideoFrameBuffer from freeing it
+    }
+  };
+
   typedef std::vector<DebugTimestampedFrame> VideoFrameArrayType;
   typedef std::map<VideoFrameBuffer *, VideoFrameArrayType> FrameBufferRegistryType;
   typedef std::map<size_t, FrameBufferRegistryType> FrameRegistryType2; // post r1825 P.F.
@@ -992,6 +1058,10 @@ private:
 
 
   FrameRegistryType2 FrameRegistry2; // P.F.
+  // buffers of NewVideoFrameFromBuffer, kept apart so that they are never reused for new frames
+  std::map<VideoFrameBuffer*, std::vector<VideoFrame*>> ExternalFrameRegistry;
+  void RegisterFrame(VideoFrame* frame);
+  void PurgeExternalFrames(bool all);
 #ifdef _DEBUG
   void ListFrameRegistry(size_t min_size, size_t max_size, bool someframes);
 #endif
@@ -1048,6 +1118,7 @@ private:
   MTGuardRegistryType MTGuardRegistry;
 
   std::vector <std::unique_ptr<ThreadPool>> ThreadPoolRegistry;
+  std::mutex thread_pool_registry_mutex; // NewThreadPool vs. AEP_THREADPOOL_QUEUE queries
   size_t nTotalThreads;
   size_t nMaxFilterInstances;
 
@@ -1073,6 +1144,8 @@ private:
 
   CacheMode cacheMode;
 
+  PerformanceCounters perf_counters;
+
   void InitMT();
 };
 
@@ -1675,6 +1748,12 @@ public:
   {
     return core->propSetDataH(map, key, d, length, type, append);
   }
+
+  PVideoFrame __stdcall NewVideoFrameFromBuffer(const VideoInfo& vi, BYTE* const* planes, const int* pitches,
+    ExternalReleaseFunc release, void* user_data, bool writable)
+  {
+    return core->NewVideoFrameFromBuffer(vi, planes, pitches, release, user_data, writable);
+  }
   int __stdcall propSetClip(AVSMap* map, const char* key, PClip& clip, int append)
   {
     return core->propSetClip(map, key, clip, append);
@@ -2019,6 +2098,12 @@ public:
       return DISPATCH(suppressThreadCount);
     case AEP_GETFRAME_RECURSIVE:
       return DISPATCH(getFrameRecursiveCount);
+    case AEP_MEMORY_USED:
+      return (size_t)GetCurrentDevice()->memory_used;
+    case AEP_MEMORY_MAX:
+      return (size_t)GetCurrentDevice()->memory_max;
+    case AEP_MEMORY_HUGE_PAGES:
+      return (size_t)GetCurrentDevice()->memory_huge_pages;
     default:
       return core->GetEnvProperty(prop);
     }
@@ -2183,9 +2268,9 @@ public:
   }
 
 
-  ThreadPool* __stdcall NewThreadPool(size_t nThreads)
+  ThreadPool* __stdcall NewThreadPool(size_t nThreads, int numa_node)
   {
-    return core->NewThreadPool(nThreads);
+    return core->NewThreadPool(nThreads, numa_node);
   }
 
 
@@ -2227,6 +2312,11 @@ public:
     return DISPATCH(supressCaching);
   }
 
+  PerformanceCounters& __stdcall GetPerformanceCounters()
+  {
+    return core->GetPerformanceCounters();
+  }
+
   void __stdcall SetDeviceOpt(DeviceOpt opt, int val)
   {
     core->SetDeviceOpt(opt, val);
@@ -2554,7 +2644,7 @@ ScriptEnvironment::ScriptEnvironment()
     top_frame.Set("DEV_FREE_THRESHOLD", (int)DEV_FREE_THRESHOLD);
 
     InitMT();
-    thread_pool = new ThreadPool(std::thread::hardware_concurrency(), 1, threadEnv.get());
+    thread_pool = new ThreadPool(std::thread::hardware_concurrency(), 1, threadEnv.get(), ThreadPool::NUMA_SPREAD);
 
     ExportBuiltinFilters();
 
@@ -2668,6 +2758,13 @@ ScriptEnvironment::~ScriptEnvironment() {
     } // it2
   } // it
 
+  if (!ExternalFrameRegistry.empty()) {
+    for (auto& it : ExternalFrameRegistry)
+      if (it.first->refcount != 0)
+        somethingLeaks = true;
+    PurgeExternalFrames(true);
+  }
+
   if (somethingLeaks) {
     LogMsg(LOGLEVEL_WARNING, "A plugin or the host application might be causing memory leaks.");
   }
@@ -3136,6 +3233,32 @@ size_t  ScriptEnvironment::GetEnvProperty(AvsEnvProperty prop)
     return AVISYNTH_INTERFACE_VERSION;
   case AEP_INTERFACE_BUGFIX:
     return AVISYNTHPLUS_INTERFACE_BUGFIX_VERSION;
+  case AEP_FRAMES_DELIVERED:
+    return (size_t)perf_counters.FramesDelivered();
+  case AEP_FRAME_TIME_P50:
+    return (size_t)perf_counters.FrameTimePercentile(50);
+  case AEP_FRAME_TIME_P95:
+    return (size_t)perf_counters.FrameTimePercentile(95);
+  case AEP_FRAME_TIME_P99:
+    return (size_t)perf_counters.FrameTimePercentile(99);
+  case AEP_CACHE_HITS:
+    return (size_t)perf_counters.CacheHits();
+  case AEP_CACHE_MISSES:
+    return (size_t)perf_counters.CacheMisses();
+  case AEP_THREADPOOL_QUEUE:
+  {
+    size_t queued = thread_pool->QueueDepth();
+    std::lock_guard<std::mutex> lock(thread_pool_registry_mutex);
+    for (auto& pool : ThreadPoolRegistry)
+      queued += pool->QueueDepth();
+    return queued;
+  }
+  case AEP_MEMORY_USED:
+    return (size_t)threadEnv->GetCurrentDevice()->memory_used;
+  case AEP_MEMORY_MAX:
+    return (size_t)threadEnv->GetCurrentDevice()->memory_max;
+  case AEP_MEMORY_HUGE_PAGES:
+    return (size_t)threadEnv->GetCurrentDevice()->memory_huge_pages;
   default:
     this->ThrowError("Invalid property request.");
     return std::numeric_limits<size_t>::max();
@@ -3380,86 +3503,93 @@ VideoFrame* ScriptEnvironment::GetFrameFromRegistry(size_t vfb_size, Device* dev
   // - allow to occupy any buffer that is bigger than the requested size
   //for (FrameRegistryType2::iterator it = FrameRegistry2.lower_bound(vfb_size), end_it = FrameRegistry2.upper_bound(vfb_size); // exact! no-go. special service clips can fragment it
   //for (FrameRegistryType2::iterator it = FrameRegistry2.lower_bound(vfb_size), end_it = FrameRegistry2.end(); // vfb_size or bigger, so a 100K size would claim a 1.5M space.
-  for (FrameRegistryType2::iterator it = FrameRegistry2.lower_bound(vfb_size), end_it = FrameRegistry2.upper_bound(vfb_size * 3 / 2); // vfb_size or at most 1.5* bigger
-    it != end_it;
-    ++it)
-  {
-    for (auto &it2: it->second)
+  // On NUMA machines a free buffer of the requesting thread's node is preferred,
+  // only then is a buffer from another node reused.
+  const int numa_node = NumaTopology::Get().CurrentThreadNode();
+  const bool node_local = NumaTopology::Get().Enabled() && device->device_type == DEV_TYPE_CPU;
+  for (int pass = node_local ? 0 : 1; pass < 2; ++pass)
+  {
+    for (FrameRegistryType2::iterator it = FrameRegistry2.lower_bound(vfb_size), end_it = FrameRegistry2.upper_bound(vfb_size * 3 / 2); // vfb_size or at most 1.5* bigger
+      it != end_it;
+      ++it)
     {
-      VFBStorage *vfb = static_cast<VFBStorage*>(it2.first); // same for all map content, the key is vfb pointer
-      if (device == vfb->device && 0 == vfb->refcount) // vfb device and refcount check
+      for (auto &it2: it->second)
       {
-        size_t videoFrameListSize = it2.second.size();
-        // size is more than one if SubFrame was used to create a new frame
-        VideoFrame *frame_found;
-        bool found = false;
-        for (VideoFrameArrayType::iterator it3 = it2.second.begin(), end_it3 = it2.second.end();
-          it3 != end_it3;
-          /* ++it3 not here, because of the delete */)
+        VFBStorage *vfb = static_cast<VFBStorage*>(it2.first); // same for all map content, the key is vfb pointer
+        if (device == vfb->device && 0 == vfb->refcount && (pass == 1 || vfb->numa_node == numa_node)) // vfb device, refcount and node check
         {
-          VideoFrame *frame = it3->frame;
-
-          // sanity check if its refcount is zero
-          // because when a vfb is free (refcount==0) then all its parent frames should also be free
-          assert(0 == frame->refcount);
-
-          // refcount == 0 implies that 'properties' was deleted and nullified
-          // Cannot assume this: assert(nullptr == frame->properties);
-          // An Avisynth 2.5 filter ("baked code" in ancient avisynth.h)
-          // can set VideoFrame's reference count to zero
-          // but it won't delete extra frame data such as .properties
-          if (frame->properties != nullptr) {
-            delete frame->properties;
-            frame->properties = nullptr;
-          }
-
-          if (!found)
+          size_t videoFrameListSize = it2.second.size();
+          // size is more than one if SubFrame was used to create a new frame
+          VideoFrame *frame_found;
+          bool found = false;
+          for (VideoFrameArrayType::iterator it3 = it2.second.begin(), end_it3 = it2.second.end();
+            it3 != end_it3;
+            /* ++it3 not here, because of the delete */)
           {
-            InterlockedIncrement(&(frame->vfb->refcount)); // same as &(vfb->refcount)
-            vfb->free_count = 0; // reset free count
-            vfb->Attach(threadEnv->GetCurrentGraphNode());
+            VideoFrame *frame = it3->frame;
+
+            // sanity check if its refcount is zero
+            // because when a vfb is free (refcount==0) then all its parent frames should also be free
+            assert(0 == frame->refcount);
+
+            // refcount == 0 implies that 'properties' was deleted and nullified
+            // Cannot assume this: assert(nullptr == frame->properties);
+            // An Avisynth 2.5 filter ("baked code" in ancient avisynth.h)
+            // can set VideoFrame's reference count to zero
+            // but it won't delete extra frame data such as .properties
+            if (frame->properties != nullptr) {
+              delete frame->properties;
+              frame->properties = nullptr;
+            }
+
+            if (!found)
+            {
+              InterlockedIncrement(&(frame->vfb->refcount)); // same as &(vfb->refcount)
+              vfb->free_count = 0; // reset free count
+              vfb->Attach(threadEnv->GetCurrentGraphNode());
 #ifdef _DEBUG
-            char buf[256];
-            t_end = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double> elapsed_seconds = t_end - t_start;
-            snprintf(buf, 255, "ScriptEnvironment::GetNewFrame NEW METHOD EXACT hit! VideoFrameListSize=%7zu GotSize=%7zu FrReg.Size=%6zu vfb=%p frame=%p SeekTime:%f\n", videoFrameListSize, vfb_size, FrameRegistry2.size(), vfb, frame, elapsed_seconds.count());
-            _RPT0(0, buf);
-            _RPT5(0, "                                          frame %p RowSize=%d Height=%d Pitch=%d Offset=%d\n", frame, frame->GetRowSize(), frame->GetHeight(), frame->GetPitch(), frame->GetOffset());
+              char buf[256];
+              t_end = std::chrono::high_resolution_clock::now();
+              std::chrono::duration<double> elapsed_seconds = t_end - t_start;
+              snprintf(buf, 255, "ScriptEnvironment::GetNewFrame NEW METHOD EXACT hit! VideoFrameListSize=%7zu GotSize=%7zu FrReg.Size=%6zu vfb=%p frame=%p SeekTime:%f\n", videoFrameListSize, vfb_size, FrameRegistry2.size(), vfb, frame, elapsed_seconds.count());
+              _RPT0(0, buf);
+              _RPT5(0, "                                          frame %p RowSize=%d Height=%d Pitch=%d Offset=%d\n", frame, frame->GetRowSize(), frame->GetHeight(), frame->GetPitch(), frame->GetOffset());
 #endif
-            frame->properties = new AVSMap();
-            // only 1 frame in list -> no delete
-            if (videoFrameListSize <= 1)
-            {
-              _RPT1(0, "ScriptEnvironment::GetNewFrame returning frame. VideoFrameListSize was 1\n", videoFrameListSize);
+              frame->properties = new AVSMap();
+              // only 1 frame in list -> no delete
+              if (videoFrameListSize <= 1)
+              {
+                _RPT1(0, "ScriptEnvironment::GetNewFrame returning frame. VideoFrameListSize was 1\n", videoFrameListSize);
 #ifdef _DEBUG
-              it3->timestamp = std::chrono::high_resolution_clock::now(); // refresh timestamp!
+                it3->timestamp = std::chrono::high_resolution_clock::now(); // refresh timestamp!
 #endif
-              return frame; // return immediately
+                return frame; // return immediately
+              }
+              // more than X: just registered the frame found, and erase all other frames from list plus delete frame objects also
+              frame_found = frame;
+              found = true;
+              ++it3;
             }
-            // more than X: just registered the frame found, and erase all other frames from list plus delete frame objects also
-            frame_found = frame;
-            found = true;
-            ++it3;
-          }
-          else {
-            // if the first frame to this vfb was already found, then we free all others and delete it from the list
-            // Benefit: no 4-5k frame list count per a single vfb.
-            //_RPT4(0, "ScriptEnvironment::GetNewFrame Delete one frame %p RowSize=%d Height=%d Pitch=%d Offset=%d\n", frame, frame->GetRowSize(), frame->GetHeight(), frame->GetPitch(), frame->GetOffset());
-            delete frame;
-            ++it3;
+            else {
+              // if the first frame to this vfb was already found, then we free all others and delete it from the list
+              // Benefit: no 4-5k frame list count per a single vfb.
+              //_RPT4(0, "ScriptEnvironment::GetNewFrame Delete one frame %p RowSize=%d Height=%d Pitch=%d Offset=%d\n", frame, frame->GetRowSize(), frame->GetHeight(), frame->GetPitch(), frame->GetOffset());
+              delete frame;
+              ++it3;
+            }
+          } // for it3
+          if (found)
+          {
+            _RPT1(0, "ScriptEnvironment::GetNewFrame returning frame_found. clearing frames. List count: it2->second.size(): %7zu \n", it2.second.size());
+            it2.second.clear();
+            it2.second.reserve(16); // initial capacity set to 16, avoid reallocation when 1st, 2nd, etc.. elements pushed later (possible speedup)
+            it2.second.push_back(DebugTimestampedFrame(frame_found)); // keep only the first
+            return frame_found;
           }
-        } // for it3
-        if (found)
-        {
-          _RPT1(0, "ScriptEnvironment::GetNewFrame returning frame_found. clearing frames. List count: it2->second.size(): %7zu \n", it2.second.size());
-          it2.second.clear();
-          it2.second.reserve(16); // initial capacity set to 16, avoid reallocation when 1st, 2nd, etc.. elements pushed later (possible speedup)
-          it2.second.push_back(DebugTimestampedFrame(frame_found)); // keep only the first
-          return frame_found;
         }
-      }
-    } // for it2
-  } // for it
+      } // for it2
+    } // for it
+  } // for pass
   _RPT3(0, "ScriptEnvironment::GetNewFrame, no free entry in FrameRegistry. Requested vfb size=%zu memused=%" PRIu64 " memmax=%" PRIu64 "\n", vfb_size, device->memory_used.load(), device->memory_max);
 
 #ifdef _DEBUG
@@ -3955,6 +4085,116 @@ PVideoFrame ScriptEnvironment::NewVideoFrameOnDevice(const VideoInfo& vi, int al
   return retval;
 }
 
+// no locking here, calling method have done it already
+void ScriptEnvironment::RegisterFrame(VideoFrame* frame)
+{
+  VideoFrameBuffer* vfb = frame->GetFrameBuffer();
+  if (vfb->external)
+    ExternalFrameRegistry[vfb].push_back(frame);
+  else
+    // automatically inserts if not exists
+    FrameRegistry2[vfb->GetDataSize()][vfb].push_back(DebugTimestampedFrame(frame));
+}
+
+void ScriptEnvironment::ExternalBufferReleased(VideoFrameBuffer* vfb)
+{
+  static_cast<ExternalVFB*>(vfb)->Release();
+}
+
+void ExternalFrameBufferReleased(VideoFrameBuffer* vfb)
+{
+  ScriptEnvironment::ExternalBufferReleased(vfb);
+}
+
+// Deletes the bookkeeping of host buffers whose release callback has run.
+// all: environment shutdown, the remaining buffers are handed back as well.
+void ScriptEnvironment::PurgeExternalFrames(bool all)
+{
+  std::unique_lock<std::recursive_mutex> env_lock(memory_mutex);
+  for (auto it = ExternalFrameRegistry.begin(); it != ExternalFrameRegistry.end(); ) {
+    ExternalVFB* vfb = static_cast<ExternalVFB*>(it->first);
+    if (!all && !vfb->released) {
+      ++it;
+      continue;
+    }
+    vfb->Release();
+    for (VideoFrame* frame : it->second) {
+      frame->vfb = 0;
+      if (0 == frame->refcount)
+        delete frame;
+    }
+    delete vfb;
+    it = ExternalFrameRegistry.erase(it);
+  }
+}
+
+PVideoFrame ScriptEnvironment::NewVideoFrameFromBuffer(const VideoInfo& vi, BYTE* const* planes, const int* pitches,
+  IScriptEnvironment::ExternalReleaseFunc release, void* user_data, bool writable)
+{
+  if (!vi.HasVideo() || vi.width <= 0 || vi.height <= 0 || planes == nullptr || pitches == nullptr)
+    ThrowError("NewVideoFrameFromBuffer: invalid video format or missing planes.");
+
+  const int planesYUV[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
+  const int planesRGB[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
+  const int* plane_ids = vi.IsPlanarRGB() || vi.IsPlanarRGBA() ? planesRGB : planesYUV;
+  const int num_planes = vi.IsPlanar() ? vi.NumComponents() : 1;
+
+  if (vi.IsPlanar() && num_planes > 1) {
+    const int xmod = 1 << vi.GetPlaneWidthSubsampling(plane_ids[1]);
+    const int ymod = 1 << vi.GetPlaneHeightSubsampling(plane_ids[1]);
+    if ((vi.width & (xmod - 1)) || (vi.height & (ymod - 1)))
+      ThrowError("NewVideoFrameFromBuffer: frame size must be mod%d in width and mod%d in height.", xmod, ymod);
+    if (pitches[1] != pitches[2])
+      ThrowError("NewVideoFrameFromBuffer: the two chroma planes must have the same pitch.");
+    if (num_planes == 4 && pitches[3] != pitches[0])
+      ThrowError("NewVideoFrameFromBuffer: the alpha plane must have the same pitch as the first plane.");
+  }
+  else if (vi.IsYUY2() && (vi.width & 1))
+    ThrowError("NewVideoFrameFromBuffer: YUY2 frame width must be even.");
+
+  // the lowest plane is the buffer start, the others are offsets from it
+  uintptr_t lowest = UINTPTR_MAX;
+  uintptr_t highest = 0;
+  for (int p = 0; p < num_planes; p++) {
+    const int plane = num_planes > 1 ? plane_ids[p] : 0;
+    const int row_size = vi.RowSize(plane);
+    const int height = vi.height >> vi.GetPlaneHeightSubsampling(plane);
+    if (planes[p] == nullptr || pitches[p] < row_size)
+      ThrowError("NewVideoFrameFromBuffer: plane %d is missing or its pitch is smaller than its row size.", p);
+    if (((uintptr_t)planes[p] | (uintptr_t)pitches[p]) & (frame_align - 1))
+      ThrowError("NewVideoFrameFromBuffer: plane %d pointer and pitch must be aligned to %d bytes.", p, frame_align);
+    lowest = std::min(lowest, (uintptr_t)planes[p]);
+    highest = std::max(highest, (uintptr_t)planes[p] + (uintptr_t)pitches[p] * (height - 1) + row_size);
+  }
+  if (highest - lowest > (uintptr_t)std::numeric_limits<int>::max())
+    ThrowError("NewVideoFrameFromBuffer: planes span more than 2GB.");
+
+  BYTE* base = (BYTE*)lowest;
+  auto offset = [&](int p) { return (int)(planes[p] - base); };
+
+  std::unique_lock<std::recursive_mutex> env_lock(memory_mutex);
+  // bookkeeping of earlier buffers whose frames are all gone
+  PurgeExternalFrames(false);
+
+  ExternalVFB* vfb = new ExternalVFB(base, (int)(highest - lowest), Devices->GetCPUDevice(), writable, release, user_data);
+  VideoFrame* frame;
+  if (num_planes == 1)
+    frame = new VideoFrame(vfb, new AVSMap(), offset(0), pitches[0], vi.RowSize(), vi.height, vi.pixel_type);
+  else {
+    const int uv = plane_ids[1];
+    const int heightUV = vi.height >> vi.GetPlaneHeightSubsampling(uv);
+    if (num_planes == 4)
+      frame = new VideoFrame(vfb, new AVSMap(), offset(0), pitches[0], vi.RowSize(plane_ids[0]), vi.height,
+        offset(1), offset(2), pitches[1], vi.RowSize(uv), heightUV, offset(3), vi.pixel_type);
+    else
+      frame = new VideoFrame(vfb, new AVSMap(), offset(0), pitches[0], vi.RowSize(plane_ids[0]), vi.height,
+        offset(1), offset(2), pitches[1], vi.RowSize(uv), heightUV, vi.pixel_type);
+  }
+  // not counted in memory_used: the cache limits don't apply to host memory
+  RegisterFrame(frame);
+  return frame;
+}
+
 
 // Variant #3. with frame property source
 PVideoFrame ScriptEnvironment::NewVideoFrameOnDevice(const VideoInfo& vi, int align, Device* device, const PVideoFrame* prop_src)
@@ -4037,14 +4277,11 @@ PVideoFrame ScriptEnvironment::Subframe(PVideoFrame src, int rel_offset, int new
   if (propNumKeys(&avsmap) > 0)
     subframe->setProperties(src->getConstProperties());
 
-  size_t vfb_size = src->GetFrameBuffer()->GetDataSize();
-
   // vector and maps needs locking
   std::unique_lock<std::recursive_mutex> env_lock(memory_mutex);
   assert(NULL != subframe);
 
-  // automatically inserts if not exists
-  FrameRegistry2[vfb_size][src->GetFrameBuffer()].push_back(DebugTimestampedFrame(subframe));
+  RegisterFrame(subframe);
 
   return subframe;
 }
@@ -4062,14 +4299,11 @@ PVideoFrame ScriptEnvironment::SubframePlanar(PVideoFrame src, int rel_offset, i
   if (propNumKeys(&avsmap) > 0)
     subframe->setProperties(src->getConstProperties());
 
-  size_t vfb_size = src->GetFrameBuffer()->GetDataSize();
-
   // vector and maps needs locking
   std::unique_lock<std::recursive_mutex> env_lock(memory_mutex); // vector needs locking!
   assert(subframe != NULL);
 
-  // automatically inserts if not exists
-  FrameRegistry2[vfb_size][src->GetFrameBuffer()].push_back(DebugTimestampedFrame(subframe));
+  RegisterFrame(subframe);
 
   return subframe;
 }
@@ -4087,14 +4321,11 @@ PVideoFrame ScriptEnvironment::SubframePlanar(PVideoFrame src, int rel_offset, i
   if (propNumKeys(&avsmap) > 0)
     subframe->setProperties(src->getConstProperties());
 
-  size_t vfb_size = src->GetFrameBuffer()->GetDataSize();
-
   // vector and maps needs locking
   std::unique_lock<std::recursive_mutex> env_lock(memory_mutex);
   assert(subframe != NULL);
 
-  // automatically inserts if not exists
-  FrameRegistry2[vfb_size][src->GetFrameBuffer()].push_back(DebugTimestampedFrame(subframe));
+  RegisterFrame(subframe);
 
   return subframe;
 }
@@ -4104,6 +4335,17 @@ void* ScriptEnvironment::ManageCache(int key, void* data) {
 // ScriptEnvironment class without extending the IScriptEnvironment
 // definition.
 
+  if ((MANAGE_CACHE_KEYS)key == MC_ServiceMTGuards) {
+    // Creates filter instances: like Invoke, under invoke_mutex and not under memory_mutex,
+    // which the worker threads need meanwhile. Filters created here may register new guards.
+    std::lock_guard<std::recursive_mutex> env_lock(invoke_mutex);
+    for (size_t i = 0; i < MTGuardRegistry.size(); i++) {
+      if (MTGuardRegistry[i] != NULL)
+        MTGuardRegistry[i]->ServiceInstances();
+    }
+    return 0;
+  }
+
   std::lock_guard<std::recursive_mutex> env_lock(memory_mutex);
   switch ((MANAGE_CACHE_KEYS)key)
   {
@@ -4234,6 +4476,10 @@ void* ScriptEnvironment::ManageCache(int key, void* data) {
     }
     break;
   }
+  case MC_ServiceMTGuards:
+  {
+    break; // handled above, outside of memory_mutex
+  }
   case MC_QueryAvs25:
   case MC_QueryAvsPreV11C:
   {
@@ -4315,6 +4561,7 @@ const Function* ScriptEnvironment::Lookup(const char* search_name, const AVSValu
   const Function *result = NULL;
 
   auto orig_args_names_count = args_names_count;
+  const FunctionMap& builtins = GetBuiltinFunctionMap();
 
   size_t oanc;
   do {
@@ -4328,14 +4575,13 @@ const Function* ScriptEnvironment::Lookup(const char* search_name, const AVSValu
         return result;
 
       // then, look for a built-in function
-      for (int i = 0; i < sizeof(builtin_functions)/sizeof(builtin_functions[0]); ++i)
-        for (const AVSFunction* j = builtin_functions[i]; !j->empty(); ++j)
+      const auto builtin_it = builtins.find(search_name);
+      if (builtin_it != builtins.end())
+        for (const AVSFunction* j : builtin_it->second)
         {
-          if (streqi(j->name, search_name)) {
-            if (AVSFunction::TypeMatch(j->param_types, args, num_args, pstrict, ctx) &&
-              AVSFunction::ArgNameMatch(j->param_types, args_names_count, arg_names))
-              return j;
-          }
+          if (AVSFunction::TypeMatch(j->param_types, args, num_args, pstrict, ctx) &&
+            AVSFunction::ArgNameMatch(j->param_types, args_names_count, arg_names))
+            return j;
         }
     }
     // Try again without arg name matching
@@ -5074,12 +5320,8 @@ bool ScriptEnvironment::FunctionExists(const char* name)
 
 bool ScriptEnvironment::InternalFunctionExists(const char* name)
 {
-  for (int i = 0; i < sizeof(builtin_functions)/sizeof(builtin_functions[0]); ++i)
-    for (const AVSFunction* j = builtin_functions[i]; !j->empty(); ++j)
-      if (streqi(j->name, name))
-        return true;
-
-  return false;
+  const FunctionMap& builtins = GetBuiltinFunctionMap();
+  return builtins.find(name) != builtins.end();
 }
 
 void ScriptEnvironment::BitBlt(BYTE* dstp, int dst_pitch, const BYTE* srcp, int src_pitch, int row_size, int height) {
@@ -5137,14 +5379,11 @@ bool ScriptEnvironment::MakePropertyWritable(PVideoFrame* pvf)
   if (propNumKeys(&avsmap) > 0)
     dst->setProperties(vf->getConstProperties());
 
-  size_t vfb_size = vf->GetFrameBuffer()->GetDataSize();
-
   // vector and maps needs locking!
   std::unique_lock<std::recursive_mutex> env_lock(memory_mutex);
   assert(dst != NULL);
 
-  // automatically inserts if not exists
-  FrameRegistry2[vfb_size][vf->GetFrameBuffer()].push_back(DebugTimestampedFrame(dst));
+  RegisterFrame(dst);
 
   *pvf = dst;
   return true;
@@ -5600,12 +5839,15 @@ PVideoFrame ScriptEnvironment::GetOnDeviceFrame(const PVideoFrame& src, Device*
 }
 
 
-ThreadPool* ScriptEnvironment::NewThreadPool(size_t nThreads)
+ThreadPool* ScriptEnvironment::NewThreadPool(size_t nThreads, int numa_node)
 {
   // Creates threads with threadIDs (which envI->GetThreadId() is returning) starting from 
   // (nTotalThreads+0) to (nTotalThreads+nThreads-1)
-  ThreadPool* pool = new ThreadPool(nThreads, nTotalThreads, threadEnv.get());
-  ThreadPoolRegistry.emplace_back(pool);
+  ThreadPool* pool = new ThreadPool(nThreads, nTotalThreads, threadEnv.get(), numa_node);
+  {
+    std::lock_guard<std::mutex> lock(thread_pool_registry_mutex);
+    ThreadPoolRegistry.emplace_back(pool);
+  }
 
   nTotalThreads += nThreads;
 
@@ -11,6 +11,8 @@
 #include <avisynth_c.h>
 #include "AVSMap.h"
 #include "internal.h"
+#include "InternalEnvironment.h"
+#include "ThreadPool.h"
 
 #ifdef AVS_WINDOWS
 #include <avs/win.h>
@@ -19,15 +21,24 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstdarg>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
 
 
+class C_FrameRequestQueue;
+
 struct AVS_Clip
 {
   PClip clip;
   IScriptEnvironment* env;
   const char* error;
-  AVS_Clip() : env(0), error(0) {}
+  std::shared_ptr<C_FrameRequestQueue> requests; // shared by the copies, the worker starts on the first request
+  AVS_Clip();
 };
 
 class C_VideoFilter : public IClip {
@@ -874,6 +885,264 @@ AVS_VideoFrame * AVSC_CC avs_get_frame(AVS_Clip * p, int n)
   }
 }
 
+/////////////////////////////////////////////////////////////////////
+//
+// Asynchronous frame requests
+//
+
+struct AVS_FrameRequest
+{
+  PClip clip;
+  int n;
+  AVS_FrameCallback callback;
+  void* user_data;
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool done;
+  PVideoFrame frame;
+  std::string error;
+  bool hasError;
+
+  std::atomic<bool> cancelled;
+  std::atomic<int> refs; // client and worker
+
+  AVS_FrameRequest(const PClip& clip, int n, AVS_FrameCallback callback, void* user_data) :
+    clip(clip), n(n), callback(callback), user_data(user_data),
+    done(false), hasError(false), cancelled(false), refs(2)
+  { }
+
+  void Complete(const PVideoFrame& result, const char* msg)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      frame = result;
+      if (msg) {
+        error = msg;
+        hasError = true;
+      }
+      done = true;
+    }
+    cond.notify_all();
+    if (callback && !cancelled)
+      callback(this, user_data);
+  }
+
+  void Release()
+  {
+    if (--refs == 0)
+      delete this;
+  }
+};
+
+// One worker thread per clip, shared by its copies. Ordered serving keeps
+// sequential access for the Prefetcher and the source filters.
+// The requests wait in an unbounded deque, drained by a single job on the pool:
+// the job queue of the pool is bounded, QueueJob would block the client thread
+// (or a callback requesting its next frame on the worker) when it is full.
+class C_FrameRequestQueue
+{
+  std::mutex mutex;
+  std::deque<AVS_FrameRequest*> pending;
+  bool draining; // a Drain job is queued or running
+  ThreadPool* pool; // created on the first request
+
+  static void Serve(AVS_FrameRequest* r, InternalEnvironment* env)
+  {
+    if (r->cancelled) {
+      r->Complete(PVideoFrame(), "Frame request is cancelled");
+    }
+    else {
+      try {
+        PVideoFrame frame = r->clip->GetFrame(r->n, env);
+        r->Complete(frame, nullptr);
+      }
+      catch (const AvisynthError& err) {
+        r->Complete(PVideoFrame(), err.msg);
+      }
+      catch (...) {
+        r->Complete(PVideoFrame(), "Unknown exception in frame request");
+      }
+    }
+    r->Release();
+  }
+
+  static AVSValue Drain(IScriptEnvironment2* env, void* data)
+  {
+    C_FrameRequestQueue* queue = static_cast<C_FrameRequestQueue*>(data);
+    for (;;) {
+      AVS_FrameRequest* r;
+      {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (queue->pending.empty()) {
+          queue->draining = false;
+          break;
+        }
+        r = queue->pending.front();
+        queue->pending.pop_front();
+      }
+      // not under the lock: a callback may queue the next request
+      Serve(r, static_cast<InternalEnvironment*>(env));
+    }
+    return AVSValue();
+  }
+
+public:
+  C_FrameRequestQueue() : draining(false), pool(nullptr) { }
+
+  ~C_FrameRequestQueue()
+  {
+    if (!pool)
+      return;
+    // the queued requests are cancelled, the running one is waited for. Their callback
+    // is still called (on this thread) unless the client released the request.
+    std::deque<AVS_FrameRequest*> cancelled;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      cancelled.swap(pending);
+    }
+    pool->Finish();
+    for (AVS_FrameRequest* r : cancelled) {
+      r->Complete(PVideoFrame(), "Frame request is cancelled");
+      r->Release();
+    }
+  }
+
+  void Start(InternalEnvironment* env)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!pool)
+      pool = env->NewThreadPool(1);
+  }
+
+  // never blocks: at most one Drain job is in the job queue of the pool
+  void Queue(AVS_FrameRequest* r, InternalEnvironment* env)
+  {
+    Start(env);
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(r);
+    if (!draining) {
+      try {
+        pool->QueueJob(Drain, this, env, nullptr);
+      }
+      catch (...) {
+        pending.pop_back();
+        throw;
+      }
+      draining = true;
+    }
+  }
+};
+
+AVS_Clip::AVS_Clip() : env(0), error(0), requests(std::make_shared<C_FrameRequestQueue>()) {}
+
+static AVS_FrameRequest* QueueFrameRequest(AVS_Clip* p, int n, AVS_FrameCallback callback, void* user_data)
+{
+  InternalEnvironment* env = GetAndRevealCamouflagedEnv(p->env);
+  // the requests are served on a worker thread, the client thread is the one which can
+  // create the MT_MULTI_INSTANCE instances asked for meanwhile. Not from a completion
+  // callback requesting its next frame: that runs on the worker thread.
+  if (env->GetThreadId() == 0 && env->GetFrameRecursiveCount() == 0)
+    env->ManageCache(MC_ServiceMTGuards, nullptr);
+  AVS_FrameRequest* r = new AVS_FrameRequest(p->clip, n, callback, user_data);
+  try {
+    p->requests->Queue(r, env);
+  }
+  catch (...) {
+    delete r;
+    throw;
+  }
+  return r;
+}
+
+extern "C"
+AVS_FrameRequest* AVSC_CC avs_request_frame(AVS_Clip* p, int n, AVS_FrameCallback callback, void* user_data)
+{
+  p->error = 0;
+  try {
+    return QueueFrameRequest(p, n, callback, user_data);
+  }
+  catch (const AvisynthError& err) {
+    p->error = err.msg;
+    return 0;
+  }
+}
+
+extern "C"
+int AVSC_CC avs_get_frames_async(AVS_Clip* p, const int* frames, int count, AVS_FrameRequest** requests,
+  AVS_FrameCallback callback, void* user_data)
+{
+  p->error = 0;
+  if (count < 0 || (count > 0 && (frames == 0 || requests == 0))) {
+    p->error = "avs_get_frames_async: invalid parameters";
+    return -1;
+  }
+  try {
+    // create the worker first, after that queueing does not fail
+    p->requests->Start(GetAndRevealCamouflagedEnv(p->env));
+    for (int i = 0; i < count; i++)
+      requests[i] = QueueFrameRequest(p, frames[i], callback, user_data);
+    return 0;
+  }
+  catch (const AvisynthError& err) {
+    p->error = err.msg;
+    return -1;
+  }
+}
+
+extern "C"
+AVS_VideoFrame* AVSC_CC avs_wait_frame(AVS_FrameRequest* r)
+{
+  std::unique_lock<std::mutex> lock(r->mutex);
+  r->cond.wait(lock, [r] { return r->done; });
+  if (r->hasError)
+    return 0;
+  AVS_VideoFrame* f;
+  new((PVideoFrame*)&f) PVideoFrame(r->frame);
+  return f;
+}
+
+extern "C"
+int AVSC_CC avs_frame_request_ready(AVS_FrameRequest* r)
+{
+  std::lock_guard<std::mutex> lock(r->mutex);
+  return r->done ? 1 : 0;
+}
+
+extern "C"
+const char* AVSC_CC avs_frame_request_get_error(AVS_FrameRequest* r) // return 0 if no error
+{
+  std::lock_guard<std::mutex> lock(r->mutex);
+  return r->hasError ? r->error.c_str() : 0;
+}
+
+extern "C"
+void AVSC_CC avs_release_frame_request(AVS_FrameRequest* r)
+{
+  if (r) {
+    r->cancelled = true;
+    r->Release();
+  }
+}
+
+extern "C"
+double AVSC_CC avs_render_file(AVS_Clip* p, const char* filename, const char* format, int start, int end)
+{
+  p->error = 0;
+  try {
+    AVSValue args[5] = { p->clip, filename, format && *format ? AVSValue(format) : AVSValue(), start, end >= 0 ? AVSValue(end) : AVSValue() };
+    static const char* const arg_names[5] = { nullptr, nullptr, "format", "start", "end" };
+    return p->env->Invoke("RenderToFile", AVSValue(args, 5), arg_names).AsFloat();
+  }
+  catch (const IScriptEnvironment::NotFound&) {
+    p->error = "Function Not Found";
+  }
+  catch (const AvisynthError& err) {
+    p->error = err.msg;
+  }
+  return -1;
+}
+
 extern "C"
 int AVSC_CC avs_get_parity(AVS_Clip * p, int n) // return field parity if field_based, else parity of first field in frame
 {
@@ -1332,6 +1601,40 @@ AVS_VideoFrame * AVSC_CC avs_new_video_frame_p_a(AVS_ScriptEnvironment * p, cons
   return 0;
 }
 
+// the C callback has its own calling convention
+struct C_ExternalRelease {
+  AVS_ExternalReleaseFunc func;
+  void* user_data;
+};
+
+static void __cdecl call_c_external_release(void* data)
+{
+  C_ExternalRelease* r = (C_ExternalRelease*)data;
+  if (r->func)
+    r->func(r->user_data);
+  delete r;
+}
+
+extern "C"
+AVS_VideoFrame * AVSC_CC avs_new_video_frame_from_buffer(AVS_ScriptEnvironment * p, const AVS_VideoInfo * vi,
+  BYTE* const* planes, const int* pitches, AVS_ExternalReleaseFunc release, void* user_data, int writable)
+{
+  p->error = 0;
+  C_ExternalRelease* r = new C_ExternalRelease{ release, user_data };
+  try {
+    PVideoFrame f0 = p->env->NewVideoFrameFromBuffer(*(const VideoInfo*)vi, planes, pitches,
+      call_c_external_release, r, writable != 0);
+    AVS_VideoFrame* f;
+    new((PVideoFrame*)&f) PVideoFrame(f0);
+    return f;
+  }
+  catch (const AvisynthError& err) {
+    delete r; // buffer not taken, no callback
+    p->error = err.msg;
+  }
+  return 0;
+}
+
 // with frame properties, no extra alignment requirement
 extern "C"
 AVS_VideoFrame * AVSC_CC avs_new_video_frame_p(AVS_ScriptEnvironment * p, const AVS_VideoInfo * vi, const AVS_VideoFrame * prop_src)
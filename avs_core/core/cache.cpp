@@ -37,6 +37,7 @@
 #include "LruCache.h"
 #include "InternalEnvironment.h"
 #include "DeviceManager.h"
+#include "PerformanceCounters.h"
 #include <cassert>
 #include <chrono>
 #include <cstdio>
@@ -205,6 +206,7 @@ PVideoFrame __stdcall Cache::GetFrame(int n, IScriptEnvironment* env_)
   {
   case LRU_LOOKUP_NOT_FOUND:
     {
+      env->GetPerformanceCounters().CacheMiss();
       try
       {
 #ifdef _DEBUG
@@ -257,6 +259,7 @@ PVideoFrame __stdcall Cache::GetFrame(int n, IScriptEnvironment* env_)
       // solution:
       // when LRU_LOOKUP_FOUND_AND_READY, the cache_handle.first->value is copied and returned in result itself
       // result =  cache_handle.first->value; // old method not needed, result is filled already by lookup
+      env->GetPerformanceCounters().CacheHit();
 #ifdef _DEBUG
       t_end = std::chrono::high_resolution_clock::now();
       std::chrono::duration<double> elapsed_seconds = t_end - t_start;
@@ -439,6 +442,54 @@ void __stdcall Cache::GetAudio(void* buf, int64_t start, int64_t count, IScriptE
 
 }
 
+void __stdcall Cache::GetAudioPlanar(void** bufs, int64_t start, int64_t count, IScriptEnvironment* env)
+{
+  if (count <= 0)
+    return;
+
+  // Our audio cache holds interleaved samples, and children without planar
+  // support would be deinterleaved anyway: serve such requests from GetAudio
+  if ((_pimpl->AudioPolicy != CACHE_AUDIO_AUTO_START_OFF && _pimpl->AudioPolicy != CACHE_AUDIO_NOTHING)
+    || !HasAudioPlanar(_pimpl->child)) {
+    GetAudioPlanarFromInterleaved(this, bufs, start, count, env);
+    return;
+  }
+
+  // Enforce audio bounds, same as in GetAudio, but channel by channel
+  VideoInfo* vi = &(_pimpl->vi);
+  const int channels = vi->AudioChannels();
+  const int bpcs = vi->BytesPerChannelSample();
+
+  int64_t skip_front = 0; // silence before sample 0
+  int64_t skip_back = 0;  // silence after the last sample
+  if ((!vi->HasAudio()) || (start + count <= 0) || (start >= vi->num_audio_samples))
+    skip_front = count;
+  else {
+    if (start < 0)
+      skip_front = -start;
+    if (start + count > vi->num_audio_samples)
+      skip_back = start + count - vi->num_audio_samples;
+  }
+
+  std::vector<void*> child_bufs(channels);
+  for (int c = 0; c < channels; c++) {
+    BYTE* p = (BYTE*)bufs[c];
+    if (p) {
+      memset(p, 0, (size_t)(skip_front * bpcs));
+      memset(p + (count - skip_back) * bpcs, 0, (size_t)(skip_back * bpcs));
+      p += skip_front * bpcs;
+    }
+    child_bufs[c] = p;
+  }
+  if (skip_front >= count)
+    return;
+
+  start += skip_front;
+  count -= skip_front + skip_back;
+  _pimpl->ac_expected_next = start + count;
+  ::GetAudioPlanar(_pimpl->child, child_bufs.data(), start, count, env);
+}
+
 const VideoInfo& __stdcall Cache::GetVideoInfo()
 {
   return _pimpl->vi;
@@ -471,6 +522,9 @@ int __stdcall Cache::SetCacheHints(int cachehints, int frame_range)
     case CACHE_GET_MTMODE:
       return MT_NICE_FILTER;
 
+    case CACHE_GET_AUDIO_PLANAR_REQ:
+      return HasAudioPlanar(_pimpl->child) ? CACHE_GET_AUDIO_PLANAR_ANS : 0;
+
     /*********************************************
         VIDEO
     *********************************************/
@@ -673,6 +727,16 @@ PVideoFrame __stdcall CacheGuard::GetFrame(int n, IScriptEnvironment* env_)
   InternalEnvironment* IEnv = GetAndRevealCamouflagedEnv(env_);
   IScriptEnvironment* env = static_cast<IScriptEnvironment*>(IEnv);
 
+  if (IEnv->GetFrameRecursiveCount() == 0 && IEnv->GetThreadId() == 0) {
+    // outermost request on the main thread: the host asks for a frame, time it
+    ScopedCounter getframe_counter(IEnv->GetFrameRecursiveCount());
+    const auto t_start = std::chrono::steady_clock::now();
+    PVideoFrame result = GetCache(env)->GetFrame(n, env);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t_start);
+    IEnv->GetPerformanceCounters().FrameDelivered((uint64_t)elapsed.count());
+    return result;
+  }
+
   ScopedCounter getframe_counter(IEnv->GetFrameRecursiveCount());
   /*
   if (!name.empty())
@@ -690,6 +754,16 @@ void __stdcall CacheGuard::GetAudio(void* buf, int64_t start, int64_t count, ISc
   return GetCache(env)->GetAudio(buf, start, count, env);
 }
 
+void __stdcall CacheGuard::GetAudioPlanar(void** bufs, int64_t start, int64_t count, IScriptEnvironment* env_)
+{
+  InternalEnvironment* IEnv = GetAndRevealCamouflagedEnv(env_);
+  IScriptEnvironment* env = static_cast<IScriptEnvironment*>(IEnv);
+
+  ScopedCounter getframe_counter(IEnv->GetFrameRecursiveCount());
+  PClip cache = GetCache(env);
+  ::GetAudioPlanar(cache, bufs, start, count, env);
+}
+
 const VideoInfo& __stdcall CacheGuard::GetVideoInfo()
 {
     return vi;
@@ -829,6 +903,9 @@ int __stdcall CacheGuard::SetCacheHints(int cachehints, int frame_range)
   case CACHE_GET_CHILD_DEV_TYPE:
     return (child->GetVersion() >= 5) ? child->SetCacheHints(cachehints, 0) : 0;
 
+  case CACHE_GET_AUDIO_PLANAR_REQ:
+    return HasAudioPlanar(child) ? CACHE_GET_AUDIO_PLANAR_ANS : 0;
+
   default:
     return 0;
   }
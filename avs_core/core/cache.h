@@ -36,6 +36,7 @@
 #define __Cache_H__
 
 #include <avisynth.h>
+#include "AudioPlanar.h"
 #include <mutex>
 #include <vector>
 #include <string>
@@ -43,7 +44,7 @@
 struct CachePimpl;
 class InternalEnvironment;
 
-class Cache : public IClip
+class Cache : public IClip, public IAudioPlanar
 {
 private:
 
@@ -62,6 +63,7 @@ public:
   ~Cache();
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
   void __stdcall GetAudio(void* buf, int64_t start, int64_t count, IScriptEnvironment* env);
+  void __stdcall GetAudioPlanar(void** bufs, int64_t start, int64_t count, IScriptEnvironment* env);
   const VideoInfo& __stdcall GetVideoInfo();
   bool __stdcall GetParity(int n);
   int __stdcall SetCacheHints(int cachehints,int frame_range);
@@ -73,7 +75,7 @@ public:
 
 };
 
-class CacheGuard : public IClip
+class CacheGuard : public IClip, public IAudioPlanar
 {
 private:
   struct CacheHints {
@@ -109,6 +111,7 @@ public:
   ~CacheGuard();
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
   void __stdcall GetAudio(void* buf, int64_t start, int64_t count, IScriptEnvironment* env);
+  void __stdcall GetAudioPlanar(void** bufs, int64_t start, int64_t count, IScriptEnvironment* env);
   const VideoInfo& __stdcall GetVideoInfo();
   bool __stdcall GetParity(int n);
   int __stdcall SetCacheHints(int cachehints, int frame_range);
@@ -56,6 +56,8 @@
 #include <locale>
 #include <cstdio>
 #include <cassert>
+#include <algorithm>
+#include <mutex>
 #include "fonts/fixedfonts.h"
 #include "strings.h"
 #include "../convert/convert_helper.h"
@@ -755,6 +757,35 @@ void AVS_FORCEINLINE LightOnePixelPackedRGB(const bool lightIt, BYTE* _dp, int v
   }
 }
 
+// 16 = y_min
+// speed optimization: one subtraction less, 5-8% faster
+// (((Y - 16) * 7) >> 3) + 16 = ((Y * 7) >> 3) + 2
+// in general: ((Y * 7) >> 3) + n, where n = range_min - ((range_min * 7) >> 3)
+template<typename pixel_t, bool isRGB>
+static AVS_FORCEINLINE pixel_t FadeOnePixel(pixel_t pixel, int bits_per_pixel)
+{
+  // background darkening
+  if constexpr (isRGB) {
+    if constexpr (sizeof(pixel_t) != 4)
+      return (pixel_t)((pixel * 7) >> 3);
+    else {
+      constexpr float factor = 7.0f / 8;
+      return (pixel_t)(pixel * factor);
+    }
+  }
+  else {
+    if constexpr (sizeof(pixel_t) != 4) {
+      const int range_min = 16 << (bits_per_pixel - 8);
+      const int n = range_min - ((range_min * 7) >> 3);
+      return (pixel_t)(((pixel * 7) >> 3) + n); // (_dstp[j] - range_min) * 7) >> 3) + range_min);
+    }
+    else {
+      constexpr float range_min_f = 16.0f / 255.0f;
+      return (pixel_t)(((pixel - range_min_f) * 7 / 8) + range_min_f);
+    }
+  }
+}
+
 template<typename pixel_t, bool fadeBackground, bool isRGB>
 void AVS_FORCEINLINE LightOnePixel(const bool lightIt, pixel_t* dstp, int j, pixel_t& val_color, int bits_per_pixel)
 {
@@ -768,32 +799,35 @@ void AVS_FORCEINLINE LightOnePixel(const bool lightIt, pixel_t* dstp, int j, pix
     dstp[j] = val_color;
   }
   else {
-    // 16 = y_min
-    // speed optimization: one subtraction less, 5-8% faster
-    // (((Y - 16) * 7) >> 3) + 16 = ((Y * 7) >> 3) + 2
-    // in general: ((Y * 7) >> 3) + n, where n = range_min - ((range_min * 7) >> 3)
+    if constexpr (fadeBackground)
+      dstp[j] = FadeOnePixel<pixel_t, isRGB>(dstp[j], bits_per_pixel);
+  }
+}
+
+// One line of a 1:1 plane from the coverage map. Branchless on purpose, compilers vectorize it.
+// With halo, background pixels are faded twice like in the bit-by-bit LightOnePixel version.
+template<typename pixel_t, bool useHalocolor, bool fadeBackground, bool isRGB>
+static AVS_FORCEINLINE void LightCoverageLine(pixel_t* AVS_RESTRICT dstp, const uint8_t* AVS_RESTRICT coverage, int count,
+  const pixel_t val_color, const pixel_t val_color_outline, int bits_per_pixel)
+{
+  // some optimization hint
+  if constexpr (sizeof(pixel_t) == 1)
+    bits_per_pixel = 8;
+  else if constexpr (sizeof(pixel_t) == 4)
+    bits_per_pixel = 32;
+
+  for (int j = 0; j < count; j++) {
+    pixel_t background = dstp[j];
     if constexpr (fadeBackground) {
-      // background darkening
-      if constexpr (isRGB) {
-        if constexpr (sizeof(pixel_t) != 4)
-          dstp[j] = (pixel_t)((dstp[j] * 7) >> 3);
-        else {
-          constexpr float factor = 7.0f / 8;
-          dstp[j] = (pixel_t)(dstp[j] * factor);
-        }
-      }
-      else {
-        if constexpr (sizeof(pixel_t) != 4) {
-          const int range_min = 16 << (bits_per_pixel - 8);
-          const int n = range_min - ((range_min * 7) >> 3);
-          dstp[j] = (pixel_t)(((dstp[j] * 7) >> 3) + n); // (_dstp[j] - range_min) * 7) >> 3) + range_min);
-        }
-        else {
-          constexpr float range_min_f = 16.0f / 255.0f;
-          dstp[j] = (pixel_t)(((dstp[j] - range_min_f) * 7 / 8) + range_min_f);
-        }
-      }
+      background = FadeOnePixel<pixel_t, isRGB>(background, bits_per_pixel);
+      if constexpr (useHalocolor)
+        background = FadeOnePixel<pixel_t, isRGB>(background, bits_per_pixel);
     }
+    const int c = coverage[j];
+    pixel_t result = c == 2 ? val_color : background;
+    if constexpr (useHalocolor)
+      result = c == 1 ? val_color_outline : result;
+    dstp[j] = result;
   }
 }
 
@@ -980,7 +1014,7 @@ static void insert_from_msb_bit(uint8_t *dst, int bitposition, const uint8_t* fo
   }
 }
 
-static uint8_t get_bit(uint8_t* src, const int bitposition)
+static uint8_t get_bit(const uint8_t* src, const int bitposition)
 {
   int pos = bitposition / 8;
   int bitindex = bitposition % 8;
@@ -988,7 +1022,7 @@ static uint8_t get_bit(uint8_t* src, const int bitposition)
   return src[pos] & mask;
 }
 
-static int get_bits(uint8_t* src, int bitposition, int count)
+static int get_bits(const uint8_t* src, int bitposition, int count)
 {
   int bitcounter = 0;
   while (count--) {
@@ -998,7 +1032,7 @@ static int get_bits(uint8_t* src, int bitposition, int count)
   return bitcounter;
 }
 
-void PreRendered::make_outline() {
+void StringBitmap::make_outline() {
   auto h = stringbitmap.size();
   auto w = stringbitmap[0].size();
 
@@ -1097,46 +1131,35 @@ void PreRendered::make_outline() {
   }
 }
 
-PreRendered::PreRendered(
+void StringBitmap::make_coverage(const bool useHalocolor, const int stringbitmap_width) {
+  coverage.resize(stringbitmap.size());
+  for (size_t ty = 0; ty < stringbitmap.size(); ty++) {
+    coverage[ty].resize(stringbitmap_width);
+    const uint8_t* fontline_ptr = stringbitmap[ty].data();
+    uint8_t* cov = coverage[ty].data();
+    for (int tx = 0; tx < stringbitmap_width; tx++)
+      cov[tx] = get_bit(fontline_ptr, tx) ? 2 : 0;
+    if (useHalocolor) {
+      const uint8_t* fontoutline_ptr = stringbitmap_outline[ty].data();
+      for (int tx = 0; tx < stringbitmap_width; tx++)
+        if (cov[tx] == 0 && get_bit(fontoutline_ptr, tx))
+          cov[tx] = 1;
+    }
+  }
+}
+
+StringBitmap::StringBitmap(
   const uint8_t* fonts,
   const int fontline_bytes_storage,
-  const int _width, const int _height,
-  int _x, int _y, // they may change
-  std::vector<int>& s,
-  int align,
-  const bool _useHalocolor,
+  const int* s, const int len,
+  const bool useHalocolor,
   const int FONT_WIDTH, const int FONT_HEIGHT,
-  const int _safety_bits_x_left,
-  const int _safety_bits_x_right
+  const int safety_bits_x_left,
+  const int safety_bits_x_right
   )
-  :
-  useHalocolor(_useHalocolor), width(_width), height(_height),
-  safety_bits_x_left(_safety_bits_x_left),
-  safety_bits_x_right(_safety_bits_x_right)
 {
-  len = (int)s.size();
-  x = _x;
-  y = _y;
-  xstart = 0;
-  ystart = 0;
-  yend = 0;
-  text_width = 0;
-
-  int startindex = 0;
-
   // optional two additional lines for top and bottom for outline
-  stringbitmap_height = useHalocolor ? FONT_HEIGHT + 2 : FONT_HEIGHT;
-
-  adjustWriteLimits(s, width, height,
-    FONT_WIDTH,
-    FONT_HEIGHT, // extra top and bottom for halo
-    align,
-    useHalocolor,
-    // adjusted parameters
-    x, y, len, startindex, xstart, ystart, yend);
-
-  if (len <= 0)
-    return;
+  const int stringbitmap_height = useHalocolor ? FONT_HEIGHT + 2 : FONT_HEIGHT;
 
   // prepare font mask and outline mask
 
@@ -1207,6 +1230,54 @@ PreRendered::PreRendered(
   if (useHalocolor)
     make_outline();
 
+  make_coverage(useHalocolor, stringbitmap_width);
+}
+
+PreRendered::PreRendered(
+  const BitmapFont* font,
+  const int _width, const int _height,
+  int _x, int _y, // they may change
+  std::vector<int>& s,
+  int align,
+  const bool _useHalocolor,
+  const int _safety_bits_x_left,
+  const int _safety_bits_x_right
+  )
+  :
+  useHalocolor(_useHalocolor), width(_width), height(_height),
+  safety_bits_x_left(_safety_bits_x_left),
+  safety_bits_x_right(_safety_bits_x_right)
+{
+  const int FONT_WIDTH = font->width;
+  const int FONT_HEIGHT = font->height;
+
+  len = (int)s.size();
+  x = _x;
+  y = _y;
+  xstart = 0;
+  ystart = 0;
+  yend = 0;
+  text_width = 0;
+
+  int startindex = 0;
+
+  // optional two additional lines for top and bottom for outline
+  stringbitmap_height = useHalocolor ? FONT_HEIGHT + 2 : FONT_HEIGHT;
+
+  adjustWriteLimits(s, width, height,
+    FONT_WIDTH,
+    FONT_HEIGHT, // extra top and bottom for halo
+    align,
+    useHalocolor,
+    // adjusted parameters
+    x, y, len, startindex, xstart, ystart, yend);
+
+  if (len <= 0)
+    return;
+
+  // the bitmap depends only on the visible characters, not on the position
+  bitmap = font->GetStringBitmap(s.data(), len, useHalocolor, safety_bits_x_left, safety_bits_x_right);
+
   // actual visible pixel count
   text_width = (FONT_WIDTH - xstart) + (len - 1) * FONT_WIDTH;
   if (x + text_width > width) text_width -= (x + text_width - width);
@@ -1225,6 +1296,31 @@ PreRendered::PreRendered(
   }
 }
 
+std::shared_ptr<const StringBitmap> BitmapFont::GetStringBitmap(const int* s, int len, bool useHalocolor,
+  int safety_bits_x_left, int safety_bits_x_right) const
+{
+  StringBitmapKey key{ std::vector<int>(s, s + len), useHalocolor, safety_bits_x_left, safety_bits_x_right };
+  {
+    std::lock_guard<std::mutex> lock(stringbitmap_mutex);
+    for (auto it = stringbitmap_cache.begin(); it != stringbitmap_cache.end(); ++it) {
+      if (it->first == key) {
+        stringbitmap_cache.splice(stringbitmap_cache.begin(), stringbitmap_cache, it);
+        return it->second;
+      }
+    }
+  }
+
+  // render outside the lock
+  auto bitmap = std::make_shared<const StringBitmap>(font_bitmaps.data(), fontline_bytes, s, len, useHalocolor,
+    width, height, safety_bits_x_left, safety_bits_x_right);
+
+  std::lock_guard<std::mutex> lock(stringbitmap_mutex);
+  stringbitmap_cache.emplace_front(std::move(key), bitmap);
+  if (stringbitmap_cache.size() > STRINGBITMAP_CACHE_SIZE)
+    stringbitmap_cache.pop_back();
+  return bitmap;
+}
+
 template<typename pixel_t>
 static auto getHBDColor_UV(int color, int bits_per_pixel)
 {
@@ -1256,7 +1352,7 @@ static auto getHBDColor_RGB(int color, int bits_per_pixel)
 
 
 template<typename pixel_t, bool useHalocolor, bool fadeBackground, bool isRGB>
-void Render1by1Planes(int bits_per_pixel, int color, int halocolor, int* pitches, BYTE** dstps, PreRendered& pre,
+void Render1by1Planes(int bits_per_pixel, int color, int halocolor, int* pitches, BYTE** dstps, const PreRendered& pre,
   const int planeCount, const bool is444)
 {
   // 1:1 planes, Y or planar RGB or 4:4:4 U/V
@@ -1294,34 +1390,17 @@ void Render1by1Planes(int bits_per_pixel, int color, int halocolor, int* pitches
     BYTE* dstp = dstps[p] + pre.x * sizeof(pixel_t) + pre.y * pitch;
 
     // Start rendering
+    const int shifted_xstart = pre.safety_bits_x_left + pre.xstart;
     for (int ty = pre.ystart; ty < pre.yend; ty++) {
-      pixel_t* _dstp = reinterpret_cast<pixel_t*>(dstp);
-      uint8_t* fontline_ptr = pre.stringbitmap[ty].data();
-      [[maybe_unused]] uint8_t* fontoutline_ptr;
-      if constexpr(useHalocolor)
-        fontoutline_ptr = pre.stringbitmap_outline[ty].data();
-      int j = 0;
-      const int shifted_xstart = pre.safety_bits_x_left + pre.xstart;
-      for (int tx = shifted_xstart; tx < shifted_xstart + pre.text_width; tx++)
-      {
-        const bool lightIt = 0 != get_bit(fontline_ptr, tx);
-        LightOnePixel<pixel_t, fadeBackground, isRGB>(lightIt, _dstp, j, val_color, bits_per_pixel);
-        if constexpr(useHalocolor) {
-          if (!lightIt)
-          {
-            const bool lightIt_outline = 0 != get_bit(fontoutline_ptr, tx);
-            LightOnePixel<pixel_t, fadeBackground, isRGB>(lightIt_outline, _dstp, j, val_color_outline, bits_per_pixel);
-          }
-        }
-        j += 1;
-      }
+      LightCoverageLine<pixel_t, useHalocolor, fadeBackground, isRGB>(reinterpret_cast<pixel_t*>(dstp), pre.bitmap->coverage[ty].data() + shifted_xstart,
+        pre.text_width, val_color, val_color_outline, bits_per_pixel);
       dstp += pitch;
     }
   }
 }
 
 template<typename pixel_t, bool useHalocolor, bool fadeBackground, int logXRatioUV, int logYRatioUV, ChromaLocationMode chromaMode>
-void RenderUV(int bits_per_pixel, int color, int halocolor, int* pitches, BYTE** dstps, PreRendered& pre)
+void RenderUV(int bits_per_pixel, int color, int halocolor, int* pitches, BYTE** dstps, const PreRendered& pre)
 {
   // some optimization hint
   if constexpr (sizeof(pixel_t) == 1)
@@ -1370,11 +1449,11 @@ void RenderUV(int bits_per_pixel, int color, int halocolor, int* pitches, BYTE**
   // safe zero array for vertical subsampled 4:2:0 case for orphan top/bottom
   std::vector<uint8_t> zeros;
   if constexpr (hasVerticalSubsample)
-    zeros.resize(pre.stringbitmap[0].size());
+    zeros.resize(pre.bitmap->stringbitmap[0].size());
 
   // second array element is only valid for vertically subsampled 4:2:0
-  uint8_t* fontlines_ptr[2] = { nullptr };
-  uint8_t* fontoutlines_ptr[2] = { nullptr };
+  const uint8_t* fontlines_ptr[2] = { nullptr };
+  const uint8_t* fontoutlines_ptr[2] = { nullptr };
 
   for (int ty = pre.ystart; ty < pre.yend; ty += ySubS) {
 
@@ -1384,29 +1463,29 @@ void RenderUV(int bits_per_pixel, int color, int halocolor, int* pitches, BYTE**
     if (hasVerticalSubsample && odd_y_start && ty == pre.ystart) {
       // top font line on odd y position + vertically subsampled (420)
       fontlines_ptr[0] = zeros.data();
-      fontlines_ptr[1] = pre.stringbitmap[ty].data();
+      fontlines_ptr[1] = pre.bitmap->stringbitmap[ty].data();
       if constexpr(useHalocolor) {
         fontoutlines_ptr[0] = zeros.data();
-        fontoutlines_ptr[1] = pre.stringbitmap_outline[ty].data();
+        fontoutlines_ptr[1] = pre.bitmap->stringbitmap_outline[ty].data();
       }
     }
     else if (hasVerticalSubsample && ty + 1 - yshift >= pre.stringbitmap_height) {
       // bottom font line on even y position
-      fontlines_ptr[0] = pre.stringbitmap[ty - yshift].data();
+      fontlines_ptr[0] = pre.bitmap->stringbitmap[ty - yshift].data();
       fontlines_ptr[1] = zeros.data();
       if constexpr(useHalocolor) {
-        fontoutlines_ptr[0] = pre.stringbitmap_outline[ty - yshift].data();
+        fontoutlines_ptr[0] = pre.bitmap->stringbitmap_outline[ty - yshift].data();
         fontoutlines_ptr[1] = zeros.data();
       }
     }
     else {
       // all font lines contributing to chroma can safely be used
       for (int m = 0; m < ySubS; m++)
-        fontlines_ptr[m] = pre.stringbitmap[ty + m - yshift].data();
+        fontlines_ptr[m] = pre.bitmap->stringbitmap[ty + m - yshift].data();
 
       if constexpr(useHalocolor) {
         for (int m = 0; m < ySubS; m++)
-          fontoutlines_ptr[m] = pre.stringbitmap_outline[ty + m - yshift].data();
+          fontoutlines_ptr[m] = pre.bitmap->stringbitmap_outline[ty + m - yshift].data();
       }
     }
 
@@ -1531,8 +1610,7 @@ void do_DrawStringPlanar(
   const int safety_bits_x_left = (1 << logXRatioUV) - 1 + (isLeftStyleChromaLoc ? 1 : 0);
   const int safety_bits_x_right = (1 << logXRatioUV) - 1;
 
-  PreRendered pre(bmfont->font_bitmaps.data(), bmfont->fontline_bytes, width, height, x, y, s, align, useHalocolor, 
-    bmfont->width, bmfont->height, safety_bits_x_left, safety_bits_x_right);
+  PreRendered pre(bmfont, width, height, x, y, s, align, useHalocolor, safety_bits_x_left, safety_bits_x_right);
 
   if (pre.len <= 0)
     return;
@@ -1596,7 +1674,7 @@ void do_DrawStringPlanar(
 }
 
 template<bool useHalocolor, bool fadeBackground, ChromaLocationMode chromaMode>
-void RenderYUY2(int color, int halocolor, int pitch, BYTE* _dstp, PreRendered& pre)
+void RenderYUY2(int color, int halocolor, int pitch, BYTE* _dstp, const PreRendered& pre)
 {
   BYTE* dstp = _dstp + pre.x * 2 + pre.y * pitch;
   BYTE* dstpUV = _dstp + (pre.x / 2) * 4 + 1 + pre.y * pitch; // always points to U of a YUYV block
@@ -1625,10 +1703,10 @@ void RenderYUY2(int color, int halocolor, int pitch, BYTE* _dstp, PreRendered& p
   for (int ty = pre.ystart; ty < pre.yend; ty++) {
     BYTE* dp = dstp;
     BYTE* dpUV = dstpUV;
-    uint8_t* fontline_ptr = pre.stringbitmap[ty].data();
-    [[maybe_unused]] uint8_t* fontoutline_ptr;
+    const uint8_t* fontline_ptr = pre.bitmap->stringbitmap[ty].data();
+    [[maybe_unused]] const uint8_t* fontoutline_ptr;
     if constexpr (useHalocolor)
-      fontoutline_ptr = pre.stringbitmap_outline[ty].data();
+      fontoutline_ptr = pre.bitmap->stringbitmap_outline[ty].data();
 
     // first Y, like in 4:4:4
     int j = 0;
@@ -1726,8 +1804,7 @@ static void do_DrawStringYUY2(
   const int safety_bits_x_left = 1 + (isLeftStyleChromaLoc ? 1 : 0);
   const int safety_bits_x_right = 1;
 
-  PreRendered pre(bmfont->font_bitmaps.data(), bmfont->fontline_bytes, width, height, x, y, s, align, useHalocolor, bmfont->width, bmfont->height,
-    safety_bits_x_left, safety_bits_x_right);
+  PreRendered pre(bmfont, width, height, x, y, s, align, useHalocolor, safety_bits_x_left, safety_bits_x_right);
 
   if (pre.len <= 0)
     return;
@@ -1747,7 +1824,7 @@ static void do_DrawStringYUY2(
 }
 
 template<typename pixel_t, bool useHalocolor, bool fadeBackground, int rgbstep>
-static void RenderPackedRGB(int color, int halocolor, BYTE* _dstp, int pitch, int height, PreRendered& pre)
+static void RenderPackedRGB(int color, int halocolor, BYTE* _dstp, int pitch, int height, const PreRendered& pre)
 {
   // packed: only 8 and 16 bits
   int bits_per_pixel = 0;
@@ -1769,19 +1846,15 @@ static void RenderPackedRGB(int color, int halocolor, BYTE* _dstp, int pitch, in
   // Start rendering
   for (int ty = pre.ystart; ty < pre.yend; ty++) {
     uint8_t* dp = dstp;
-    uint8_t* fontline_ptr = pre.stringbitmap[ty].data();
-    [[maybe_unused]] uint8_t* fontoutline_ptr;
-    if constexpr(useHalocolor)
-      fontoutline_ptr = pre.stringbitmap_outline[ty].data();
+    const uint8_t* coverage = pre.bitmap->coverage[ty].data() + pre.safety_bits_x_left + pre.xstart;
 
-    const int shifted_xstart = pre.safety_bits_x_left + pre.xstart; // though safety bit count must be 0 here
-    for (int tx = shifted_xstart; tx < shifted_xstart + pre.text_width; tx++)
+    for (int j = 0; j < pre.text_width; j++)
     {
-      const bool lightIt = 0 != get_bit(fontline_ptr, tx);
+      const bool lightIt = coverage[j] == 2;
       LightOnePixelPackedRGB<pixel_t, fadeBackground>(lightIt, dp, val_color_R, val_color_G, val_color_B);
       if constexpr(useHalocolor) {
         if (!lightIt) {
-          const bool lightIt_outline = 0 != get_bit(fontoutline_ptr, tx);
+          const bool lightIt_outline = coverage[j] == 1;
           LightOnePixelPackedRGB<pixel_t, fadeBackground>(lightIt_outline, dp, val_color_R_outline, val_color_G_outline, val_color_B_outline);
         }
       }
@@ -1798,8 +1871,7 @@ static void do_DrawStringPackedRGB(
 {
   const int safety_bits_x_left = 0; // no horizontal subsampling
   const int safety_bits_x_right = 0; // no horizontal subsampling
-  PreRendered pre(bmfont->font_bitmaps.data(), bmfont->fontline_bytes, width, height, x, y, s, align, useHalocolor, bmfont->width, bmfont->height,
-    safety_bits_x_left, safety_bits_x_right);
+  PreRendered pre(bmfont, width, height, x, y, s, align, useHalocolor, safety_bits_x_left, safety_bits_x_right);
 
   if (pre.len <= 0)
     return;
@@ -1825,7 +1897,7 @@ extern const uint16_t *font_bitmaps[];
 extern const uint16_t *font_codepoints[];
 extern const FixedFont_info_t *font_infos[];
 
-std::unique_ptr<BitmapFont> GetBitmapFont(int size, const char *name, bool bold, bool debugSave) {
+static std::unique_ptr<BitmapFont> CreateBitmapFont(int size, const char *name, bool bold, bool debugSave) {
 
   BitmapFont* current_font = nullptr;
 
@@ -1914,6 +1986,30 @@ std::unique_ptr<BitmapFont> GetBitmapFont(int size, const char *name, bool bold,
   return std::unique_ptr<BitmapFont>(current_font);
 }
 
+std::shared_ptr<BitmapFont> GetBitmapFont(int size, const char* name, bool bold, bool debugSave) {
+  if (debugSave)
+    return CreateBitmapFont(size, name, bold, debugSave);
+
+  // Fonts are never released: the set of (name, size, bold) combinations used in a process is small,
+  // and a font is requested again by each instance and by each frame drawn with DrawStringPlanar.
+  static std::mutex font_cache_mutex;
+  static std::vector<std::pair<std::string, std::shared_ptr<BitmapFont>>> font_cache;
+
+  std::string key(name);
+  std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return (char)tolower(c); });
+  key += "/" + std::to_string(size) + (bold ? "/b" : "/r");
+
+  std::lock_guard<std::mutex> lock(font_cache_mutex);
+  for (auto& entry : font_cache) {
+    if (entry.first == key)
+      return entry.second;
+  }
+  std::shared_ptr<BitmapFont> font = CreateBitmapFont(size, name, bold, debugSave);
+  if (font)
+    font_cache.emplace_back(key, font);
+  return font;
+}
+
 static void DrawString_internal(BitmapFont* current_font, const VideoInfo& vi, PVideoFrame& dst, int x, int y, std::string& s_utf8,
   int color, int halocolor, bool useHalocolor, int align, bool fadeBackground, int chromalocation)
 {
@@ -2136,7 +2232,7 @@ void DrawStringPlanar(VideoInfo& vi, PVideoFrame& dst, int x, int y, const char*
 
   int halocolor = 0;
 
-  std::unique_ptr<BitmapFont> current_font = GetBitmapFont(20, "info_h", false, false); // 10x20
+  std::shared_ptr<BitmapFont> current_font = GetBitmapFont(20, "info_h", false, false); // 10x20
 
   if (current_font == nullptr)
     return;
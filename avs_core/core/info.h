@@ -45,6 +45,9 @@
 #include <iomanip>
 #include <vector>
 #include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
 #include "strings.h"
 
 enum ChromaLocationMode {
@@ -55,6 +58,31 @@ enum ChromaLocationMode {
   LEFT_422
 };
 
+class BitmapFont;
+
+// Position independent part of a rendered string: bit masks of the characters and of their halo,
+// and a byte per pixel coverage map made of them. Immutable, cached by BitmapFont::GetStringBitmap.
+class StringBitmap {
+public:
+  std::vector<std::vector<uint8_t>> stringbitmap;
+  std::vector<std::vector<uint8_t>> stringbitmap_outline;
+  std::vector<std::vector<uint8_t>> coverage; // 0: background, 1: halo, 2: text
+
+  StringBitmap(
+    const uint8_t* fonts,
+    const int fontline_bytes,
+    const int* s, const int len,
+    const bool useHalocolor,
+    const int FONT_WIDTH, const int FONT_HEIGHT,
+    const int safety_bits_x_left,
+    const int safety_bits_x_right
+  );
+
+private:
+  void make_outline();
+  void make_coverage(const bool useHalocolor, const int stringbitmap_width);
+};
+
 class PreRendered {
   const bool useHalocolor;
   const int width;
@@ -71,23 +99,18 @@ public:
   const int safety_bits_x_left; // extra leftside playground for chroma rendering
   const int safety_bits_x_right; // extra rightside playground for chroma rendering
 
-  std::vector<std::vector<uint8_t>> stringbitmap;
-  std::vector<std::vector<uint8_t>> stringbitmap_outline;
+  std::shared_ptr<const StringBitmap> bitmap;
 
   PreRendered(
-    const uint8_t* fonts,
-    const int fontline_bytes,
+    const BitmapFont* font,
     const int _width, const int _height,
     int _x, int _y, // they may change
     std::vector<int>& s, // it may get shortened
     const int align,
     const bool _useHalocolor,
-    const int FONT_WIDTH, const int FONT_HEIGHT,
     const int _safety_bits_x_left,
     const int _safety_bits_x_right
     );
-
-  void make_outline();
 };
 
 class BitmapFont {
@@ -151,9 +174,28 @@ public:
 
   // helper function for remapping an utf8 string to font index entry list
   std::vector<int> remap(const std::string& s_utf8);
+
+  // Bitmaps of the recently drawn strings. Fonts are shared between filter instances and threads.
+  std::shared_ptr<const StringBitmap> GetStringBitmap(const int* s, int len, bool useHalocolor,
+    int safety_bits_x_left, int safety_bits_x_right) const;
+
+private:
+  struct StringBitmapKey {
+    std::vector<int> s;
+    bool useHalocolor;
+    int safety_bits_x_left, safety_bits_x_right;
+    bool operator==(const StringBitmapKey& other) const {
+      return s == other.s && useHalocolor == other.useHalocolor &&
+        safety_bits_x_left == other.safety_bits_x_left && safety_bits_x_right == other.safety_bits_x_right;
+    }
+  };
+  static constexpr size_t STRINGBITMAP_CACHE_SIZE = 32;
+  mutable std::mutex stringbitmap_mutex;
+  mutable std::list<std::pair<StringBitmapKey, std::shared_ptr<const StringBitmap>>> stringbitmap_cache; // most recent first
 };
 
-std::unique_ptr<BitmapFont> GetBitmapFont(int size, const char* name, bool bold, bool debugSave);
+// Fonts are cached by (name, size, bold), all callers asking for the same font get the same instance.
+std::shared_ptr<BitmapFont> GetBitmapFont(int size, const char* name, bool bold, bool debugSave);
 
 void SimpleTextOutW(BitmapFont* current_font, const VideoInfo& vi, PVideoFrame& frame, int real_x, int real_y, std::string& text_utf8,
   bool fadeBackground, int textcolor, int halocolor, bool useHaloColor, int align, int chromaplacement);
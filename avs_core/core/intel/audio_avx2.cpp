@@ -0,0 +1,42 @@
+// Avisynth+
+// https://avs-plus.net
+//
+// This file is part of Avisynth+ which is released under GPL2+ with exception.
+
+// Audio channel operation helpers (AVX2)
+
+#include <immintrin.h>
+#include "audio_avx2.h"
+
+void amplify_float_avx2(float* samples, const float* gains, int channels, int count)
+{
+  // 8 audio samples of all channels are exactly 'channels' vectors
+  const int c_loop = count & ~7;
+  float* p = samples;
+  for (int i = 0; i < c_loop; i += 8) {
+    for (int v = 0; v < channels; v++) {
+      __m256 s = _mm256_loadu_ps(p);
+      _mm256_storeu_ps(p, _mm256_mul_ps(s, _mm256_loadu_ps(gains + v * 8)));
+      p += 8;
+    }
+  }
+  for (int i = c_loop; i < count; i++)
+    for (int j = 0; j < channels; j++)
+      *p++ *= gains[j];
+  _mm256_zeroupper();
+}
+
+void mix_float_avx2(float* dst, const float* src, float factor1, float factor2, int n)
+{
+  const __m256 f1 = _mm256_set1_ps(factor1);
+  const __m256 f2 = _mm256_set1_ps(factor2);
+  const int c_loop = n & ~7;
+  // FMA: may differ from the C and SSE2 versions in the last bit
+  for (int i = 0; i < c_loop; i += 8) {
+    __m256 b = _mm256_mul_ps(_mm256_loadu_ps(src + i), f2);
+    _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(_mm256_loadu_ps(dst + i), f1, b));
+  }
+  for (int i = c_loop; i < n; i++)
+    dst[i] = (dst[i] * factor1) + (src[i] * factor2);
+  _mm256_zeroupper();
+}
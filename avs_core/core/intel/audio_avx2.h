@@ -0,0 +1,18 @@
+// Avisynth+
+// https://avs-plus.net
+//
+// This file is part of Avisynth+ which is released under GPL2+ with exception.
+
+// Audio channel operation helpers (AVX2)
+
+#ifndef __Audio_AVX2_H__
+#define __Audio_AVX2_H__
+
+#include <avs/types.h>
+#include <stdint.h>
+
+// gains: see amplify_float_sse2
+void amplify_float_avx2(float* samples, const float* gains, int channels, int count);
+void mix_float_avx2(float* dst, const float* src, float factor1, float factor2, int n);
+
+#endif  // __Audio_AVX2_H__
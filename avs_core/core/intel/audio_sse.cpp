@@ -0,0 +1,239 @@
+// Avisynth+
+// https://avs-plus.net
+//
+// This file is part of Avisynth+ which is released under GPL2+ with exception.
+
+// Audio channel operation helpers (SSE2)
+// Used by Amplify, MixAudio, ConvertToMono, GetChannel and MergeChannels
+
+#include "audio_sse.h"
+#include <avs/config.h>
+#include <emmintrin.h>
+
+#if defined(GCC) || defined(CLANG)
+  #define SSE2 __attribute__((__target__("sse2")))
+#else
+  #define SSE2
+#endif
+
+// Q17 fixed point rounding of 2x2 double products:
+// clamp((p + 65536) >> 17, INT16_MIN, INT16_MAX).
+// Products of an int16 sample and an int32 factor (and the sum of two such
+// products) fit exactly into the 53 bit mantissa, scaling by 2^-17 is exact,
+// so the result is identical to the 64 bit integer arithmetic of the C version.
+// Flooring is done by truncation after biasing into the positive range.
+SSE2 static AVS_FORCEINLINE __m128i q17_round_int16(__m128d a, __m128d b)
+{
+  const __m128d rounder = _mm_set1_pd(65536.0);
+  const __m128d scale = _mm_set1_pd(1.0 / 131072.0);
+  const __m128d lo = _mm_set1_pd(-32768.0);
+  const __m128d hi = _mm_set1_pd(32767.0);
+  const __m128d bias = _mm_set1_pd(32768.0);
+  a = _mm_mul_pd(_mm_add_pd(a, rounder), scale);
+  b = _mm_mul_pd(_mm_add_pd(b, rounder), scale);
+  a = _mm_add_pd(_mm_min_pd(_mm_max_pd(a, lo), hi), bias);
+  b = _mm_add_pd(_mm_min_pd(_mm_max_pd(b, lo), hi), bias);
+  __m128i res = _mm_unpacklo_epi64(_mm_cvttpd_epi32(a), _mm_cvttpd_epi32(b));
+  return _mm_sub_epi32(res, _mm_set1_epi32(32768));
+}
+
+SSE2 static AVS_FORCEINLINE __m128d lo_pd(__m128i v32)
+{
+  return _mm_cvtepi32_pd(v32);
+}
+
+SSE2 static AVS_FORCEINLINE __m128d hi_pd(__m128i v32)
+{
+  return _mm_cvtepi32_pd(_mm_shuffle_epi32(v32, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+SSE2 static AVS_FORCEINLINE __m128i sign_extend_lo_16_32(__m128i v)
+{
+  return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+SSE2 static AVS_FORCEINLINE __m128i sign_extend_hi_16_32(__m128i v)
+{
+  return _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+}
+
+SSE2 void amplify_float_sse2(float* samples, const float* gains, int channels, int count)
+{
+  // 4 audio samples of all channels are exactly 'channels' vectors,
+  // vector v always sees the same gain pattern gains[4*v..4*v+3]
+  const int c_loop = count & ~3;
+  float* p = samples;
+  for (int i = 0; i < c_loop; i += 4) {
+    for (int v = 0; v < channels; v++) {
+      __m128 s = _mm_loadu_ps(p);
+      _mm_storeu_ps(p, _mm_mul_ps(s, _mm_loadu_ps(gains + v * 4)));
+      p += 4;
+    }
+  }
+  for (int i = c_loop; i < count; i++)
+    for (int j = 0; j < channels; j++)
+      *p++ *= gains[j];
+}
+
+SSE2 void amplify_int16_sse2(int16_t* samples, const double* gains, int channels, int count)
+{
+  const int c_loop = count & ~7;
+  int16_t* p = samples;
+  for (int i = 0; i < c_loop; i += 8) {
+    for (int v = 0; v < channels; v++) {
+      const double* g = gains + v * 8;
+      __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      __m128i s_lo = sign_extend_lo_16_32(s);
+      __m128i s_hi = sign_extend_hi_16_32(s);
+      __m128i r_lo = q17_round_int16(
+        _mm_mul_pd(lo_pd(s_lo), _mm_loadu_pd(g + 0)),
+        _mm_mul_pd(hi_pd(s_lo), _mm_loadu_pd(g + 2)));
+      __m128i r_hi = q17_round_int16(
+        _mm_mul_pd(lo_pd(s_hi), _mm_loadu_pd(g + 4)),
+        _mm_mul_pd(hi_pd(s_hi), _mm_loadu_pd(g + 6)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_packs_epi32(r_lo, r_hi));
+      p += 8;
+    }
+  }
+  // rest: same arithmetic, one sample at a time
+  for (int i = c_loop; i < count; i++) {
+    for (int j = 0; j < channels; j++) {
+      __m128i r = q17_round_int16(_mm_set_sd(*p * gains[j]), _mm_setzero_pd());
+      *p++ = (int16_t)_mm_cvtsi128_si32(r);
+    }
+  }
+}
+
+SSE2 void mix_float_sse2(float* dst, const float* src, float factor1, float factor2, int n)
+{
+  const __m128 f1 = _mm_set1_ps(factor1);
+  const __m128 f2 = _mm_set1_ps(factor2);
+  const int c_loop = n & ~3;
+  for (int i = 0; i < c_loop; i += 4) {
+    __m128 a = _mm_mul_ps(_mm_loadu_ps(dst + i), f1);
+    __m128 b = _mm_mul_ps(_mm_loadu_ps(src + i), f2);
+    _mm_storeu_ps(dst + i, _mm_add_ps(a, b));
+  }
+  for (int i = c_loop; i < n; i++)
+    dst[i] = (dst[i] * factor1) + (src[i] * factor2);
+}
+
+SSE2 void mix_int16_sse2(int16_t* dst, const int16_t* src, int factor1, int factor2, int n)
+{
+  const __m128d f1 = _mm_set1_pd((double)factor1);
+  const __m128d f2 = _mm_set1_pd((double)factor2);
+  const int c_loop = n & ~7;
+  for (int i = 0; i < c_loop; i += 8) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i a_lo = sign_extend_lo_16_32(a), a_hi = sign_extend_hi_16_32(a);
+    __m128i b_lo = sign_extend_lo_16_32(b), b_hi = sign_extend_hi_16_32(b);
+    __m128i r_lo = q17_round_int16(
+      _mm_add_pd(_mm_mul_pd(lo_pd(a_lo), f1), _mm_mul_pd(lo_pd(b_lo), f2)),
+      _mm_add_pd(_mm_mul_pd(hi_pd(a_lo), f1), _mm_mul_pd(hi_pd(b_lo), f2)));
+    __m128i r_hi = q17_round_int16(
+      _mm_add_pd(_mm_mul_pd(lo_pd(a_hi), f1), _mm_mul_pd(lo_pd(b_hi), f2)),
+      _mm_add_pd(_mm_mul_pd(hi_pd(a_hi), f1), _mm_mul_pd(hi_pd(b_hi), f2)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(r_lo, r_hi));
+  }
+  for (int i = c_loop; i < n; i++) {
+    __m128d p = _mm_set_sd((double)dst[i] * factor1 + (double)src[i] * factor2);
+    dst[i] = (int16_t)_mm_cvtsi128_si32(q17_round_int16(p, _mm_setzero_pd()));
+  }
+}
+
+SSE2 void downmix_stereo_float_sse2(const float* src, float* dst, int count)
+{
+  const __m128 half = _mm_set1_ps(0.5f);
+  const int c_loop = count & ~3;
+  for (int i = 0; i < c_loop; i += 4) {
+    __m128 a = _mm_loadu_ps(src + i * 2);
+    __m128 b = _mm_loadu_ps(src + i * 2 + 4);
+    __m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_add_ps(l, r), half));
+  }
+  for (int i = c_loop; i < count; i++)
+    dst[i] = (src[i * 2] + src[i * 2 + 1]) * 0.5f;
+}
+
+SSE2 void downmix_stereo_int16_sse2(const int16_t* src, int16_t* dst, int count)
+{
+  // (l + r + 1) >> 1, same as the generic (sum * (65536 / 2) + 32768) >> 16
+  const __m128i one = _mm_set1_epi32(1);
+  const int c_loop = count & ~7;
+  for (int i = 0; i < c_loop; i += 8) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2 + 8));
+    __m128i sum_a = _mm_add_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(a, 16));
+    __m128i sum_b = _mm_add_epi32(_mm_srai_epi32(_mm_slli_epi32(b, 16), 16), _mm_srai_epi32(b, 16));
+    sum_a = _mm_srai_epi32(_mm_add_epi32(sum_a, one), 1);
+    sum_b = _mm_srai_epi32(_mm_add_epi32(sum_b, one), 1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(sum_a, sum_b));
+  }
+  for (int i = c_loop; i < count; i++)
+    dst[i] = (int16_t)((src[i * 2] + src[i * 2 + 1] + 1) >> 1);
+}
+
+SSE2 void extract_stereo_channel_16_sse2(const int16_t* src, int16_t* dst, int channel, int count)
+{
+  const int c_loop = count & ~7;
+  for (int i = 0; i < c_loop; i += 8) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2 + 8));
+    if (channel == 0) {
+      a = _mm_slli_epi32(a, 16);
+      b = _mm_slli_epi32(b, 16);
+    }
+    a = _mm_srai_epi32(a, 16);
+    b = _mm_srai_epi32(b, 16);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(a, b));
+  }
+  for (int i = c_loop; i < count; i++)
+    dst[i] = src[i * 2 + channel];
+}
+
+SSE2 void extract_stereo_channel_32_sse2(const int32_t* src, int32_t* dst, int channel, int count)
+{
+  const int c_loop = count & ~3;
+  for (int i = 0; i < c_loop; i += 4) {
+    __m128 a = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2)));
+    __m128 b = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2 + 4)));
+    __m128 res = channel == 0 ?
+      _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)) :
+      _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_castps_si128(res));
+  }
+  for (int i = c_loop; i < count; i++)
+    dst[i] = src[i * 2 + channel];
+}
+
+SSE2 void interleave_mono2_16_sse2(const int16_t* left, const int16_t* right, int16_t* dst, int count)
+{
+  const int c_loop = count & ~7;
+  for (int i = 0; i < c_loop; i += 8) {
+    __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+    __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), _mm_unpacklo_epi16(l, r));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2 + 8), _mm_unpackhi_epi16(l, r));
+  }
+  for (int i = c_loop; i < count; i++) {
+    dst[i * 2] = left[i];
+    dst[i * 2 + 1] = right[i];
+  }
+}
+
+SSE2 void interleave_mono2_32_sse2(const int32_t* left, const int32_t* right, int32_t* dst, int count)
+{
+  const int c_loop = count & ~3;
+  for (int i = 0; i < c_loop; i += 4) {
+    __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+    __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), _mm_unpacklo_epi32(l, r));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2 + 4), _mm_unpackhi_epi32(l, r));
+  }
+  for (int i = c_loop; i < count; i++) {
+    dst[i * 2] = left[i];
+    dst[i * 2 + 1] = right[i];
+  }
+}
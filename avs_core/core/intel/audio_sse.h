@@ -0,0 +1,37 @@
+// Avisynth+
+// https://avs-plus.net
+//
+// This file is part of Avisynth+ which is released under GPL2+ with exception.
+
+// Audio channel operation helpers (SSE2)
+
+#ifndef __Audio_SSE_H__
+#define __Audio_SSE_H__
+
+#include <avs/types.h>
+#include <stdint.h>
+
+// Per-channel gain on interleaved samples.
+// gains: per-channel gain pattern repeated to at least channels*8 entries
+// (gains[k] == gain of channel k % channels), count is in audio samples (frames)
+void amplify_float_sse2(float* samples, const float* gains, int channels, int count);
+// Q17 fixed point gain, evaluated in double precision, bit-identical with the C version
+void amplify_int16_sse2(int16_t* samples, const double* gains, int channels, int count);
+
+// dst = dst * factor1 + src * factor2 over n channel samples
+void mix_float_sse2(float* dst, const float* src, float factor1, float factor2, int n);
+void mix_int16_sse2(int16_t* dst, const int16_t* src, int factor1, int factor2, int n);
+
+// stereo -> mono downmix
+void downmix_stereo_float_sse2(const float* src, float* dst, int count);
+void downmix_stereo_int16_sse2(const int16_t* src, int16_t* dst, int count);
+
+// pick one channel of a stereo stream
+void extract_stereo_channel_16_sse2(const int16_t* src, int16_t* dst, int channel, int count);
+void extract_stereo_channel_32_sse2(const int32_t* src, int32_t* dst, int channel, int count);
+
+// interleave two mono streams into stereo
+void interleave_mono2_16_sse2(const int16_t* left, const int16_t* right, int16_t* dst, int count);
+void interleave_mono2_32_sse2(const int32_t* left, const int32_t* right, int32_t* dst, int count);
+
+#endif  // __Audio_SSE_H__
@@ -509,7 +509,8 @@ void VideoFrame::Release() {
       delete properties; // if needed, frame registry will re-create
       properties = nullptr;
     }
-    InterlockedDecrement(&_vfb->refcount);
+    if (!InterlockedDecrement(&_vfb->refcount) && _vfb->external)
+      ExternalFrameBufferReleased(_vfb); // host memory: hand it back now
   }
 }
 
@@ -573,7 +574,7 @@ int VideoFrame::GetOffset(int plane) const {
 const BYTE* VideoFrame::GetReadPtr(int plane) const { return vfb->GetReadPtr() + GetOffset(plane); }
 
 bool VideoFrame::IsWritable() const {
-  if (refcount == 1 && vfb->refcount == 1) {
+  if (refcount == 1 && vfb->refcount == 1 && vfb->external != 2) {
     vfb->GetWritePtr(); // Bump sequence number
     return true;
   }
@@ -590,7 +591,7 @@ BYTE* VideoFrame::GetWritePtr(int plane) const {
       _ASSERT(FALSE);
 //        throw AvisynthError("Internal Error - refcount was more than one!");
     }
-    return (refcount == 1 && vfb->refcount == 1) ? vfb->GetWritePtr() + GetOffset(plane) : 0;
+    return (refcount == 1 && vfb->refcount == 1 && vfb->external != 2) ? vfb->GetWritePtr() + GetOffset(plane) : 0;
   }
   return vfb->data + GetOffset(plane);
 }
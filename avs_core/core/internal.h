@@ -77,6 +77,7 @@ enum MANAGE_CACHE_KEYS
   MC_NodAndExpandCache = (int)0xFFFF0008,
   MC_RegisterMTGuard,
   MC_UnRegisterMTGuard,
+  MC_ServiceMTGuards,    // host thread, outside of GetFrame: MT_MULTI_INSTANCE instances on demand
 
 	MC_RegisterGraphNode = (int)0xFFFF0100,
 	MC_UnRegisterGraphNode,
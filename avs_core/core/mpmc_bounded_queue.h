@@ -65,6 +65,11 @@ public:
   {
     return max_size;
   }
+
+  size_type count() const
+  {
+    return size;
+  }
 };
 
 #include <mutex>
@@ -116,6 +121,12 @@ public:
 		return finished;
 	}
 
+  size_type size()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_container.count();
+  }
+
   bool push_front(T&& item)
   {
     std::unique_lock<std::mutex> lock(m_mutex);
@@ -254,6 +254,7 @@ extern const AVSFunction Script_functions[] = {
   { "Assert", BUILTIN_FUNC_PREFIX, "s", AssertEval },
 
   { "SetMemoryMax", BUILTIN_FUNC_PREFIX, "[]i[type]i[index]i", SetMemoryMax }, // Neo
+  { "SetHugePages", BUILTIN_FUNC_PREFIX, "i", SetHugePages },
   { "SetWorkingDir", BUILTIN_FUNC_PREFIX, "s", SetWorkingDir },
   { "Exist",         BUILTIN_FUNC_PREFIX, "s[utf8]b", Exist },
 
@@ -302,7 +303,7 @@ extern const AVSFunction Script_functions[] = {
   { "InternalFunctionExists", BUILTIN_FUNC_PREFIX, "s", InternalFunctionExists  },
 
   { "SetFilterMTMode",  BUILTIN_FUNC_PREFIX, "si[force]b", SetFilterMTMode  },
-  { "Prefetch",         BUILTIN_FUNC_PREFIX, "c[threads]i[frames]i", Prefetcher::Create },
+  { "Prefetch",         BUILTIN_FUNC_PREFIX, "c[threads]i[frames]i[numa_node]i", Prefetcher::Create },
   { "SetLogParams",     BUILTIN_FUNC_PREFIX, "[target]s[level]i", SetLogParams },
   { "LogMsg",           BUILTIN_FUNC_PREFIX, "si", LogMsg },
   { "SetCacheMode",     BUILTIN_FUNC_PREFIX, "[mode]i", SetCacheMode }, // Neo
@@ -2254,6 +2255,17 @@ AVSValue SetMemoryMax(AVSValue args, void*, IScriptEnvironment* env)
   return envI->SetMemoryMax((AvsDeviceType)deviceType, deviceIndex, memMax);
 }
 
+AVSValue SetHugePages(AVSValue args, void*, IScriptEnvironment* env)
+{
+  // 0: off, 1: transparent, 2: explicit huge pages for new CPU frame buffers
+  const int mode = args[0].AsInt();
+  if (mode < 0 || mode > 2)
+    env->ThrowError("SetHugePages: mode must be 0 (off), 1 (transparent) or 2 (explicit)");
+  InternalEnvironment *envI = static_cast<InternalEnvironment*>(env);
+  envI->SetDeviceOpt(DEV_HUGE_PAGES, mode);
+  return AVSValue();
+}
+
 AVSValue SetMaxCPU(AVSValue args, void*, IScriptEnvironment* env)
 {
   InternalEnvironment* envI = static_cast<InternalEnvironment*>(env);
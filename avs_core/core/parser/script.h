@@ -282,6 +282,7 @@ AVSValue LogMsg(AVSValue args, void*, IScriptEnvironment* env);
 AVSValue SetCacheMode(AVSValue args, void*, IScriptEnvironment* env);
 AVSValue SetDeviceOpt(AVSValue args, void*, IScriptEnvironment* env);
 AVSValue SetMemoryMax(AVSValue args, void*, IScriptEnvironment* env);
+AVSValue SetHugePages(AVSValue args, void*, IScriptEnvironment* env);
 AVSValue SetMaxCPU(AVSValue args, void*, IScriptEnvironment* env); // 20200331
 
 AVSValue IsY(AVSValue args, void*, IScriptEnvironment* env);
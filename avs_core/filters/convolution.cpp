@@ -43,8 +43,22 @@
 // avs+: all color spaces, 8-32 bits, 7x7, 9x9, luma/chroma/alpha option
 
 #include "convolution.h"
+#ifdef INTEL_INTRINSICS
+#include "intel/convolution_sse.h"
+#include "intel/convolution_avx2.h"
+#endif
 #include "../core/internal.h"
-
+#include <avs/alignment.h>
+#include <avs/minmax.h>
+#ifdef AVS_WINDOWS
+    #include <avs/win.h>
+#else
+    #include <avs/posix.h>
+#endif
+
+#include <algorithm>
+#include <numeric>
+#include <cstring>
 #include <regex>
 #include <iostream>
 #include <iterator>
@@ -56,7 +70,7 @@
 
 extern const AVSFunction Convolution_filters[] = {
 // Please when adding parameters try not to break the legacy order - IanB July 2004
-  { "GeneralConvolution", BUILTIN_FUNC_PREFIX, "c[bias]f[matrix]s[divisor]f[auto]b[luma]b[chroma]b[alpha]b", GeneralConvolution::Create },
+  { "GeneralConvolution", BUILTIN_FUNC_PREFIX, "c[bias]f[matrix]s[divisor]f[auto]b[luma]b[chroma]b[alpha]b[border]s", GeneralConvolution::Create },
     /**
       * GeneralConvolution(PClip clip, int divisor=1, int bias=0, string matrix)
       * clip     =  input video
@@ -67,6 +81,7 @@ extern const AVSFunction Convolution_filters[] = {
       * luma     =  apply on luma (if applicable) avs+
       * chroma   =  apply on chroma (if applicable) avs+
       * alpha    =  apply on alpha (if applicable e.g. RGB32 converted to planar RGBA) avs+
+      * border   =  "repeat" (default), "mirror" or "keep": handling of pixels outside the frame avs+
       *
       * clip.GeneralConvolution(matrix = "1 2 3
       *                                   4 5 6
@@ -91,268 +106,188 @@ AVS_FORCEINLINE int static_clip(int value) {
 ****** General Convolution 2D filter *****
 *****************************************/
 
+// One output line. Source lines are already extended by limit border pixels on both sides,
+// no x check needed.
 // safe_int_t is int or int64_t. Int is faster but for larger bitdepth int32 overflows
 template<typename pixel_t, int matrix_size, typename safe_int_t>
-static void do_conv_integer(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel)
+static void conv_row_integer_c(BYTE* dstp8, const BYTE* const* rows, int width, const int* matrix, int /*matrix_size*/, int iCountDiv, int iBias, int max_pixel_value)
 {
-  pixel_t *dstp = reinterpret_cast<pixel_t *>(dstp8);
-  const pixel_t *srcp = reinterpret_cast<const pixel_t *>(srcp8);
-  dst_pitch /= sizeof(pixel_t);
-  src_pitch /= sizeof(pixel_t);
-
-  constexpr int limit = (matrix_size - 1) / 2; // +-1, +-2, +-3
-  const int max_pixel_value = (1 << bits_per_pixel) - 1;
-
-  std::vector<const pixel_t*> src_lineptrs;
-  src_lineptrs.resize(limit + height + limit);
-
-  // prefill line pointers
-  for (int y = -limit; y < height + limit; y++)
-  {
-    if (y < 0)
-      src_lineptrs[y + limit] = srcp + src_pitch * 0; // duplicate top
-    else if (y < height)
-      src_lineptrs[y + limit] = srcp + src_pitch * y;
-    else
-      src_lineptrs[y + limit] = srcp + src_pitch * (height - 1); // duplicate bottom
-  }
-
-  std::vector<const pixel_t *> src_current_lineptrs(matrix_size); // +/-limit => 2*limit + 1
-
+  pixel_t* dstp = reinterpret_cast<pixel_t*>(dstp8);
+  constexpr int limit = (matrix_size - 1) / 2; // +-1, +-2, +-3, +-4
   constexpr safe_int_t rounder = 1 << (20 - 1);
 
-  for (int y = 0; y < height; ++y) {
-    // prefill current vertical line pointers
-    for (int yy = -limit; yy <= limit; yy++) {
-      src_current_lineptrs[yy + limit] = src_lineptrs[limit + (y + yy)];
-    }
-    int x = 0;
-    // left area: check valid x
-    for (; x < limit; x++)
-    {
-      safe_int_t sum = 0; // int or int64_t!!!
-      const int *current_matrix = matrix + limit; // center of the matrix line
-      for (int yy = 0; yy < matrix_size; yy++) { // 0..limit * 2 + 1
-        const pixel_t *current_line = src_current_lineptrs[yy];
-        for (int xx = -limit; xx <= limit; xx++) {
-          int current_x = x + xx;
-          if (current_x < 0) current_x = 0;
-          else if (current_x >= width) current_x = width - 1;
-          const int current_pixel = current_line[current_x];
-          const int current_weight = current_matrix[xx];
-          sum += current_pixel * current_weight;
-        }
-        current_matrix += matrix_size; // next matrix line
+  const pixel_t* lines[matrix_size];
+  for (int yy = 0; yy < matrix_size; yy++)
+    lines[yy] = reinterpret_cast<const pixel_t*>(rows[yy]);
+
+  for (int x = 0; x < width; x++) {
+    safe_int_t sum = 0; // int or int64_t!!!
+    const int* current_matrix = matrix + limit; // center of the matrix line
+    for (int yy = 0; yy < matrix_size; yy++) { // 0..limit * 2 + 1
+      const pixel_t* current_line = lines[yy];
+      // compilers are smart nowadays but let's help them
+      if constexpr (matrix_size == 3) {
+        sum +=
+          current_line[x - 1] * current_matrix[-1] +
+          current_line[x + 0] * current_matrix[0] +
+          current_line[x + 1] * current_matrix[1];
       }
-      int result = (int)((sum * iCountDiv + rounder) >> 20) + iBias;
-      dstp[x] = clamp(result, 0, max_pixel_value);
-    }
-    // middle area: no x check: fast!
-    for (; x < width - limit; x++) {
-      safe_int_t sum = 0;
-      const int *current_matrix = matrix + limit; // center of the matrix line
-      for (int yy = 0; yy < matrix_size; yy++) { // 0..limit * 2 + 1
-        const pixel_t *current_line = src_current_lineptrs[yy];
-        // compilers are smart nowadays but let's help them
-        if constexpr (matrix_size == 3) {
-          sum +=
-            current_line[x - 1] * current_matrix[-1] +
-            current_line[x + 0] * current_matrix[0] +
-            current_line[x + 1] * current_matrix[1];
-        }
-        else if constexpr (matrix_size == 5) {
-          sum +=
-            current_line[x - 2] * current_matrix[-2] +
-            current_line[x - 1] * current_matrix[-1] +
-            current_line[x + 0] * current_matrix[0] +
-            current_line[x + 1] * current_matrix[1] +
-            current_line[x + 2] * current_matrix[2];
-        }
-        else {
-          for (int xx = -limit; xx <= limit; xx++) {
-            int current_x = x + xx;
-            // no checking!
-            /*if (current_x < 0) current_x = 0;
-            else if (current_x >= width) current_x = width - 1;*/
-            const int current_pixel = current_line[current_x];
-            const int current_weight = current_matrix[xx];
-            sum += current_pixel * current_weight;
-          }
-        }
-        current_matrix += matrix_size; // next matrix line
+      else if constexpr (matrix_size == 5) {
+        sum +=
+          current_line[x - 2] * current_matrix[-2] +
+          current_line[x - 1] * current_matrix[-1] +
+          current_line[x + 0] * current_matrix[0] +
+          current_line[x + 1] * current_matrix[1] +
+          current_line[x + 2] * current_matrix[2];
       }
-      int result = (int)((sum * iCountDiv + rounder) >> 20) + iBias;
-      dstp[x] = clamp(result, 0, max_pixel_value);
-    }
-    // right area: check valid x
-    for (; x < width; x++)
-    {
-      safe_int_t sum = 0;
-      const int *current_matrix = matrix + limit; // center of the matrix line
-      for (int yy = 0; yy < matrix_size; yy++) { // 0..limit * 2 + 1
-        const pixel_t *current_line = src_current_lineptrs[yy];
+      else {
         for (int xx = -limit; xx <= limit; xx++) {
-          int current_x = x + xx;
-          if (current_x < 0) current_x = 0;
-          else if (current_x >= width) current_x = width - 1;
-          const int current_pixel = current_line[current_x];
+          const int current_pixel = current_line[x + xx];
           const int current_weight = current_matrix[xx];
           sum += current_pixel * current_weight;
         }
-        current_matrix += matrix_size; // next matrix line
       }
-      int result = (int)((sum * iCountDiv + rounder) >> 20) + iBias;
-      dstp[x] = clamp(result, 0, max_pixel_value);
+      current_matrix += matrix_size; // next matrix line
     }
-    dstp += dst_pitch;
-    srcp += src_pitch;
+    int result = (int)((sum * iCountDiv + rounder) >> 20) + iBias;
+    dstp[x] = clamp(result, 0, max_pixel_value);
   }
 }
 
-// instantiate for 8 bit 3,5,7 and 9
-template void do_conv_integer<uint8_t, 3, int>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-template void do_conv_integer<uint8_t, 5, int>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-template void do_conv_integer<uint8_t, 7, int>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-template void do_conv_integer<uint8_t, 9, int>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-template void do_conv_integer<uint8_t, 3, int64_t>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-template void do_conv_integer<uint8_t, 5, int64_t>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-template void do_conv_integer<uint8_t, 7, int64_t>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-template void do_conv_integer<uint8_t, 9, int64_t>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-
-template void do_conv_integer<uint16_t, 3, int>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-template void do_conv_integer<uint16_t, 5, int>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-template void do_conv_integer<uint16_t, 7, int>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-template void do_conv_integer<uint16_t, 9, int>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-template void do_conv_integer<uint16_t, 3, int64_t>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-template void do_conv_integer<uint16_t, 5, int64_t>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-template void do_conv_integer<uint16_t, 7, int64_t>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-template void do_conv_integer<uint16_t, 9, int64_t>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-
 template<int matrix_size>
-static void do_conv_float(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const float *matrix, float fCountDiv, float fBias)
+static void conv_row_float_c(BYTE* dstp8, const BYTE* const* rows, int width, const float* matrix, int /*matrix_size*/, float fCountDiv, float fBias)
 {
-  float *dstp = reinterpret_cast<float *>(dstp8);
-  const float *srcp = reinterpret_cast<const float *>(srcp8);
-  dst_pitch /= sizeof(float);
-  src_pitch /= sizeof(float);
-
-  constexpr int limit = (matrix_size - 1) / 2; // +-1, +-2, +-3
-
-  std::vector<const float*> src_lineptrs;
-  src_lineptrs.resize(limit + height + limit);
-
-  // prefill line pointers
-  for (int y = -limit; y < height + limit; y++)
-  {
-    if (y < 0)
-      src_lineptrs[y + limit] = srcp + src_pitch * 0;
-    else if (y < height)
-      src_lineptrs[y + limit] = srcp + src_pitch * y;
-    else
-      src_lineptrs[y + limit] = srcp + src_pitch * (height - 1);
-  }
-
-  std::vector<const float *> src_current_lineptrs(matrix_size); // +/-limit => 2*limit + 1
-
-  for (int y = 0; y < height; ++y) {
-    // prefill current vertical line pointers
-    for (int yy = -limit; yy <= limit; yy++) {
-      src_current_lineptrs[yy + limit] = src_lineptrs[limit + (y + yy)];
-    }
-    int x = 0;
-    // left area: check valid x
-    for (; x < limit; x++)
-    {
-      float sum = 0.0f;
-      const float *current_matrix = matrix + limit; // center of the matrix line
-      for (int yy = 0; yy < matrix_size; yy++) { // 0..limit * 2 + 1
-        const float *current_line = src_current_lineptrs[yy];
-        for (int xx = -limit; xx <= limit; xx++) {
-          int current_x = x + xx;
-          if (current_x < 0) current_x = 0;
-          else if (current_x >= width) current_x = width - 1;
-          const float current_pixel = current_line[current_x];
-          const float current_weight = current_matrix[xx];
-          sum += current_pixel * current_weight;
-        }
-        current_matrix += matrix_size; // next matrix line
+  float* dstp = reinterpret_cast<float*>(dstp8);
+  constexpr int limit = (matrix_size - 1) / 2;
+
+  const float* lines[matrix_size];
+  for (int yy = 0; yy < matrix_size; yy++)
+    lines[yy] = reinterpret_cast<const float*>(rows[yy]);
+
+  for (int x = 0; x < width; x++) {
+    float sum = 0.0f;
+    const float* current_matrix = matrix + limit; // center of the matrix line
+    for (int yy = 0; yy < matrix_size; yy++) {
+      const float* current_line = lines[yy];
+      if constexpr (matrix_size == 3) {
+        sum +=
+          current_line[x - 1] * current_matrix[-1] +
+          current_line[x + 0] * current_matrix[0] +
+          current_line[x + 1] * current_matrix[1];
       }
-      float result = sum * fCountDiv + fBias;
-      dstp[x] = result; // no clipping for float
-    }
-    // middle area: no x check: fast!
-    for (; x < width - limit; x++) {
-      float sum = 0.0f;
-      const float *current_matrix = matrix + limit; // center of the matrix line
-      for (int yy = 0; yy < matrix_size; yy++) { // 0..limit * 2 + 1
-        const float *current_line = src_current_lineptrs[yy];
-        // compilers are smart nowadays but let's help them
-        if constexpr (matrix_size == 3) {
-          sum +=
-            current_line[x - 1] * current_matrix[-1] +
-            current_line[x + 0] * current_matrix[0] +
-            current_line[x + 1] * current_matrix[1];
-        }
-        else if constexpr (matrix_size == 5) {
-          sum +=
-            current_line[x - 2] * current_matrix[-2] +
-            current_line[x - 1] * current_matrix[-1] +
-            current_line[x + 0] * current_matrix[0] +
-            current_line[x + 1] * current_matrix[1] +
-            current_line[x + 2] * current_matrix[2];
-        }
-        else {
-          // surprise: even MSVC unrolls this loop for 7 and 9
-          for (int xx = -limit; xx <= limit; xx++) {
-            int current_x = x + xx;
-            // no checking!
-            /*if (current_x < 0) current_x = 0;
-            else if (current_x >= width) current_x = width - 1;*/
-            const float current_pixel = current_line[current_x];
-            const float current_weight = current_matrix[xx];
-            sum += current_pixel * current_weight;
-          }
-        }
-        current_matrix += matrix_size; // next matrix line
+      else if constexpr (matrix_size == 5) {
+        sum +=
+          current_line[x - 2] * current_matrix[-2] +
+          current_line[x - 1] * current_matrix[-1] +
+          current_line[x + 0] * current_matrix[0] +
+          current_line[x + 1] * current_matrix[1] +
+          current_line[x + 2] * current_matrix[2];
       }
-      float result = sum * fCountDiv + fBias;
-      dstp[x] = result; // no clipping for float
-    }
-    // right area: check valid x
-    for (; x < width; x++)
-    {
-      float sum = 0.0f;
-      const float *current_matrix = matrix + limit; // center of the matrix line
-      for (int yy = 0; yy < matrix_size; yy++) { // 0..limit * 2 + 1
-        const float *current_line = src_current_lineptrs[yy];
+      else {
+        // surprise: even MSVC unrolls this loop for 7 and 9
         for (int xx = -limit; xx <= limit; xx++) {
-          int current_x = x + xx;
-          if (current_x < 0) current_x = 0;
-          else if (current_x >= width) current_x = width - 1;
-          const float current_pixel = current_line[current_x];
+          const float current_pixel = current_line[x + xx];
           const float current_weight = current_matrix[xx];
           sum += current_pixel * current_weight;
         }
-        current_matrix += matrix_size; // next matrix line
       }
-      float result = sum * fCountDiv + fBias;
-      dstp[x] = result; // no clipping for float
+      current_matrix += matrix_size; // next matrix line
     }
-    dstp += dst_pitch;
-    srcp += src_pitch;
+    float result = sum * fCountDiv + fBias;
+    dstp[x] = result; // no clipping for float
+  }
+}
+
+// Separable kernels. The horizontal pass keeps the full precision product in 32 bits,
+// scaling, rounding and bias are applied once after the vertical pass.
+template<typename pixel_t>
+static void conv_h_integer_c(int32_t* dstp, const BYTE* srcp8, int width, const int* weights, int matrix_size)
+{
+  const pixel_t* srcp = reinterpret_cast<const pixel_t*>(srcp8);
+  const int limit = (matrix_size - 1) / 2;
+  for (int x = 0; x < width; x++) {
+    int sum = 0;
+    for (int k = 0; k < matrix_size; k++)
+      sum += srcp[x - limit + k] * weights[k];
+    dstp[x] = sum;
+  }
+}
+
+template<typename pixel_t>
+static void conv_v_integer_c(BYTE* dstp8, const int32_t* const* rows, int width, const int* weights, int matrix_size, int iCountDiv, int iBias, int max_pixel_value)
+{
+  pixel_t* dstp = reinterpret_cast<pixel_t*>(dstp8);
+  constexpr int rounder = 1 << (20 - 1);
+  for (int x = 0; x < width; x++) {
+    int sum = 0;
+    for (int k = 0; k < matrix_size; k++)
+      sum += rows[k][x] * weights[k];
+    int result = ((sum * iCountDiv + rounder) >> 20) + iBias;
+    dstp[x] = clamp(result, 0, max_pixel_value);
+  }
+}
+
+static void conv_h_float_c(float* dstp, const BYTE* srcp8, int width, const float* weights, int matrix_size)
+{
+  const float* srcp = reinterpret_cast<const float*>(srcp8);
+  const int limit = (matrix_size - 1) / 2;
+  for (int x = 0; x < width; x++) {
+    float sum = 0.0f;
+    for (int k = 0; k < matrix_size; k++)
+      sum += srcp[x - limit + k] * weights[k];
+    dstp[x] = sum;
+  }
+}
+
+static void conv_v_float_c(BYTE* dstp8, const float* const* rows, int width, const float* weights, int matrix_size, float fCountDiv, float fBias)
+{
+  float* dstp = reinterpret_cast<float*>(dstp8);
+  for (int x = 0; x < width; x++) {
+    float sum = 0.0f;
+    for (int k = 0; k < matrix_size; k++)
+      sum += rows[k][x] * weights[k];
+    dstp[x] = sum * fCountDiv + fBias;
+  }
+}
+
+template<typename pixel_t, typename safe_int_t>
+static conv_row_int_t* get_conv_row_integer_c(int matrix_size)
+{
+  switch (matrix_size) {
+  case 3: return conv_row_integer_c<pixel_t, 3, safe_int_t>;
+  case 5: return conv_row_integer_c<pixel_t, 5, safe_int_t>;
+  case 7: return conv_row_integer_c<pixel_t, 7, safe_int_t>;
+  default: return conv_row_integer_c<pixel_t, 9, safe_int_t>;
   }
 }
 
-template void do_conv_float<3>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const float *matrix, float fCountDiv, float fBias);
-template void do_conv_float<5>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const float *matrix, float fCountDiv, float fBias);
-template void do_conv_float<7>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const float *matrix, float fCountDiv, float fBias);
-template void do_conv_float<9>(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const float *matrix, float fCountDiv, float fBias);
+static conv_row_float_t* get_conv_row_float_c(int matrix_size)
+{
+  switch (matrix_size) {
+  case 3: return conv_row_float_c<3>;
+  case 5: return conv_row_float_c<5>;
+  case 7: return conv_row_float_c<7>;
+  default: return conv_row_float_c<9>;
+  }
+}
+
+// source index of a pixel outside [0..n-1]; keep is processed as repeat, then the border is restored
+static AVS_FORCEINLINE int border_index(int i, int n, int border)
+{
+  if (border == GeneralConvolution::BORDER_MIRROR) {
+    if (i < 0) i = -i;
+    if (i >= n) i = 2 * (n - 1) - i;
+  }
+  return clamp(i, 0, n - 1);
+}
 
 /***** Setup stuff ****/
 
 GeneralConvolution::GeneralConvolution(PClip _child, double _divisor, float _nBias, const char * _matrix,
-  bool _autoscale, bool _luma, bool _chroma, bool _alpha, IScriptEnvironment* _env)
-  : GenericVideoFilter(_child), divisor(_divisor), nBias((int)_nBias), fBias(_nBias), autoscale(_autoscale), luma(_luma), chroma(_chroma), alpha(_alpha)
+  bool _autoscale, bool _luma, bool _chroma, bool _alpha, int _border, IScriptEnvironment* _env)
+  : GenericVideoFilter(_child), divisor(_divisor), nBias((int)_nBias), fBias(_nBias), autoscale(_autoscale), border(_border),
+  luma(_luma), chroma(_chroma), alpha(_alpha), separable(false),
+  rowFnPtr(nullptr), FrowFnPtr(nullptr), hFnPtr(nullptr), vFnPtr(nullptr), FhFnPtr(nullptr), FvFnPtr(nullptr)
 {
   if (vi.Is420() || vi.Is422() || vi.IsYV411()) {
     if (luma && chroma)
@@ -364,6 +299,13 @@ GeneralConvolution::GeneralConvolution(PClip _child, double _divisor, float _nBi
     _env->ThrowError("GeneralConvolution: divisor cannot be zero");
   setMatrix(_matrix, vi.BitsPerComponent() < 32, _env); // float: todo
 
+  pixelsize = vi.ComponentSize();
+  matrix_size = nSize == 3 * 3 ? 3 : nSize == 5 * 5 ? 5 : nSize == 7 * 7 ? 7 : 9;
+
+#ifdef INTEL_INTRINSICS
+  const int cpu = _env->GetCPUFlags();
+#endif
+
   if (vi.BitsPerComponent() <= 16) {
     // precompute divisor
     int iCountT;
@@ -377,7 +319,6 @@ GeneralConvolution::GeneralConvolution(PClip _child, double _divisor, float _nBi
     // Truncate instead of round - keep in the spirit of the original code
     // 3.6.3: we do introduce rounding before scaling back from +20 bit range
     // 0x100000: 20 bit precision integer arithmetic
-    // todo: check overflow for matrices larger than 5x5
     iCountDiv = (int)(0x100000 / (iCountT == 0 ? divisor : iCountT * divisor));
     if (iCountDiv == 0)
       _env->ThrowError("GeneralConvolution: normalizing factor is zero, check for too large elements or divisor value");
@@ -393,49 +334,39 @@ GeneralConvolution::GeneralConvolution(PClip _child, double _divisor, float _nBi
     if ((int64_t)max_pixel_value * maxWeightSum * std::abs(iCountDiv) >= std::numeric_limits<int>::max())
       int64needed = true;
 
-    switch (vi.BitsPerComponent()) {
+    // Partial sums of the two pass method are bounded by max_pixel_value * sum(abs(weight))
+    if (!int64needed && matrix_size >= 5 &&
+      (int64_t)max_pixel_value * (iWeightSumPositives - iWeightSumNegatives) < std::numeric_limits<int>::max())
+      setSeparable();
 
-    case 8:
-      if (nSize == 3 * 3) {
-        if (int64needed) conversionFnPtr = do_conv_integer<uint8_t, 3, int64_t>;
-        else conversionFnPtr = do_conv_integer<uint8_t, 3, int>;
-      }
-      else if (nSize == 5 * 5) {
-        if (int64needed) conversionFnPtr = do_conv_integer<uint8_t, 5, int64_t>;
-        else conversionFnPtr = do_conv_integer<uint8_t, 5, int>;
-      }
-      else if (nSize == 7 * 7) {
-        if (int64needed) conversionFnPtr = do_conv_integer<uint8_t, 7, int64_t>;
-        else conversionFnPtr = do_conv_integer<uint8_t, 7, int>;
-      }
-      else if (nSize == 9 * 9) {
-        if (int64needed) conversionFnPtr = do_conv_integer<uint8_t, 9, int64_t>;
-        else conversionFnPtr = do_conv_integer<uint8_t, 9, int>;
-      }
-      break;
-
-    case 10:
-    case 12:
-    case 14:
-    case 16:
-      if (nSize == 3 * 3) {
-        if (int64needed) conversionFnPtr = do_conv_integer<uint16_t, 3, int64_t>;
-        else conversionFnPtr = do_conv_integer<uint16_t, 3, int>;
-      }
-      else if (nSize == 5 * 5) {
-        if (int64needed) conversionFnPtr = do_conv_integer<uint16_t, 5, int64_t>;
-        else conversionFnPtr = do_conv_integer<uint16_t, 5, int>;
-      }
-      else if (nSize == 7 * 7) {
-        if (int64needed) conversionFnPtr = do_conv_integer<uint16_t, 7, int64_t>;
-        else conversionFnPtr = do_conv_integer<uint16_t, 7, int>;
+    if (pixelsize == 1) {
+      if (int64needed) rowFnPtr = get_conv_row_integer_c<uint8_t, int64_t>(matrix_size);
+      else rowFnPtr = get_conv_row_integer_c<uint8_t, int>(matrix_size);
+      hFnPtr = conv_h_integer_c<uint8_t>;
+      vFnPtr = conv_v_integer_c<uint8_t>;
+    }
+    else {
+      if (int64needed) rowFnPtr = get_conv_row_integer_c<uint16_t, int64_t>(matrix_size);
+      else rowFnPtr = get_conv_row_integer_c<uint16_t, int>(matrix_size);
+      hFnPtr = conv_h_integer_c<uint16_t>;
+      vFnPtr = conv_v_integer_c<uint16_t>;
+    }
+
+#ifdef INTEL_INTRINSICS
+    // SIMD versions work on int32 lanes: same overflow condition as the int C version
+    if (!int64needed) {
+      if (cpu & CPUF_AVX2) {
+        rowFnPtr = pixelsize == 1 ? conv_row_integer_avx2<uint8_t> : conv_row_integer_avx2<uint16_t>;
+        hFnPtr = pixelsize == 1 ? conv_h_integer_avx2<uint8_t> : conv_h_integer_avx2<uint16_t>;
+        vFnPtr = pixelsize == 1 ? conv_v_integer_avx2<uint8_t> : conv_v_integer_avx2<uint16_t>;
       }
-      else if (nSize == 9 * 9) {
-        if (int64needed) conversionFnPtr = do_conv_integer<uint16_t, 9, int64_t>;
-        else conversionFnPtr = do_conv_integer<uint16_t, 9, int>;
+      else if (cpu & CPUF_SSE4_1) {
+        rowFnPtr = pixelsize == 1 ? conv_row_integer_sse41<uint8_t> : conv_row_integer_sse41<uint16_t>;
+        hFnPtr = pixelsize == 1 ? conv_h_integer_sse41<uint8_t> : conv_h_integer_sse41<uint16_t>;
+        vFnPtr = pixelsize == 1 ? conv_v_integer_sse41<uint8_t> : conv_v_integer_sse41<uint16_t>;
       }
-      break;
     }
+#endif
   }
   else {
     // 32 bit float clip
@@ -450,14 +381,89 @@ GeneralConvolution::GeneralConvolution(PClip _child, double _divisor, float _nBi
 
     fCountDiv = (float)(1.0f / (fCountT == 0 ? divisor : fCountT * divisor));
 
-    if (nSize == 3 * 3)
-      FconversionFnPtr = do_conv_float<3>;
-    else if (nSize == 5 * 5)
-      FconversionFnPtr = do_conv_float<5>;
-    else if (nSize == 7 * 7)
-      FconversionFnPtr = do_conv_float<7>;
-    else if (nSize == 9 * 9)
-      FconversionFnPtr = do_conv_float<9>;
+    if (matrix_size >= 5)
+      setSeparable();
+
+    FrowFnPtr = get_conv_row_float_c(matrix_size);
+    FhFnPtr = conv_h_float_c;
+    FvFnPtr = conv_v_float_c;
+
+#ifdef INTEL_INTRINSICS
+    if (cpu & CPUF_AVX2) {
+      FrowFnPtr = conv_row_float_avx2;
+      FhFnPtr = conv_h_float_avx2;
+      FvFnPtr = conv_v_float_avx2;
+    }
+    else if (cpu & CPUF_SSE2) {
+      FrowFnPtr = conv_row_float_sse2;
+      FhFnPtr = conv_h_float_sse2;
+      FvFnPtr = conv_v_float_sse2;
+    }
+#endif
+  }
+}
+
+// Rank-1 check: matrix[y][x] == col[y] * row[x].
+// Integer: row is the first nonzero matrix line divided by the gcd of its elements, all lines must be
+// its exact integer multiples. Float: the line with the largest element is the row, relative tolerance.
+void GeneralConvolution::setSeparable()
+{
+  const int msize = matrix_size;
+  separable = false;
+
+  if (!iMatrix.empty()) {
+    int r0 = -1;
+    for (int y = 0; y < msize && r0 < 0; y++)
+      for (int x = 0; x < msize; x++)
+        if (iMatrix[y * msize + x] != 0) { r0 = y; break; }
+    if (r0 < 0)
+      return;
+
+    int g = 0;
+    for (int x = 0; x < msize; x++)
+      g = std::gcd(g, std::abs(iMatrix[r0 * msize + x]));
+    iRow.resize(msize);
+    for (int x = 0; x < msize; x++)
+      iRow[x] = iMatrix[r0 * msize + x] / g;
+    int j = 0;
+    while (iRow[j] == 0) j++;
+
+    iCol.resize(msize);
+    for (int y = 0; y < msize; y++) {
+      const int* line = &iMatrix[y * msize];
+      if (line[j] % iRow[j] != 0)
+        return;
+      iCol[y] = line[j] / iRow[j];
+      for (int x = 0; x < msize; x++)
+        if (line[x] != iCol[y] * iRow[x])
+          return;
+    }
+    separable = true;
+  }
+  else {
+    int ymax = 0, j = 0;
+    float maxabs = 0.0f;
+    for (int y = 0; y < msize; y++)
+      for (int x = 0; x < msize; x++)
+        if (std::abs(fMatrix[y * msize + x]) > maxabs) {
+          maxabs = std::abs(fMatrix[y * msize + x]);
+          ymax = y;
+          j = x;
+        }
+    if (maxabs == 0.0f)
+      return;
+
+    fRow.assign(fMatrix.begin() + ymax * msize, fMatrix.begin() + (ymax + 1) * msize);
+    fCol.resize(msize);
+    const float tolerance = maxabs * 1e-6f;
+    for (int y = 0; y < msize; y++) {
+      const float* line = &fMatrix[y * msize];
+      fCol[y] = line[j] / fRow[j];
+      for (int x = 0; x < msize; x++)
+        if (std::abs(line[x] - fCol[y] * fRow[x]) > tolerance)
+          return;
+    }
+    separable = true;
   }
 }
 
@@ -465,6 +471,17 @@ AVSValue __cdecl GeneralConvolution::Create(AVSValue args, void*, IScriptEnviron
 {
   const VideoInfo& vi_orig = args[0].AsClip()->GetVideoInfo();
 
+  const char* border_s = args[8].AsString("repeat");
+  int border;
+  if (lstrcmpi(border_s, "repeat") == 0)
+    border = BORDER_REPEAT;
+  else if (lstrcmpi(border_s, "mirror") == 0)
+    border = BORDER_MIRROR;
+  else if (lstrcmpi(border_s, "keep") == 0)
+    border = BORDER_KEEP;
+  else
+    env->ThrowError("GeneralConvolution: invalid border \"%s\", must be \"repeat\", \"mirror\" or \"keep\"", border_s);
+
   // convert old RGB format to planar RGB
   AVSValue new_args[1] = { args[0].AsClip() };
   PClip clip;
@@ -484,7 +501,7 @@ AVSValue __cdecl GeneralConvolution::Create(AVSValue args, void*, IScriptEnviron
   GeneralConvolution* Result = new GeneralConvolution(clip, args[3].AsFloat(1.0f), args[1].AsFloatf(0.0f),
     args[2].AsString("0 0 0 0 1 0 0 0 0"), args[4].AsBool(true),
     args[5].AsBool(true), args[6].AsBool(true), args[7].AsBool(true), // luma, chroma, alpha, when n/a then ignored
-    env);
+    border, env);
 
   AVSValue new_args2[1] = { Result };
   if (vi_orig.IsRGB24()) {
@@ -568,6 +585,99 @@ void GeneralConvolution::setMatrix(const char * _matrix, bool _isInteger, IScrip
     env->ThrowError("GeneralConvolution: matrix incomplete, possible size %dx%d but element count %d", dim, dim, nSize);
 }
 
+// Source lines are copied into a ring of matrix_size lines extended by the border pixels,
+// the kernels work on them without any edge checks.
+// Separable: one extended source line is filtered horizontally into a ring of 32 bit lines.
+void GeneralConvolution::convolvePlane(BYTE* dstp, int dst_pitch, const BYTE* srcp, int src_pitch, int width, int height, BYTE* buf, IScriptEnvironment* env)
+{
+  AVS_UNUSED(env);
+  const int limit = (matrix_size - 1) / 2;
+  const int max_pixel_value = (1 << vi.BitsPerComponent()) - 1;
+  // +64: SIMD reads and writes full vectors over the end of the line
+  const int line_size = AlignNumber((width + 2 * limit) * pixelsize + 64, FRAME_ALIGN);
+  const int hline_size = AlignNumber(width * 4 + 64, FRAME_ALIGN);
+
+  auto load_line = [&](BYTE* line, int y) {
+    const BYTE* s = srcp + (size_t)border_index(y, height, border) * src_pitch;
+    memcpy(line + limit * pixelsize, s, width * pixelsize);
+    for (int i = 1; i <= limit; i++) {
+      memcpy(line + (limit - i) * pixelsize, s + border_index(-i, width, border) * pixelsize, pixelsize);
+      memcpy(line + (limit + width - 1 + i) * pixelsize, s + border_index(width - 1 + i, width, border) * pixelsize, pixelsize);
+    }
+  };
+
+  // logical line r (-limit..height+limit-1) lives in ring slot (r + limit) % matrix_size
+  if (!separable) {
+    BYTE* lines[9];
+    const BYTE* rows[9];
+    for (int i = 0; i < matrix_size; i++)
+      lines[i] = buf + i * line_size;
+    for (int r = -limit; r < limit; r++)
+      load_line(lines[r + limit], r);
+
+    for (int y = 0; y < height; y++) {
+      load_line(lines[(y + 2 * limit) % matrix_size], y + limit);
+      for (int yy = 0; yy < matrix_size; yy++)
+        rows[yy] = lines[(y + yy) % matrix_size] + limit * pixelsize;
+      if (pixelsize <= 2)
+        rowFnPtr(dstp + y * dst_pitch, rows, width, iMatrix.data(), matrix_size, iCountDiv, nBias, max_pixel_value);
+      else
+        FrowFnPtr(dstp + y * dst_pitch, rows, width, fMatrix.data(), matrix_size, fCountDiv, fBias);
+    }
+  }
+  else {
+    BYTE* line = buf;
+    BYTE* hlines[9];
+    for (int i = 0; i < matrix_size; i++)
+      hlines[i] = buf + line_size + i * hline_size;
+
+    auto filter_h = [&](int r) {
+      load_line(line, r);
+      BYTE* hline = hlines[(r + limit) % matrix_size];
+      if (pixelsize <= 2)
+        hFnPtr(reinterpret_cast<int32_t*>(hline), line + limit * pixelsize, width, iRow.data(), matrix_size);
+      else
+        FhFnPtr(reinterpret_cast<float*>(hline), line + limit * pixelsize, width, fRow.data(), matrix_size);
+    };
+
+    for (int r = -limit; r < limit; r++)
+      filter_h(r);
+
+    for (int y = 0; y < height; y++) {
+      filter_h(y + limit);
+      if (pixelsize <= 2) {
+        const int32_t* rows[9];
+        for (int yy = 0; yy < matrix_size; yy++)
+          rows[yy] = reinterpret_cast<const int32_t*>(hlines[(y + yy) % matrix_size]);
+        vFnPtr(dstp + y * dst_pitch, rows, width, iCol.data(), matrix_size, iCountDiv, nBias, max_pixel_value);
+      }
+      else {
+        const float* rows[9];
+        for (int yy = 0; yy < matrix_size; yy++)
+          rows[yy] = reinterpret_cast<const float*>(hlines[(y + yy) % matrix_size]);
+        FvFnPtr(dstp + y * dst_pitch, rows, width, fCol.data(), matrix_size, fCountDiv, fBias);
+      }
+    }
+  }
+
+  if (border == BORDER_KEEP) {
+    // pixels whose kernel would reach outside the plane are copied from the source
+    const int kh = min(limit, height);
+    const int kw = min(limit, width);
+    for (int y = 0; y < height; y++) {
+      BYTE* d = dstp + y * dst_pitch;
+      const BYTE* s = srcp + y * src_pitch;
+      if (y < kh || y >= height - kh) {
+        memcpy(d, s, width * pixelsize);
+      }
+      else {
+        memcpy(d, s, kw * pixelsize);
+        memcpy(d + (width - kw) * pixelsize, s + (width - kw) * pixelsize, kw * pixelsize);
+      }
+    }
+  }
+}
+
 PVideoFrame __stdcall GeneralConvolution::GetFrame(int n, IScriptEnvironment* env)
 {
   int h = vi.height;
@@ -576,8 +686,14 @@ PVideoFrame __stdcall GeneralConvolution::GetFrame(int n, IScriptEnvironment* en
   PVideoFrame src = child->GetFrame(n, env);
   PVideoFrame dst = env->NewVideoFrameP(vi, &src);
 
-  const int *matrix = iMatrix.data();
-  const float *matrixf = fMatrix.data();
+  // line ring for the widest plane
+  const int limit = (matrix_size - 1) / 2;
+  const int line_size = AlignNumber((w + 2 * limit) * pixelsize + 64, FRAME_ALIGN);
+  const int hline_size = AlignNumber(w * 4 + 64, FRAME_ALIGN);
+  const size_t buf_size = separable ? line_size + (size_t)matrix_size * hline_size : (size_t)matrix_size * line_size;
+  BYTE* buf = reinterpret_cast<BYTE*>(env->Allocate(buf_size, FRAME_ALIGN, AVS_POOLED_ALLOC));
+  if (!buf)
+    env->ThrowError("GeneralConvolution: Could not reserve memory.");
 
   int planes_y[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
   int planes_r[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
@@ -599,11 +715,9 @@ PVideoFrame __stdcall GeneralConvolution::GetFrame(int n, IScriptEnvironment* en
       height >>= vi.GetPlaneHeightSubsampling(plane);
     }
 
-    if(vi.BitsPerComponent() <= 16)
-      conversionFnPtr(dst->GetWritePtr(plane), dst->GetPitch(plane), src->GetReadPtr(plane), src->GetPitch(plane), width, height, matrix, iCountDiv, nBias, vi.BitsPerComponent());
-    else
-      FconversionFnPtr(dst->GetWritePtr(plane), dst->GetPitch(plane), src->GetReadPtr(plane), src->GetPitch(plane), width, height, matrixf, fCountDiv, fBias);
+    convolvePlane(dst->GetWritePtr(plane), dst->GetPitch(plane), src->GetReadPtr(plane), src->GetPitch(plane), width, height, buf, env);
   }
+  env->Free(buf);
   return dst;
   // really, not other case left... packed RGB was converted to planar RGB, YUY2 to YV16
 }
@@ -43,22 +43,36 @@
 
 #include <avisynth.h>
 #include <vector>
+#include <stdint.h>
 
 /*****************************************
 ****** General Convolution 2D filter *****
 *****************************************/
 
 
+// One output line of a full 2D kernel. rows[] are matrix_size source lines, each already
+// extended by (matrix_size-1)/2 border pixels on both sides, rows[i] points to pixel 0.
+using conv_row_int_t = void(BYTE* dstp, const BYTE* const* rows, int width, const int* matrix, int matrix_size, int iCountDiv, int iBias, int max_pixel_value);
+using conv_row_float_t = void(BYTE* dstp, const BYTE* const* rows, int width, const float* matrix, int matrix_size, float fCountDiv, float fBias);
+
+// Separable (rank-1) kernels: horizontal pass of one bordered source line into a 32 bit line,
+// vertical pass over matrix_size such lines into the destination.
+using conv_h_int_t = void(int32_t* dstp, const BYTE* srcp, int width, const int* weights, int matrix_size);
+using conv_v_int_t = void(BYTE* dstp, const int32_t* const* rows, int width, const int* weights, int matrix_size, int iCountDiv, int iBias, int max_pixel_value);
+using conv_h_float_t = void(float* dstp, const BYTE* srcp, int width, const float* weights, int matrix_size);
+using conv_v_float_t = void(BYTE* dstp, const float* const* rows, int width, const float* weights, int matrix_size, float fCountDiv, float fBias);
+
+
 class GeneralConvolution : public GenericVideoFilter
-/** This class exposes a video filter that applies general convolutions -- up to a 5x5
-  * kernel -- to a clip.  Smaller (3x3) kernels have their own code path.  SIMD support forthcoming.
+/** This class exposes a video filter that applies general convolutions -- up to a 9x9
+  * kernel -- to a clip. Rank-1 kernels of 5x5 and larger run as a horizontal and a vertical pass,
+  * integer kernels have SSE4.1/AVX2 and float kernels SSE2/AVX2 line functions.
  **/
 {
-  using do_conv_int_t = void(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const int *matrix, int iCountDiv, int iBias, int bits_per_pixel);
-  using do_conv_float_t = void(BYTE* dstp8, int dst_pitch, const BYTE *srcp8, int src_pitch, int width, int height, const float *matrix, float fCountDiv, float fBias);
-
 public:
-    GeneralConvolution(PClip _child, double _divisor, float _nBias, const char * _matrix, bool _autoscale, bool _luma, bool _chroma, bool _alpha, IScriptEnvironment* _env);
+    enum { BORDER_REPEAT = 0, BORDER_MIRROR, BORDER_KEEP };
+
+    GeneralConvolution(PClip _child, double _divisor, float _nBias, const char * _matrix, bool _autoscale, bool _luma, bool _chroma, bool _alpha, int _border, IScriptEnvironment* _env);
     PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
     static AVSValue __cdecl Create(AVSValue args, void* user_data, IScriptEnvironment* env);
 
@@ -71,11 +85,17 @@ protected:
     void setMatrix(const char * _matrix, bool _isinteger, IScriptEnvironment* env);
 
 private:
+    void setSeparable();
+    void convolvePlane(BYTE* dstp, int dst_pitch, const BYTE* srcp, int src_pitch, int width, int height, BYTE* buf, IScriptEnvironment* env);
+
     double divisor;
     size_t nSize;
+    int matrix_size;
     int nBias;
     float fBias;
     bool autoscale;
+    int border;
+    int pixelsize;
 
     int iCountDiv;
     float fCountDiv;
@@ -92,8 +112,17 @@ private:
     int iWeightSumPositives;
     int iWeightSumNegatives;
 
-    do_conv_int_t *conversionFnPtr;
-    do_conv_float_t *FconversionFnPtr;
+    // rank-1 decomposition, matrix[y][x] == col[y] * row[x]
+    bool separable;
+    std::vector<int> iRow, iCol;
+    std::vector<float> fRow, fCol;
+
+    conv_row_int_t *rowFnPtr;
+    conv_row_float_t *FrowFnPtr;
+    conv_h_int_t *hFnPtr;
+    conv_v_int_t *vFnPtr;
+    conv_h_float_t *FhFnPtr;
+    conv_v_float_t *FvFnPtr;
 
 };
 
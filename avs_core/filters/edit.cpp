@@ -38,6 +38,7 @@
 #include "merge.h"
 #include <climits>
 #include <cmath>
+#include <algorithm>
 
 #ifdef AVS_WINDOWS
     #include <avs/win.h>
@@ -180,6 +181,7 @@ Trim::Trim(double starttime, double endtime, PClip _child, trim_mode_e mode, boo
   if (vi.num_frames < 0)
   vi.num_frames = 0;
 
+  AbsorbChild();
 }
 
 
@@ -268,6 +270,22 @@ Trim::Trim(int _firstframe, int _lastframe, bool _padaudio, PClip _child, trim_m
     else
       vi.num_audio_samples = samples - audio_offset;
   }
+
+  AbsorbChild();
+}
+
+
+// A Trim of an uncached Trim reads straight from the inner one's child,
+// so chains of Trim(cache=false) cost a single offset.
+void Trim::AbsorbChild()
+{
+  Trim* inner = dynamic_cast<Trim*>(child.operator->());
+  if (!inner)
+    return;
+
+  firstframe += inner->firstframe;
+  audio_offset += inner->audio_offset;
+  child = inner->child;
 }
 
 
@@ -443,9 +461,34 @@ AVSValue __cdecl DuplicateFrame::Create(AVSValue args, void*, IScriptEnvironment
  *******************************/
 
 Splice::Splice(PClip _child1, PClip _child2, bool realign_sound, bool _passCache, IScriptEnvironment* env)
- : GenericVideoFilter(_child1), child2(_child2), passCache(_passCache)
+ : Splice(_child1, _passCache, env)
 {
-  VideoInfo vi2 = child2->GetVideoInfo();
+  Append(_child2, realign_sound, env);
+  Finalize();
+}
+
+
+Splice::Splice(PClip _child1, bool _passCache, IScriptEnvironment* env)
+ : GenericVideoFilter(_child1), passCache(_passCache), child_devs(0)
+{
+  Splice* splice = dynamic_cast<Splice*>(_child1.operator->());
+  Trim* trim = dynamic_cast<Trim*>(_child1.operator->());
+
+  if (splice) {
+    segments = splice->segments;
+    for (auto& seg : segments)
+      seg.pass_hints = seg.pass_hints && passCache;
+  }
+  else if (trim)
+    segments.push_back({ trim->child, 0, trim->firstframe, 0, trim->audio_offset, false });
+  else
+    segments.push_back({ _child1, 0, 0, 0, 0, passCache });
+}
+
+
+void Splice::Append(PClip clip, bool realign_sound, IScriptEnvironment* env)
+{
+  const VideoInfo vi2 = clip->GetVideoInfo();
 
   if (vi.HasVideo() ^ vi2.HasVideo())
     env->ThrowError("Splice: one clip has video and the other doesn't (not allowed)");
@@ -469,12 +512,10 @@ Splice::Splice(PClip _child1, PClip _child2, bool realign_sound, bool _passCache
 
   // Check Audio
   if (vi.HasAudio()) {
-    // If sample types do not match they are both converted to float samples to avoid loss of precision.
-    child2 = ConvertAudio::Create(child2, vi.SampleType(), SAMPLE_FLOAT);  // Clip 1 is check to be same type as clip 1, if not, convert to float samples.
-    vi2 = child2->GetVideoInfo();
-
-    child = ConvertAudio::Create(child, vi2.SampleType(), vi2.SampleType());  // Clip 1 is now be same type as clip 2.
-    vi = child->GetVideoInfo();
+    // If sample types do not match they are all converted to float samples to avoid loss of precision.
+    // The conversion itself is deferred to Finalize(), when the common type is known.
+    if (vi.SampleType() != vi2.SampleType())
+      vi.sample_type = SAMPLE_FLOAT;
 
     if (vi.AudioChannels() != vi2.AudioChannels())
       env->ThrowError("Splice: The number of audio channels doesn't match");
@@ -483,11 +524,12 @@ Splice::Splice(PClip _child1, PClip _child2, bool realign_sound, bool _passCache
       env->ThrowError("Splice: The audio of the two clips have different samplerates! Use SSRC()/ResampleAudio()");
   }
 
-  video_switchover_point = vi.num_frames;
+  const int video_switchover_point = vi.num_frames;
 
   if (!video_switchover_point)  // We don't have video, so we cannot align sound to frames
     realign_sound = false;
 
+  int64_t audio_switchover_point;
   if (realign_sound)
     audio_switchover_point = vi.AudioSamplesFromFrames(video_switchover_point);
   else
@@ -500,39 +542,95 @@ Splice::Splice(PClip _child1, PClip _child2, bool realign_sound, bool _passCache
 
   vi.num_audio_samples = audio_switchover_point + vi2.num_audio_samples;
 
-  child_devs = (GetDeviceTypes(child) & GetDeviceTypes(child2));
+  Splice* splice = dynamic_cast<Splice*>(clip.operator->());
+  Trim* trim = dynamic_cast<Trim*>(clip.operator->());
+
+  if (splice) {
+    for (auto seg : splice->segments) {
+      seg.frame_start += video_switchover_point;
+      seg.audio_start += audio_switchover_point;
+      seg.pass_hints = seg.pass_hints && passCache;
+      segments.push_back(seg);
+    }
+  }
+  else if (trim)
+    segments.push_back({ trim->child, video_switchover_point, trim->firstframe, audio_switchover_point, trim->audio_offset, false });
+  else
+    segments.push_back({ clip, video_switchover_point, 0, audio_switchover_point, 0, passCache });
+}
+
+
+void Splice::Finalize()
+{
+  child_devs = ~0;
+  for (auto& seg : segments) {
+    if (vi.HasAudio())
+      seg.clip = ConvertAudio::Create(seg.clip, vi.SampleType(), vi.SampleType());
+    child_devs &= GetDeviceTypes(seg.clip);
+  }
+  child = segments[0].clip;
+
+  frame_starts.clear();
+  for (const auto& seg : segments)
+    frame_starts.push_back(seg.frame_start);
+
+  // An aligned join can start before the end of an unaligned one on its left,
+  // in which case the later join wins: keep only the segments whose start lies
+  // below every start to their right. The first segment also serves negative positions.
+  audio_starts.clear();
+  audio_segments.clear();
+  int64_t cut = INT64_MAX;
+  for (int i = (int)segments.size() - 1; i >= 0; --i) {
+    if (i == 0 || segments[i].audio_start < cut) {
+      audio_starts.push_back(segments[i].audio_start);
+      audio_segments.push_back(i);
+    }
+    cut = std::min(cut, segments[i].audio_start);
+  }
+  std::reverse(audio_starts.begin(), audio_starts.end());
+  std::reverse(audio_segments.begin(), audio_segments.end());
+}
+
+
+int Splice::FindSegment(int n) const
+{
+  const auto it = std::upper_bound(frame_starts.begin(), frame_starts.end(), n);
+  return it == frame_starts.begin() ? 0 : (int)(it - frame_starts.begin()) - 1;
 }
 
 
 PVideoFrame Splice::GetFrame(int n, IScriptEnvironment* env)
 {
-  if (n < video_switchover_point)
-    return child->GetFrame(n, env);
-  else
-    return child2->GetFrame(n - video_switchover_point, env);
+  const Segment& seg = segments[FindSegment(n)];
+  return seg.clip->GetFrame(n - seg.frame_start + seg.frame_offset, env);
 }
 
 
 void Splice::GetAudio(void* buf, int64_t start, int64_t count, IScriptEnvironment* env)
 {
-  if (start+count <= audio_switchover_point)
-    child->GetAudio(buf, start, count, env);
-  else if (start >= audio_switchover_point)
-    child2->GetAudio(buf, start - audio_switchover_point, count, env);
-  else {
-    const int64_t count1 = audio_switchover_point - start;
-    child->GetAudio(buf, start, count1, env);
-    child2->GetAudio((char*)buf+vi.BytesFromAudioSamples(count1), 0, count-count1, env);
+  size_t i = std::upper_bound(audio_starts.begin(), audio_starts.end(), start) - audio_starts.begin();
+  if (i > 0)
+    --i;
+
+  char* dst = (char*)buf;
+  while (count > 0) {
+    const Segment& seg = segments[audio_segments[i]];
+    int64_t n = count;
+    if (i + 1 < audio_starts.size())
+      n = std::min(n, audio_starts[i + 1] - start);
+    seg.clip->GetAudio(dst, start - seg.audio_start + seg.audio_offset, n, env);
+    dst += vi.BytesFromAudioSamples(n);
+    start += n;
+    count -= n;
+    ++i;
   }
 }
 
 
 bool Splice::GetParity(int n)
 {
-  if (n < video_switchover_point)
-    return child->GetParity(n);
-  else
-    return child2->GetParity(n - video_switchover_point);
+  const Segment& seg = segments[FindSegment(n)];
+  return seg.clip->GetParity(n - seg.frame_start + seg.frame_offset);
 }
 
 
@@ -548,8 +646,16 @@ int Splice::SetCacheHints(int cachehints,int frame_range)
     return child_devs;
   default:
     if (passCache) {
-      child2->SetCacheHints(cachehints, frame_range);
-      return child->SetCacheHints(cachehints, frame_range);
+      // same order and result as the nested two-clip splices this replaces
+      int result = 0;
+      for (size_t i = segments.size(); i-- > 0; ) {
+        if (segments[i].pass_hints) {
+          const int ret = segments[i].clip->SetCacheHints(cachehints, frame_range);
+          if (i == 0)
+            result = ret;
+        }
+      }
+      return result;
     }
     break;
   }
@@ -559,9 +665,11 @@ int Splice::SetCacheHints(int cachehints,int frame_range)
 
 AVSValue __cdecl Splice::CreateUnaligned(AVSValue args, void*, IScriptEnvironment* env)
 {
-  PClip result = args[0].AsClip();
+  Splice* splice = new Splice(args[0].AsClip(), false, env);
+  PClip result = splice;
   for (int i=0; i<args[1].ArraySize(); ++i)
-    result = new Splice(result, args[1][i].AsClip(), false, false, env);
+    splice->Append(args[1][i].AsClip(), false, env);
+  splice->Finalize();
   return result;
 }
 
@@ -569,9 +677,11 @@ AVSValue __cdecl Splice::CreateUnaligned(AVSValue args, void*, IScriptEnvironmen
 
 AVSValue __cdecl Splice::CreateAligned(AVSValue args, void*, IScriptEnvironment* env)
 {
-  PClip result = args[0].AsClip();
+  Splice* splice = new Splice(args[0].AsClip(), false, env);
+  PClip result = splice;
   for (int i=0; i<args[1].ArraySize(); ++i)
-    result = new Splice(result, args[1][i].AsClip(), true, false, env);
+    splice->Append(args[1][i].AsClip(), true, env);
+  splice->Finalize();
   return result;
 }
 
@@ -704,37 +814,7 @@ PVideoFrame Dissolve::GetFrame(int n, IScriptEnvironment* env)
   const double multiplier = n - video_fade_end + overlap;
   float weight = (float)(multiplier / (overlap + 1.0));
 
-  env->MakeWritable(&a);
-
-  const int planes_y[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
-  const int planes_r[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
-  const int *planes;
-
-  int planeCount;
-  planeCount = vi.IsPlanar() ? vi.NumComponents() : 1;
-  planes = (!vi.IsPlanar() || vi.IsYUV() || vi.IsYUVA()) ? planes_y : planes_r;
-
-  const int bits_per_pixel = vi.BitsPerComponent();
-  for (int j = 0; j < planeCount; ++j)
-  {
-    const int plane = planes[j];
-    const BYTE*  b_data = b->GetReadPtr(plane);
-    int          b_pitch = b->GetPitch(plane);
-    BYTE*        a_data = a->GetWritePtr(plane);
-    int          a_pitch = a->GetPitch(plane);
-    int          row_size = a->GetRowSize(plane);
-    int          height = a->GetHeight(plane);
-
-    int weight_i;
-    int invweight_i;
-#ifdef INTEL_INTRINSICS
-    MergeFuncPtr weighted_merge_planar = getMergeFunc(bits_per_pixel, env->GetCPUFlags(), a_data, b_data, weight, /*out*/weight_i, /*out*/invweight_i);
-#else
-    MergeFuncPtr weighted_merge_planar = getMergeFunc(bits_per_pixel, a_data, b_data, weight, /*out*/weight_i, /*out*/invweight_i);
-#endif
-    weighted_merge_planar(a_data, b_data, a_pitch, b_pitch, row_size, height, weight, weight_i, invweight_i);
-  }
-  return a;
+  return WeightedMergeFrames(a, b, weight, vi, env);
 }
 
 
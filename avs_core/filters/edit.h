@@ -37,6 +37,7 @@
 
 #include <avisynth.h>
 #include "../core/internal.h"
+#include <vector>
 
 /********************************************************************
 ********************************************************************/
@@ -73,9 +74,13 @@ public:
   static AVSValue __cdecl CreateA(AVSValue args, void* mode, IScriptEnvironment* env);
 
 private:
+  void AbsorbChild();
+
   int firstframe;
   int64_t audio_offset;
   bool cache;
+
+  friend class Splice;
 };
 
 
@@ -156,6 +161,10 @@ private:
 class Splice : public GenericVideoFilter
 /**
   * Class to splice together video clips
+  *
+  * Nested splices and uncached Trims are absorbed on construction, so a chain
+  * like a+b+c+... or Trim(a,..)++Trim(a,..)++... is a single flat segment table
+  * looked up by binary search instead of one level of GetFrame per join.
  **/
 {
 public:
@@ -171,9 +180,24 @@ public:
   static AVSValue __cdecl CreateAlignedNoCache(AVSValue args, void*, IScriptEnvironment* env);
 
 private:
-  PClip child2;
-  int video_switchover_point;
-  int64_t audio_switchover_point;
+  struct Segment {
+    PClip clip;
+    int frame_start;      // first output frame
+    int frame_offset;     // added to the segment-relative frame number (absorbed Trim)
+    int64_t audio_start;  // first output sample, as set by the join; later joins may cut it
+    int64_t audio_offset;
+    bool pass_hints;      // cache hints reached this clip before flattening
+  };
+
+  Splice(PClip _child1, bool passCache, IScriptEnvironment* env);
+  void Append(PClip clip, bool realign_sound, IScriptEnvironment* env);
+  void Finalize();
+  int FindSegment(int n) const;
+
+  std::vector<Segment> segments;
+  std::vector<int> frame_starts;
+  std::vector<int64_t> audio_starts; // live audio ranges only, see Finalize()
+  std::vector<int> audio_segments;
   const bool passCache;
   int child_devs;
 };
@@ -556,6 +556,72 @@ AVSValue __cdecl SeparateRows::Create(AVSValue args, void*, IScriptEnvironment*
 
 
 
+/*********************************
+ *******   Weave line views   ******
+ *********************************/
+
+// SeparateFields and SeparateRows return views into the frame buffer of their parent
+// with a multiplied pitch. When the frames to be woven are such views of one buffer
+// lying on consecutive lines, the result is again a view with the divided pitch, no
+// copy is made. A writable copy is made only if a later filter asks for it.
+// frames[] are in memory line order. Returns nullptr if no view is possible.
+static PVideoFrame WeaveView(const PVideoFrame* frames, int count, const VideoInfo& vi, IScriptEnvironment* env)
+{
+  const PVideoFrame& first = frames[0];
+  if (first->GetRowSize() != vi.RowSize() || first->GetHeight() * count != vi.height)
+    return nullptr;
+
+  const int planes_y[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
+  const int planes_r[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
+  const int* planes = (vi.IsYUV() || vi.IsYUVA()) ? planes_y : planes_r;
+  const int num_planes = vi.IsPlanar() ? vi.NumComponents() : 1;
+  const int align = (int)env->GetEnvProperty(AEP_FRAME_ALIGN);
+
+  for (int p = 0; p < num_planes; ++p) {
+    const int plane = vi.IsPlanar() ? planes[p] : 0;
+    const int pitch = first->GetPitch(plane);
+    if (pitch % count || (pitch / count) % align)
+      return nullptr;
+    for (int k = 1; k < count; ++k) {
+      const PVideoFrame& f = frames[k];
+      if (f->GetFrameBuffer() != first->GetFrameBuffer() ||
+        f->GetPitch(plane) != pitch ||
+        f->GetRowSize(plane) != first->GetRowSize(plane) ||
+        f->GetHeight(plane) != first->GetHeight(plane) ||
+        f->GetOffset(plane) != first->GetOffset(plane) + k * (pitch / count))
+        return nullptr;
+    }
+  }
+
+  if (vi.IsPlanar() && !vi.IsY()) {
+    const int plane0 = vi.IsRGB() ? PLANAR_G : PLANAR_Y;
+    const int plane1 = vi.IsRGB() ? PLANAR_B : PLANAR_U;
+    if (vi.NumComponents() == 4)
+      return env->SubframePlanarA(first, 0, first->GetPitch(plane0) / count, first->GetRowSize(plane0), vi.height,
+        0, 0, first->GetPitch(plane1) / count, 0);
+    return env->SubframePlanar(first, 0, first->GetPitch(plane0) / count, first->GetRowSize(plane0), vi.height,
+      0, 0, first->GetPitch(plane1) / count);
+  }
+  return env->Subframe(first, 0, first->GetPitch() / count, first->GetRowSize(), vi.height);
+}
+
+
+// true if both frames show the same lines of the same buffer
+static bool IsSameView(const PVideoFrame& a, const PVideoFrame& b, const VideoInfo& vi)
+{
+  if (a->GetFrameBuffer() != b->GetFrameBuffer())
+    return false;
+  const int planes[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
+  const int num_planes = vi.IsPlanar() ? vi.NumComponents() : 1;
+  for (int p = 0; p < num_planes; ++p) {
+    const int plane = vi.IsPlanar() ? planes[p] : 0;
+    if (a->GetOffset(plane) != b->GetOffset(plane) || a->GetPitch(plane) != b->GetPitch(plane) ||
+      a->GetRowSize(plane) != b->GetRowSize(plane) || a->GetHeight(plane) != b->GetHeight(plane))
+      return false;
+  }
+  return true;
+}
+
 /****************************
  *******   WeaveRows   ******
  ****************************/
@@ -578,6 +644,20 @@ PVideoFrame WeaveRows::GetFrame(int n, IScriptEnvironment* env)
   const int b = n * period;
   const int e = b + period;
 
+  // SeparateRows output of a single frame weaves back into a view of it
+  if (e <= inframes) {
+    const bool rgb_packed = vi.IsRGB() && !vi.IsPlanar(); // RGB upsidedown
+    std::vector<PVideoFrame> srcs(period);
+    for (int i = b; i < e; i++)
+      srcs[rgb_packed ? e - 1 - i : i - b] = child->GetFrame(i, env);
+    PVideoFrame view = WeaveView(srcs.data(), period, vi, env);
+    if (view) {
+      if (rgb_packed)
+        env->copyFrameProps(srcs[period - 1], view);
+      return view;
+    }
+  }
+
   PVideoFrame dst = env->NewVideoFrame(vi);
   BYTE *dstp = dst->GetWritePtr();
   const int dstpitch = dst->GetPitch();
@@ -868,10 +948,21 @@ PVideoFrame DoubleWeaveFields::GetFrame(int n, IScriptEnvironment* env)
   PVideoFrame a = child->GetFrame(n, env);
   PVideoFrame b = child->GetFrame(n+1, env);
 
-  PVideoFrame result = env->NewVideoFrameP(vi, &a);
-
   const bool parity = child->GetParity(n);
 
+  // fields of the same SeparateFields frame: weave them back into a view of it.
+  // a goes to the odd lines in memory when parity ^ noTopBottom, see copy_field
+  const bool a_odd = parity ^ (vi.IsYUV() || vi.IsYUVA() || vi.IsPlanarRGB() || vi.IsPlanarRGBA());
+  const PVideoFrame fields[2] = { a_odd ? b : a, a_odd ? a : b };
+  PVideoFrame view = WeaveView(fields, 2, vi, env);
+  if (view) {
+    if (a_odd)
+      env->copyFrameProps(a, view);
+    return view;
+  }
+
+  PVideoFrame result = env->NewVideoFrameP(vi, &a);
+
   copy_field(result, a, vi.IsYUV() || vi.IsYUVA(), vi.IsPlanarRGB() || vi.IsPlanarRGBA(), parity, env);
   copy_field(result, b, vi.IsYUV() || vi.IsYUVA(), vi.IsPlanarRGB() || vi.IsPlanarRGBA(), !parity, env);
 
@@ -938,6 +1029,10 @@ PVideoFrame DoubleWeaveFrames::GetFrame(int n, IScriptEnvironment* env)
     PVideoFrame b = child->GetFrame((n+1)>>1, env);
     bool parity = this->GetParity(n);
 
+    // e.g. a repeated frame: the woven lines are the same
+    if (IsSameView(a, b, vi))
+      return a;
+
     if (a->IsWritable()) {
       copy_alternate_lines(a, b,  vi.IsYUV() || vi.IsYUVA(), vi.IsPlanarRGB() || vi.IsPlanarRGBA(), !parity, env);
       return a;
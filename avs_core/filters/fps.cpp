@@ -591,7 +591,7 @@ AVSValue __cdecl ChangeFPS::CreateFromClip(AVSValue args, void*, IScriptEnvironm
 
 ConvertFPS::ConvertFPS(PClip _child, unsigned new_numerator, unsigned new_denominator, int _zone,
   int _vbi, IScriptEnvironment* env)
-  : GenericVideoFilter(_child), zone(_zone), vbi(_vbi), lps(0)
+  : GenericVideoFilter(_child), zone(_zone), vbi(_vbi), lps(0), source_n{ -1, -1 }, source_next(0)
 {
   if (zone >= 0 && !vi.IsYUY2()) // Tritical Jan 2006
     env->ThrowError("ConvertFPS: zone >= 0 requires YUY2 input");
@@ -620,6 +620,23 @@ ConvertFPS::ConvertFPS(PClip _child, unsigned new_numerator, unsigned new_denomi
 }
 
 
+PVideoFrame ConvertFPS::GetSourceFrame(int n, IScriptEnvironment* env)
+{
+  {
+    std::lock_guard<std::mutex> lock(source_mutex);
+    for (int i = 0; i < 2; i++)
+      if (source_n[i] == n)
+        return source_frame[i];
+  }
+  PVideoFrame frame = child->GetFrame(n, env);
+  std::lock_guard<std::mutex> lock(source_mutex);
+  source_n[source_next] = n;
+  source_frame[source_next] = frame;
+  source_next ^= 1;
+  return frame;
+}
+
+
 PVideoFrame __stdcall ConvertFPS::GetFrame(int n, IScriptEnvironment* env)
 {
   // Using int64 modulo instead of modf, for double holds only 53 bits
@@ -640,48 +657,16 @@ PVideoFrame __stdcall ConvertFPS::GetFrame(int n, IScriptEnvironment* env)
 
     // Don't bother if the blend ratio is small
     if (frac_f < threshold_f)
-      return child->GetFrame(nsrc, env);
+      return GetSourceFrame(nsrc, env);
 
     if (frac_f > 1.0 - threshold_f)
-      return child->GetFrame(nsrc + 1, env);
-
-    PVideoFrame a = child->GetFrame(nsrc, env);
-    PVideoFrame b = child->GetFrame(nsrc + 1, env);
-
-    env->MakeWritable(&a);
-
-    const int planes_y[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
-    const int planes_r[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
-    const int *planes;
-
-    int planeCount;
-    planeCount = vi.IsPlanar() ? vi.NumComponents() : 1;
-    planes = (!vi.IsPlanar() || vi.IsYUV() || vi.IsYUVA()) ? planes_y : planes_r;
-
-    const int bits_per_pixel = vi.BitsPerComponent();
-    for (int j = 0; j < planeCount; ++j)
-    {
-      const int plane = planes[j];
-      const BYTE*  b_data = b->GetReadPtr(plane);
-      int          b_pitch = b->GetPitch(plane);
-      BYTE*        a_data = a->GetWritePtr(plane);
-      int          a_pitch = a->GetPitch(plane);
-      int          row_size = a->GetRowSize(plane);
-      int          height = a->GetHeight(plane);
-
-      int weight_i;
-      int invweight_i;
-      float weight = (float)frac_f; // between 0 and 1.0
-
-#ifdef INTEL_INTRINSICS
-      MergeFuncPtr weighted_merge_planar = getMergeFunc(bits_per_pixel, env->GetCPUFlags(), a_data, b_data, weight, /*out*/weight_i, /*out*/invweight_i);
-#else
-      MergeFuncPtr weighted_merge_planar = getMergeFunc(bits_per_pixel, a_data, b_data, weight, /*out*/weight_i, /*out*/invweight_i);
-#endif
-      weighted_merge_planar(a_data, b_data, a_pitch, b_pitch, row_size, height, weight, weight_i, invweight_i);
-    }
+      return GetSourceFrame(nsrc + 1, env);
+
+    PVideoFrame a = GetSourceFrame(nsrc, env);
+    PVideoFrame b = GetSourceFrame(nsrc + 1, env);
 
-    return a;
+    // between 0 and 1.0; a is shared with the source cache, the result is a new frame
+    return WeightedMergeFrames(a, b, (float)frac_f, vi, env);
 
   }
   else {
@@ -689,8 +674,8 @@ PVideoFrame __stdcall ConvertFPS::GetFrame(int n, IScriptEnvironment* env)
   // If zone > 0, perform a gradual transition, i.e. blend one frame into the next
   // over the given number of lines.
 
-    PVideoFrame a = child->GetFrame(nsrc, env);
-    PVideoFrame b = child->GetFrame(nsrc+1, env);
+    PVideoFrame a = GetSourceFrame(nsrc, env);
+    PVideoFrame b = GetSourceFrame(nsrc+1, env);
     const BYTE*  b_data   = b->GetReadPtr();
     int          b_pitch  = b->GetPitch();
     const int    row_size = a->GetRowSize();
@@ -710,7 +695,7 @@ PVideoFrame __stdcall ConvertFPS::GetFrame(int n, IScriptEnvironment* env)
       top -= lps;
       nsrc--;
       b = a;
-      a = child->GetFrame( nsrc, env );
+      a = GetSourceFrame( nsrc, env );
       b_pitch = a_pitch;
       b_data  = a_data;
       a_data  = a->GetReadPtr();
@@ -749,7 +734,7 @@ loop:
     if( top < height ) {
       nsrc++;
       a = b;
-      b = child->GetFrame(nsrc+1, env);
+      b = GetSourceFrame(nsrc+1, env);
       a_pitch = b_pitch;
       b_pitch = b->GetPitch();
       a_data  = b_data;
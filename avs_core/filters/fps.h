@@ -35,6 +35,7 @@
 #define __FPS_H__
 
 #include <stdint.h>
+#include <mutex>
 #include <avisynth.h>
 #include "../core/internal.h"
 
@@ -123,11 +124,19 @@ public:
   static AVSValue __cdecl CreateFromClip(AVSValue args, void*, IScriptEnvironment* env);
 
 private:
+  PVideoFrame GetSourceFrame(int n, IScriptEnvironment* env);
+
   int64_t fa, fb;
   int zone;
 //Variables used in switch mode only
   int vbi;    //Vertical Blanking Interval (lines)
   int lps;    //Lines per source frame
+
+  // The last two source frames: consecutive output frames share them
+  std::mutex source_mutex;
+  int source_n[2];
+  PVideoFrame source_frame[2];
+  int source_next;
 };
 
 
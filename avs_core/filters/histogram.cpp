@@ -55,6 +55,8 @@
 #include <avs/minmax.h>
 #include <cstdio>
 #include <cmath>
+#include <algorithm>
+#include <limits>
 #include <stdint.h>
 
 
@@ -66,7 +68,7 @@ constexpr double PI = 3.14159265358979323846;
 ********************************************************************/
 
 extern const AVSFunction Histogram_filters[] = {
-  { "Histogram", BUILTIN_FUNC_PREFIX, "c[mode]s[factor]f[bits]i[keepsource]b[markers]b", Histogram::Create },   // src clip, avs+ new bits, keepsource and markers param
+  { "Histogram", BUILTIN_FUNC_PREFIX, "c[mode]s[factor]f[bits]i[keepsource]b[markers]b[logfile]s", Histogram::Create },   // src clip, avs+ new bits, keepsource and markers param
   { 0 }
 };
 
@@ -74,8 +76,9 @@ extern const AVSFunction Histogram_filters[] = {
  *******   Histogram Filter   ******
  **********************************/
 
-Histogram::Histogram(PClip _child, Mode _mode, AVSValue _option, int _show_bits, bool _keepsource, bool _markers, IScriptEnvironment* env)
-  : GenericVideoFilter(_child), mode(_mode), option(_option), show_bits(_show_bits), keepsource(_keepsource), markers(_markers)
+Histogram::Histogram(PClip _child, Mode _mode, AVSValue _option, int _show_bits, bool _keepsource, bool _markers, const char* _logfile, IScriptEnvironment* env)
+  : GenericVideoFilter(_child), mode(_mode), option(_option), show_bits(_show_bits), keepsource(_keepsource), markers(_markers),
+  logfile(nullptr), framecount(0)
 {
   bool optionValid = false;
 
@@ -88,7 +91,7 @@ Histogram::Histogram(PClip _child, Mode _mode, AVSValue _option, int _show_bits,
   // until all histogram is ported
   bool non8bit = show_bits != 8 || bits_per_pixel != 8;
 
-  if (non8bit && mode != ModeClassic && mode != ModeLevels && mode != ModeColor && mode != ModeColor2 && mode != ModeLuma)
+  if (non8bit && mode != ModeClassic && mode != ModeLevels && mode != ModeColor && mode != ModeColor2 && mode != ModeLuma && mode != ModeData)
   {
     env->ThrowError("Histogram: this histogram type is available only for 8 bit formats and parameters");
   }
@@ -243,10 +246,46 @@ Histogram::Histogram(PClip _child, Mode _mode, AVSValue _option, int _show_bits,
     aud_clip = ConvertAudio::Create(child, SAMPLE_INT16, SAMPLE_INT16);
   }
 
+  if (mode == ModeData) {
+    if (!vi.IsPlanar()) {
+      env->ThrowError("Histogram: Data mode only available in PLANAR.");
+    }
+    // video is passed through, results go to frame properties
+    vi.width = origwidth;
+    vi.height = origheight;
+  }
+
+  if (_logfile[0] != 0) {
+    if (mode != ModeData)
+      env->ThrowError("Histogram: logfile is available only in Data mode.");
+    logfile = fopen(_logfile, "wt");
+    if (!logfile)
+      env->ThrowError("Histogram: unable to create file %s", _logfile);
+    const char* names = vi.IsRGB() ? "RGBA" : "YUVA";
+    fprintf(logfile, " Frame");
+    for (int p = 0; p < vi.NumComponents(); p++)
+      fprintf(logfile, "  %c:    Min        Max       Average", names[p]);
+    fprintf(logfile, "\n");
+  }
+
   if (!optionValid && option.Defined())
     env->ThrowError("Histogram: Unknown optional value.");
 }
 
+Histogram::~Histogram()
+{
+  if (logfile) {
+    const char* names = vi.IsRGB() ? "RGBA" : "YUVA";
+    fprintf(logfile, "\n\n\nTotal frames processed: %d\n\n", framecount);
+    fprintf(logfile, "         Minimum      Maximum   Average\n");
+    if (framecount > 0) {
+      for (int p = 0; p < vi.NumComponents(); p++)
+        fprintf(logfile, "  %c: %11.4f %11.4f %11.4f\n", names[p], stat_min[p], stat_max[p], stat_avg_tot[p] / framecount);
+    }
+    fclose(logfile);
+  }
+}
+
 PVideoFrame __stdcall Histogram::GetFrame(int n, IScriptEnvironment* env)
 {
   switch (mode) {
@@ -267,6 +306,8 @@ PVideoFrame __stdcall Histogram::GetFrame(int n, IScriptEnvironment* env)
     return DrawModeOverlay(n, env);
   case ModeAudioLevels:
     return DrawModeAudioLevels(n, env);
+  case ModeData:
+    return StoreModeData(n, env);
   }
   return DrawModeClassic(n, env);
 }
@@ -1972,6 +2013,173 @@ PVideoFrame Histogram::DrawModeLevels(int n, IScriptEnvironment* env) {
 }
 
 
+/***********************************
+ *******   Mode Data          ******
+ **********************************/
+
+// Population count of one plane at the full bit depth of the clip.
+// 8 bit: four interleaved tables so that runs of equal pixels do not stall on the same counter.
+template<typename pixel_t>
+static void histogram_count_plane(const BYTE* srcp8, int pitch, int width, int height, int max_pixel_value, uint32_t* hist)
+{
+  const pixel_t* srcp = reinterpret_cast<const pixel_t*>(srcp8);
+  pitch /= sizeof(pixel_t);
+  if constexpr (sizeof(pixel_t) == 1) {
+    uint32_t* hist1 = hist + 256;
+    uint32_t* hist2 = hist + 2 * 256;
+    uint32_t* hist3 = hist + 3 * 256;
+    const int mod4_width = width & ~3;
+    for (int y = 0; y < height; y++) {
+      int x;
+      for (x = 0; x < mod4_width; x += 4) {
+        hist[srcp[x]]++;
+        hist1[srcp[x + 1]]++;
+        hist2[srcp[x + 2]]++;
+        hist3[srcp[x + 3]]++;
+      }
+      for (; x < width; x++)
+        hist[srcp[x]]++;
+      srcp += pitch;
+    }
+    for (int i = 0; i < 256; i++)
+      hist[i] += hist1[i] + hist2[i] + hist3[i];
+  }
+  else {
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++)
+        hist[min((int)srcp[x], max_pixel_value)]++;
+      srcp += pitch;
+    }
+  }
+}
+
+// Histogram mode "data": no drawing, the source frame is passed through and
+// per plane minimum, maximum, average and the population of 1<<bits bins are
+// attached as frame properties.
+PVideoFrame Histogram::StoreModeData(int n, IScriptEnvironment* env)
+{
+  PVideoFrame src = child->GetFrame(n, env);
+
+  const int show_size = 1 << show_bits;
+  const bool isFloat = (bits_per_pixel == 32);
+  const int max_pixel_value = (1 << bits_per_pixel) - 1;
+  const int planecount = vi.NumComponents();
+
+  const int planesYUV[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
+  const int planesRGB[4] = { PLANAR_R, PLANAR_G, PLANAR_B, PLANAR_A };
+  const int* planes = vi.IsRGB() ? planesRGB : planesYUV;
+  const char* propnamesYUV[4] = { "HistogramY", "HistogramU", "HistogramV", "HistogramA" };
+  const char* propnamesRGB[4] = { "HistogramR", "HistogramG", "HistogramB", "HistogramA" };
+  const char** propnames = vi.IsRGB() ? propnamesRGB : propnamesYUV;
+
+  // counters at the clip's own bit depth (8 bit: 4 sub-tables), bins are folded from them
+  const int count_size = isFloat ? show_size : max(4 * 256, max_pixel_value + 1);
+  uint32_t* hist = static_cast<uint32_t*>(env->Allocate(count_size * sizeof(uint32_t), 16, AVS_POOLED_ALLOC));
+  if (!hist)
+    env->ThrowError("Histogram: Could not reserve memory.");
+  std::vector<int64_t> bins(show_size);
+
+  double plane_min[4], plane_max[4], plane_avg[4];
+
+  env->MakePropertyWritable(&src);
+  AVSMap* props = env->getFramePropsRW(src);
+
+  for (int p = 0; p < planecount; p++) {
+    const int plane = planes[p];
+    const BYTE* srcp = src->GetReadPtr(plane);
+    const int w = src->GetRowSize(plane) / pixelsize;
+    const int h = src->GetHeight(plane);
+    const int pitch = src->GetPitch(plane);
+
+    std::fill_n(hist, count_size, 0);
+    std::fill(bins.begin(), bins.end(), 0);
+
+    if (isFloat) {
+      // chroma is centered on zero
+      const bool chroma = (plane == PLANAR_U || plane == PLANAR_V);
+      const float offset = chroma ? 0.5f : 0.0f;
+      const float scale = (float)(show_size - 1);
+      float fmin = std::numeric_limits<float>::max();
+      float fmax = std::numeric_limits<float>::lowest();
+      double sum = 0.0;
+      const float* srcp32 = reinterpret_cast<const float*>(srcp);
+      for (int y = 0; y < h; y++) {
+        double row_sum = 0.0;
+        for (int x = 0; x < w; x++) {
+          const float v = srcp32[x];
+          fmin = min(fmin, v);
+          fmax = max(fmax, v);
+          row_sum += v;
+          const int bin = (int)((v + offset) * scale + 0.5f);
+          hist[clamp(bin, 0, show_size - 1)]++;
+        }
+        sum += row_sum;
+        srcp32 += pitch / sizeof(float);
+      }
+      for (int i = 0; i < show_size; i++)
+        bins[i] = hist[i];
+      plane_min[p] = fmin;
+      plane_max[p] = fmax;
+      plane_avg[p] = sum / ((double)w * h);
+    }
+    else {
+      if (pixelsize == 1)
+        histogram_count_plane<uint8_t>(srcp, pitch, w, h, max_pixel_value, hist);
+      else
+        histogram_count_plane<uint16_t>(srcp, pitch, w, h, max_pixel_value, hist);
+
+      // exact min, max and sum from the full resolution population
+      int vmin = max_pixel_value;
+      int vmax = 0;
+      int64_t sum = 0;
+      for (int i = 0; i <= max_pixel_value; i++) {
+        const uint32_t count = hist[i];
+        if (count == 0)
+          continue;
+        vmin = min(vmin, i);
+        vmax = i;
+        sum += (int64_t)i * count;
+        if (bits_per_pixel >= show_bits)
+          bins[i >> (bits_per_pixel - show_bits)] += count;
+        else
+          bins[i << (show_bits - bits_per_pixel)] += count;
+      }
+      plane_min[p] = vmin;
+      plane_max[p] = vmax;
+      plane_avg[p] = (double)sum / ((double)w * h);
+    }
+
+    env->propSetIntArray(props, propnames[p], bins.data(), show_size);
+  }
+
+  env->Free(hist);
+
+  env->propSetFloatArray(props, "HistogramMin", plane_min, planecount);
+  env->propSetFloatArray(props, "HistogramMax", plane_max, planecount);
+  env->propSetFloatArray(props, "HistogramAverage", plane_avg, planecount);
+
+  if (logfile) {
+    framecount++;
+    fprintf(logfile, "%6d", n);
+    for (int p = 0; p < planecount; p++) {
+      fprintf(logfile, "  %11.4f %11.4f %11.4f", plane_min[p], plane_max[p], plane_avg[p]);
+      if (framecount == 1) {
+        stat_min[p] = plane_min[p];
+        stat_max[p] = plane_max[p];
+        stat_avg_tot[p] = plane_avg[p];
+      }
+      else {
+        stat_min[p] = min(stat_min[p], plane_min[p]);
+        stat_max[p] = max(stat_max[p], plane_max[p]);
+        stat_avg_tot[p] += plane_avg[p];
+      }
+    }
+    fprintf(logfile, "\n");
+  }
+
+  return src;
+}
+
 void Histogram::ClassicLUTInit()
 {
   int internal_bits_per_pixel = (pixelsize == 4) ? 16 : bits_per_pixel; // 16bit histogram simulation for float
@@ -2287,6 +2495,9 @@ AVSValue __cdecl Histogram::Create(AVSValue args, void*, IScriptEnvironment* env
   if (!lstrcmpi(st_m, "audiolevels"))
     mode = ModeAudioLevels;
 
+  if (!lstrcmpi(st_m, "data"))
+    mode = ModeData;
+
   const VideoInfo& vi_orig = args[0].AsClip()->GetVideoInfo();
 
   if (mode == ModeLevels && vi_orig.IsRGB() && !vi_orig.IsPlanar()) {
@@ -2300,7 +2511,7 @@ AVSValue __cdecl Histogram::Create(AVSValue args, void*, IScriptEnvironment* env
     else if (vi_orig.IsRGB32() || vi_orig.IsRGB64()) {
       clip = env->Invoke("ConvertToPlanarRGBA", AVSValue(new_args, 1)).AsClip();
     }
-    Histogram* Result = new Histogram(clip, mode, args[2], args[3].AsInt(8), args[4].AsBool(true), args[5].AsBool(true), env);
+    Histogram* Result = new Histogram(clip, mode, args[2], args[3].AsInt(8), args[4].AsBool(true), args[5].AsBool(true), args[6].AsString(""), env);
 
     AVSValue new_args2[1] = { Result };
     if (vi_orig.IsRGB24()) {
@@ -2317,6 +2528,6 @@ AVSValue __cdecl Histogram::Create(AVSValue args, void*, IScriptEnvironment* env
     }
   }
   else {
-    return new Histogram(args[0].AsClip(), mode, args[2], args[3].AsInt(8), args[4].AsBool(true), args[5].AsBool(true), env);
+    return new Histogram(args[0].AsClip(), mode, args[2], args[3].AsInt(8), args[4].AsBool(true), args[5].AsBool(true), args[6].AsString(""), env);
   }
 }
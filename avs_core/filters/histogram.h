@@ -36,6 +36,7 @@
 
 #include <avisynth.h>
 #include <vector>
+#include <cstdio>
 #include "stdint.h"
 
 /********************************************************************
@@ -57,10 +58,12 @@ public:
 	ModeStereoY8,
 	ModeStereo,
 	ModeOverlay,
-	ModeAudioLevels
+	ModeAudioLevels,
+	ModeData
   };
 
-  Histogram(PClip _child, Mode _mode, AVSValue _option, int _show_bits, bool _keepsource, bool _markers, IScriptEnvironment* env);
+  Histogram(PClip _child, Mode _mode, AVSValue _option, int _show_bits, bool _keepsource, bool _markers, const char* _logfile, IScriptEnvironment* env);
+  ~Histogram();
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
   PVideoFrame DrawModeClassic    (int n, IScriptEnvironment* env);
   PVideoFrame DrawModeLevels     (int n, IScriptEnvironment* env);
@@ -70,9 +73,11 @@ public:
   PVideoFrame DrawModeStereo     (int n, IScriptEnvironment* env);
   PVideoFrame DrawModeOverlay    (int n, IScriptEnvironment* env);
   PVideoFrame DrawModeAudioLevels(int n, IScriptEnvironment* env);
+  PVideoFrame StoreModeData      (int n, IScriptEnvironment* env);
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
+    // logfile lines and the clip totals are collected in the instance
+    return cachehints == CACHE_GET_MTMODE ? (logfile ? MT_SERIALIZED : MT_NICE_FILTER) : 0;
   }
 
   static AVSValue __cdecl Create(AVSValue args, void*, IScriptEnvironment* env);
@@ -93,6 +98,11 @@ private:
   int E167;
   std::vector<uint16_t> exptab;
   void ClassicLUTInit();
+
+  // data mode: statistics collected over the whole clip for the logfile
+  FILE* logfile;
+  int framecount;
+  double stat_min[4], stat_max[4], stat_avg_tot[4];
 };
 
 
@@ -0,0 +1,194 @@
+// Avisynth v2.5.  Copyright 2002 Ben Rudiak-Gould et al.
+// http://avisynth.nl
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA, or visit
+// http://www.gnu.org/copyleft/gpl.html .
+//
+// Linking Avisynth statically or dynamically with other modules is making a
+// combined work based on Avisynth.  Thus, the terms and conditions of the GNU
+// General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of Avisynth give you
+// permission to link Avisynth with independent modules that communicate with
+// Avisynth solely through the interfaces defined in avisynth.h, regardless of the license
+// terms of these independent modules, and to copy and distribute the
+// resulting combined work under terms of your choice, provided that
+// every copy of the combined work is accompanied by a complete copy of
+// the source code of Avisynth (the version of Avisynth used to produce the
+// combined work), being distributed under the terms of the GNU General
+// Public License plus this exception.  An independent module is a module
+// which is not derived from or based on Avisynth, such as 3rd-party filters,
+// import and export plugins, or graphical user interfaces.
+
+// Avisynth filter: general convolution, AVX2 line functions
+
+#include <avisynth.h>
+#include "convolution_avx2.h"
+#include <stdint.h>
+
+// experimental simd includes for avx2 compiled files
+#if defined (__GNUC__) && ! defined (__INTEL_COMPILER)
+#include <x86intrin.h>
+// x86intrin.h includes header files for whatever instruction
+// sets are specified on the compiler command line, such as: xopintrin.h, fma4intrin.h
+#else
+#include <immintrin.h> // MS version of immintrin.h covers AVX, AVX2 and FMA3
+#endif // __GNUC__
+
+#if !defined(__FMA__)
+// Assume that all processors that have AVX2 also have FMA3
+#if defined (__GNUC__) && ! defined (__INTEL_COMPILER) && ! defined (__clang__)
+// Prevent error message in g++ when using FMA intrinsics with avx2:
+#pragma message "It is recommended to specify also option -mfma when using -mavx2 or higher"
+#else
+#define __FMA__  1
+#endif
+#endif
+
+// 8 pixels zero extended to int32
+template<typename pixel_t>
+static AVS_FORCEINLINE __m256i conv_load8_avx2(const pixel_t* p)
+{
+  if constexpr (sizeof(pixel_t) == 1)
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+  else
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+// ((sum * iCountDiv + rounder) >> 20) + iBias, clamped, 8 pixels stored
+template<typename pixel_t>
+static AVS_FORCEINLINE void conv_scale_store8_avx2(pixel_t* dstp, __m256i sum, const __m256i& countdiv, const __m256i& rounder, const __m256i& bias, const __m256i& maxv)
+{
+  __m256i result = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(sum, countdiv), rounder), 20);
+  result = _mm256_add_epi32(result, bias);
+  result = _mm256_min_epi32(_mm256_max_epi32(result, _mm256_setzero_si256()), maxv);
+  const __m128i lo = _mm256_castsi256_si128(result);
+  const __m128i hi = _mm256_extracti128_si256(result, 1);
+  if constexpr (sizeof(pixel_t) == 1) {
+    __m128i packed = _mm_packs_epi32(lo, hi);
+    packed = _mm_packus_epi16(packed, packed);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dstp), packed);
+  }
+  else {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dstp), _mm_packus_epi32(lo, hi));
+  }
+}
+
+template<typename pixel_t>
+void conv_row_integer_avx2(BYTE* dstp8, const BYTE* const* rows, int width, const int* matrix, int matrix_size, int iCountDiv, int iBias, int max_pixel_value)
+{
+  pixel_t* dstp = reinterpret_cast<pixel_t*>(dstp8);
+  const int limit = (matrix_size - 1) / 2;
+  const __m256i countdiv = _mm256_set1_epi32(iCountDiv);
+  const __m256i rounder = _mm256_set1_epi32(1 << (20 - 1));
+  const __m256i bias = _mm256_set1_epi32(iBias);
+  const __m256i maxv = _mm256_set1_epi32(max_pixel_value);
+
+  for (int x = 0; x < width; x += 8) {
+    __m256i sum = _mm256_setzero_si256();
+    const int* current_matrix = matrix;
+    for (int yy = 0; yy < matrix_size; yy++) {
+      const pixel_t* current_line = reinterpret_cast<const pixel_t*>(rows[yy]) + x - limit;
+      for (int xx = 0; xx < matrix_size; xx++) {
+        __m256i pix = conv_load8_avx2(current_line + xx);
+        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(pix, _mm256_set1_epi32(current_matrix[xx])));
+      }
+      current_matrix += matrix_size;
+    }
+    conv_scale_store8_avx2(dstp + x, sum, countdiv, rounder, bias, maxv);
+  }
+}
+
+template<typename pixel_t>
+void conv_h_integer_avx2(int32_t* dstp, const BYTE* srcp8, int width, const int* weights, int matrix_size)
+{
+  const pixel_t* srcp = reinterpret_cast<const pixel_t*>(srcp8) - (matrix_size - 1) / 2;
+  for (int x = 0; x < width; x += 8) {
+    __m256i sum = _mm256_setzero_si256();
+    for (int k = 0; k < matrix_size; k++)
+      sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(conv_load8_avx2(srcp + x + k), _mm256_set1_epi32(weights[k])));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(dstp + x), sum);
+  }
+}
+
+template<typename pixel_t>
+void conv_v_integer_avx2(BYTE* dstp8, const int32_t* const* rows, int width, const int* weights, int matrix_size, int iCountDiv, int iBias, int max_pixel_value)
+{
+  pixel_t* dstp = reinterpret_cast<pixel_t*>(dstp8);
+  const __m256i countdiv = _mm256_set1_epi32(iCountDiv);
+  const __m256i rounder = _mm256_set1_epi32(1 << (20 - 1));
+  const __m256i bias = _mm256_set1_epi32(iBias);
+  const __m256i maxv = _mm256_set1_epi32(max_pixel_value);
+
+  for (int x = 0; x < width; x += 8) {
+    __m256i sum = _mm256_setzero_si256();
+    for (int k = 0; k < matrix_size; k++) {
+      __m256i h = _mm256_load_si256(reinterpret_cast<const __m256i*>(rows[k] + x));
+      sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(h, _mm256_set1_epi32(weights[k])));
+    }
+    conv_scale_store8_avx2(dstp + x, sum, countdiv, rounder, bias, maxv);
+  }
+}
+
+template void conv_row_integer_avx2<uint8_t>(BYTE* dstp, const BYTE* const* rows, int width, const int* matrix, int matrix_size, int iCountDiv, int iBias, int max_pixel_value);
+template void conv_row_integer_avx2<uint16_t>(BYTE* dstp, const BYTE* const* rows, int width, const int* matrix, int matrix_size, int iCountDiv, int iBias, int max_pixel_value);
+template void conv_h_integer_avx2<uint8_t>(int32_t* dstp, const BYTE* srcp, int width, const int* weights, int matrix_size);
+template void conv_h_integer_avx2<uint16_t>(int32_t* dstp, const BYTE* srcp, int width, const int* weights, int matrix_size);
+template void conv_v_integer_avx2<uint8_t>(BYTE* dstp, const int32_t* const* rows, int width, const int* weights, int matrix_size, int iCountDiv, int iBias, int max_pixel_value);
+template void conv_v_integer_avx2<uint16_t>(BYTE* dstp, const int32_t* const* rows, int width, const int* weights, int matrix_size, int iCountDiv, int iBias, int max_pixel_value);
+
+void conv_row_float_avx2(BYTE* dstp8, const BYTE* const* rows, int width, const float* matrix, int matrix_size, float fCountDiv, float fBias)
+{
+  float* dstp = reinterpret_cast<float*>(dstp8);
+  const int limit = (matrix_size - 1) / 2;
+  const __m256 countdiv = _mm256_set1_ps(fCountDiv);
+  const __m256 bias = _mm256_set1_ps(fBias);
+
+  for (int x = 0; x < width; x += 8) {
+    __m256 sum = _mm256_setzero_ps();
+    const float* current_matrix = matrix;
+    for (int yy = 0; yy < matrix_size; yy++) {
+      const float* current_line = reinterpret_cast<const float*>(rows[yy]) + x - limit;
+      for (int xx = 0; xx < matrix_size; xx++)
+        sum = _mm256_fmadd_ps(_mm256_loadu_ps(current_line + xx), _mm256_set1_ps(current_matrix[xx]), sum);
+      current_matrix += matrix_size;
+    }
+    _mm256_storeu_ps(dstp + x, _mm256_fmadd_ps(sum, countdiv, bias)); // no clipping for float
+  }
+}
+
+void conv_h_float_avx2(float* dstp, const BYTE* srcp8, int width, const float* weights, int matrix_size)
+{
+  const float* srcp = reinterpret_cast<const float*>(srcp8) - (matrix_size - 1) / 2;
+  for (int x = 0; x < width; x += 8) {
+    __m256 sum = _mm256_setzero_ps();
+    for (int k = 0; k < matrix_size; k++)
+      sum = _mm256_fmadd_ps(_mm256_loadu_ps(srcp + x + k), _mm256_set1_ps(weights[k]), sum);
+    _mm256_store_ps(dstp + x, sum);
+  }
+}
+
+void conv_v_float_avx2(BYTE* dstp8, const float* const* rows, int width, const float* weights, int matrix_size, float fCountDiv, float fBias)
+{
+  float* dstp = reinterpret_cast<float*>(dstp8);
+  const __m256 countdiv = _mm256_set1_ps(fCountDiv);
+  const __m256 bias = _mm256_set1_ps(fBias);
+  for (int x = 0; x < width; x += 8) {
+    __m256 sum = _mm256_setzero_ps();
+    for (int k = 0; k < matrix_size; k++)
+      sum = _mm256_fmadd_ps(_mm256_load_ps(rows[k] + x), _mm256_set1_ps(weights[k]), sum);
+    _mm256_storeu_ps(dstp + x, _mm256_fmadd_ps(sum, countdiv, bias));
+  }
+}
@@ -0,0 +1,52 @@
+// Avisynth v2.5.  Copyright 2002 Ben Rudiak-Gould et al.
+// http://avisynth.nl
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA, or visit
+// http://www.gnu.org/copyleft/gpl.html .
+//
+// Linking Avisynth statically or dynamically with other modules is making a
+// combined work based on Avisynth.  Thus, the terms and conditions of the GNU
+// General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of Avisynth give you
+// permission to link Avisynth with independent modules that communicate with
+// Avisynth solely through the interfaces defined in avisynth.h, regardless of the license
+// terms of these independent modules, and to copy and distribute the
+// resulting combined work under terms of your choice, provided that
+// every copy of the combined work is accompanied by a complete copy of
+// the source code of Avisynth (the version of Avisynth used to produce the
+// combined work), being distributed under the terms of the GNU General
+// Public License plus this exception.  An independent module is a module
+// which is not derived from or based on Avisynth, such as 3rd-party filters,
+// import and export plugins, or graphical user interfaces.
+
+#ifndef __Convolution_AVX2_H__
+#define __Convolution_AVX2_H__
+
+#include <avisynth.h>
+#include <stdint.h>
+
+template<typename pixel_t>
+void conv_row_integer_avx2(BYTE* dstp, const BYTE* const* rows, int width, const int* matrix, int matrix_size, int iCountDiv, int iBias, int max_pixel_value);
+template<typename pixel_t>
+void conv_h_integer_avx2(int32_t* dstp, const BYTE* srcp, int width, const int* weights, int matrix_size);
+template<typename pixel_t>
+void conv_v_integer_avx2(BYTE* dstp, const int32_t* const* rows, int width, const int* weights, int matrix_size, int iCountDiv, int iBias, int max_pixel_value);
+
+void conv_row_float_avx2(BYTE* dstp, const BYTE* const* rows, int width, const float* matrix, int matrix_size, float fCountDiv, float fBias);
+void conv_h_float_avx2(float* dstp, const BYTE* srcp, int width, const float* weights, int matrix_size);
+void conv_v_float_avx2(BYTE* dstp, const float* const* rows, int width, const float* weights, int matrix_size, float fCountDiv, float fBias);
+
+#endif  // __Convolution_AVX2_H__
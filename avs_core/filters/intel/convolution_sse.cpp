@@ -0,0 +1,191 @@
+// Avisynth v2.5.  Copyright 2002 Ben Rudiak-Gould et al.
+// http://avisynth.nl
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA, or visit
+// http://www.gnu.org/copyleft/gpl.html .
+//
+// Linking Avisynth statically or dynamically with other modules is making a
+// combined work based on Avisynth.  Thus, the terms and conditions of the GNU
+// General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of Avisynth give you
+// permission to link Avisynth with independent modules that communicate with
+// Avisynth solely through the interfaces defined in avisynth.h, regardless of the license
+// terms of these independent modules, and to copy and distribute the
+// resulting combined work under terms of your choice, provided that
+// every copy of the combined work is accompanied by a complete copy of
+// the source code of Avisynth (the version of Avisynth used to produce the
+// combined work), being distributed under the terms of the GNU General
+// Public License plus this exception.  An independent module is a module
+// which is not derived from or based on Avisynth, such as 3rd-party filters,
+// import and export plugins, or graphical user interfaces.
+
+// Avisynth filter: general convolution, SSE2/SSE4.1 line functions
+
+#include <avisynth.h>
+#include "convolution_sse.h"
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <stdint.h>
+
+// 4 pixels zero extended to int32
+template<typename pixel_t>
+#if defined(GCC) || defined(CLANG)
+__attribute__((__target__("sse4.1")))
+#endif
+static AVS_FORCEINLINE __m128i conv_load4_sse41(const pixel_t* p)
+{
+  if constexpr (sizeof(pixel_t) == 1)
+    return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*reinterpret_cast<const int*>(p)));
+  else
+    return _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+}
+
+// ((sum * iCountDiv + rounder) >> 20) + iBias, clamped, 4 pixels stored
+template<typename pixel_t>
+#if defined(GCC) || defined(CLANG)
+__attribute__((__target__("sse4.1")))
+#endif
+static AVS_FORCEINLINE void conv_scale_store4_sse41(pixel_t* dstp, __m128i sum, const __m128i& countdiv, const __m128i& rounder, const __m128i& bias, const __m128i& maxv)
+{
+  __m128i result = _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(sum, countdiv), rounder), 20);
+  result = _mm_add_epi32(result, bias);
+  result = _mm_min_epi32(_mm_max_epi32(result, _mm_setzero_si128()), maxv);
+  if constexpr (sizeof(pixel_t) == 1) {
+    result = _mm_packs_epi32(result, result);
+    result = _mm_packus_epi16(result, result);
+    *reinterpret_cast<int*>(dstp) = _mm_cvtsi128_si32(result);
+  }
+  else {
+    result = _mm_packus_epi32(result, result);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dstp), result);
+  }
+}
+
+template<typename pixel_t>
+#if defined(GCC) || defined(CLANG)
+__attribute__((__target__("sse4.1")))
+#endif
+void conv_row_integer_sse41(BYTE* dstp8, const BYTE* const* rows, int width, const int* matrix, int matrix_size, int iCountDiv, int iBias, int max_pixel_value)
+{
+  pixel_t* dstp = reinterpret_cast<pixel_t*>(dstp8);
+  const int limit = (matrix_size - 1) / 2;
+  const __m128i countdiv = _mm_set1_epi32(iCountDiv);
+  const __m128i rounder = _mm_set1_epi32(1 << (20 - 1));
+  const __m128i bias = _mm_set1_epi32(iBias);
+  const __m128i maxv = _mm_set1_epi32(max_pixel_value);
+
+  for (int x = 0; x < width; x += 4) {
+    __m128i sum = _mm_setzero_si128();
+    const int* current_matrix = matrix;
+    for (int yy = 0; yy < matrix_size; yy++) {
+      const pixel_t* current_line = reinterpret_cast<const pixel_t*>(rows[yy]) + x - limit;
+      for (int xx = 0; xx < matrix_size; xx++) {
+        __m128i pix = conv_load4_sse41(current_line + xx);
+        sum = _mm_add_epi32(sum, _mm_mullo_epi32(pix, _mm_set1_epi32(current_matrix[xx])));
+      }
+      current_matrix += matrix_size;
+    }
+    conv_scale_store4_sse41(dstp + x, sum, countdiv, rounder, bias, maxv);
+  }
+}
+
+template<typename pixel_t>
+#if defined(GCC) || defined(CLANG)
+__attribute__((__target__("sse4.1")))
+#endif
+void conv_h_integer_sse41(int32_t* dstp, const BYTE* srcp8, int width, const int* weights, int matrix_size)
+{
+  const pixel_t* srcp = reinterpret_cast<const pixel_t*>(srcp8) - (matrix_size - 1) / 2;
+  for (int x = 0; x < width; x += 4) {
+    __m128i sum = _mm_setzero_si128();
+    for (int k = 0; k < matrix_size; k++)
+      sum = _mm_add_epi32(sum, _mm_mullo_epi32(conv_load4_sse41(srcp + x + k), _mm_set1_epi32(weights[k])));
+    _mm_store_si128(reinterpret_cast<__m128i*>(dstp + x), sum);
+  }
+}
+
+template<typename pixel_t>
+#if defined(GCC) || defined(CLANG)
+__attribute__((__target__("sse4.1")))
+#endif
+void conv_v_integer_sse41(BYTE* dstp8, const int32_t* const* rows, int width, const int* weights, int matrix_size, int iCountDiv, int iBias, int max_pixel_value)
+{
+  pixel_t* dstp = reinterpret_cast<pixel_t*>(dstp8);
+  const __m128i countdiv = _mm_set1_epi32(iCountDiv);
+  const __m128i rounder = _mm_set1_epi32(1 << (20 - 1));
+  const __m128i bias = _mm_set1_epi32(iBias);
+  const __m128i maxv = _mm_set1_epi32(max_pixel_value);
+
+  for (int x = 0; x < width; x += 4) {
+    __m128i sum = _mm_setzero_si128();
+    for (int k = 0; k < matrix_size; k++) {
+      __m128i h = _mm_load_si128(reinterpret_cast<const __m128i*>(rows[k] + x));
+      sum = _mm_add_epi32(sum, _mm_mullo_epi32(h, _mm_set1_epi32(weights[k])));
+    }
+    conv_scale_store4_sse41(dstp + x, sum, countdiv, rounder, bias, maxv);
+  }
+}
+
+template void conv_row_integer_sse41<uint8_t>(BYTE* dstp, const BYTE* const* rows, int width, const int* matrix, int matrix_size, int iCountDiv, int iBias, int max_pixel_value);
+template void conv_row_integer_sse41<uint16_t>(BYTE* dstp, const BYTE* const* rows, int width, const int* matrix, int matrix_size, int iCountDiv, int iBias, int max_pixel_value);
+template void conv_h_integer_sse41<uint8_t>(int32_t* dstp, const BYTE* srcp, int width, const int* weights, int matrix_size);
+template void conv_h_integer_sse41<uint16_t>(int32_t* dstp, const BYTE* srcp, int width, const int* weights, int matrix_size);
+template void conv_v_integer_sse41<uint8_t>(BYTE* dstp, const int32_t* const* rows, int width, const int* weights, int matrix_size, int iCountDiv, int iBias, int max_pixel_value);
+template void conv_v_integer_sse41<uint16_t>(BYTE* dstp, const int32_t* const* rows, int width, const int* weights, int matrix_size, int iCountDiv, int iBias, int max_pixel_value);
+
+void conv_row_float_sse2(BYTE* dstp8, const BYTE* const* rows, int width, const float* matrix, int matrix_size, float fCountDiv, float fBias)
+{
+  float* dstp = reinterpret_cast<float*>(dstp8);
+  const int limit = (matrix_size - 1) / 2;
+  const __m128 countdiv = _mm_set1_ps(fCountDiv);
+  const __m128 bias = _mm_set1_ps(fBias);
+
+  for (int x = 0; x < width; x += 4) {
+    __m128 sum = _mm_setzero_ps();
+    const float* current_matrix = matrix;
+    for (int yy = 0; yy < matrix_size; yy++) {
+      const float* current_line = reinterpret_cast<const float*>(rows[yy]) + x - limit;
+      for (int xx = 0; xx < matrix_size; xx++)
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(current_line + xx), _mm_set1_ps(current_matrix[xx])));
+      current_matrix += matrix_size;
+    }
+    _mm_storeu_ps(dstp + x, _mm_add_ps(_mm_mul_ps(sum, countdiv), bias)); // no clipping for float
+  }
+}
+
+void conv_h_float_sse2(float* dstp, const BYTE* srcp8, int width, const float* weights, int matrix_size)
+{
+  const float* srcp = reinterpret_cast<const float*>(srcp8) - (matrix_size - 1) / 2;
+  for (int x = 0; x < width; x += 4) {
+    __m128 sum = _mm_setzero_ps();
+    for (int k = 0; k < matrix_size; k++)
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(srcp + x + k), _mm_set1_ps(weights[k])));
+    _mm_store_ps(dstp + x, sum);
+  }
+}
+
+void conv_v_float_sse2(BYTE* dstp8, const float* const* rows, int width, const float* weights, int matrix_size, float fCountDiv, float fBias)
+{
+  float* dstp = reinterpret_cast<float*>(dstp8);
+  const __m128 countdiv = _mm_set1_ps(fCountDiv);
+  const __m128 bias = _mm_set1_ps(fBias);
+  for (int x = 0; x < width; x += 4) {
+    __m128 sum = _mm_setzero_ps();
+    for (int k = 0; k < matrix_size; k++)
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(rows[k] + x), _mm_set1_ps(weights[k])));
+    _mm_storeu_ps(dstp + x, _mm_add_ps(_mm_mul_ps(sum, countdiv), bias));
+  }
+}
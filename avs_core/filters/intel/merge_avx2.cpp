@@ -342,3 +342,42 @@ void weighted_merge_planar_avx2(BYTE *p1, const BYTE *p2, int p1_pitch, int p2_p
     p2 += p2_pitch;
   }
 }
+
+
+void weighted_merge_planar_avx2_float(BYTE *p1, const BYTE *p2, int p1_pitch, int p2_pitch, int rowsize, int height, float weight_f, int weight_i, int invweight_i) {
+  AVS_UNUSED(weight_i);
+  AVS_UNUSED(invweight_i);
+
+  float invweight_f = 1.0f - weight_f;
+  auto mask = _mm256_set1_ps(weight_f);
+  auto mask_128 = _mm_set1_ps(weight_f);
+
+  int wMod32 = (rowsize / 32) * 32;
+  int wMod16 = (rowsize / 16) * 16;
+
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < wMod32; x += 32) {
+      auto px1 = _mm256_load_ps(reinterpret_cast<const float*>(p1 + x));
+      auto px2 = _mm256_load_ps(reinterpret_cast<const float*>(p2 + x));
+      // dst + mask * (src - dst), as in SSE2 but fused
+      auto diff = _mm256_sub_ps(px2, px1);
+      auto result = _mm256_fmadd_ps(diff, mask, px1);
+      _mm256_store_ps(reinterpret_cast<float *>(p1 + x), result);
+    }
+
+    for (int x = wMod32; x < wMod16; x += 16) {
+      auto px1 = _mm_load_ps(reinterpret_cast<const float*>(p1 + x));
+      auto px2 = _mm_load_ps(reinterpret_cast<const float*>(p2 + x));
+      auto diff = _mm_sub_ps(px2, px1);
+      auto result = _mm_fmadd_ps(diff, mask_128, px1);
+      _mm_store_ps(reinterpret_cast<float *>(p1 + x), result);
+    }
+
+    for (size_t x = wMod16 / sizeof(float); x < rowsize / sizeof(float); x++) {
+      reinterpret_cast<float *>(p1)[x] = reinterpret_cast<float *>(p1)[x] * invweight_f + reinterpret_cast<const float *>(p2)[x] * weight_f;
+    }
+
+    p1 += p1_pitch;
+    p2 += p2_pitch;
+  }
+}
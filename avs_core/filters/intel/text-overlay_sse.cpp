@@ -36,7 +36,9 @@
 #include <avs/minmax.h>
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <cstdlib>
 #include <emmintrin.h>
+#include <smmintrin.h>
 
 void compare_sse2(uint32_t mask, int increment,
                          const BYTE * f1ptr, int pitch1,
@@ -220,5 +222,84 @@ void compare_isse(uint32_t mask, int increment,
 
 #endif
 
+// 10-16 bit planar. Differences are kept as int32, squares are accumulated as
+// unsigned 64 bit products (a 16 bit difference squared does not fit in int32).
+#if defined(GCC) || defined(CLANG)
+__attribute__((__target__("sse4.1")))
+#endif
+void compare_planar_uint16_sse41(
+    const BYTE * f1ptr8, int pitch1,
+    const BYTE * f2ptr8, int pitch2,
+    int rowsize, int height,
+    int64_t &SAD_sum, int64_t &SD_sum, int &pos_D, int &neg_D, double &SSD_sum)
+{
+  const uint16_t *f1ptr = reinterpret_cast<const uint16_t *>(f1ptr8);
+  const uint16_t *f2ptr = reinterpret_cast<const uint16_t *>(f2ptr8);
+  pitch1 /= sizeof(uint16_t);
+  pitch2 /= sizeof(uint16_t);
+  const int width = rowsize / sizeof(uint16_t);
+  const int mod8_width = width & ~7;
+
+  __m128i positive_diff = _mm_set1_epi32(pos_D);
+  __m128i negative_diff = _mm_set1_epi32(neg_D);
+  const __m128i zero = _mm_setzero_si128();
+
+  for (int y = 0; y < height; y++) {
+    __m128i row_sad = _mm_setzero_si128();
+    __m128i row_sd = _mm_setzero_si128();
+    __m128i row_ssd = _mm_setzero_si128(); // 2x uint64
+
+    for (int x = 0; x < mod8_width; x += 8) {
+      __m128i src1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(f1ptr + x));
+      __m128i src2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(f2ptr + x));
+      __m128i d_lo = _mm_sub_epi32(_mm_unpacklo_epi16(src1, zero), _mm_unpacklo_epi16(src2, zero));
+      __m128i d_hi = _mm_sub_epi32(_mm_unpackhi_epi16(src1, zero), _mm_unpackhi_epi16(src2, zero));
+
+      positive_diff = _mm_max_epi32(positive_diff, _mm_max_epi32(d_lo, d_hi));
+      negative_diff = _mm_min_epi32(negative_diff, _mm_min_epi32(d_lo, d_hi));
+
+      row_sd = _mm_add_epi32(row_sd, _mm_add_epi32(d_lo, d_hi));
+      __m128i a_lo = _mm_abs_epi32(d_lo);
+      __m128i a_hi = _mm_abs_epi32(d_hi);
+      row_sad = _mm_add_epi32(row_sad, _mm_add_epi32(a_lo, a_hi));
+
+      // even and odd lanes squared into 64 bit
+      row_ssd = _mm_add_epi64(row_ssd, _mm_mul_epu32(a_lo, a_lo));
+      row_ssd = _mm_add_epi64(row_ssd, _mm_mul_epu32(a_hi, a_hi));
+      a_lo = _mm_srli_epi64(a_lo, 32);
+      a_hi = _mm_srli_epi64(a_hi, 32);
+      row_ssd = _mm_add_epi64(row_ssd, _mm_mul_epu32(a_lo, a_lo));
+      row_ssd = _mm_add_epi64(row_ssd, _mm_mul_epu32(a_hi, a_hi));
+    }
 
+    // per row lane sums stay well inside int32: (width / 4) * 65535
+    int32_t sad_tmp[4], sd_tmp[4];
+    uint64_t ssd_tmp[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sad_tmp), row_sad);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sd_tmp), row_sd);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(ssd_tmp), row_ssd);
+    int64_t row_SSD = (int64_t)(ssd_tmp[0] + ssd_tmp[1]);
+    SAD_sum += (int64_t)sad_tmp[0] + sad_tmp[1] + sad_tmp[2] + sad_tmp[3];
+    SD_sum += (int64_t)sd_tmp[0] + sd_tmp[1] + sd_tmp[2] + sd_tmp[3];
+
+    for (int x = mod8_width; x < width; x++) {
+      const int d0 = f1ptr[x] - f2ptr[x];
+      SD_sum += d0;
+      SAD_sum += abs(d0);
+      row_SSD += (int64_t)d0 * d0;
+      pos_D = max(pos_D, d0);
+      neg_D = min(neg_D, d0);
+    }
+    SSD_sum += row_SSD;
+    f1ptr += pitch1;
+    f2ptr += pitch2;
+  }
 
+  int32_t pos_tmp[4], neg_tmp[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(pos_tmp), positive_diff);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(neg_tmp), negative_diff);
+  for (int i = 0; i < 4; ++i) {
+    pos_D = max(pos_D, pos_tmp[i]);
+    neg_D = min(neg_D, neg_tmp[i]);
+  }
+}
@@ -0,0 +1,306 @@
+// Avisynth v2.5.  Copyright 2002 Ben Rudiak-Gould et al.
+// http://avisynth.nl
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA, or visit
+// http://www.gnu.org/copyleft/gpl.html .
+//
+// Linking Avisynth statically or dynamically with other modules is making a
+// combined work based on Avisynth.  Thus, the terms and conditions of the GNU
+// General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of Avisynth give you
+// permission to link Avisynth with independent modules that communicate with
+// Avisynth solely through the interfaces defined in avisynth.h, regardless of the license
+// terms of these independent modules, and to copy and distribute the
+// resulting combined work under terms of your choice, provided that
+// every copy of the combined work is accompanied by a complete copy of
+// the source code of Avisynth (the version of Avisynth used to produce the
+// combined work), being distributed under the terms of the GNU General
+// Public License plus this exception.  An independent module is a module
+// which is not derived from or based on Avisynth, such as 3rd-party filters,
+// import and export plugins, or graphical user interfaces.
+
+// Avisynth filter: Turn, AVX2 transpose kernels
+
+#include "../turn.h"
+#include "turn_avx2.h"
+#include <stdint.h>
+
+// experimental simd includes for avx2 compiled files
+#if defined (__GNUC__) && ! defined (__INTEL_COMPILER)
+#include <x86intrin.h>
+// x86intrin.h includes header files for whatever instruction
+// sets are specified on the compiler command line, such as: xopintrin.h, fma4intrin.h
+#else
+#include <immintrin.h> // MS version of immintrin.h covers AVX, AVX2 and FMA3
+#endif // __GNUC__
+
+
+// Block kernels follow the turn_right_plane_tiled contract:
+// the bottom source row of the block becomes the leftmost destination column.
+
+// 8 columns x 16 rows: rows r and r+8 share a register, two 8x8 byte transposes run side by side
+// and each destination row is stored as one 16 byte write.
+static AVS_FORCEINLINE __m256i load_8x2_avx2(const BYTE* p, int pitch8)
+{
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))),
+    _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + pitch8)), 1);
+}
+
+static AVS_FORCEINLINE void store_2rows_avx2(BYTE* dstp, int dst_pitch, __m256i v)
+{
+  // lane1 holds source rows 15..8, which go left of rows 7..0
+  v = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(1, 3, 0, 2));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dstp), _mm256_castsi256_si128(v));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dstp + dst_pitch), _mm256_extracti128_si256(v, 1));
+}
+
+static AVS_FORCEINLINE void transpose_8x8x16_avx2(const BYTE* srcp, BYTE* dstp, int src_pitch, int dst_pitch)
+{
+  const int pitch8 = src_pitch * 8;
+  __m256i a07 = load_8x2_avx2(srcp + src_pitch * 0, pitch8);
+  __m256i b07 = load_8x2_avx2(srcp + src_pitch * 1, pitch8);
+  __m256i c07 = load_8x2_avx2(srcp + src_pitch * 2, pitch8);
+  __m256i d07 = load_8x2_avx2(srcp + src_pitch * 3, pitch8);
+  __m256i e07 = load_8x2_avx2(srcp + src_pitch * 4, pitch8);
+  __m256i f07 = load_8x2_avx2(srcp + src_pitch * 5, pitch8);
+  __m256i g07 = load_8x2_avx2(srcp + src_pitch * 6, pitch8);
+  __m256i h07 = load_8x2_avx2(srcp + src_pitch * 7, pitch8);
+
+  // same network as transpose_8x8x8_sse2, per lane
+  __m256i ea07 = _mm256_unpacklo_epi8(e07, a07);
+  __m256i fb07 = _mm256_unpacklo_epi8(f07, b07);
+  __m256i gc07 = _mm256_unpacklo_epi8(g07, c07);
+  __m256i hd07 = _mm256_unpacklo_epi8(h07, d07);
+
+  __m256i geca03 = _mm256_unpacklo_epi8(gc07, ea07);
+  __m256i geca47 = _mm256_unpackhi_epi8(gc07, ea07);
+  __m256i hfdb03 = _mm256_unpacklo_epi8(hd07, fb07);
+  __m256i hfdb47 = _mm256_unpackhi_epi8(hd07, fb07);
+
+  store_2rows_avx2(dstp + dst_pitch * 0, dst_pitch, _mm256_unpacklo_epi8(hfdb03, geca03));
+  store_2rows_avx2(dstp + dst_pitch * 2, dst_pitch, _mm256_unpackhi_epi8(hfdb03, geca03));
+  store_2rows_avx2(dstp + dst_pitch * 4, dst_pitch, _mm256_unpacklo_epi8(hfdb47, geca47));
+  store_2rows_avx2(dstp + dst_pitch * 6, dst_pitch, _mm256_unpackhi_epi8(hfdb47, geca47));
+}
+
+
+// 8x8 16 bit: columns 0-3 are transposed in lane0, columns 4-7 in lane1
+static AVS_FORCEINLINE __m256i load_16x8_avx2(const BYTE* p)
+{
+  return _mm256_permute4x64_epi64(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))), 0x50);
+}
+
+static AVS_FORCEINLINE void store_16x8_avx2(BYTE* dstp, int dst_pitch, __m256i v)
+{
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dstp), _mm256_castsi256_si128(v));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dstp + dst_pitch * 4), _mm256_extracti128_si256(v, 1));
+}
+
+static AVS_FORCEINLINE void transpose_16x8x8_avx2(const BYTE* srcp, BYTE* dstp, int src_pitch, int dst_pitch)
+{
+  // a is the bottom row
+  __m256i a07 = load_16x8_avx2(srcp + src_pitch * 7);
+  __m256i b07 = load_16x8_avx2(srcp + src_pitch * 6);
+  __m256i c07 = load_16x8_avx2(srcp + src_pitch * 5);
+  __m256i d07 = load_16x8_avx2(srcp + src_pitch * 4);
+  __m256i e07 = load_16x8_avx2(srcp + src_pitch * 3);
+  __m256i f07 = load_16x8_avx2(srcp + src_pitch * 2);
+  __m256i g07 = load_16x8_avx2(srcp + src_pitch * 1);
+  __m256i h07 = load_16x8_avx2(srcp + src_pitch * 0);
+
+  __m256i ae = _mm256_unpacklo_epi16(a07, e07);
+  __m256i bf = _mm256_unpacklo_epi16(b07, f07);
+  __m256i cg = _mm256_unpacklo_epi16(c07, g07);
+  __m256i dh = _mm256_unpacklo_epi16(d07, h07);
+
+  __m256i aceg01 = _mm256_unpacklo_epi16(ae, cg);
+  __m256i aceg23 = _mm256_unpackhi_epi16(ae, cg);
+  __m256i bdfh01 = _mm256_unpacklo_epi16(bf, dh);
+  __m256i bdfh23 = _mm256_unpackhi_epi16(bf, dh);
+
+  store_16x8_avx2(dstp + dst_pitch * 0, dst_pitch, _mm256_unpacklo_epi16(aceg01, bdfh01));
+  store_16x8_avx2(dstp + dst_pitch * 1, dst_pitch, _mm256_unpackhi_epi16(aceg01, bdfh01));
+  store_16x8_avx2(dstp + dst_pitch * 2, dst_pitch, _mm256_unpacklo_epi16(aceg23, bdfh23));
+  store_16x8_avx2(dstp + dst_pitch * 3, dst_pitch, _mm256_unpackhi_epi16(aceg23, bdfh23));
+}
+
+
+// 8x8 32 bit (integer or float, only moved)
+static AVS_FORCEINLINE void transpose_32x8x8_avx2(const BYTE* srcp, BYTE* dstp, int src_pitch, int dst_pitch)
+{
+  __m256 r0 = _mm256_loadu_ps(reinterpret_cast<const float*>(srcp + src_pitch * 7));
+  __m256 r1 = _mm256_loadu_ps(reinterpret_cast<const float*>(srcp + src_pitch * 6));
+  __m256 r2 = _mm256_loadu_ps(reinterpret_cast<const float*>(srcp + src_pitch * 5));
+  __m256 r3 = _mm256_loadu_ps(reinterpret_cast<const float*>(srcp + src_pitch * 4));
+  __m256 r4 = _mm256_loadu_ps(reinterpret_cast<const float*>(srcp + src_pitch * 3));
+  __m256 r5 = _mm256_loadu_ps(reinterpret_cast<const float*>(srcp + src_pitch * 2));
+  __m256 r6 = _mm256_loadu_ps(reinterpret_cast<const float*>(srcp + src_pitch * 1));
+  __m256 r7 = _mm256_loadu_ps(reinterpret_cast<const float*>(srcp + src_pitch * 0));
+
+  __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+  __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+  __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+  __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+  __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+  __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+  __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+  __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+  __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+  _mm256_storeu_ps(reinterpret_cast<float*>(dstp + dst_pitch * 0), _mm256_permute2f128_ps(u0, u4, 0x20));
+  _mm256_storeu_ps(reinterpret_cast<float*>(dstp + dst_pitch * 1), _mm256_permute2f128_ps(u1, u5, 0x20));
+  _mm256_storeu_ps(reinterpret_cast<float*>(dstp + dst_pitch * 2), _mm256_permute2f128_ps(u2, u6, 0x20));
+  _mm256_storeu_ps(reinterpret_cast<float*>(dstp + dst_pitch * 3), _mm256_permute2f128_ps(u3, u7, 0x20));
+  _mm256_storeu_ps(reinterpret_cast<float*>(dstp + dst_pitch * 4), _mm256_permute2f128_ps(u0, u4, 0x31));
+  _mm256_storeu_ps(reinterpret_cast<float*>(dstp + dst_pitch * 5), _mm256_permute2f128_ps(u1, u5, 0x31));
+  _mm256_storeu_ps(reinterpret_cast<float*>(dstp + dst_pitch * 6), _mm256_permute2f128_ps(u2, u6, 0x31));
+  _mm256_storeu_ps(reinterpret_cast<float*>(dstp + dst_pitch * 7), _mm256_permute2f128_ps(u3, u7, 0x31));
+}
+
+
+// 4x4 64 bit (RGB64)
+static AVS_FORCEINLINE void transpose_64x4x4_avx2(const BYTE* srcp, BYTE* dstp, int src_pitch, int dst_pitch)
+{
+  __m256i r0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcp + src_pitch * 3));
+  __m256i r1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcp + src_pitch * 2));
+  __m256i r2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcp + src_pitch * 1));
+  __m256i r3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcp + src_pitch * 0));
+
+  __m256i t0 = _mm256_unpacklo_epi64(r0, r1); // r0[0] r1[0] r0[2] r1[2]
+  __m256i t1 = _mm256_unpackhi_epi64(r0, r1); // r0[1] r1[1] r0[3] r1[3]
+  __m256i t2 = _mm256_unpacklo_epi64(r2, r3);
+  __m256i t3 = _mm256_unpackhi_epi64(r2, r3);
+
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(dstp + dst_pitch * 0), _mm256_permute2x128_si256(t0, t2, 0x20));
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(dstp + dst_pitch * 1), _mm256_permute2x128_si256(t1, t3, 0x20));
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(dstp + dst_pitch * 2), _mm256_permute2x128_si256(t0, t2, 0x31));
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(dstp + dst_pitch * 3), _mm256_permute2x128_si256(t1, t3, 0x31));
+}
+
+
+void turn_right_plane_8_avx2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
+{
+  turn_right_plane_tiled<1, 8, 16>(srcp, dstp, src_rowsize, src_height, src_pitch, dst_pitch,
+    transpose_8x8x16_avx2, turn_right_plane_8_c);
+}
+
+void turn_left_plane_8_avx2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
+{
+  turn_right_plane_8_avx2(srcp + (src_height - 1) * src_pitch, dstp + (src_rowsize - 1) * dst_pitch, src_rowsize, src_height, -src_pitch, -dst_pitch);
+}
+
+void turn_right_plane_16_avx2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
+{
+  turn_right_plane_tiled<2, 8, 8>(srcp, dstp, src_rowsize, src_height, src_pitch, dst_pitch,
+    transpose_16x8x8_avx2, turn_right_plane_16_c);
+}
+
+void turn_left_plane_16_avx2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
+{
+  turn_right_plane_16_avx2(srcp + src_pitch * (src_height - 1), dstp + dst_pitch * (src_rowsize / 2 - 1), src_rowsize, src_height, -src_pitch, -dst_pitch);
+}
+
+void turn_right_plane_32_avx2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
+{
+  turn_right_plane_tiled<4, 8, 8>(srcp, dstp, src_rowsize, src_height, src_pitch, dst_pitch,
+    transpose_32x8x8_avx2, turn_right_plane_32_c);
+}
+
+void turn_left_plane_32_avx2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
+{
+  turn_right_plane_32_avx2(srcp + src_pitch * (src_height - 1), dstp + dst_pitch * (src_rowsize / 4 - 1), src_rowsize, src_height, -src_pitch, -dst_pitch);
+}
+
+// on RGB, TurnLeft and TurnRight are reversed.
+void turn_left_rgb32_avx2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
+{
+  turn_right_plane_32_avx2(srcp, dstp, src_rowsize, src_height, src_pitch, dst_pitch);
+}
+
+void turn_right_rgb32_avx2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
+{
+  turn_left_plane_32_avx2(srcp, dstp, src_rowsize, src_height, src_pitch, dst_pitch);
+}
+
+static void turn_right_plane_64_avx2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
+{
+  turn_right_plane_tiled<8, 4, 4>(srcp, dstp, src_rowsize, src_height, src_pitch, dst_pitch,
+    transpose_64x4x4_avx2, turn_right_plane_c<uint64_t>);
+}
+
+void turn_left_rgb64_avx2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
+{
+  turn_right_plane_64_avx2(srcp, dstp, src_rowsize, src_height, src_pitch, dst_pitch);
+}
+
+void turn_right_rgb64_avx2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
+{
+  turn_right_plane_64_avx2(srcp + src_pitch * (src_height - 1), dstp + dst_pitch * (src_rowsize / 8 - 1), src_rowsize, src_height, -src_pitch, -dst_pitch);
+}
+
+
+template <typename T>
+void turn_180_plane_avx2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
+{
+  const BYTE* s0 = srcp;
+  BYTE* d0 = dstp + dst_pitch * (src_height - 1) + src_rowsize - 32;
+  const int w = src_rowsize & ~31;
+
+  __m256i pshufb_mask;
+  if constexpr (sizeof(T) == 1)
+    pshufb_mask = _mm256_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+      0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  else if constexpr (sizeof(T) == 2)
+    pshufb_mask = _mm256_set_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+      1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+  const __m256i reverse32 = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+  for (int y = 0; y < src_height; ++y)
+  {
+    for (int x = 0; x < w; x += 32)
+    {
+      __m256i src = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s0 + x));
+      if constexpr (sizeof(T) == 8) // RGB64
+        src = _mm256_permute4x64_epi64(src, _MM_SHUFFLE(0, 1, 2, 3));
+      else if constexpr (sizeof(T) == 4) // RGB32, 32 bit planes
+        src = _mm256_permutevar8x32_epi32(src, reverse32);
+      else // uint16_t, uint8_t: reverse inside lanes, then swap lanes
+        src = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(src, pshufb_mask), _MM_SHUFFLE(1, 0, 3, 2));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(d0 - x), src);
+    }
+    s0 += src_pitch;
+    d0 -= dst_pitch;
+  }
+
+  if (src_rowsize != w)
+  {
+    turn_180_plane_c<T>(srcp + w, dstp, src_rowsize - w, src_height, src_pitch, dst_pitch);
+  }
+}
+
+// instantiate
+template void turn_180_plane_avx2<uint8_t>(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch);
+template void turn_180_plane_avx2<uint16_t>(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch);
+template void turn_180_plane_avx2<uint32_t>(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch);
+template void turn_180_plane_avx2<uint64_t>(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch);
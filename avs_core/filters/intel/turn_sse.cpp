@@ -91,30 +91,8 @@ static AVS_FORCEINLINE void transpose_8x8x8_sse2(const BYTE* srcp, BYTE* dstp, i
 
 void turn_right_plane_8_sse2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
 {
-    const BYTE* s0 = srcp;
-    int w = src_rowsize & ~7;
-    int h = src_height & ~7;
-
-    for (int y = 0; y < h; y += 8)
-    {
-        BYTE* d0 = dstp + src_height - 8  - y;
-        for (int x = 0; x < w; x += 8)
-        {
-            transpose_8x8x8_sse2(s0 + x, d0, src_pitch, dst_pitch);
-            d0 += dst_pitch * 8;
-        }
-        s0 += src_pitch * 8;
-    }
-
-    if (src_rowsize != w)
-    {
-        turn_right_plane_8_c(srcp + w, dstp + w * dst_pitch, src_rowsize - w, src_height, src_pitch, dst_pitch);
-    }
-
-    if (src_height != h)
-    {
-        turn_right_plane_8_c(srcp + h * src_pitch, dstp, src_rowsize, src_height - h, src_pitch, dst_pitch);
-    }
+    turn_right_plane_tiled<1, 8, 8>(srcp, dstp, src_rowsize, src_height, src_pitch, dst_pitch,
+        transpose_8x8x8_sse2, turn_right_plane_8_c);
 }
 
 
@@ -151,38 +129,19 @@ static AVS_FORCEINLINE void transpose_16x4x8_sse2(const BYTE* srcp, BYTE* dstp,
     __m128i abcdefgh2 = _mm_unpacklo_epi16(aceg23, bdfh23); //a2 b2 c2 d2 e2 f2 g2 h2
     __m128i abcdefgh3 = _mm_unpackhi_epi16(aceg23, bdfh23); //a3 b3 c3 d3 e3 f3 g3 h3
 
-    _mm_store_si128(reinterpret_cast<__m128i*>(dstp + dst_pitch * 0), abcdefgh0);
-    _mm_store_si128(reinterpret_cast<__m128i*>(dstp + dst_pitch * 1), abcdefgh1);
-    _mm_store_si128(reinterpret_cast<__m128i*>(dstp + dst_pitch * 2), abcdefgh2);
-    _mm_store_si128(reinterpret_cast<__m128i*>(dstp + dst_pitch * 3), abcdefgh3);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dstp + dst_pitch * 0), abcdefgh0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dstp + dst_pitch * 1), abcdefgh1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dstp + dst_pitch * 2), abcdefgh2);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dstp + dst_pitch * 3), abcdefgh3);
 }
 
 
 void turn_right_plane_16_sse2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
 {
-    const BYTE* s0 = srcp + src_pitch * (src_height - 1);
-    int w = src_rowsize & ~7;
-    int h = src_height & ~7;
-
-    for (int y = 0; y < h; y += 8)
-    {
-        BYTE* d0 = dstp + y * 2;
-        for (int x = 0; x < w; x += 8)
-        {
-            transpose_16x4x8_sse2(s0 + x, d0, -src_pitch, dst_pitch);
-            d0 += 4 * dst_pitch;
-        }
-        s0 -= 8 * src_pitch;
-    }
-    if (src_rowsize != w)
-    {
-        turn_right_plane_16_c(srcp + w, dstp + dst_pitch * w / 2, src_rowsize - w, src_height, src_pitch, dst_pitch);
-    }
-
-    if (src_height != h)
-    {
-        turn_right_plane_16_c(srcp, dstp + h * 2, src_rowsize, src_height - h, src_pitch, dst_pitch);
-    }
+    // the kernel puts its first source row leftmost: feed it bottom-up
+    turn_right_plane_tiled<2, 4, 8>(srcp, dstp, src_rowsize, src_height, src_pitch, dst_pitch,
+        [](const BYTE* s, BYTE* d, int sp, int dp) { transpose_16x4x8_sse2(s + 7 * sp, d, -sp, dp); },
+        turn_right_plane_16_c);
 }
 
 
@@ -219,30 +178,9 @@ static AVS_FORCEINLINE void transpose_32x4x4_sse2(const BYTE* srcp, BYTE* dstp,
 
 void turn_right_plane_32_sse2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
 {
-    const BYTE* s0 = srcp + src_pitch * (src_height - 1);
-    int w = src_rowsize & ~15;
-    int h = src_height & ~3;
-
-    for (int y = 0; y < h; y += 4)
-    {
-        BYTE* d0 = dstp + y * 4;
-        for (int x = 0; x < w; x += 16)
-        {
-            transpose_32x4x4_sse2(s0 + x, d0, -src_pitch, dst_pitch);
-            d0 += 4 * dst_pitch;
-        }
-        s0 -= 4 * src_pitch;
-    }
-
-    if (src_rowsize != w)
-    {
-        turn_right_plane_32_c(srcp + w, dstp + w / 4 * dst_pitch, src_rowsize - w, src_height, src_pitch, dst_pitch);
-    }
-
-    if (src_height != h)
-    {
-        turn_right_plane_32_c(srcp, dstp + h * 4, src_rowsize, src_height - h, src_pitch, dst_pitch);
-    }
+    turn_right_plane_tiled<4, 4, 4>(srcp, dstp, src_rowsize, src_height, src_pitch, dst_pitch,
+        [](const BYTE* s, BYTE* d, int sp, int dp) { transpose_32x4x4_sse2(s + 3 * sp, d, -sp, dp); },
+        turn_right_plane_32_c);
 }
 
 void turn_left_plane_32_sse2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
@@ -267,37 +205,21 @@ void turn_right_rgb32_sse2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int sr
 
 
 
-static inline void turn_right_plane_64_sse2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
+static AVS_FORCEINLINE void transpose_64x2x2_sse2(const BYTE* srcp, BYTE* dstp, const int src_pitch, const int dst_pitch)
 {
-    const BYTE* s0 = srcp + src_pitch * (src_height - 1);
-    int w = src_rowsize & ~15;
-    int h = src_height & ~1;
-
-    for (int y = 0; y < h; y += 2)
-    {
-        BYTE* d0 = dstp + y * 8;
-        for (int x = 0; x < w; x += 16)
-        {
-            __m128i a01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s0 + x));               // a0 a1
-            __m128i b01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s0 + x - src_pitch));   // b0 b1
-            __m128i ab0 = _mm_unpacklo_epi64(a01, b01); // a0 b0
-            __m128i ab1 = _mm_unpackhi_epi64(a01, b01); // a1 b1
-            _mm_storeu_si128(reinterpret_cast<__m128i*>(d0), ab0);
-            _mm_storeu_si128(reinterpret_cast<__m128i*>(d0 + dst_pitch), ab1);
-            d0 += 2 * dst_pitch;
-        }
-        s0 -= 2 * src_pitch;
-    }
+    __m128i a01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcp));               // a0 a1
+    __m128i b01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcp + src_pitch));   // b0 b1
+    __m128i ba0 = _mm_unpacklo_epi64(b01, a01); // b0 a0
+    __m128i ba1 = _mm_unpackhi_epi64(b01, a01); // b1 a1
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dstp), ba0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dstp + dst_pitch), ba1);
+}
 
-    if (src_rowsize != w)
-    {
-        turn_right_plane_c<uint64_t>(srcp + w, dstp + w / 8 * dst_pitch, 8, src_height, src_pitch, dst_pitch);
-    }
 
-    if (src_height != h)
-    {
-        turn_right_plane_c<uint64_t>(srcp, dstp + h * 8, src_rowsize, 1, src_pitch, dst_pitch);
-    }
+void turn_right_plane_64_sse2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch)
+{
+    turn_right_plane_tiled<8, 2, 2>(srcp, dstp, src_rowsize, src_height, src_pitch, dst_pitch,
+        transpose_64x2x2_sse2, turn_right_plane_c<uint64_t>);
 }
 
 
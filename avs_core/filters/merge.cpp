@@ -47,6 +47,7 @@
 #include "../core/internal.h"
 #include "avs/alignment.h"
 #include <cstdint>
+#include <cstring>
 
 
 /* -----------------------------------
@@ -224,12 +225,70 @@ MergeFuncPtr getMergeFunc(int bits_per_pixel, BYTE *srcp, const BYTE *otherp, fl
 
   // pixelsize == 4
 #ifdef INTEL_INTRINSICS
+  if (cpuFlags & CPUF_AVX2)
+    return &weighted_merge_planar_avx2_float;
   if (cpuFlags & CPUF_SSE2)
     return &weighted_merge_planar_sse2_float;
 #endif
   return &weighted_merge_planar_c_float;
 }
 
+
+PVideoFrame WeightedMergeFrames(const PVideoFrame& a, const PVideoFrame& b, float weight, const VideoInfo& vi, IScriptEnvironment* env)
+{
+  const int planes_y[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
+  const int planes_r[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
+  const int* planes = (!vi.IsPlanar() || vi.IsYUV() || vi.IsYUVA()) ? planes_y : planes_r;
+  const int planeCount = vi.IsPlanar() ? vi.NumComponents() : 1;
+  const int bits_per_pixel = vi.BitsPerComponent();
+
+  int weight_i;
+  int invweight_i;
+#ifdef INTEL_INTRINSICS
+  MergeFuncPtr weighted_merge_planar = getMergeFunc(bits_per_pixel, env->GetCPUFlags(), nullptr, nullptr, weight, /*out*/weight_i, /*out*/invweight_i);
+#else
+  MergeFuncPtr weighted_merge_planar = getMergeFunc(bits_per_pixel, nullptr, nullptr, weight, /*out*/weight_i, /*out*/invweight_i);
+#endif
+
+  // weights which leave one of the frames unchanged: pass it by reference
+  if (bits_per_pixel == 32 ? weight == 0.0f : weight_i == 0)
+    return a;
+  if (bits_per_pixel == 32 ? weight == 1.0f : invweight_i == 0)
+    return b;
+
+  PVideoFrame dst = a;
+  if (!dst->IsWritable())
+    dst = env->NewVideoFrameP(vi, &a);
+
+  for (int j = 0; j < planeCount; ++j)
+  {
+    const int plane = planes[j];
+    const BYTE* a_data = a->GetReadPtr(plane);
+    const BYTE* b_data = b->GetReadPtr(plane);
+    BYTE* dst_data = dst->GetWritePtr(plane);
+    const int a_pitch = a->GetPitch(plane);
+    const int b_pitch = b->GetPitch(plane);
+    const int dst_pitch = dst->GetPitch(plane);
+    const int row_size = a->GetRowSize(plane);
+    const int height = a->GetHeight(plane);
+
+    if (dst_data == a_data) {
+      weighted_merge_planar(dst_data, b_data, dst_pitch, b_pitch, row_size, height, weight, weight_i, invweight_i);
+      continue;
+    }
+    // a is shared: copy each line and blend it while it is in L1,
+    // instead of a full frame copy followed by a second pass
+    for (int y = 0; y < height; ++y) {
+      memcpy(dst_data, a_data, row_size);
+      weighted_merge_planar(dst_data, b_data, dst_pitch, b_pitch, row_size, 1, weight, weight_i, invweight_i);
+      dst_data += dst_pitch;
+      a_data += a_pitch;
+      b_data += b_pitch;
+    }
+  }
+  return dst;
+}
+
 static void merge_plane(BYTE* srcp, const BYTE* otherp, int src_pitch, int other_pitch, int src_rowsize, int src_height, float weight, int pixelsize, int bits_per_pixel, IScriptEnvironment* env) {
   if ((weight > 0.4961f) && (weight < 0.5039f))
   {
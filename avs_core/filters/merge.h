@@ -132,4 +132,8 @@ template<typename pixel_t>
 void weighted_merge_planar_c(BYTE *p1, const BYTE *p2, int p1_pitch, int p2_pitch, int rowsize, int height, float weight_f, int weight_i, int invweight_i);
 void weighted_merge_planar_c_float(BYTE *p1, const BYTE *p2, int p1_pitch, int p2_pitch, int rowsize, int height, float weight_f, int weight_i, int invweight_i);
 
+// Blends all planes: (1-weight)*a + weight*b. Returns a or b itself when the weight
+// leaves it unchanged, blends in place when a is writable, else into a new frame.
+PVideoFrame WeightedMergeFrames(const PVideoFrame& a, const PVideoFrame& b, float weight, const VideoInfo& vi, IScriptEnvironment* env);
+
 #endif  // __Merge_H__
@@ -220,7 +220,7 @@ static void convert_yv24_chroma_to_yv16_c(BYTE *dstp8, const BYTE *srcp8, int ds
   }
 }
 
-void ConvertYToYV12Chroma(BYTE *dst, BYTE *src, int dstpitch, int srcpitch, int pixelsize, int w, int h, IScriptEnvironment* env)
+void ConvertYToYV12Chroma(BYTE *dst, const BYTE *src, int dstpitch, int srcpitch, int pixelsize, int w, int h, IScriptEnvironment* env)
 {
     if(pixelsize==1)
       convert_yv24_chroma_to_yv12_c<uint8_t>(dst, src, dstpitch, srcpitch, w, h);
@@ -230,7 +230,7 @@ void ConvertYToYV12Chroma(BYTE *dst, BYTE *src, int dstpitch, int srcpitch, int
       convert_yv24_chroma_to_yv12_c<float>(dst, src, dstpitch, srcpitch, w, h);
 }
 
-void ConvertYToYV16Chroma(BYTE *dst, BYTE *src, int dstpitch, int srcpitch, int pixelsize, int w, int h, IScriptEnvironment* env)
+void ConvertYToYV16Chroma(BYTE *dst, const BYTE *src, int dstpitch, int srcpitch, int pixelsize, int w, int h, IScriptEnvironment* env)
 {
     if(pixelsize==1)
       convert_yv24_chroma_to_yv16_c<uint8_t>(dst, src, dstpitch, srcpitch, w, h);
@@ -839,9 +839,10 @@ static void convert_yv24_chroma_to_yv16_c(BYTE *dstp8, const BYTE *srcp8, int ds
   }
 }
 
-void ConvertYToYV12Chroma(BYTE *dst, BYTE *src, int dstpitch, int srcpitch, int pixelsize, int w, int h, IScriptEnvironment* env)
+void ConvertYToYV12Chroma(BYTE *dst, const BYTE *src, int dstpitch, int srcpitch, int pixelsize, int w, int h, IScriptEnvironment* env)
 {
-  if ((env->GetCPUFlags() & CPUF_SSE2) && IsPtrAligned(src, 16) && IsPtrAligned(dst, 16))
+  if ((env->GetCPUFlags() & CPUF_SSE2) && IsPtrAligned(src, 16) && IsPtrAligned(dst, 16)
+    && w * pixelsize >= 16) // last chunk is right-aligned simd
   {
     if (pixelsize == 1)
       convert_yv24_chroma_to_yv12_sse2<uint8_t>(dst, src, dstpitch, srcpitch, w, h);
@@ -866,7 +867,7 @@ void ConvertYToYV12Chroma(BYTE *dst, BYTE *src, int dstpitch, int srcpitch, int
   }
 }
 
-void ConvertYToYV16Chroma(BYTE *dst, BYTE *src, int dstpitch, int srcpitch, int pixelsize, int w, int h, IScriptEnvironment* env)
+void ConvertYToYV16Chroma(BYTE *dst, const BYTE *src, int dstpitch, int srcpitch, int pixelsize, int w, int h, IScriptEnvironment* env)
 {
   if ((env->GetCPUFlags() & CPUF_SSE2) && IsPtrAligned(src, 16) && IsPtrAligned(dst, 16)
     && w * pixelsize >= 16) // last chunk is also simd, but working on a right-aligned 32 bytes -> 8 bytes. Also simd but unaligned.
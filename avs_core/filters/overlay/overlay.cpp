@@ -43,6 +43,7 @@
 #include <stdlib.h>
 #include "overlay.h"
 #include <string>
+#include <algorithm>
 #include "../core/internal.h"
 
 /********************************************************************
@@ -89,6 +90,75 @@ static int getPixelTypeWithoutAlpha(VideoInfo& vi)
     (vi.IsPlanarRGBA() ? (vi.pixel_type & ~VideoInfo::CS_RGBA_TYPE) | VideoInfo::CS_RGB_TYPE : vi.pixel_type));
 }
 
+/***** region of interest conversions ******/
+
+template<typename pixel_t>
+static void convert_chroma_rect_to_444_c(BYTE *dstp8, const BYTE *srcp8, int dst_pitch, int src_pitch, int dst_width, int dst_height, int ssy) {
+  pixel_t *dstp = reinterpret_cast<pixel_t *>(dstp8);
+  const pixel_t *srcp = reinterpret_cast<const pixel_t *>(srcp8);
+  dst_pitch /= sizeof(pixel_t);
+  src_pitch /= sizeof(pixel_t);
+  for (int y = 0; y < dst_height; ++y) {
+    const pixel_t *srcp_y = srcp + (y >> ssy) * src_pitch;
+    for (int x = 0; x < dst_width; ++x)
+      dstp[x] = srcp_y[x >> 1];
+    dstp += dst_pitch;
+  }
+}
+
+// Point-upsamples the rectangle at x,y of a 4:2:0 (ssy=1) or 4:2:2 (ssy=0) frame into
+// the whole of a 4:4:4 frame, the same way Convert444FromYV12/YV16 do for full frames.
+// x,y must be multiples of the subsampling.
+static void Convert444FromSubsampledRect(PVideoFrame &src, PVideoFrame &dst, int x, int y, int ssy, int pixelsize, IScriptEnvironment* env)
+{
+  const int w = dst->GetRowSize(PLANAR_Y) / pixelsize;
+  const int h = dst->GetHeight(PLANAR_Y);
+
+  env->BitBlt(dst->GetWritePtr(PLANAR_Y), dst->GetPitch(PLANAR_Y),
+    src->GetReadPtr(PLANAR_Y) + y * src->GetPitch(PLANAR_Y) + x * pixelsize, src->GetPitch(PLANAR_Y), w * pixelsize, h);
+
+  const int planes[2] = { PLANAR_U, PLANAR_V };
+  for (int p = 0; p < 2; p++) {
+    const int src_pitch = src->GetPitch(planes[p]);
+    const BYTE* srcp = src->GetReadPtr(planes[p]) + (y >> ssy) * src_pitch + (x >> 1) * pixelsize;
+    if (pixelsize == 1)
+      convert_chroma_rect_to_444_c<uint8_t>(dst->GetWritePtr(planes[p]), srcp, dst->GetPitch(planes[p]), src_pitch, w, h, ssy);
+    else if (pixelsize == 2)
+      convert_chroma_rect_to_444_c<uint16_t>(dst->GetWritePtr(planes[p]), srcp, dst->GetPitch(planes[p]), src_pitch, w, h, ssy);
+    else
+      convert_chroma_rect_to_444_c<float>(dst->GetWritePtr(planes[p]), srcp, dst->GetPitch(planes[p]), src_pitch, w, h, ssy);
+  }
+
+  if (dst->GetRowSize(PLANAR_A))
+    env->BitBlt(dst->GetWritePtr(PLANAR_A), dst->GetPitch(PLANAR_A),
+      src->GetReadPtr(PLANAR_A) + y * src->GetPitch(PLANAR_A) + x * pixelsize, src->GetPitch(PLANAR_A), w * pixelsize, h);
+}
+
+// Inverse of Convert444FromSubsampledRect: writes the 4:4:4 frame back into the rectangle at x,y,
+// averaging chroma like Convert444ToYV12/YV16.
+static void Convert444ToSubsampledRect(PVideoFrame &src, PVideoFrame &dst, int x, int y, int ssy, int pixelsize, IScriptEnvironment* env)
+{
+  const int w = src->GetRowSize(PLANAR_Y) / pixelsize;
+  const int h = src->GetHeight(PLANAR_Y);
+
+  env->BitBlt(dst->GetWritePtr(PLANAR_Y) + y * dst->GetPitch(PLANAR_Y) + x * pixelsize, dst->GetPitch(PLANAR_Y),
+    src->GetReadPtr(PLANAR_Y), src->GetPitch(PLANAR_Y), w * pixelsize, h);
+
+  const int planes[2] = { PLANAR_U, PLANAR_V };
+  for (int p = 0; p < 2; p++) {
+    const int dst_pitch = dst->GetPitch(planes[p]);
+    BYTE* dstp = dst->GetWritePtr(planes[p]) + (y >> ssy) * dst_pitch + (x >> 1) * pixelsize;
+    if (ssy)
+      ConvertYToYV12Chroma(dstp, src->GetReadPtr(planes[p]), dst_pitch, src->GetPitch(planes[p]), pixelsize, w >> 1, h >> 1, env);
+    else
+      ConvertYToYV16Chroma(dstp, src->GetReadPtr(planes[p]), dst_pitch, src->GetPitch(planes[p]), pixelsize, w >> 1, h, env);
+  }
+
+  if (src->GetRowSize(PLANAR_A))
+    env->BitBlt(dst->GetWritePtr(PLANAR_A) + y * dst->GetPitch(PLANAR_A) + x * pixelsize, dst->GetPitch(PLANAR_A),
+      src->GetReadPtr(PLANAR_A), src->GetPitch(PLANAR_A), w * pixelsize, h);
+}
+
 Overlay::Overlay(PClip _child, AVSValue args, IScriptEnvironment *env) :
 GenericVideoFilter(_child) {
 
@@ -429,10 +499,52 @@ PVideoFrame __stdcall Overlay::GetFrame(int n, IScriptEnvironment *env) {
   int con_y_offset;
   FetchConditionals(env, &op_offset, &op_offset_f, &con_x_offset, &con_y_offset, ignore_conditional, condVarSuffix);
 
+  int ov_x = offset_x + con_x_offset;
+  int ov_y = offset_y + con_y_offset;
+
+  // Part of the base frame covered by the overlay
+  const int cover_x1 = std::min(ov_x + overlayVi.width, inputVi.width);
+  const int cover_y1 = std::min(ov_y + overlayVi.height, inputVi.height);
+  const int cover_x0 = std::max(ov_x, 0);
+  const int cover_y0 = std::max(ov_y, 0);
+
+  // Nothing to overlay: the base frame passes through untouched
+  if ((cover_x0 >= cover_x1 || cover_y0 >= cover_y1) && vi.pixel_type == inputVi.pixel_type)
+    return child->GetFrame(n, env);
+
   AVSValue child2;
   PVideoFrame frame;
 
-  if (inputVi.pixel_type == viInternalWorkingFormat.pixel_type)
+  // 4:2:0 or 4:2:2 in and out with a 4:4:4 working format: only the covered
+  // rectangle is converted to 4:4:4 and back, the rest of the frame is kept as is.
+  // The round trip of the untouched area would have been lossless anyway.
+  const bool useRect = isInternal444 && (inputVi.Is420() || inputVi.Is422()) && vi.pixel_type == inputVi.pixel_type;
+  PVideoFrame baseFrame;
+  int rect_x = 0;
+  int rect_y = 0;
+  int rect_w = vi.width;
+  int rect_h = vi.height;
+  const int rect_ssy = inputVi.Is420() ? 1 : 0;
+
+  if (useRect) {
+    // 64 pixel horizontal granularity keeps chroma rows as aligned as in the full frame, for the SIMD converters
+    rect_x = cover_x0 & ~63;
+    rect_y = cover_y0 & ~rect_ssy;
+    rect_w = std::min((cover_x1 + 63) & ~63, inputVi.width) - rect_x;
+    rect_h = std::min((cover_y1 + rect_ssy) & ~rect_ssy, inputVi.height) - rect_y;
+
+    baseFrame = child->GetFrame(n, env);
+    VideoInfo viRect = viInternalWorkingFormat;
+    viRect.width = rect_w;
+    viRect.height = rect_h;
+    frame = env->NewVideoFrameP(viRect, &baseFrame);
+    Convert444FromSubsampledRect(baseFrame, frame, rect_x, rect_y, rect_ssy, pixelsize, env);
+
+    // overlay position relative to the working rectangle
+    ov_x -= rect_x;
+    ov_y -= rect_y;
+  }
+  else if (inputVi.pixel_type == viInternalWorkingFormat.pixel_type)
   {
     // get frame as is.
     // includes 420, 422, 444, planarRGB(A)
@@ -487,7 +599,7 @@ PVideoFrame __stdcall Overlay::GetFrame(int n, IScriptEnvironment *env) {
   // Fetch current frame and convert it to internal format
   env->MakeWritable(&frame);
 
-  ImageOverlayInternal* img = new ImageOverlayInternal(frame, vi.width, vi.height, viInternalWorkingFormat, child->GetVideoInfo().IsYUVA() || child->GetVideoInfo().IsPlanarRGBA(), false, env);
+  ImageOverlayInternal* img = new ImageOverlayInternal(frame, rect_w, rect_h, viInternalWorkingFormat, child->GetVideoInfo().IsYUVA() || child->GetVideoInfo().IsPlanarRGBA(), false, env);
 
   PVideoFrame Oframe;
   AVSValue overlay2;
@@ -584,7 +696,7 @@ PVideoFrame __stdcall Overlay::GetFrame(int n, IScriptEnvironment *env) {
   ImageOverlayInternal* overlayImg = new ImageOverlayInternal(Oframe, overlayVi.width, overlayVi.height, actual_viInternalOverlayWorkingFormat, overlay->GetVideoInfo().IsYUVA() || overlay->GetVideoInfo().IsPlanarRGBA(), false, env);
 
   // Clip overlay to original image
-  ClipFrames(img, overlayImg, offset_x + con_x_offset, offset_y + con_y_offset);
+  ClipFrames(img, overlayImg, ov_x, ov_y);
 
   if (overlayImg->IsSizeZero()) { // Nothing to overlay
   }
@@ -654,7 +766,7 @@ PVideoFrame __stdcall Overlay::GetFrame(int n, IScriptEnvironment *env) {
       maskImg = new ImageOverlayInternal(Mframe, maskVi.width, maskVi.height, viInternalOverlayWorkingFormat, mask->GetVideoInfo().IsYUVA() || mask->GetVideoInfo().IsPlanarRGBA(), greymask, env);
 
       img->ReturnOriginal(true);
-      ClipFrames(img, maskImg, offset_x + con_x_offset, offset_y + con_y_offset);
+      ClipFrames(img, maskImg, ov_x, ov_y);
 
 
     }
@@ -692,6 +804,12 @@ PVideoFrame __stdcall Overlay::GetFrame(int n, IScriptEnvironment *env) {
     delete img;
   }
 
+  if (useRect) {
+    env->MakeWritable(&baseFrame);
+    Convert444ToSubsampledRect(frame, baseFrame, rect_x, rect_y, rect_ssy, pixelsize, env);
+    return baseFrame;
+  }
+
   // here img->frame is 444
   // apply fast conversion
   if(outputVi.Is420() && viInternalWorkingFormat.Is444())
@@ -89,7 +89,7 @@ extern const AVSFunction Text_filters[] = {
   "c[offset_f]i[x]f[y]f[font]s[size]f[text_color]i[halo_color]i[font_width]f[font_angle]f[bold]b[italic]b[noaa]b",
   ShowSMPTE::CreateTime },
 
-  { "Info", BUILTIN_FUNC_PREFIX, "c[font]s[size]f[text_color]i[halo_color]i[bold]b[italic]b[noaa]b[cpu]b[x]f[y]f[align]i", FilterInfo::Create },  // clip
+  { "Info", BUILTIN_FUNC_PREFIX, "c[font]s[size]f[text_color]i[halo_color]i[bold]b[italic]b[noaa]b[cpu]b[x]f[y]f[align]i[perf]b", FilterInfo::Create },  // clip
 
   { "Subtitle",BUILTIN_FUNC_PREFIX,
   "cs[x]f[y]f[first_frame]i[last_frame]i[font]s[size]f[text_color]i[halo_color]i"
@@ -102,7 +102,7 @@ extern const AVSFunction Text_filters[] = {
 },       // see docs!
 
   { "Compare",BUILTIN_FUNC_PREFIX,
-  "cc[channels]s[logfile]s[show_graph]b",
+  "cc[channels]s[logfile]s[show_graph]b[show]b",
   Compare::Create },
 
   { "Text",BUILTIN_FUNC_PREFIX,
@@ -2179,7 +2179,7 @@ AVSValue __cdecl SimpleText::Create(AVSValue args, void*, IScriptEnvironment* en
  **********************************/
 
 FilterInfo::FilterInfo( PClip _child, const char _fontname[], int _size, int _textcolor, int _halocolor, bool _bold, bool _italic, bool _noaa, 
-  bool _cpu, int _x, int _y, int _align, IScriptEnvironment* env)
+  bool _cpu, int _x, int _y, int _align, bool _perf, IScriptEnvironment* env)
   : GenericVideoFilter(_child), vii(AdjustVi()), size(_size),
   text_color(vi.IsYUV() || vi.IsYUVA() ? RGB2YUV_Rec601(_textcolor) : _textcolor),
   halo_color(vi.IsYUV() || vi.IsYUVA() ? RGB2YUV_Rec601(_halocolor) : _halocolor)
@@ -2190,7 +2190,7 @@ FilterInfo::FilterInfo( PClip _child, const char _fontname[], int _size, int _te
     _bold, _italic, _noaa)
 #endif
   , bold(_bold), italic(_italic), noaa(_noaa),
-  cpu(_cpu), x(_x), y(_y), align(_align)
+  cpu(_cpu), x(_x), y(_y), align(_align), perf(_perf)
 {
   AVS_UNUSED(env);
 #if defined(AVS_WINDOWS) && !defined(NO_WIN_GDI)
@@ -2348,7 +2348,7 @@ PVideoFrame FilterInfo::GetFrame(int n, IScriptEnvironment* env)
     const char* c_space = "Unknown";
     const char* s_type = t_NONE;
     const char* s_parity;
-    char text[1024];
+    char text[1536];
     int tlen;
     std::string chn_layout_str;
 
@@ -2462,6 +2462,28 @@ PVideoFrame FilterInfo::GetFrame(int n, IScriptEnvironment* env)
 #endif
     } // show cpu capabilities
 
+    if (perf) {
+      // environment-wide counters since startup, see AEP_FRAMES_DELIVERED and friends
+      const size_t cache_hits = env->GetEnvProperty(AEP_CACHE_HITS);
+      const size_t cache_lookups = cache_hits + env->GetEnvProperty(AEP_CACHE_MISSES);
+      tlen += snprintf(text + tlen, sizeof(text) - tlen,
+        "Frames delivered: %zu\n"
+        "Frame time p50/p95/p99: %.2f/%.2f/%.2f ms\n"
+        "Cache hit ratio: %.1f%% (%zu of %zu)\n"
+        "Frame memory: %zu of %zu MB (huge pages: %zu MB), Queued jobs: %zu\n"
+        , env->GetEnvProperty(AEP_FRAMES_DELIVERED)
+        , env->GetEnvProperty(AEP_FRAME_TIME_P50) / 1000.0
+        , env->GetEnvProperty(AEP_FRAME_TIME_P95) / 1000.0
+        , env->GetEnvProperty(AEP_FRAME_TIME_P99) / 1000.0
+        , cache_lookups ? 100.0 * cache_hits / cache_lookups : 0.0
+        , cache_hits, cache_lookups
+        , env->GetEnvProperty(AEP_MEMORY_USED) >> 20
+        , env->GetEnvProperty(AEP_MEMORY_MAX) >> 20
+        , env->GetEnvProperty(AEP_MEMORY_HUGE_PAGES) >> 20
+        , env->GetEnvProperty(AEP_THREADPOOL_QUEUE)
+      );
+    } // show performance counters
+
     // Windows GDI: aligns the whole box, its content is kept top left aligned
     // "Text" fixed font mode: individual lines are aligned as well
 
@@ -2543,8 +2565,8 @@ PVideoFrame FilterInfo::GetFrame(int n, IScriptEnvironment* env)
 
 AVSValue __cdecl FilterInfo::Create(AVSValue args, void*, IScriptEnvironment* env)
 {
-    // 0   1      2       3             4         5       6      7       8    9  10    11
-    // c[font]s[size]f[text_color]i[halo_color]i[bold]b[italic]b[noaa]b[cpu]b[x]f[y]f[align]
+    // 0   1      2       3             4         5       6      7       8    9  10    11      12
+    // c[font]s[size]f[text_color]i[halo_color]i[bold]b[italic]b[noaa]b[cpu]b[x]f[y]f[align]i[perf]b
     PClip clip = args[0].AsClip();
     // new parameters 20160823
 #if defined(AVS_WINDOWS) && !defined(NO_WIN_GDI)
@@ -2567,6 +2589,7 @@ AVSValue __cdecl FilterInfo::Create(AVSValue args, void*, IScriptEnvironment* en
     const bool cpu = args[8].AsBool(true);
 
     const int align = args[11].AsInt(7); // default top left
+    const bool perf = args[12].AsBool(false);
 
     const int info_default_x = 4; // subtitle: 8
 #if defined(AVS_WINDOWS) && !defined(NO_WIN_GDI)
@@ -2615,7 +2638,7 @@ AVSValue __cdecl FilterInfo::Create(AVSValue args, void*, IScriptEnvironment* en
     if ((align < 1) || (align > 9))
       env->ThrowError("Info: Align values are 1 - 9 mapped to your numeric pad");
 
-    return new FilterInfo(clip, font, size, text_color, halo_color, bold, italic, noaa, cpu, x, y, align, env);
+    return new FilterInfo(clip, font, size, text_color, halo_color, bold, italic, noaa, cpu, x, y, align, perf, env);
 }
 
 
@@ -2624,7 +2647,7 @@ AVSValue __cdecl FilterInfo::Create(AVSValue args, void*, IScriptEnvironment* en
  *******    Compare Filter    *******
  ***********************************/
 
-Compare::Compare(PClip _child1, PClip _child2, const char* channels, const char *fname, bool _show_graph, IScriptEnvironment* env)
+Compare::Compare(PClip _child1, PClip _child2, const char* channels, const char *fname, bool _show_graph, bool _show, IScriptEnvironment* env)
   : GenericVideoFilter(_child1),
 #if defined(AVS_WINDOWS) && !defined(NO_WIN_GDI)
   antialiaser(vi.width, vi.height, "Courier New", 16 * 8,
@@ -2636,6 +2659,7 @@ Compare::Compare(PClip _child1, PClip _child2, const char* channels, const char
   child2(_child2),
   log(nullptr),
   show_graph(_show_graph),
+  show(_show),
   framecount(0),
   text_color((vi.IsYUV() || vi.IsYUVA()) ? 0xD21092 : 0xFFFF00),
   halo_color((vi.IsYUV() || vi.IsYUVA()) ? 0x108080 : 0)
@@ -2742,7 +2766,7 @@ Compare::Compare(PClip _child1, PClip _child2, const char* channels, const char
       fprintf(log,"-----------------------------------------------------\n");
     } else
       env->ThrowError("Compare: unable to create file %s", fname);
-  } else {
+  } else if (show) {
     psnrs = new(std::nothrow) int[vi.num_frames];
     if (psnrs)
       for (int i = 0; i < vi.num_frames; i++)
@@ -2790,6 +2814,7 @@ AVSValue __cdecl Compare::Create(AVSValue args, void*, IScriptEnvironment *env)
             args[2].AsString(""),   // channels
             args[3].AsString(""),   // logfile
             args[4].AsBool(true),   // show_graph
+            args[5].AsBool(true),   // show
             env);
 }
 
@@ -2842,7 +2867,7 @@ static void compare_planar_uint16_t_c(
             int d0 = p1 - p2;
             SD_sum += d0;
             SAD_sum += abs(d0);
-            row_SSD += d0 * d0;
+            row_SSD += (int64_t)d0 * d0;
             pos_D = max(pos_D, d0);
             neg_D = min(neg_D, d0);
         }
@@ -2907,7 +2932,7 @@ static void compare_uint16_t_c(uint64_t mask64, int increment,
             int d3 = (p1 >> 48) - (p2 >> 48);
             SD_sum += d0 + d1 + d2 + d3;
             SAD_sum += abs(d0) + abs(d1) + abs(d2) + abs(d3);
-            row_SSD += d0 * d0 + d1 * d1 + d2 * d2 + d3 * d3;
+            row_SSD += (int64_t)d0 * d0 + (int64_t)d1 * d1 + (int64_t)d2 * d2 + (int64_t)d3 * d3;
             pos_D = max(max(max(max(pos_D, d0), d1), d2), d3);
             neg_D = min(min(min(min(neg_D, d0), d1), d2), d3);
         }
@@ -2936,6 +2961,15 @@ PVideoFrame __stdcall Compare::GetFrame(int n, IScriptEnvironment* env)
 
   const int incr = (vi.IsRGB24() || vi.IsRGB48()) ? 3 : 4;
 
+  const int max_pixel_value = (1 << bits_per_pixel) - 1;
+  const double factor = (double)(max_pixel_value);
+
+  // frame property values: one entry per compared plane,
+  // packed formats report the selected channels together as a single entry
+  int stat_count = 0;
+  double stat_MAD[4], stat_MD[4], stat_PSNR[4];
+  int64_t stat_pos_D[4], stat_neg_D[4];
+
   if (vi.IsRGB24() || vi.IsYUY2() || vi.IsRGB32() || vi.IsRGB48() || vi.IsRGB64()) {
 
     const BYTE* f1ptr = f1->GetReadPtr();
@@ -2989,18 +3023,31 @@ PVideoFrame __stdcall Compare::GetFrame(int n, IScriptEnvironment* env)
         const int rowsize = f1->GetRowSize(plane);
         const int height = f1->GetHeight(plane);
 
-        bytecount += (rowsize / pixelsize) * height;
+        const int plane_bytecount = (rowsize / pixelsize) * height;
+        bytecount += plane_bytecount;
+
+        int p_SD = 0;
+        int64_t p_SD_64 = 0;
+        int p_SAD = 0;
+        int64_t p_SAD_64 = 0;
+        int p_pos_D = 0;
+        int p_neg_D = 0;
+        double p_SSD = 0;
 #ifdef INTEL_INTRINSICS
 
         if ((pixelsize == 1) && (rowsize % 16 == 0) && (env->GetCPUFlags() & CPUF_SSE2))
         {
-          compare_sse2(mask, incr, f1ptr, pitch1, f2ptr, pitch2, rowsize, height, SAD, SD, pos_D, neg_D, SSD);
+          compare_sse2(mask, incr, f1ptr, pitch1, f2ptr, pitch2, rowsize, height, p_SAD, p_SD, p_pos_D, p_neg_D, p_SSD);
+        }
+        else if ((pixelsize == 2) && (env->GetCPUFlags() & CPUF_SSE4_1))
+        {
+          compare_planar_uint16_sse41(f1ptr, pitch1, f2ptr, pitch2, rowsize, height, p_SAD_64, p_SD_64, p_pos_D, p_neg_D, p_SSD);
         }
         else
 #ifdef X86_32
           if ((pixelsize == 1) && (rowsize % 8 == 0) && (env->GetCPUFlags() & CPUF_INTEGER_SSE))
           {
-            compare_isse(mask, incr, f1ptr, pitch1, f2ptr, pitch2, rowsize, height, SAD, SD, pos_D, neg_D, SSD);
+            compare_isse(mask, incr, f1ptr, pitch1, f2ptr, pitch2, rowsize, height, p_SAD, p_SD, p_pos_D, p_neg_D, p_SSD);
           }
           else
 #endif
@@ -3008,10 +3055,25 @@ PVideoFrame __stdcall Compare::GetFrame(int n, IScriptEnvironment* env)
           {
 
             if (pixelsize == 1)
-              compare_planar_c(f1ptr, pitch1, f2ptr, pitch2, rowsize, height, SAD, SD, pos_D, neg_D, SSD);
+              compare_planar_c(f1ptr, pitch1, f2ptr, pitch2, rowsize, height, p_SAD, p_SD, p_pos_D, p_neg_D, p_SSD);
             else
-              compare_planar_uint16_t_c(f1ptr, pitch1, f2ptr, pitch2, rowsize, height, SAD_64, SD_64, pos_D, neg_D, SSD);
+              compare_planar_uint16_t_c(f1ptr, pitch1, f2ptr, pitch2, rowsize, height, p_SAD_64, p_SD_64, p_pos_D, p_neg_D, p_SSD);
           }
+
+        SD += p_SD;
+        SD_64 += p_SD_64;
+        SAD += p_SAD;
+        SAD_64 += p_SAD_64;
+        pos_D = max(pos_D, p_pos_D);
+        neg_D = min(neg_D, p_neg_D);
+        SSD += p_SSD;
+
+        stat_MAD[stat_count] = ((pixelsize == 1) ? (double)p_SAD : (double)p_SAD_64) / plane_bytecount;
+        stat_MD[stat_count] = ((pixelsize == 1) ? (double)p_SD : (double)p_SD_64) / plane_bytecount;
+        stat_PSNR[stat_count] = 10.0 * log10(plane_bytecount * factor * factor / (p_SSD == 0.0 ? 1.0 : p_SSD));
+        stat_pos_D[stat_count] = p_pos_D;
+        stat_neg_D[stat_count] = p_neg_D;
+        stat_count++;
       }
     }
   }
@@ -3019,10 +3081,17 @@ PVideoFrame __stdcall Compare::GetFrame(int n, IScriptEnvironment* env)
   double MAD = ((pixelsize==1) ? (double)SAD : (double)SAD_64) / bytecount;
   double MD = ((pixelsize==1) ? (double)SD : (double)SD_64) / bytecount;
   if (SSD == 0.0) SSD = 1.0;
-  const int max_pixel_value = (1 << bits_per_pixel) - 1;
-  double factor = (double)(max_pixel_value);
   double PSNR = 10.0 * log10(bytecount * factor * factor / SSD);
 
+  if (stat_count == 0) {
+    stat_MAD[0] = MAD;
+    stat_MD[0] = MD;
+    stat_PSNR[0] = PSNR;
+    stat_pos_D[0] = pos_D;
+    stat_neg_D[0] = neg_D;
+    stat_count = 1;
+  }
+
   framecount++;
   if (framecount == 1) {
     MAD_min = MAD_tot = MAD_max = MAD;
@@ -3049,7 +3118,7 @@ PVideoFrame __stdcall Compare::GetFrame(int n, IScriptEnvironment* env)
       fprintf(log,"%6u  %8.4f  %+9.4f  %3d    %3d    %8.4f\n", (unsigned int)n, MAD, MD, pos_D, neg_D, PSNR);
     else
       fprintf(log,"%6u  %11.4f  %+12.4f  %7d    %7d    %8.4f\n", (unsigned int)n, MAD, MD, pos_D, neg_D, PSNR);
-  } else {
+  } else if (show) {
     env->MakeWritable(&f1);
     BYTE* dstp = f1->GetWritePtr();
     int dst_pitch = f1->GetPitch();
@@ -3238,6 +3307,15 @@ PVideoFrame __stdcall Compare::GetFrame(int n, IScriptEnvironment* env)
     } // show_graph
   } // no logfile
 
+  // without show the frame of the first clip is passed untouched, only its properties are new
+  env->MakePropertyWritable(&f1);
+  AVSMap* props = env->getFramePropsRW(f1);
+  env->propSetFloatArray(props, "CompareMAD", stat_MAD, stat_count);
+  env->propSetFloatArray(props, "CompareMD", stat_MD, stat_count);
+  env->propSetFloatArray(props, "ComparePSNR", stat_PSNR, stat_count);
+  env->propSetIntArray(props, "CompareMaxPosDev", stat_pos_D, stat_count);
+  env->propSetIntArray(props, "CompareMaxNegDev", stat_neg_D, stat_count);
+
   return f1;
 }
 
@@ -3302,7 +3380,7 @@ bool GetTextBoundingBox( const char* text, const char* fontname, int size, bool
 bool GetTextBoundingBoxFixed(const char* text, const char* fontname, int size, bool bold,
   bool italic, int align, int& width, int& height, bool utf8)
 {
-  std::unique_ptr<BitmapFont> current_font;
+  std::shared_ptr<BitmapFont> current_font;
   /*
   if (*font_filename) {
     // external font file
@@ -3372,7 +3450,7 @@ void ApplyMessage( PVideoFrame* frame, const VideoInfo& vi, const char* message,
   antialiaser.Apply(vi, frame, (*frame)->GetPitch());
   }
 #else
-  std::unique_ptr<BitmapFont> current_font;
+  std::shared_ptr<BitmapFont> current_font;
 
   size = size / 8; // size comes in GDI units (*8)
 
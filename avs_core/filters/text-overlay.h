@@ -118,7 +118,7 @@ private:
 #if defined(AVS_WINDOWS) && !defined(NO_WIN_GDI)
   Antialiaser antialiaser;
 #else
-  std::unique_ptr<BitmapFont> current_font;
+  std::shared_ptr<BitmapFont> current_font;
   int chromaplacement;
 #endif
   const bool scroll;
@@ -156,7 +156,7 @@ private:
 #if defined(AVS_WINDOWS) && !defined(NO_WIN_GDI)
   Antialiaser antialiaser;
 #else
-  std::unique_ptr<BitmapFont> current_font;
+  std::shared_ptr<BitmapFont> current_font;
   int chromaplacement;
 #endif
   const bool scroll;
@@ -193,7 +193,7 @@ private:
 #if defined(AVS_WINDOWS) && !defined(NO_WIN_GDI)
   Antialiaser antialiaser;
 #else
-  std::unique_ptr<BitmapFont> current_font;
+  std::shared_ptr<BitmapFont> current_font;
   int chromaplacement;
 #endif
   int rate;
@@ -284,7 +284,7 @@ private:
   const bool utf8;
   const bool bold;
   const int chromalocation;
-  std::unique_ptr<BitmapFont> current_font;
+  std::shared_ptr<BitmapFont> current_font;
 };
 
 class FilterInfo : public GenericVideoFilter
@@ -293,7 +293,7 @@ class FilterInfo : public GenericVideoFilter
  **/
 {
 public:
-  FilterInfo( PClip _child, const char _fontname[], int _size, int _textcolor, int _halocolor, bool _bold, bool _italic, bool _noaa, bool _cpu, int _x, int _y, int _align, IScriptEnvironment* env);
+  FilterInfo( PClip _child, const char _fontname[], int _size, int _textcolor, int _halocolor, bool _bold, bool _italic, bool _noaa, bool _cpu, int _x, int _y, int _align, bool _perf, IScriptEnvironment* env);
   virtual ~FilterInfo(void);
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
   bool __stdcall GetParity(int n) override;
@@ -317,7 +317,7 @@ private:
 #if defined(AVS_WINDOWS) && !defined(NO_WIN_GDI)
   Antialiaser antialiaser;
 #else
-  std::unique_ptr<BitmapFont> current_font;
+  std::shared_ptr<BitmapFont> current_font;
   int chromaplacement;
 #endif
   [[maybe_unused]] const bool bold;
@@ -326,6 +326,7 @@ private:
   const bool cpu;
   const int x, y;
   const int align;
+  const bool perf;
 };
 
 
@@ -335,7 +336,7 @@ class Compare : public GenericVideoFilter
  **/
 {
 public:
-  Compare(PClip _child1, PClip _child2, const char* channels, const char *fname, bool _show_graph, IScriptEnvironment* env);
+  Compare(PClip _child1, PClip _child2, const char* channels, const char *fname, bool _show_graph, bool _show, IScriptEnvironment* env);
   ~Compare();
   static AVSValue __cdecl Create(AVSValue args, void* , IScriptEnvironment* env);
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
@@ -355,7 +356,7 @@ private:
 #if defined(AVS_WINDOWS) && !defined(NO_WIN_GDI)
   Antialiaser antialiaser;
 #else
-  std::unique_ptr<BitmapFont> current_font;
+  std::shared_ptr<BitmapFont> current_font;
   int chromaplacement;
 #endif
   PClip child2;
@@ -365,6 +366,7 @@ private:
   FILE* log;
   int* psnrs;
   bool show_graph;
+  bool show; // false: statistics go to frame properties (and logfile) only
   double PSNR_min, PSNR_tot, PSNR_max;
   double MAD_min, MAD_tot, MAD_max;
   double MD_min, MD_tot, MD_max;
@@ -41,18 +41,22 @@
 #include "turn.h"
 #ifdef INTEL_INTRINSICS
 #include "intel/turn_sse.h"
+#include "intel/turn_avx2.h"
 #endif
 #include "resample.h"
 #include "planeswap.h"
 #include "../core/internal.h"
+#include "../core/InternalEnvironment.h"
 #include <stdint.h>
+#include <vector>
+#include <avs/minmax.h>
 #include "../convert/convert_helper.h"
 
 
 extern const AVSFunction Turn_filters[] = {
-    { "TurnLeft",  BUILTIN_FUNC_PREFIX, "c", Turn::create_turnleft },
-    { "TurnRight", BUILTIN_FUNC_PREFIX, "c", Turn::create_turnright },
-    { "Turn180",   BUILTIN_FUNC_PREFIX, "c", Turn::create_turn180 },
+    { "TurnLeft",  BUILTIN_FUNC_PREFIX, "c[crop_left]i[crop_top]i[crop_width]i[crop_height]i", Turn::create_turnleft },
+    { "TurnRight", BUILTIN_FUNC_PREFIX, "c[crop_left]i[crop_top]i[crop_width]i[crop_height]i", Turn::create_turnright },
+    { "Turn180",   BUILTIN_FUNC_PREFIX, "c[crop_left]i[crop_top]i[crop_width]i[crop_height]i", Turn::create_turn180 },
     { 0 }
 };
 
@@ -259,7 +263,8 @@ static void turn_180_yuy2(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src
 }
 
 
-Turn::Turn(PClip c, int direction, IScriptEnvironment* env) : GenericVideoFilter(c), u_or_b_source(nullptr), v_or_r_source(nullptr)
+Turn::Turn(PClip c, int direction, int _crop_left, int _crop_top, int _crop_width, int _crop_height, IScriptEnvironment* env)
+  : GenericVideoFilter(c), u_or_b_source(nullptr), v_or_r_source(nullptr)
 {
     if (vi.pixel_type & VideoInfo::CS_INTERLEAVED) {
         num_planes = 1;
@@ -301,6 +306,49 @@ Turn::Turn(PClip c, int direction, IScriptEnvironment* env) : GenericVideoFilter
         vi.height = t;
     }
 
+    // Crop of the turned picture (Crop syntax): only the covered source area is turned
+    if (_crop_left < 0 || _crop_top < 0)
+        env->ThrowError("Turn: crop_left and crop_top must not be negative.");
+    if (_crop_width <= 0)
+        _crop_width = vi.width - _crop_left + _crop_width;
+    if (_crop_height <= 0)
+        _crop_height = vi.height - _crop_top + _crop_height;
+    if (_crop_width <= 0 || _crop_height <= 0)
+        env->ThrowError("Turn: crop destination size is 0 or less.");
+    if (_crop_left + _crop_width > vi.width || _crop_top + _crop_height > vi.height)
+        env->ThrowError("Turn: crop area is outside of the turned picture.");
+
+    int xmask = 0, ymask = 0;
+    if (vi.IsYUY2()) {
+        // source lines are processed in pairs when turning left or right
+        xmask = 1;
+        ymask = direction != DIRECTION_180 ? 1 : 0;
+    }
+    else if ((vi.IsYUV() || vi.IsYUVA()) && num_planes > 1) {
+        xmask = (1 << vi.GetPlaneWidthSubsampling(PLANAR_U)) - 1;
+        ymask = (1 << vi.GetPlaneHeightSubsampling(PLANAR_U)) - 1;
+    }
+    if ((_crop_left | _crop_width) & xmask)
+        env->ThrowError("Turn: crop_left and crop_width must be MOD %d.", xmask + 1);
+    if ((_crop_top | _crop_height) & ymask)
+        env->ThrowError("Turn: crop_top and crop_height must be MOD %d.", ymask + 1);
+
+    const bool packed_rgb = vi.IsRGB() && !vi.IsPlanar();
+    plane_direction = direction;
+    if (packed_rgb && direction != DIRECTION_180) {
+        // RGB is upside-down, TurnLeft and TurnRight are reversed in memory
+        plane_direction = direction == DIRECTION_LEFT ? DIRECTION_RIGHT : DIRECTION_LEFT;
+    }
+    if (packed_rgb)
+        _crop_top = vi.height - _crop_height - _crop_top;
+
+    crop_left = _crop_left;
+    crop_top = _crop_top;
+    vi.width = _crop_width;
+    vi.height = _crop_height;
+
+    unit_size = (vi.pixel_type & VideoInfo::CS_INTERLEAVED) ? vi.BytesFromPixels(1) : vi.ComponentSize();
+
     SetTurnFunction(direction, env);
 }
 
@@ -340,6 +388,7 @@ void Turn::SetTurnFunction(int direction, IScriptEnvironment* env)
   const int cpu = env->GetCPUFlags();
   const bool sse2 = cpu & CPUF_SSE2;
   const bool ssse3 = cpu & CPUF_SSSE3;
+  const bool avx2 = cpu & CPUF_AVX2;
 #endif
 
   TurnFuncPtr funcs[3];
@@ -352,7 +401,9 @@ void Turn::SetTurnFunction(int direction, IScriptEnvironment* env)
   if (vi.IsRGB64())
   {
 #ifdef INTEL_INTRINSICS
-    if (sse2)
+    if (avx2)
+      set_funcs(turn_left_rgb64_avx2, turn_right_rgb64_avx2, turn_180_plane_avx2<uint64_t>);
+    else if (sse2)
       set_funcs(turn_left_rgb64_sse2, turn_right_rgb64_sse2, turn_180_plane_sse2<uint64_t>);
     else
 #endif
@@ -368,7 +419,9 @@ void Turn::SetTurnFunction(int direction, IScriptEnvironment* env)
   else if (vi.IsRGB32())
   {
 #ifdef INTEL_INTRINSICS
-    if (sse2)
+    if (avx2)
+      set_funcs(turn_left_rgb32_avx2, turn_right_rgb32_avx2, turn_180_plane_avx2<uint32_t>);
+    else if (sse2)
       set_funcs(turn_left_rgb32_sse2, turn_right_rgb32_sse2, turn_180_plane_sse2<uint32_t>);
     else
 #endif
@@ -387,7 +440,11 @@ void Turn::SetTurnFunction(int direction, IScriptEnvironment* env)
   else if (vi.ComponentSize() == 1) // 8 bit
   {
 #ifdef INTEL_INTRINSICS
-    if (sse2)
+    if (avx2)
+    {
+      set_funcs(turn_left_plane_8_avx2, turn_right_plane_8_avx2, turn_180_plane_avx2<BYTE>);
+    }
+    else if (sse2)
     {
       set_funcs(turn_left_plane_8_sse2, turn_right_plane_8_sse2,
         ssse3 ? turn_180_plane_ssse3<BYTE> : turn_180_plane_sse2<BYTE>);
@@ -401,7 +458,11 @@ void Turn::SetTurnFunction(int direction, IScriptEnvironment* env)
   else if (vi.ComponentSize() == 2) // 16 bit
   {
 #ifdef INTEL_INTRINSICS
-    if (sse2)
+    if (avx2)
+    {
+      set_funcs(turn_left_plane_16_avx2, turn_right_plane_16_avx2, turn_180_plane_avx2<uint16_t>);
+    }
+    else if (sse2)
     {
       set_funcs(turn_left_plane_16_sse2, turn_right_plane_16_sse2,
         ssse3 ? turn_180_plane_ssse3<uint16_t> : turn_180_plane_sse2<uint16_t>);
@@ -416,7 +477,10 @@ void Turn::SetTurnFunction(int direction, IScriptEnvironment* env)
   else if (vi.ComponentSize() == 4) // 32 bit
   {
 #ifdef INTEL_INTRINSICS
-    if (sse2) {
+    if (avx2) {
+      set_funcs(turn_left_plane_32_avx2, turn_right_plane_32_avx2, turn_180_plane_avx2<uint32_t>);
+    }
+    else if (sse2) {
       set_funcs(turn_left_plane_32_sse2, turn_right_plane_32_sse2, turn_180_plane_sse2<uint32_t>);
     }
     else
@@ -439,6 +503,23 @@ int __stdcall Turn::SetCacheHints(int cachehints, int frame_range)
 }
 
 
+// one rectangle of one plane, turned by one job
+struct TurnJob {
+    TurnFuncPtr turn_function;
+    const BYTE* srcp;
+    BYTE* dstp;
+    int src_rowsize, src_height, src_pitch, dst_pitch;
+};
+
+
+static AVSValue __cdecl turn_job(IScriptEnvironment2*, void* data)
+{
+    const TurnJob* job = static_cast<const TurnJob*>(data);
+    job->turn_function(job->srcp, job->dstp, job->src_rowsize, job->src_height, job->src_pitch, job->dst_pitch);
+    return AVSValue();
+}
+
+
 PVideoFrame __stdcall Turn::GetFrame(int n, IScriptEnvironment* env)
 {
     const int dplanes[] = {
@@ -458,12 +539,77 @@ PVideoFrame __stdcall Turn::GetFrame(int n, IScriptEnvironment* env)
         src,
     };
 
+    // Large frames requested outside of Prefetch (e.g. single frame access or a
+    // serial chain) are split into stripes of the turned picture and turned by the
+    // thread pool; under Prefetch the frames themselves already run in parallel.
+    int stripes = 1;
+    InternalEnvironment* IEnv = GetAndRevealCamouflagedEnv(env);
+    if ((size_t)vi.RowSize() * vi.height >= 2 * 1024 * 1024 && IEnv->GetEnvProperty(AEP_THREAD_ID) == 0)
+        stripes = (int)min<size_t>(IEnv->GetEnvProperty(AEP_THREADPOOL_THREADS), 8);
+
+    std::vector<TurnJob> jobs;
+    jobs.reserve(num_planes * stripes);
+
     for (int p = 0; p < num_planes; ++p) {
         const int splane = splanes[p];
         const int dplane = dplanes[p];
-        turn_function(srcs[p]->GetReadPtr(splane), dst->GetWritePtr(dplane),
-                      srcs[p]->GetRowSize(splane), srcs[p]->GetHeight(splane),
-                      srcs[p]->GetPitch(splane), dst->GetPitch(dplane));
+        const bool chroma = (vi.IsYUV() || vi.IsYUVA()) && vi.IsPlanar() && (p == 1 || p == 2);
+        const int xs = chroma ? vi.GetPlaneWidthSubsampling(dplane) : 0;
+        const int ys = chroma ? vi.GetPlaneHeightSubsampling(dplane) : 0;
+
+        // source plane and the crop, in units (pixels or components) and lines of this plane
+        const int src_width = srcs[p]->GetRowSize(splane) / unit_size;
+        const int src_height = srcs[p]->GetHeight(splane);
+        const int cl = crop_left >> xs;
+        const int ct = crop_top >> ys;
+        const int cw = dst->GetRowSize(dplane) / unit_size;
+        const int ch = dst->GetHeight(dplane);
+
+        // left and right turns are split along the destination columns (source lines),
+        // Turn180 along the lines
+        const int split_size = plane_direction == DIRECTION_180 ? ch : cw;
+        const int stripe_size = stripes > 1 ? ((split_size + stripes - 1) / stripes + 63) & ~63 : split_size;
+
+        for (int start = 0; start < split_size; start += stripe_size) {
+            const int len = min(stripe_size, split_size - start);
+            // destination rectangle inside the cropped frame
+            const int ox = plane_direction == DIRECTION_180 ? 0 : start;
+            const int oy = plane_direction == DIRECTION_180 ? start : 0;
+            const int ow = plane_direction == DIRECTION_180 ? cw : len;
+            const int oh = plane_direction == DIRECTION_180 ? len : ch;
+            const int x = cl + ox, y = ct + oy;
+
+            // source rectangle which turns into it
+            int sx, sy, sw, sh;
+            if (plane_direction == DIRECTION_RIGHT) {
+                sx = y; sy = src_height - x - ow; sw = oh; sh = ow;
+            }
+            else if (plane_direction == DIRECTION_LEFT) {
+                sx = src_width - y - oh; sy = x; sw = oh; sh = ow;
+            }
+            else {
+                sx = src_width - x - ow; sy = src_height - y - oh; sw = ow; sh = oh;
+            }
+
+            const int src_pitch = srcs[p]->GetPitch(splane);
+            const int dst_pitch = dst->GetPitch(dplane);
+            jobs.push_back({ turn_function,
+                srcs[p]->GetReadPtr(splane) + sy * src_pitch + sx * unit_size,
+                dst->GetWritePtr(dplane) + oy * dst_pitch + ox * unit_size,
+                sw * unit_size, sh, src_pitch, dst_pitch });
+        }
+    }
+
+    if (stripes > 1) {
+        IJobCompletion* completion = IEnv->NewCompletion(jobs.size());
+        for (auto& job : jobs)
+            IEnv->ParallelJob(turn_job, &job, completion);
+        completion->Wait();
+        completion->Destroy();
+    }
+    else {
+        for (const auto& job : jobs)
+            job.turn_function(job.srcp, job.dstp, job.src_rowsize, job.src_height, job.src_pitch, job.dst_pitch);
     }
 
     return dst;
@@ -472,17 +618,17 @@ PVideoFrame __stdcall Turn::GetFrame(int n, IScriptEnvironment* env)
 
 AVSValue __cdecl Turn::create_turnleft(AVSValue args, void* , IScriptEnvironment* env)
 {
-    return new Turn(args[0].AsClip(), DIRECTION_LEFT, env);
+    return new Turn(args[0].AsClip(), DIRECTION_LEFT, args[1].AsInt(0), args[2].AsInt(0), args[3].AsInt(0), args[4].AsInt(0), env);
 }
 
 
 AVSValue __cdecl Turn::create_turnright(AVSValue args, void* , IScriptEnvironment* env)
 {
-    return new Turn(args[0].AsClip(), DIRECTION_RIGHT, env);
+    return new Turn(args[0].AsClip(), DIRECTION_RIGHT, args[1].AsInt(0), args[2].AsInt(0), args[3].AsInt(0), args[4].AsInt(0), env);
 }
 
 
 AVSValue __cdecl Turn::create_turn180(AVSValue args, void* , IScriptEnvironment* env)
 {
-    return new Turn(args[0].AsClip(), DIRECTION_180, env);
+    return new Turn(args[0].AsClip(), DIRECTION_180, args[1].AsInt(0), args[2].AsInt(0), args[3].AsInt(0), args[4].AsInt(0), env);
 }
@@ -48,12 +48,16 @@ class Turn : public GenericVideoFilter {
     int num_planes;
     int splanes[4];
 
+    int plane_direction; // direction in memory: left and right are swapped for bottom-up packed RGB
+    int crop_left, crop_top; // fused crop, in memory rows
+    int unit_size; // bytes of a pixel (packed) or of a component (planar)
+
     void SetUVSource(int mul_h, int mul_v, IScriptEnvironment* env);
     void SetTurnFunction(int direction, IScriptEnvironment* env);
 
 
 public:
-    Turn(PClip _child, int direction, IScriptEnvironment* env);
+    Turn(PClip _child, int direction, int _crop_left, int _crop_top, int _crop_width, int _crop_height, IScriptEnvironment* env);
 
     PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
     int __stdcall SetCacheHints(int cachehints, int frame_range) override;
@@ -84,4 +88,39 @@ void turn_right_plane_c(const BYTE* srcp, BYTE* dstp, int src_rowsize, int heigh
 template <typename T>
 void turn_180_plane_c(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch);
 
+// Cache blocked driver for the SIMD TurnRight kernels.
+// kernel(s, d, src_pitch, dst_pitch) transposes a block of block_cols x block_rows
+// pixels: s is the top-left source pixel, d the leftmost destination pixel of the
+// first destination row (which receives the bottom source row first).
+// The plane is walked in bands of source lines giving 256 bytes of every destination
+// line, so each destination line (and its TLB entry) is visited once per band and
+// the source lines of the band stay in L1.
+// Columns and rows which do not fill a block are done by turn_c.
+template <int pixel_size, int block_cols, int block_rows, typename Kernel>
+static AVS_FORCEINLINE void turn_right_plane_tiled(const BYTE* srcp, BYTE* dstp, int src_rowsize, int src_height, int src_pitch, int dst_pitch,
+  Kernel kernel, TurnFuncPtr turn_c)
+{
+  constexpr int block_bytes = pixel_size * block_cols;
+  constexpr int band_rows = (256 / pixel_size) > block_rows ? (256 / pixel_size) : block_rows;
+  const int w = src_rowsize / block_bytes * block_bytes;
+  const int h = src_height / block_rows * block_rows;
+
+  for (int band = 0; band < h; band += band_rows)
+  {
+    const int band_end = (band + band_rows) < h ? band + band_rows : h;
+    for (int x = 0; x < w; x += block_bytes)
+    {
+      BYTE* d0 = dstp + (x / pixel_size) * dst_pitch;
+      for (int y = band; y < band_end; y += block_rows)
+        kernel(srcp + y * src_pitch + x, d0 + (src_height - y - block_rows) * pixel_size, src_pitch, dst_pitch);
+    }
+  }
+
+  if (src_rowsize != w)
+    turn_c(srcp + w, dstp + (w / pixel_size) * dst_pitch, src_rowsize - w, src_height, src_pitch, dst_pitch);
+
+  if (src_height != h)
+    turn_c(srcp + h * src_pitch, dstp, w, src_height - h, src_pitch, dst_pitch);
+}
+
 #endif  // _AVS_TURN_H
@@ -54,6 +54,9 @@
 //           - New propSetDataH, like propSetData but with optional data type hint (byte/string)
 //             (VSAPI4: mapSetData, our propSetData became VSAPI4: mapSetData3)
 // 20250415  V11.1 Fix AVS_Value 64 bit data member declaration for 64-bit non Intel (other than X86_X64) systems.
+// 20261019  V11.2 NewVideoFrameFromBuffer: VideoFrame on memory owned by the caller (zero-copy import)
+// 20261019  V11.3 GetEnvProperty: AEP_FRAMES_DELIVERED .. AEP_MEMORY_HUGE_PAGES performance counter and memory queries
+// 20261019  V11.4 C interface only: asynchronous frame requests (avs_request_frame etc., see avisynth_c.h)
 
 // http://avisynth.nl
 
@@ -125,7 +128,7 @@ enum AvsVersion {
   AVISYNTH_CLASSIC_INTERFACE_VERSION_26BETA = 5,
   AVISYNTH_CLASSIC_INTERFACE_VERSION = 6,
   AVISYNTH_INTERFACE_VERSION = 11,
-  AVISYNTHPLUS_INTERFACE_BUGFIX_VERSION = 1 // reset to zero whenever the normal interface version bumps
+  AVISYNTHPLUS_INTERFACE_BUGFIX_VERSION = 4 // reset to zero whenever the normal interface version bumps
 };
 
 /* Compiler-specific crap */
@@ -1013,6 +1016,9 @@ class VideoFrameBuffer {
   // AVS+CUDA extension, does not break plugins if appended here
   Device* device;
 
+  // AVS+ extension: nonzero if data is owned by the host (NewVideoFrameFromBuffer), 2: read-only
+  int external;
+
 protected:
   VideoFrameBuffer(int size, int margin, Device* device);
   VideoFrameBuffer();
@@ -1238,6 +1244,10 @@ enum CachePolicyHint {
   // By returning IS_MTGUARD_ANS to IS_MTGUARD_REQ, we tell the caller we are an mt guard
   CACHE_IS_MTGUARD_REQ,
   CACHE_IS_MTGUARD_ANS,
+  // By returning AUDIO_PLANAR_ANS to AUDIO_PLANAR_REQ, a core filter tells the caller
+  // that it can deliver non-interleaved audio (core-internal IAudioPlanar interface)
+  CACHE_GET_AUDIO_PLANAR_REQ,
+  CACHE_GET_AUDIO_PLANAR_ANS,
 
   CACHE_AVSPLUS_CUDA_CONSTANTS = 600,
 
@@ -1538,6 +1548,19 @@ enum AvsEnvProperty {
 
   AEP_SUPPRESS_THREAD = 921,
   AEP_GETFRAME_RECURSIVE = 922,
+
+  // V11.3 (check AEP_INTERFACE_BUGFIX >= 3)
+  // Performance counters, totals since the environment was created
+  AEP_FRAMES_DELIVERED = 941, // frames returned to the host
+  AEP_FRAME_TIME_P50 = 942,   // host frame request latency percentiles, microseconds
+  AEP_FRAME_TIME_P95 = 943,
+  AEP_FRAME_TIME_P99 = 944,
+  AEP_CACHE_HITS = 945,
+  AEP_CACHE_MISSES = 946,
+  AEP_THREADPOOL_QUEUE = 947, // jobs waiting for a worker thread, all pools
+  AEP_MEMORY_USED = 948,      // frame buffer bytes on the current device
+  AEP_MEMORY_MAX = 949,       // SetMemoryMax limit of the current device, bytes
+  AEP_MEMORY_HUGE_PAGES = 950, // frame buffer bytes in huge pages on the current device (SetHugePages)
 };
 
 // IScriptEnvironment::Allocate()
@@ -1714,6 +1737,15 @@ public:
   virtual int __stdcall propGetDataTypeHint(const AVSMap* map, const char* key, int index, int* error) = 0; // returns AVSPropDataTypeHint
   virtual int __stdcall propSetDataH(AVSMap* map, const char* key, const char* d, int length, int type, int append) = 0;
 
+  // V11.2 (check AEP_INTERFACE_BUGFIX >= 2)
+  // Frame on planes in memory owned by the caller, no copy. planes and pitches: Y,U,V,A or G,B,R,A
+  // (or the only plane of packed formats), aligned to FRAME_ALIGN. 'release' is called once the frame
+  // and all frames made from it are released, until then the memory must stay valid.
+  // Not writable: MakeWritable makes a copy instead of writing into the buffer.
+  typedef void (__cdecl *ExternalReleaseFunc)(void* user_data);
+  virtual PVideoFrame __stdcall NewVideoFrameFromBuffer(const VideoInfo& vi, BYTE* const* planes, const int* pitches,
+    ExternalReleaseFunc release, void* user_data, bool writable) = 0;
+
 }; // end class IScriptEnvironment. Order is important. Avoid overloads with the same name.
 
 
@@ -1797,6 +1829,7 @@ public:
   typedef IScriptEnvironment::NotFound NotFound;
   typedef IScriptEnvironment::ApplyFunc ApplyFunc;
   typedef IScriptEnvironment::ShutdownFunc ShutdownFunc;
+  typedef IScriptEnvironment::ExternalReleaseFunc ExternalReleaseFunc;
 
   virtual void __stdcall DeleteScriptEnvironment() = 0;
 
@@ -1931,6 +1964,9 @@ public:
   virtual int __stdcall propGetDataTypeHint(const AVSMap* map, const char* key, int index, int* error) = 0; /* returns AVSPropDataTypeHint */
   virtual int __stdcall propSetDataH(AVSMap* map, const char* key, const char* d, int length, int type, int append) = 0;
 
+  virtual PVideoFrame __stdcall NewVideoFrameFromBuffer(const VideoInfo& vi, BYTE* const* planes, const int* pitches,
+    ExternalReleaseFunc release, void* user_data, bool writable) = 0;
+
   virtual AVSMap* __stdcall createMap() = 0;
   virtual void __stdcall freeMap(AVSMap* map) = 0;
   virtual void __stdcall clearMap(AVSMap* map) = 0;
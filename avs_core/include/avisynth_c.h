@@ -130,6 +130,13 @@
 //         New avs_add_func_r: alternative avs_add_func which returns the result in a byref parameter
 //         New AVS_ApplyFuncR type
 // 20250415 V11.1 Fix AVS_Value 64 bit data member declaration for 64-bit non Intel (other than X86_X64) systems.
+// 20261019 V11.2 avs_new_video_frame_from_buffer, AVS_ExternalReleaseFunc (zero-copy frame on host memory)
+// 20261019 V11.3 Add enums AVS_AEP_FRAMES_DELIVERED .. AVS_AEP_MEMORY_USED performance counter and
+//         AVS_AEP_MEMORY_MAX, AVS_AEP_MEMORY_HUGE_PAGES memory queries (avs_get_env_property).
+//         Older cores return an error for them, check AVS_AEP_INTERFACE_BUGFIX >= 3.
+// 20261019 V11.4 Asynchronous frame requests: avs_request_frame, avs_get_frames_async, avs_wait_frame,
+//         avs_frame_request_ready, avs_frame_request_get_error, avs_release_frame_request, AVS_FrameCallback
+//         avs_render_file (RenderToFile: clip to y4m, raw, wav or w64 file)
 
 // Notes.
 // Choose either method:
@@ -164,7 +171,7 @@
 enum {
   AVISYNTH_INTERFACE_CLASSIC_VERSION = 6,
   AVISYNTH_INTERFACE_VERSION = 11,
-  AVISYNTHPLUS_INTERFACE_BUGFIX_VERSION = 1 // reset to zero whenever the normal interface version bumps
+  AVISYNTHPLUS_INTERFACE_BUGFIX_VERSION = 4 // reset to zero whenever the normal interface version bumps
 };
 #endif
 
@@ -506,6 +513,10 @@ enum {
   // By returning IS_MTGUARD_ANS to IS_MTGUARD_REQ, we tell the caller we are an mt guard
   AVS_CACHE_IS_MTGUARD_REQ = 512,
   AVS_CACHE_IS_MTGUARD_ANS = 513,
+  // By returning AUDIO_PLANAR_ANS to AUDIO_PLANAR_REQ, a core filter tells the caller
+  // that it can deliver non-interleaved audio (core-internal)
+  AVS_CACHE_GET_AUDIO_PLANAR_REQ = 514,
+  AVS_CACHE_GET_AUDIO_PLANAR_ANS = 515,
 
   AVS_CACHE_AVSPLUS_CUDA_CONSTANTS = 600,
 
@@ -570,7 +581,19 @@ enum {
   AVS_AEP_PLANE_ALIGN = 903,
 
   AVS_AEP_SUPPRESS_THREAD = 921,
-  AVS_AEP_GETFRAME_RECURSIVE = 922
+  AVS_AEP_GETFRAME_RECURSIVE = 922,
+
+  // Performance counters and memory statistics, V11.3
+  AVS_AEP_FRAMES_DELIVERED = 941,
+  AVS_AEP_FRAME_TIME_P50 = 942,
+  AVS_AEP_FRAME_TIME_P95 = 943,
+  AVS_AEP_FRAME_TIME_P99 = 944,
+  AVS_AEP_CACHE_HITS = 945,
+  AVS_AEP_CACHE_MISSES = 946,
+  AVS_AEP_THREADPOOL_QUEUE = 947,
+  AVS_AEP_MEMORY_USED = 948,
+  AVS_AEP_MEMORY_MAX = 949,
+  AVS_AEP_MEMORY_HUGE_PAGES = 950
 };
 
 // enum AvsAllocType for avs_allocate
@@ -1154,6 +1177,47 @@ AVSC_API(int, avs_get_version)(AVS_Clip *);
 AVSC_API(AVS_VideoFrame *, avs_get_frame)(AVS_Clip *, int n);
 // The returned video frame must be released with avs_release_video_frame
 
+// Asynchronous frame requests, V11.4.
+// Frames are produced on a worker thread of the core, the requests of a clip (and its copies)
+// are served in request order. With Prefetch at the end of the script the following frames
+// are computed in parallel meanwhile, so many frames can be in flight without client threads.
+// avs_get_frame on the same clip while requests are in flight is only allowed when the script
+// ends with Prefetch, otherwise wait for the pending requests first.
+typedef struct AVS_FrameRequest AVS_FrameRequest;
+
+// Called on the worker thread when the request is complete, also on error.
+// Requests still queued when the last copy of the clip is released complete with the error
+// "Frame request is cancelled", their callback is called on the releasing thread.
+// avs_wait_frame does not block here. Do not release the clip from the callback.
+typedef void (AVSC_CC * AVS_FrameCallback)(AVS_FrameRequest * request, void * user_data);
+
+AVSC_API(AVS_FrameRequest *, avs_request_frame)(AVS_Clip *, int n,
+                                                AVS_FrameCallback callback, void * user_data);
+// callback can be 0. Returns 0 on error, see avs_clip_get_error.
+// The returned request must be released with avs_release_frame_request
+
+AVSC_API(int, avs_get_frames_async)(AVS_Clip *, const int * frames, int count,
+                                    AVS_FrameRequest ** requests,
+                                    AVS_FrameCallback callback, void * user_data);
+// Requests count frames at once and fills requests[0..count-1].
+// Returns 0, or -1 on error (no request is made), see avs_clip_get_error.
+
+AVSC_API(AVS_VideoFrame *, avs_wait_frame)(AVS_FrameRequest *);
+// Waits for the request. Returns 0 on error, see avs_frame_request_get_error.
+// The returned video frame must be released with avs_release_video_frame
+
+AVSC_API(int, avs_frame_request_ready)(AVS_FrameRequest *); // 1 if complete, does not wait
+
+AVSC_API(const char *, avs_frame_request_get_error)(AVS_FrameRequest *); // return 0 if no error
+
+AVSC_API(void, avs_release_frame_request)(AVS_FrameRequest *);
+// A request which is not started yet is cancelled
+
+// V11.4: RenderToFile from the C interface.
+AVSC_API(double, avs_render_file)(AVS_Clip *, const char * filename, const char * format, int start, int end);
+// Renders the clip into a file like RenderToFile: format "y4m", "raw", "wav", "w64" or 0 (from the file extension),
+// end = -1: last frame. Returns frames per second (audio formats: realtime factor), -1 on error (avs_clip_get_error)
+
 AVSC_API(int, avs_get_parity)(AVS_Clip *, int n);
 // return field parity if field_based, else parity of first field in frame
 
@@ -1406,6 +1470,15 @@ AVSC_API(AVS_VideoFrame*, avs_new_video_frame_p)(AVS_ScriptEnvironment*,
 AVSC_API(AVS_VideoFrame*, avs_new_video_frame_p_a)(AVS_ScriptEnvironment*,
   const AVS_VideoInfo* vi, const AVS_VideoFrame* prop_src, int align);
 
+// V11.2: frame on planes owned by the caller, no copy.
+// planes/pitches: Y,U,V,A or G,B,R,A (only [0] for packed formats), aligned to AVS_FRAME_ALIGN.
+// release(user_data) is called once the frame and every frame made from it are released,
+// until then the memory must stay valid. writable == 0: MakeWritable copies instead.
+typedef void (AVSC_CC * AVS_ExternalReleaseFunc)(void * user_data);
+AVSC_API(AVS_VideoFrame*, avs_new_video_frame_from_buffer)(AVS_ScriptEnvironment*,
+  const AVS_VideoInfo* vi, BYTE* const* planes, const int* pitches,
+  AVS_ExternalReleaseFunc release, void* user_data, int writable);
+
 // Generic query to ask for various system properties, see AVS_AEP_xxx enums
 AVSC_API(size_t, avs_get_env_property)(AVS_ScriptEnvironment*, int avs_aep_prop);
 
@@ -1651,6 +1724,15 @@ struct AVS_Library {
   AVSC_DECLARE_FUNC(avs_val_is_string);
   AVSC_DECLARE_FUNC(avs_val_is_array);
   AVSC_DECLARE_FUNC(avs_val_is_error);
+  // asynchronous frame requests
+  AVSC_DECLARE_FUNC(avs_request_frame);
+  AVSC_DECLARE_FUNC(avs_get_frames_async);
+  AVSC_DECLARE_FUNC(avs_wait_frame);
+  AVSC_DECLARE_FUNC(avs_frame_request_ready);
+  AVSC_DECLARE_FUNC(avs_frame_request_get_error);
+  AVSC_DECLARE_FUNC(avs_release_frame_request);
+  AVSC_DECLARE_FUNC(avs_new_video_frame_from_buffer);
+  AVSC_DECLARE_FUNC(avs_render_file);
 };
 
 #undef AVSC_DECLARE_FUNC
@@ -1940,6 +2022,15 @@ avs_bits_per_component    constant 8 (8 bits/component)
   AVSC_LOAD_FUNC_OPT(avs_val_is_string);
   AVSC_LOAD_FUNC_OPT(avs_val_is_array);
   AVSC_LOAD_FUNC_OPT(avs_val_is_error);
+  // asynchronous frame requests
+  AVSC_LOAD_FUNC_OPT(avs_request_frame);
+  AVSC_LOAD_FUNC_OPT(avs_get_frames_async);
+  AVSC_LOAD_FUNC_OPT(avs_wait_frame);
+  AVSC_LOAD_FUNC_OPT(avs_frame_request_ready);
+  AVSC_LOAD_FUNC_OPT(avs_frame_request_get_error);
+  AVSC_LOAD_FUNC_OPT(avs_release_frame_request);
+  AVSC_LOAD_FUNC_OPT(avs_new_video_frame_from_buffer);
+  AVSC_LOAD_FUNC_OPT(avs_render_file);
 
 #undef __AVSC_STRINGIFY
 #undef AVSC_STRINGIFY
@@ -0,0 +1,103 @@
+// Avisynth+ shared memory frame server layout
+//
+// SharedMemoryServer(clip, name) publishes the frames of a clip into a named
+// shared memory block (POSIX shm_open "/name", Windows file mapping "name").
+// The block is a single producer / single consumer ring of slots; a consumer
+// process maps it and reads the planes in place, without pipes or copies.
+//
+// Protocol
+// - The block starts with AVS_ShmHeader, the slots begin at slots_offset, slot i
+//   (0 <= i < slot_count) at slots_offset + i * slot_size.
+// - write_index is incremented by the server after a slot is filled, read_index
+//   by the consumer after it is done with a slot. The next slot to read is
+//   read_index % slot_count, it is valid while read_index < write_index.
+//   Both are 64 bit counters, access them atomically (acquire load, release store).
+// - The consumer sets consumer_state to AVS_SHM_CONSUMER_ATTACHED when it starts
+//   and to AVS_SHM_CONSUMER_CLOSED when it quits early; the server stops then.
+// - state becomes AVS_SHM_STATE_END after the last frame, AVS_SHM_STATE_ERROR
+//   (see error[]) when rendering failed. Frames published before stay readable.
+//
+// Frame properties are serialized into the props area of the slot:
+//   uint32 number of keys, then per key: uint16 key length, key (no terminating 0),
+//   uint8 type ('i', 'f' or 's'), uint32 number of elements, then the elements:
+//   int64 ('i'), double ('f') or uint32 length + bytes ('s').
+// Clip and frame properties are not serialized. All values are in host byte order.
+
+#ifndef AVS_SHMSERVER_H
+#define AVS_SHMSERVER_H
+
+#include <stdint.h>
+
+#define AVS_SHM_MAGIC "AVSSHMF"
+#define AVS_SHM_VERSION 1
+
+enum {
+  AVS_SHM_STATE_RUNNING = 0,
+  AVS_SHM_STATE_END = 1,
+  AVS_SHM_STATE_ERROR = 2
+};
+
+enum {
+  AVS_SHM_CONSUMER_NONE = 0,
+  AVS_SHM_CONSUMER_ATTACHED = 1,
+  AVS_SHM_CONSUMER_CLOSED = 2
+};
+
+typedef struct AVS_ShmHeader {
+  // cache line 0, written by the server
+  char magic[8];                   // AVS_SHM_MAGIC
+  uint32_t version;                // AVS_SHM_VERSION
+  uint32_t header_size;            // sizeof(AVS_ShmHeader)
+  volatile uint64_t write_index;   // slots published
+  volatile int32_t state;          // AVS_SHM_STATE_xxx
+  uint32_t reserved0[9];
+
+  // cache line 1, written by the consumer
+  volatile uint64_t read_index;    // slots consumed
+  volatile int32_t consumer_state; // AVS_SHM_CONSUMER_xxx
+  uint32_t reserved1[13];
+
+  // stream description, constant
+  int32_t width;
+  int32_t height;
+  int32_t pixel_type;              // AVS_CS_xxx
+  int32_t image_type;
+  uint32_t fps_numerator;
+  uint32_t fps_denominator;
+  int32_t first_frame;             // clip frame number of the first published frame
+  int32_t num_frames;              // number of frames published in total
+  int32_t audio_samples_per_second; // 0: no audio
+  int32_t sample_type;             // AVS_SAMPLE_xxx
+  int32_t nchannels;
+  int32_t reserved2;
+  int64_t num_audio_samples;
+
+  // ring layout, constant
+  uint32_t slot_count;
+  uint32_t num_planes;             // planes in Y,U,V,A or G,B,R,A order, packed formats: 1
+  uint64_t slots_offset;           // from the start of the block
+  uint64_t slot_size;
+  uint32_t plane_offset[4];        // from the start of a slot
+  int32_t pitch[4];
+  int32_t row_size[4];             // bytes
+  int32_t plane_height[4];
+  uint32_t props_offset;           // from the start of a slot
+  uint32_t props_capacity;
+  uint32_t audio_offset;           // from the start of a slot
+  uint32_t audio_capacity;
+
+  char error[256];                 // AVS_SHM_STATE_ERROR message
+} AVS_ShmHeader;
+
+// at the start of each slot
+typedef struct AVS_ShmSlotHeader {
+  int32_t frame_number;            // clip frame number
+  uint32_t props_size;             // bytes used in the props area
+  int32_t props_truncated;         // 1: not all properties fit into props_capacity
+  uint32_t audio_bytes;            // bytes used in the audio area
+  int64_t audio_start;             // first audio sample belonging to the frame
+  int64_t audio_samples;
+  uint8_t reserved[32];
+} AVS_ShmSlotHeader;
+
+#endif // AVS_SHMSERVER_H
@@ -0,0 +1,224 @@
+/*
+ * SharedMemoryConsumer: minimal consumer of SharedMemoryServer, also usable as a test.
+ *
+ * Maps the shared memory block, checks the header and the ring indices, reads every
+ * published frame and optionally compares the planes with a raw file of the same clip
+ * made by RenderToFile(..., "raw"). Exit code 0 when all checks pass.
+ *
+ *   cc -I<avisynth include dir> SharedMemoryConsumer.c -o SharedMemoryConsumer (-lrt)
+ *   script served by any host: ... SharedMemoryServer("enc1")
+ *   SharedMemoryConsumer enc1 [reference.raw]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <avs/shmserver.h>
+
+#ifdef _WIN32
+  #include <windows.h>
+  #define sleep_ms(ms) Sleep(ms)
+#else
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #define sleep_ms(ms) usleep((ms) * 1000)
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+  /* MSVC: volatile accesses have acquire/release semantics (/volatile:ms) */
+  #define LOAD_ACQUIRE(p) (*(p))
+  #define STORE_RELEASE(p, v) (*(p) = (v))
+#endif
+
+static int failed = 0;
+
+static void fail(const char* what, long long a, long long b)
+{
+  fprintf(stderr, "FAIL: %s (%lld, %lld)\n", what, a, b);
+  failed = 1;
+}
+
+/* waits up to 10 seconds for the server to create the block */
+static uint8_t* map_block(const char* name, size_t* size)
+{
+  int i;
+#ifdef _WIN32
+  HANDLE mapping = NULL;
+  MEMORY_BASIC_INFORMATION info;
+  uint8_t* base;
+  for (i = 0; i < 1000 && mapping == NULL; i++) {
+    mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+    if (mapping == NULL)
+      sleep_ms(10);
+  }
+  if (mapping == NULL)
+    return NULL;
+  base = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+  CloseHandle(mapping);
+  if (base == NULL || VirtualQuery(base, &info, sizeof(info)) == 0)
+    return NULL;
+  *size = info.RegionSize;
+  return base;
+#else
+  char path[256];
+  int fd = -1;
+  struct stat st;
+  void* base;
+  snprintf(path, sizeof(path), "%s%s", name[0] == '/' ? "" : "/", name);
+  for (i = 0; i < 1000 && fd < 0; i++) {
+    fd = shm_open(path, O_RDWR, 0);
+    if (fd < 0)
+      sleep_ms(10);
+  }
+  if (fd < 0)
+    return NULL;
+  /* the server sizes the block right after creating it */
+  for (i = 0; i < 1000 && fstat(fd, &st) == 0 && st.st_size == 0; i++)
+    sleep_ms(10);
+  base = st.st_size > 0 ? mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (base == MAP_FAILED)
+    return NULL;
+  *size = (size_t)st.st_size;
+  return (uint8_t*)base;
+#endif
+}
+
+static void check_header(const AVS_ShmHeader* hdr, size_t size)
+{
+  uint32_t p;
+  if (hdr->version != AVS_SHM_VERSION)
+    fail("version", hdr->version, AVS_SHM_VERSION);
+  if (hdr->header_size != sizeof(AVS_ShmHeader))
+    fail("header_size", hdr->header_size, (long long)sizeof(AVS_ShmHeader));
+  if (hdr->num_planes < 1 || hdr->num_planes > 4)
+    fail("num_planes", hdr->num_planes, 4);
+  if (hdr->slot_count < 1 || hdr->num_frames < 1)
+    fail("slot_count, num_frames", hdr->slot_count, hdr->num_frames);
+  if (hdr->slots_offset < sizeof(AVS_ShmHeader) || hdr->slots_offset + hdr->slot_size * hdr->slot_count > size)
+    fail("slots outside the block", (long long)(hdr->slots_offset + hdr->slot_size * hdr->slot_count), (long long)size);
+  for (p = 0; p < hdr->num_planes && p < 4; p++) {
+    if (hdr->plane_offset[p] < sizeof(AVS_ShmSlotHeader) || hdr->pitch[p] < hdr->row_size[p] || hdr->plane_height[p] < 1 ||
+        hdr->plane_offset[p] + (uint64_t)hdr->pitch[p] * hdr->plane_height[p] > hdr->props_offset)
+      fail("plane layout", p, hdr->plane_offset[p]);
+  }
+  if (hdr->props_offset + (uint64_t)hdr->props_capacity > hdr->audio_offset ||
+      hdr->audio_offset + (uint64_t)hdr->audio_capacity > hdr->slot_size)
+    fail("props or audio area", hdr->audio_offset, (long long)hdr->slot_size);
+}
+
+int main(int argc, char** argv)
+{
+  size_t size = 0;
+  uint8_t* base;
+  AVS_ShmHeader* hdr;
+  FILE* reference = NULL;
+  uint8_t* row = NULL;
+  uint64_t r = 0;
+  int frames = 0;
+  int64_t audio_samples = 0;
+  int64_t audio_end = -1;
+  int i;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s name [reference.raw]\n", argv[0]);
+    return 2;
+  }
+  if (argc > 2 && (reference = fopen(argv[2], "rb")) == NULL) {
+    fprintf(stderr, "cannot open %s\n", argv[2]);
+    return 2;
+  }
+  base = map_block(argv[1], &size);
+  if (base == NULL || size < sizeof(AVS_ShmHeader)) {
+    fprintf(stderr, "cannot map shared memory %s\n", argv[1]);
+    return 2;
+  }
+  hdr = (AVS_ShmHeader*)base;
+
+  /* the server writes the magic last */
+  for (i = 0; i < 1000 && memcmp((const void*)hdr->magic, AVS_SHM_MAGIC, sizeof(hdr->magic)) != 0; i++)
+    sleep_ms(10);
+  if (memcmp((const void*)hdr->magic, AVS_SHM_MAGIC, sizeof(hdr->magic)) != 0) {
+    fprintf(stderr, "no SharedMemoryServer header in %s\n", argv[1]);
+    return 2;
+  }
+  check_header(hdr, size);
+  if (failed)
+    return 1;
+  STORE_RELEASE(&hdr->consumer_state, AVS_SHM_CONSUMER_ATTACHED);
+  if (reference) {
+    int32_t max_row = 0;
+    for (i = 0; i < (int)hdr->num_planes; i++)
+      if (hdr->row_size[i] > max_row)
+        max_row = hdr->row_size[i];
+    row = (uint8_t*)malloc((size_t)max_row);
+  }
+
+  for (;;) {
+    const uint64_t w = LOAD_ACQUIRE(&hdr->write_index);
+    const uint8_t* slot;
+    const AVS_ShmSlotHeader* slot_header;
+    uint32_t p;
+    int y;
+
+    if (w < r || w - r > hdr->slot_count)
+      fail("write_index out of the ring", (long long)w, (long long)r);
+    if (failed)
+      break;
+    if (r == w) {
+      /* state is set after the last write_index store, read the index again */
+      if (LOAD_ACQUIRE(&hdr->state) != AVS_SHM_STATE_RUNNING && LOAD_ACQUIRE(&hdr->write_index) == r)
+        break;
+      sleep_ms(1);
+      continue;
+    }
+
+    slot = base + hdr->slots_offset + (r % hdr->slot_count) * hdr->slot_size;
+    slot_header = (const AVS_ShmSlotHeader*)slot;
+    if (slot_header->frame_number != hdr->first_frame + frames)
+      fail("frame_number", slot_header->frame_number, hdr->first_frame + frames);
+    if (slot_header->props_size > hdr->props_capacity || slot_header->audio_bytes > hdr->audio_capacity)
+      fail("props or audio size", slot_header->props_size, slot_header->audio_bytes);
+    /* the audio of consecutive frames is contiguous */
+    if (slot_header->audio_samples > 0) {
+      if (audio_end >= 0 && slot_header->audio_start != audio_end)
+        fail("audio_start", (long long)slot_header->audio_start, (long long)audio_end);
+      audio_end = slot_header->audio_start + slot_header->audio_samples;
+      audio_samples += slot_header->audio_samples;
+    }
+
+    /* RenderToFile raw writes the rows of the planes one after the other, in the same plane order */
+    for (p = 0; reference && p < hdr->num_planes; p++) {
+      for (y = 0; y < hdr->plane_height[p]; y++) {
+        if (fread(row, 1, hdr->row_size[p], reference) != (size_t)hdr->row_size[p] ||
+            memcmp(row, slot + hdr->plane_offset[p] + (size_t)y * hdr->pitch[p], hdr->row_size[p]) != 0) {
+          fail("frame bytes differ from the reference, frame and plane", slot_header->frame_number, p);
+          break;
+        }
+      }
+    }
+    frames++;
+    STORE_RELEASE(&hdr->read_index, ++r);
+    if (failed) {
+      STORE_RELEASE(&hdr->consumer_state, AVS_SHM_CONSUMER_CLOSED);
+      break;
+    }
+  }
+
+  if (!failed && hdr->state == AVS_SHM_STATE_ERROR)
+    fail(hdr->error, frames, hdr->num_frames);
+  else if (!failed && frames != hdr->num_frames)
+    fail("frames read", frames, hdr->num_frames);
+  printf("%dx%d, %d frames, %lld audio samples: %s\n", hdr->width, hdr->height, frames,
+    (long long)audio_samples, failed ? "FAILED" : "OK");
+  free(row);
+  if (reference)
+    fclose(reference);
+  return failed;
+}
@@ -40,17 +40,86 @@
 #include <sstream>
 #include <avs/config.h>
 #include <avs/filesystem.h>
+#include <cctype>
+#ifndef AVS_WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #define TEXT_COLOR 0xf0f080
 
 using namespace std;
 
 
+MappedFile::MappedFile(const char * filename) : data(nullptr), size(0)
+{
+#ifdef AVS_WINDOWS
+  mapping = NULL;
+  file = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return;
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    return;
+  mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL)
+    return;
+  data = static_cast<const BYTE *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (data)
+    size = (size_t)file_size.QuadPart;
+#else
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void * p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+      data = static_cast<const BYTE *>(p);
+      size = (size_t)st.st_size;
+    }
+  }
+  close(fd); // the mapping stays valid
+#endif
+}
+
+
+MappedFile::~MappedFile()
+{
+#ifdef AVS_WINDOWS
+  if (data)
+    UnmapViewOfFile(data);
+  if (mapping != NULL)
+    CloseHandle(mapping);
+  if (file != INVALID_HANDLE_VALUE)
+    CloseHandle(file);
+#else
+  if (data)
+    munmap(const_cast<BYTE *>(data), size);
+#endif
+}
+
+
+void MappedFile::touch() const
+{
+  volatile BYTE sink = 0;
+  for (size_t i = 0; i < size; i += 4096)
+    sink += data[i];
+  (void)sink;
+}
+
+
 ImageReader::ImageReader(const char * _base_name, const int _start, const int _end,
                          const double _fps, bool _use_DevIL, bool _info, const char * _pixel,
-                         bool _animation, IScriptEnvironment* env)
- : start(_start), use_DevIL(_use_DevIL), info(_info), animation(_animation), framecopies(0)
+                         bool _animation, int _readahead, IScriptEnvironment* env)
+ : start(_start), use_DevIL(_use_DevIL), use_PNM(false), info(_info), animation(_animation), framecopies(0),
+   readahead(_readahead), readahead_stop(false), readahead_next(0), readahead_last(-1)
 {
+  if (_readahead < 0)
+    env->ThrowError("ImageReader: readahead must be 0 or more");
+
   if (DevIL_Version == 0) // Init the DevIL.dll version
     DevIL_Version = ilGetInteger(IL_VERSION_NUM);
 
@@ -166,7 +235,22 @@ ImageReader::ImageReader(const char * _base_name, const int _start, const int _e
       }
     }
     else {
-      use_DevIL = true; // Not a BMP, give it to DevIL
+      // Read 8/16 bit PGM/PPM ourselves when the requested pixel_type is the image's own format
+      MappedFile file(filename);
+      bool grey = false;
+      int width = 0, height = 0, maxval = 0;
+      if (file.valid() && parsePNM(file.data, file.size, grey, width, height, maxval) && (maxval == 255 || maxval == 65535)
+        && !lstrcmpi(_pixel, grey ? (maxval == 255 ? "y8" : "y16") : (maxval == 255 ? "rgb24" : "rgb48"))) {
+        use_PNM = true;
+        vi.width = width;
+        vi.height = height;
+        if (grey)
+          vi.pixel_type = maxval == 255 ? VideoInfo::CS_Y8 : VideoInfo::CS_Y16;
+        else
+          vi.pixel_type = maxval == 255 ? VideoInfo::CS_BGR24 : VideoInfo::CS_BGR48;
+      }
+      else
+        use_DevIL = true; // Not a BMP, give it to DevIL
     }
   }
 
@@ -278,11 +362,25 @@ ImageReader::ImageReader(const char * _base_name, const int _start, const int _e
     else
       framecopies = vi.num_frames;
   }
+
+  // no sequence, nothing to read ahead
+  if (framecopies > 0 || animation)
+    readahead = 0;
+  if (readahead > 0)
+    readahead_worker = std::thread(&ImageReader::readAheadThread, this);
 }
 
 
 ImageReader::~ImageReader()
 {
+  if (readahead_worker.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(readahead_mutex);
+      readahead_stop = true;
+    }
+    readahead_cond.notify_all();
+    readahead_worker.join();
+  }
   if (use_DevIL) {
       std::lock_guard<std::mutex> lock(DevIL_mutex);
       ilShutDown();
@@ -310,17 +408,23 @@ PVideoFrame ImageReader::GetFrame(int n, IScriptEnvironment* env)
   const int height = frame->GetHeight();
   const int width = vi.width;
 
+  // not the member: GetFrame can run on several threads
+  char filename[sizeof(this->filename)];
 #ifdef AVS_WINDOWS
   _snprintf(filename, (sizeof filename)-1, base_name, n+start);
 #else
   snprintf(filename, (sizeof filename) - 1, base_name, n+start);
 #endif
+  filename[(sizeof filename) - 1] = '\0';
 
   // do not lock right now
   std::unique_lock<std::mutex> lock(DevIL_mutex, std::defer_lock);
 
   if (use_DevIL)  /* read using DevIL */
   {
+    if (readahead > 0)
+      openFile(n, filename); // DevIL reads the file itself, this only moves the read-ahead window
+
     lock.lock();
 
     // Setup
@@ -458,27 +562,30 @@ PVideoFrame ImageReader::GetFrame(int n, IScriptEnvironment* env)
       return frame;
     }
   }
+  else if (use_PNM) {
+    std::shared_ptr<MappedFile> file = openFile(n, filename);
+    if (!readPNM(*file, frame, env))
+      return frame;
+  }
   else {  /* treat as ebmp  */
-    // Open file, ensure it has the expected properties
-    ifstream file(filename, ios::binary);
-    if (!checkProperties(file, frame, env)) {
-      file.close();
+    // Map file, ensure it has the expected properties
+    std::shared_ptr<MappedFile> file = openFile(n, filename);
+    if (!checkProperties(*file, frame, env))
       return frame;
-    }
 
-    // Seek past padding
-    file.seekg (fileHeader.bfOffBits, ios::beg);
+    // Skip padding
+    const BYTE * srcPtr = file->data + fileHeader.bfOffBits;
 
     // Read in raster
     if (vi.IsY())
     {
       // read upside down
       BYTE * endPtr = dstPtr + pitch * (height-1);
-      fileRead(file, endPtr, -pitch, row_size, height);
+      fileRead(srcPtr, endPtr, -pitch, row_size, height);
     }
     else
     {
-      fileRead(file, dstPtr, pitch, row_size, height);
+      srcPtr = fileRead(srcPtr, dstPtr, pitch, row_size, height);
 
       if (vi.IsPlanar())
       {
@@ -486,14 +593,12 @@ PVideoFrame ImageReader::GetFrame(int n, IScriptEnvironment* env)
         const int pitchUV = frame->GetPitch(PLANAR_U);
         const int row_sizeUV = frame->GetRowSize(PLANAR_U);
         const int heightUV = frame->GetHeight(PLANAR_U);
-        fileRead(file, dstPtr, pitchUV, row_sizeUV, heightUV);
+        srcPtr = fileRead(srcPtr, dstPtr, pitchUV, row_sizeUV, heightUV);
 
         dstPtr = frame->GetWritePtr(PLANAR_V);
-        fileRead(file, dstPtr, pitchUV, row_sizeUV, heightUV);
+        fileRead(srcPtr, dstPtr, pitchUV, row_sizeUV, heightUV);
       }
     }
-
-    file.close();
   }
 
   if (info) {
@@ -509,15 +614,174 @@ PVideoFrame ImageReader::GetFrame(int n, IScriptEnvironment* env)
 }
 
 
-void ImageReader::fileRead(istream & file, BYTE * dstPtr, const int pitch, const int row_size, const int height)
+const BYTE * ImageReader::fileRead(const BYTE * srcPtr, BYTE * dstPtr, const int pitch, const int row_size, const int height)
 {
   int padding = (4 - (row_size % 4)) % 4;
   for (int y=0; y<height; ++y)
   {
-    file.read( reinterpret_cast<char *> (dstPtr), row_size);
-    file.seekg(padding, ios_base::cur);
+    memcpy(dstPtr, srcPtr, row_size);
+    srcPtr += row_size + padding;
     dstPtr += pitch;
   }
+  return srcPtr;
+}
+
+
+size_t ImageReader::parsePNM(const BYTE * data, size_t size, bool & grey, int & width, int & height, int & maxval)
+{
+  if (size < 2 || data[0] != 'P' || (data[1] != '5' && data[1] != '6'))
+    return 0;
+  grey = data[1] == '5';
+
+  size_t pos = 2;
+  int values[3];
+  for (int i = 0; i < 3; i++) {
+    // whitespace and comments
+    while (pos < size && (isspace(data[pos]) || data[pos] == '#')) {
+      if (data[pos] == '#')
+        while (pos < size && data[pos] != '\n')
+          pos++;
+      else
+        pos++;
+    }
+    if (pos >= size || !isdigit(data[pos]))
+      return 0;
+    values[i] = 0;
+    while (pos < size && isdigit(data[pos]) && values[i] < 0x1000000)
+      values[i] = values[i] * 10 + (data[pos++] - '0');
+  }
+  // exactly one whitespace before the raster
+  if (pos >= size || !isspace(data[pos]))
+    return 0;
+  width = values[0];
+  height = values[1];
+  maxval = values[2];
+  if (width <= 0 || height <= 0 || maxval <= 0 || maxval > 65535)
+    return 0;
+  return pos + 1;
+}
+
+
+bool ImageReader::readPNM(const MappedFile & file, PVideoFrame & frame, IScriptEnvironment * env)
+{
+  if (!file.valid())
+  {
+    if (info)
+      BlankApplyMessage(frame, "ImageReader: cannot open file", env);
+    else
+      BlankFrame(frame);
+    return false;
+  }
+
+  bool grey = false;
+  int width = 0, height = 0, maxval = 0;
+  const size_t offset = parsePNM(file.data, file.size, grey, width, height, maxval);
+  const int component_size = maxval > 255 ? 2 : 1;
+  if (offset == 0 || grey != vi.IsY() || component_size != vi.ComponentSize())
+  {
+    BlankApplyMessage(frame, "ImageReader: images must have the same PGM/PPM format", env);
+    return false;
+  }
+  if (width != vi.width || height != vi.height)
+  {
+    BlankApplyMessage(frame, "ImageReader: image sizes must be identical", env);
+    return false;
+  }
+  const int channels = grey ? 1 : 3;
+  const size_t line_size = (size_t)width * channels * component_size;
+  if (file.size - offset < line_size * height)
+  {
+    BlankApplyMessage(frame, "ImageReader: file is truncated", env);
+    return false;
+  }
+
+  // PNM is top-down RGB with big-endian 16 bit samples, packed RGB frames are bottom-up BGR
+  BYTE * dstPtr = frame->GetWritePtr();
+  const int pitch = frame->GetPitch();
+  for (int y = 0; y < height; y++)
+  {
+    const BYTE * src = file.data + offset + line_size * y;
+    BYTE * dst = dstPtr + (size_t)pitch * (grey ? y : height - 1 - y);
+    if (component_size == 1) {
+      if (grey)
+        memcpy(dst, src, width);
+      else
+        for (int x = 0; x < width; x++) {
+          dst[x * 3 + 0] = src[x * 3 + 2];
+          dst[x * 3 + 1] = src[x * 3 + 1];
+          dst[x * 3 + 2] = src[x * 3 + 0];
+        }
+    }
+    else {
+      uint16_t * dst16 = reinterpret_cast<uint16_t *>(dst);
+      for (int x = 0; x < width * channels; x++) {
+        const int sx = grey ? x : x - x % 3 + 2 - x % 3; // B and R are swapped
+        dst16[x] = uint16_t((src[sx * 2] << 8) | src[sx * 2 + 1]);
+      }
+    }
+  }
+  return true;
+}
+
+
+std::shared_ptr<MappedFile> ImageReader::openFile(int n, const char * filename)
+{
+  if (readahead > 0)
+  {
+    std::shared_ptr<MappedFile> file;
+    {
+      std::lock_guard<std::mutex> lock(readahead_mutex);
+      auto it = readahead_files.find(n);
+      if (it != readahead_files.end()) {
+        file = it->second;
+        readahead_files.erase(it);
+      }
+      // move the window to the frames following n
+      if (readahead_next <= n || readahead_next > n + readahead + 1)
+        readahead_next = n + 1;
+      readahead_last = n + readahead;
+      // forget what is out of the window (seek)
+      readahead_files.erase(readahead_files.begin(), readahead_files.lower_bound(n - readahead));
+      readahead_files.erase(readahead_files.upper_bound(readahead_last), readahead_files.end());
+    }
+    readahead_cond.notify_one();
+    if (file)
+      return file;
+  }
+  return std::make_shared<MappedFile>(filename);
+}
+
+
+void ImageReader::readAheadThread()
+{
+  std::unique_lock<std::mutex> lock(readahead_mutex);
+  for (;;)
+  {
+    readahead_cond.wait(lock, [this] { return readahead_stop || readahead_next <= readahead_last; });
+    if (readahead_stop)
+      break;
+
+    const int n = readahead_next++;
+    if (n >= vi.num_frames || readahead_files.count(n))
+      continue;
+    lock.unlock();
+
+    char name[sizeof(filename)];
+#ifdef AVS_WINDOWS
+    _snprintf(name, (sizeof name) - 1, base_name, n + start);
+#else
+    snprintf(name, (sizeof name) - 1, base_name, n + start);
+#endif
+    name[(sizeof name) - 1] = '\0';
+    auto file = std::make_shared<MappedFile>(name);
+    if (file->valid())
+      file->touch();
+
+    lock.lock();
+    // a missing file is left to GetFrame, so is a frame which is out of the window by now
+    if (file->valid() && n <= readahead_last && n > readahead_last - readahead - 1)
+      readahead_files[n] = file;
+  }
 }
 
 
@@ -604,9 +868,9 @@ void ImageReader::BlankApplyMessage(PVideoFrame & frame, const char * text, IScr
 }
 
 
-bool ImageReader::checkProperties(ifstream & file, PVideoFrame & frame, IScriptEnvironment * env)
+bool ImageReader::checkProperties(const MappedFile & file, PVideoFrame & frame, IScriptEnvironment * env)
 {
-  if (!file.is_open())
+  if (!file.valid() || file.size < sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER))
   {
     if (info)
       BlankApplyMessage(frame, "ImageReader: cannot open file", env);
@@ -619,8 +883,8 @@ bool ImageReader::checkProperties(ifstream & file, PVideoFrame & frame, IScriptE
   BITMAPFILEHEADER tempFileHeader;
   BITMAPINFOHEADER tempInfoHeader;
 
-  file.read( reinterpret_cast<char *> (&tempFileHeader), sizeof(tempFileHeader) );
-  file.read( reinterpret_cast<char *> (&tempInfoHeader), sizeof(tempInfoHeader) );
+  memcpy(&tempFileHeader, file.data, sizeof(tempFileHeader));
+  memcpy(&tempInfoHeader, file.data + sizeof(tempFileHeader), sizeof(tempInfoHeader));
 
   if (tempFileHeader.bfType != fileHeader.bfType)
   {
@@ -664,5 +928,16 @@ bool ImageReader::checkProperties(ifstream & file, PVideoFrame & frame, IScriptE
     return false;
   }
 
+  // the whole raster must be in the file, rows are padded to mod-4
+  auto plane_size = [](int row_size, int height) { return (size_t)((row_size + 3) & ~3) * height; };
+  size_t raster_size = plane_size(frame->GetRowSize(), frame->GetHeight());
+  if (vi.IsPlanar() && !vi.IsY())
+    raster_size += 2 * plane_size(frame->GetRowSize(PLANAR_U), frame->GetHeight(PLANAR_U));
+  if (file.size < fileHeader.bfOffBits || file.size - fileHeader.bfOffBits < raster_size)
+  {
+    BlankApplyMessage(frame, "ImageReader: file is truncated", env);
+    return false;
+  }
+
   return true;
 }
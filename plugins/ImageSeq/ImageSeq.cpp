@@ -77,7 +77,10 @@ AVSValue __cdecl Create_ImageWriter(AVSValue args, void* user_data, IScriptEnvir
                          args[2].AsInt(0),
                          args[3].AsInt(0),
                          env->SaveString(args[4].AsString("ebmp")),
-                         args[5].AsBool(false), env);
+                         args[5].AsBool(false),
+                         args[6].AsInt(0),
+                         args[7].AsInt(0),
+                         args[8].AsInt(0), env);
 }
 
 AVSValue __cdecl Create_ImageReader(AVSValue args, void*, IScriptEnvironment* env)
@@ -90,7 +93,7 @@ AVSValue __cdecl Create_ImageReader(AVSValue args, void*, IScriptEnvironment* en
 
   ImageReader *IR = new ImageReader(path, args[1].AsInt(0), args[2].AsInt(1000), (float)args[3].AsDblDef(24.0),
                                     args[4].AsBool(false), args[5].AsBool(false), args[6].AsString("rgb24"),
-                                    /*animation*/ false, env);
+                                    /*animation*/ false, args[7].AsInt(0), env);
   // If we are returning a stream of 2 or more copies of the same image
   // then use FreezeFrame and the Cache to minimise any reloading.
   if (IR->framecopies > 1) {
@@ -108,7 +111,7 @@ AVSValue __cdecl Create_Animated(AVSValue args, void*, IScriptEnvironment* env)
     env->ThrowError("ImageSourceAnim: You must specify a filename.");
 
   return new ImageReader(args[0].AsString(), 0, 0, (float)args[1].AsDblDef(24.0), /*use_DevIL*/ true,
-                         args[2].AsBool(false), args[3].AsString("rgb32"), /*animation*/ true, env);
+                         args[2].AsBool(false), args[3].AsString("rgb32"), /*animation*/ true, /*readahead*/ 0, env);
 }
 
 const AVS_Linkage * AVS_linkage = 0;
@@ -116,12 +119,12 @@ extern "C" __declspec(dllexport) const char* __stdcall AvisynthPluginInit3(IScri
 {
 	AVS_linkage = vectors;
 
-  // clip, base filename, start, end, image format/extension, info
-  env->AddFunction("ImageWriter", "c[file]s[start]i[end]i[type]s[info]b", Create_ImageWriter, 0);
+  // clip, base filename, start, end, image format/extension, info, writer threads, queue depth, fsync batch
+  env->AddFunction("ImageWriter", "c[file]s[start]i[end]i[type]s[info]b[threads]i[queue]i[fsync]i", Create_ImageWriter, 0);
 
-  // base filename (sprintf-style), start, end, frames per second, default reader to use, info, pixel_type
-  env->AddFunction("ImageReader", "[file]s[start]i[end]i[fps]f[use_devil]b[info]b[pixel_type]s", Create_ImageReader, 0);
-  env->AddFunction("ImageSource", "[file]s[start]i[end]i[fps]f[use_devil]b[info]b[pixel_type]s", Create_ImageReader, 0);
+  // base filename (sprintf-style), start, end, frames per second, default reader to use, info, pixel_type, files to read ahead
+  env->AddFunction("ImageReader", "[file]s[start]i[end]i[fps]f[use_devil]b[info]b[pixel_type]s[readahead]i", Create_ImageReader, 0);
+  env->AddFunction("ImageSource", "[file]s[start]i[end]i[fps]f[use_devil]b[info]b[pixel_type]s[readahead]i", Create_ImageReader, 0);
 
   env->AddFunction("ImageSourceAnim", "[file]s[fps]f[info]b[pixel_type]s", Create_Animated, 0);
 
@@ -47,12 +47,21 @@
 #include <fstream>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
 
 #ifndef AVS_WINDOWS
 typedef uint16_t      WORD;
 typedef int32_t       LONG;
 typedef uint32_t      DWORD;
 
+// same layout as in the Windows headers: no padding after bfType
+#pragma pack(push, 2)
 typedef struct tagBITMAPFILEHEADER {
   WORD    bfType;
   DWORD   bfSize;
@@ -74,6 +83,7 @@ typedef struct tagBITMAPINFOHEADER {
   DWORD      biClrUsed;
   DWORD      biClrImportant;
 } BITMAPINFOHEADER;
+#pragma pack(pop)
 
 #endif
 
@@ -83,14 +93,37 @@ class ImageWriter : public GenericVideoFilter
  **/
 {
 public:
-  ImageWriter(PClip _child, const char * _base_name, const int _start, const int _end, const char * _ext, bool _info, IScriptEnvironment* env);
+  ImageWriter(PClip _child, const char * _base_name, const int _start, const int _end, const char * _ext, bool _info,
+              int _threads, int _queue, int _fsync, IScriptEnvironment* env);
   ~ImageWriter();
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
 
 private:
+  // Formats written without DevIL
+  enum WriterType { WRITER_EBMP, WRITER_BMP, WRITER_PNM, WRITER_TIFF, WRITER_DEVIL };
+
+  struct WriteJob {
+    PVideoFrame frame;
+    std::string filename;
+  };
+
+  // Encodes and writes one frame, no IScriptEnvironment calls: also runs on the writer threads.
+  // Returns an empty string or the error message.
+  std::string writeFrame(const PVideoFrame & frame, const char * filename, std::vector<BYTE> & row);
+  std::string writeEBMP(const PVideoFrame & frame, const char * filename);
+  std::string writeBMP(const PVideoFrame & frame, const char * filename, std::vector<BYTE> & row);
+  std::string writePNM(const PVideoFrame & frame, const char * filename, std::vector<BYTE> & row);
+  std::string writeTIFF(const PVideoFrame & frame, const char * filename, std::vector<BYTE> & row);
+  std::string writeDevIL(const PVideoFrame & frame, const char * filename);
   void fileWrite(std::ostream & file, const BYTE * srcPtr, const int pitch, const int row_size, const int height);
 
+  void workerThread();
+  // fsync batching: flushes the listed files to disk once 'fsync' of them were written
+  void fileWritten(std::vector<std::string> & batch, const char * filename);
+  static void syncFiles(std::vector<std::string> & batch);
+
   bool info;
+  WriterType writer;
 
 #ifdef AVS_WINDOWS
   char base_name[MAX_PATH + 1];
@@ -105,6 +138,43 @@ private:
 
   BITMAPFILEHEADER fileHeader;
   BITMAPINFOHEADER infoHeader;
+
+  // asynchronous writing: a bounded queue served by the writer threads
+  std::vector<std::thread> workers;
+  std::deque<WriteJob> jobs;
+  size_t max_jobs;
+  bool stopping;
+  std::mutex jobs_mutex;
+  std::condition_variable jobs_cond;   // signals new jobs and stop
+  std::condition_variable space_cond;  // signals free room in the queue
+  std::string pending_error;           // first write error of the threads, shown on the next frame
+
+  int fsync_batch;
+  std::mutex sync_mutex;
+  std::vector<std::string> sync_list;  // files written by GetFrame when there are no writer threads
+};
+
+
+class MappedFile
+/**
+  * Read-only memory mapping of a whole file
+ **/
+{
+public:
+  explicit MappedFile(const char * filename);
+  ~MappedFile();
+  bool valid() const { return data != nullptr; }
+  // reads one byte of each page, so that the file is in memory before it is needed
+  void touch() const;
+
+  const BYTE * data;
+  size_t size;
+
+private:
+#ifdef AVS_WINDOWS
+  HANDLE file;
+  HANDLE mapping;
+#endif
 };
 
 
@@ -116,7 +186,7 @@ class ImageReader : public IClip
 public:
   ImageReader(const char * _base_name, const int _start, const int _end,
               const double _fps, bool _use_DevIL, bool _info, const char * _pixel,
-              bool _animation, IScriptEnvironment* env);
+              bool _animation, int _readahead, IScriptEnvironment* env);
   ~ImageReader();
 
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
@@ -129,10 +199,18 @@ public:
   int  framecopies;
 
 private:
-  void fileRead(std::istream & file, BYTE * dstPtr, const int pitch, const int row_size, const int height);
+  // PGM/PPM header: P5 or P6, width, height, maxval; returns the offset of the raster, 0 if invalid
+  static size_t parsePNM(const BYTE * data, size_t size, bool & grey, int & width, int & height, int & maxval);
+
+  const BYTE * fileRead(const BYTE * srcPtr, BYTE * dstPtr, const int pitch, const int row_size, const int height);
+  bool readPNM(const MappedFile & file, PVideoFrame & frame, IScriptEnvironment * env);
   void BlankFrame(PVideoFrame & frame);
   void BlankApplyMessage(PVideoFrame & frame, const char * text, IScriptEnvironment * env);
-  bool checkProperties(std::ifstream & file, PVideoFrame & frame, IScriptEnvironment * env);
+  bool checkProperties(const MappedFile & file, PVideoFrame & frame, IScriptEnvironment * env);
+
+  // read-ahead: a thread maps and loads the files of the next frames
+  std::shared_ptr<MappedFile> openFile(int n, const char * filename);
+  void readAheadThread();
 
 #ifdef AVS_WINDOWS
   char base_name[MAX_PATH + 1];
@@ -141,6 +219,7 @@ private:
 #endif
   const int start;
   bool use_DevIL;
+  bool use_PNM;   // 8/16 bit PGM/PPM read without DevIL
   bool info;
   bool animation;
 
@@ -155,6 +234,15 @@ bool should_flip;
 
   BITMAPFILEHEADER fileHeader;
   BITMAPINFOHEADER infoHeader;
+
+  int readahead;
+  std::thread readahead_worker;
+  std::mutex readahead_mutex;
+  std::condition_variable readahead_cond;
+  bool readahead_stop;
+  int readahead_next;  // next frame to load
+  int readahead_last;  // load up to this frame
+  std::map<int, std::shared_ptr<MappedFile>> readahead_files; // loaded, not yet requested
 };
 
 
@@ -41,6 +41,14 @@
 #include <avs/config.h>
 #include <avs/filesystem.h>
 #include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <functional>
+#ifndef AVS_WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #define TEXT_COLOR 0xf0f080
 
@@ -48,8 +56,8 @@ using namespace std;
 
 
 ImageWriter::ImageWriter(PClip _child, const char * _base_name, const int _start, const int _end,
-                         const char * _ext, bool _info, IScriptEnvironment* env)
- : GenericVideoFilter(_child), ext(_ext), info(_info)
+                         const char * _ext, bool _info, int _threads, int _queue, int _fsync, IScriptEnvironment* env)
+ : GenericVideoFilter(_child), ext(_ext), info(_info), stopping(false), fsync_batch(_fsync)
 {
 #ifdef AVS_WINDOWS
   // treat empty input as current directory
@@ -80,8 +88,14 @@ ImageWriter::ImageWriter(PClip _child, const char * _base_name, const int _start
     strcat(base_name, "%06d.%s"); // Append default formating
   }
 
+  if (_threads < 0)
+    env->ThrowError("ImageWriter: threads must be 0 or more");
+  if (_queue < 0)
+    env->ThrowError("ImageWriter: queue must be 0 or more");
+
   if (!lstrcmpi(ext, "ebmp"))
   {
+    writer = WRITER_EBMP;
     if (vi.BitsPerComponent() != 8)
       env->ThrowError("ImageWriter: ebmp requires 8 bits/component images");
     // construct file header
@@ -115,8 +129,15 @@ ImageWriter::ImageWriter(PClip _child, const char * _base_name, const int _start
     if (!((vi.IsY() && (vi.BitsPerComponent() == 8 || vi.BitsPerComponent() == 16)) || (vi.IsRGB() && !vi.IsPlanar())))
       env->ThrowError("ImageWriter: DevIL requires 8 or 16 bits per channel RGB or greyscale input");
 
-
-    {
+    // Built-in writers for the simple uncompressed formats, everything else goes through DevIL
+    if (!lstrcmpi(ext, "bmp") && vi.ComponentSize() == 1)
+      writer = WRITER_BMP;
+    else if (!lstrcmpi(ext, "ppm") || !lstrcmpi(ext, "pgm") || !lstrcmpi(ext, "pnm"))
+      writer = WRITER_PNM;
+    else if (!lstrcmpi(ext, "tif") || !lstrcmpi(ext, "tiff"))
+      writer = WRITER_TIFF;
+    else {
+      writer = WRITER_DEVIL;
       std::lock_guard<std::mutex> lock(DevIL_mutex);
       ilInit();
     }
@@ -132,12 +153,28 @@ ImageWriter::ImageWriter(PClip _child, const char * _base_name, const int _start
     end = _end;
 
   end = max(end, start);
+
+  // GetFrame only queues the frames, these threads encode and write them
+  max_jobs = _queue > 0 ? _queue : 2 * _threads;
+  for (int i = 0; i < _threads; i++)
+    workers.emplace_back(&ImageWriter::workerThread, this);
 }
 
 
 ImageWriter::~ImageWriter()
 {
-  if (!!lstrcmpi(ext, "ebmp")) {
+  if (!workers.empty()) {
+    {
+      std::lock_guard<std::mutex> lock(jobs_mutex);
+      stopping = true;
+    }
+    jobs_cond.notify_all();
+    for (auto& worker : workers)
+      worker.join();
+  }
+  syncFiles(sync_list);
+
+  if (writer == WRITER_DEVIL) {
     std::lock_guard<std::mutex> lock(DevIL_mutex);
     ilShutDown();
   }
@@ -172,128 +209,408 @@ PVideoFrame ImageWriter::GetFrame(int n, IScriptEnvironment* env)
   filename[PATH_MAX] = '\0';
 #endif
 
-  if (!lstrcmpi(ext, "ebmp"))  /* Use internal 'ebmp' writer */
+  std::string error;
+  if (!workers.empty())
   {
-    // initialize file object
-    ofstream file(filename, ios::out | ios::trunc | ios::binary);
-    if (!file)
-    {
-      ostringstream ss;
-      ss << "ImageWriter: could not create file '" << filename << "'";
-      env->MakeWritable(&frame);
-      env->ApplyMessage(&frame, vi, ss.str().c_str(), vi.width/4, TEXT_COLOR, 0, 0);
-      return frame;
+    // Queue the frame, the job keeps its own reference so the overlays below make a copy.
+    // Errors of the writer threads are reported on the next frame returned.
+    std::unique_lock<std::mutex> lock(jobs_mutex);
+    space_cond.wait(lock, [this] { return jobs.size() < max_jobs; });
+    jobs.push_back(WriteJob{ frame, filename });
+    error.swap(pending_error);
+    lock.unlock();
+    jobs_cond.notify_one();
+  }
+  else
+  {
+    std::vector<BYTE> row;
+    error = writeFrame(frame, filename, row);
+    if (error.empty()) {
+      std::lock_guard<std::mutex> lock(sync_mutex);
+      fileWritten(sync_list, filename);
     }
+  }
 
-    // write headers
-    file.write(reinterpret_cast<const char *>( &fileHeader ), sizeof(BITMAPFILEHEADER));
-    file.write(reinterpret_cast<const char *>( &infoHeader ), sizeof(BITMAPINFOHEADER));
+  if (!error.empty())
+  {
+    env->MakeWritable(&frame);
+    env->ApplyMessage(&frame, vi, error.c_str(), vi.width / 4, TEXT_COLOR, 0, 0);
+    return frame;
+  }
 
-    // write raster
-    const BYTE * srcPtr = frame->GetReadPtr();
-    int pitch = frame->GetPitch();
-    int row_size = frame->GetRowSize();
-    int height = frame->GetHeight();
+  if (info) {
+    // overlay on video output: progress indicator
+    ostringstream text;
+    text << "Frame " << n << (workers.empty() ? " written to: " : " queued for: ") << filename;
+    env->MakeWritable(&frame);
+    env->ApplyMessage(&frame, vi, text.str().c_str(), vi.width/4, TEXT_COLOR, 0, 0);
+  }
+
+  return frame;
+}
 
-    if (vi.IsY8())
+
+void ImageWriter::workerThread()
+{
+  std::vector<BYTE> row; // conversion buffer, kept between frames
+  std::vector<std::string> batch;
+
+  for (;;)
+  {
+    WriteJob job;
     {
-      // write upside down
-      const BYTE * endPtr = srcPtr + pitch * (height-1);
-      fileWrite(file, endPtr, -pitch, row_size, height);
+      std::unique_lock<std::mutex> lock(jobs_mutex);
+      jobs_cond.wait(lock, [this] { return stopping || !jobs.empty(); });
+      if (jobs.empty())
+        break; // stopping and nothing left to write
+      job = std::move(jobs.front());
+      jobs.pop_front();
+    }
+    space_cond.notify_one();
+
+    std::string error = writeFrame(job.frame, job.filename.c_str(), row);
+    if (!error.empty()) {
+      std::lock_guard<std::mutex> lock(jobs_mutex);
+      if (pending_error.empty())
+        pending_error = error;
     }
     else
+      fileWritten(batch, job.filename.c_str());
+  }
+
+  syncFiles(batch);
+}
+
+
+void ImageWriter::fileWritten(std::vector<std::string> & batch, const char * filename)
+{
+  if (fsync_batch <= 0)
+    return;
+  batch.push_back(filename);
+  if ((int)batch.size() >= fsync_batch)
+    syncFiles(batch);
+}
+
+
+void ImageWriter::syncFiles(std::vector<std::string> & batch)
+{
+  for (const auto& name : batch)
+  {
+#ifdef AVS_WINDOWS
+    HANDLE h = CreateFile(name.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+    if (h != INVALID_HANDLE_VALUE) {
+      FlushFileBuffers(h);
+      CloseHandle(h);
+    }
+#else
+    int fd = open(name.c_str(), O_RDONLY);
+    if (fd >= 0) {
+      fsync(fd);
+      close(fd);
+    }
+#endif
+  }
+  batch.clear();
+}
+
+
+std::string ImageWriter::writeFrame(const PVideoFrame & frame, const char * filename, std::vector<BYTE> & row)
+{
+  try {
+    switch (writer)
+    {
+    case WRITER_EBMP: return writeEBMP(frame, filename);
+    case WRITER_BMP:  return writeBMP(frame, filename, row);
+    case WRITER_PNM:  return writePNM(frame, filename, row);
+    case WRITER_TIFF: return writeTIFF(frame, filename, row);
+    default:          return writeDevIL(frame, filename);
+    }
+  }
+  catch (const std::bad_alloc&) {
+    return std::string("ImageWriter: out of memory writing file '") + filename + "'";
+  }
+}
+
+
+std::string ImageWriter::writeEBMP(const PVideoFrame & frame, const char * filename)
+{
+  // initialize file object
+  ofstream file(filename, ios::out | ios::trunc | ios::binary);
+  if (!file)
+    return std::string("ImageWriter: could not create file '") + filename + "'";
+
+  // write headers
+  file.write(reinterpret_cast<const char *>( &fileHeader ), sizeof(BITMAPFILEHEADER));
+  file.write(reinterpret_cast<const char *>( &infoHeader ), sizeof(BITMAPINFOHEADER));
+
+  // write raster
+  const BYTE * srcPtr = frame->GetReadPtr();
+  int pitch = frame->GetPitch();
+  int row_size = frame->GetRowSize();
+  int height = frame->GetHeight();
+
+  if (vi.IsY8())
+  {
+    // write upside down
+    const BYTE * endPtr = srcPtr + pitch * (height-1);
+    fileWrite(file, endPtr, -pitch, row_size, height);
+  }
+  else
+  {
+    fileWrite(file, srcPtr, pitch, row_size, height);
+
+    if (vi.IsPlanar())
     {
+      srcPtr = frame->GetReadPtr(PLANAR_U);
+      pitch = frame->GetPitch(PLANAR_U);
+      row_size = frame->GetRowSize(PLANAR_U);
+      height = frame->GetHeight(PLANAR_U);
       fileWrite(file, srcPtr, pitch, row_size, height);
 
-      if (vi.IsPlanar())
-      {
-        srcPtr = frame->GetReadPtr(PLANAR_U);
-        pitch = frame->GetPitch(PLANAR_U);
-        row_size = frame->GetRowSize(PLANAR_U);
-        height = frame->GetHeight(PLANAR_U);
-        fileWrite(file, srcPtr, pitch, row_size, height);
-
-        srcPtr = frame->GetReadPtr(PLANAR_V);
-        fileWrite(file, srcPtr, pitch, row_size, height);
-      }
+      srcPtr = frame->GetReadPtr(PLANAR_V);
+      fileWrite(file, srcPtr, pitch, row_size, height);
     }
-
-    // clean up
-    file.close();
   }
-  else { /* Use DevIL library */
-    std::unique_lock<std::mutex> lock(DevIL_mutex);
-
-    // Set up DevIL
-    ILuint myImage = 0;
-    ilGenImages(1, &myImage); // Initialize 1 image structure
-    ilBindImage(myImage);     // Set this as the current image
-
-    const ILenum il_format = vi.IsY() ? IL_LUMINANCE : ((vi.IsRGB32() || vi.IsRGB64()) ? IL_BGRA : IL_BGR);
-    const ILenum ilPixelType = vi.ComponentSize() == 1 ? IL_UNSIGNED_BYTE : IL_UNSIGNED_SHORT;
-
-    // Set image parameters
-    int bytesPerPixel = vi.BitsPerPixel() / 8 / vi.ComponentSize();
-    if (IL_TRUE == ilTexImage(vi.width, vi.height, 1, ILubyte(bytesPerPixel), il_format, ilPixelType, NULL)) {
-
-      // Program actual image raster
-      const BYTE* srcPtr = frame->GetReadPtr();
-      int pitch = frame->GetPitch();
-      if (should_flip) {
-        for (int y = vi.height - 1; y >= 0; --y)
-        {
-          ilSetPixels(0, y, 0, vi.width, 1, 1, il_format, ilPixelType, (void*)srcPtr);
-          srcPtr += pitch;
-        }
+
+  // clean up
+  file.close();
+  return std::string();
+}
+
+
+std::string ImageWriter::writeDevIL(const PVideoFrame & frame, const char * filename)
+{
+  std::unique_lock<std::mutex> lock(DevIL_mutex);
+
+  // Set up DevIL
+  ILuint myImage = 0;
+  ilGenImages(1, &myImage); // Initialize 1 image structure
+  ilBindImage(myImage);     // Set this as the current image
+
+  const ILenum il_format = vi.IsY() ? IL_LUMINANCE : ((vi.IsRGB32() || vi.IsRGB64()) ? IL_BGRA : IL_BGR);
+  const ILenum ilPixelType = vi.ComponentSize() == 1 ? IL_UNSIGNED_BYTE : IL_UNSIGNED_SHORT;
+
+  // Set image parameters
+  int bytesPerPixel = vi.BitsPerPixel() / 8 / vi.ComponentSize();
+  if (IL_TRUE == ilTexImage(vi.width, vi.height, 1, ILubyte(bytesPerPixel), il_format, ilPixelType, NULL)) {
+
+    // Program actual image raster
+    const BYTE* srcPtr = frame->GetReadPtr();
+    int pitch = frame->GetPitch();
+    if (should_flip) {
+      for (int y = vi.height - 1; y >= 0; --y)
+      {
+        ilSetPixels(0, y, 0, vi.width, 1, 1, il_format, ilPixelType, (void*)srcPtr);
+        srcPtr += pitch;
       }
-      else {
-        for (int y = 0; y < vi.height; ++y)
-        {
-          ilSetPixels(0, y, 0, vi.width, 1, 1, il_format, ilPixelType, (void*)srcPtr);
-          srcPtr += pitch;
-        }
+    }
+    else {
+      for (int y = 0; y < vi.height; ++y)
+      {
+        ilSetPixels(0, y, 0, vi.width, 1, 1, il_format, ilPixelType, (void*)srcPtr);
+        srcPtr += pitch;
       }
+    }
 
-      // DevIL writer fails if the file exists, so delete first
+    // DevIL writer fails if the file exists, so delete first
 #ifdef AVS_WINDOWS
-      DeleteFile(filename);
+    DeleteFile(filename);
 #else
-      fs::remove(fs::path(filename));
+    fs::remove(fs::path(filename));
 #endif
 
-      // Save to disk (format automatically inferred from extension)
-      ilSaveImage(filename);
-    }
+    // Save to disk (format automatically inferred from extension)
+    ilSaveImage(filename);
+  }
 
-    // Get errors if any
-    ILenum err = ilGetError();
+  // Get errors if any
+  ILenum err = ilGetError();
 
-    // Clean up
-    ilDeleteImages(1, &myImage);
+  // Clean up
+  ilDeleteImages(1, &myImage);
 
-    lock.unlock();
+  lock.unlock();
 
-    if (err != IL_NO_ERROR)
-    {
-      ostringstream ss;
-      ss << "ImageWriter: error '" << getErrStr(err) << "' in DevIL library\n"
-            "writing file \"" << filename << "\"\n"
-            "DevIL version " << DevIL_Version << ".";
-      env->MakeWritable(&frame);
-      env->ApplyMessage(&frame, vi, ss.str().c_str(), vi.width / 4, TEXT_COLOR, 0, 0);
-      return frame;
+  if (err != IL_NO_ERROR)
+  {
+    ostringstream ss;
+    ss << "ImageWriter: error '" << getErrStr(err) << "' in DevIL library\n"
+          "writing file \"" << filename << "\"\n"
+          "DevIL version " << DevIL_Version << ".";
+    return ss.str();
+  }
+  return std::string();
+}
+
+
+static void put16le(std::vector<BYTE> & v, uint32_t x) { v.push_back(BYTE(x)); v.push_back(BYTE(x >> 8)); }
+static void put32le(std::vector<BYTE> & v, uint32_t x) { put16le(v, x & 0xffff); put16le(v, x >> 16); }
+
+// One top-down output line from packed BGR(A) or greyscale source pixels, into RGB(A) or grey order.
+// src_step: source components per pixel, channels: output components per pixel.
+static void packRow(const BYTE * src, BYTE * dst, int width, int src_step, int channels, int component_size, bool big_endian)
+{
+  for (int c = 0; c < channels; c++)
+  {
+    const int sc = (src_step == 1 || c == 3) ? c : 2 - c; // B and R are swapped
+    if (component_size == 1) {
+      for (int x = 0; x < width; x++)
+        dst[x * channels + c] = src[x * src_step + sc];
+    }
+    else {
+      const uint16_t * src16 = reinterpret_cast<const uint16_t *>(src);
+      for (int x = 0; x < width; x++) {
+        const uint16_t v = src16[x * src_step + sc];
+        BYTE * d = dst + (x * channels + c) * 2;
+        d[big_endian ? 0 : 1] = BYTE(v >> 8);
+        d[big_endian ? 1 : 0] = BYTE(v);
+      }
     }
   }
+}
 
-  if (info) {
-    // overlay on video output: progress indicator
-    ostringstream text;
-    text << "Frame " << n << " written to: " << filename;
-    env->MakeWritable(&frame);
-    env->ApplyMessage(&frame, vi, text.str().c_str(), vi.width/4, TEXT_COLOR, 0, 0);
+static std::string writeFile(const char * filename, const std::vector<BYTE> & header,
+  const PVideoFrame & frame, bool flip, int out_row_size, std::vector<BYTE> & row,
+  const std::function<void(const BYTE *, BYTE *)> & convert)
+{
+  FILE * file = fopen(filename, "wb");
+  if (!file)
+    return std::string("ImageWriter: could not create file '") + filename + "'";
+
+  fwrite(header.data(), 1, header.size(), file);
+
+  const BYTE * srcPtr = frame->GetReadPtr();
+  const int pitch = frame->GetPitch();
+  const int height = frame->GetHeight();
+  row.resize(out_row_size);
+  for (int y = 0; y < height; y++) {
+    const BYTE * src = srcPtr + (size_t)pitch * (flip ? height - 1 - y : y);
+    convert(src, row.data());
+    fwrite(row.data(), 1, out_row_size, file);
   }
 
-  return frame;
+  const bool failed = ferror(file) != 0;
+  if (fclose(file) != 0 || failed)
+    return std::string("ImageWriter: error writing file '") + filename + "'";
+  return std::string();
+}
+
+
+// BMP, 8 bit only: packed RGB frames already have the bottom-up BGR(A) layout of the format,
+// greyscale is written with a grey palette
+std::string ImageWriter::writeBMP(const PVideoFrame & frame, const char * filename, std::vector<BYTE> & row)
+{
+  const bool grey = vi.IsY();
+  const int bytes_per_pixel = grey ? 1 : vi.BytesFromPixels(1);
+  const int line_size = vi.width * bytes_per_pixel;
+  const int stride = (line_size + 3) & ~3;
+  const uint32_t palette_size = grey ? 256 * 4 : 0;
+  const uint32_t offset = 14 + 40 + palette_size;
+  const uint32_t image_size = (uint32_t)stride * vi.height;
+
+  std::vector<BYTE> header;
+  put16le(header, ('M' << 8) + 'B');
+  put32le(header, offset + image_size);
+  put32le(header, 0);
+  put32le(header, offset);
+  put32le(header, 40);
+  put32le(header, vi.width);
+  put32le(header, vi.height); // positive: bottom-up
+  put16le(header, 1);
+  put16le(header, bytes_per_pixel * 8);
+  put32le(header, 0); // BI_RGB
+  put32le(header, image_size);
+  put32le(header, 0);
+  put32le(header, 0);
+  put32le(header, grey ? 256 : 0);
+  put32le(header, 0);
+  for (uint32_t i = 0; i < palette_size / 4; i++)
+    put32le(header, i * 0x010101);
+
+  return writeFile(filename, header, frame, /*flip*/ grey, stride, row,
+    [line_size, stride](const BYTE * src, BYTE * dst) {
+      memcpy(dst, src, line_size);
+      memset(dst + line_size, 0, stride - line_size); // pad with 0's to mod-4
+    });
+}
+
+
+// PGM (P5) for greyscale, PPM (P6) for RGB, alpha is dropped. 16 bit samples are big-endian.
+std::string ImageWriter::writePNM(const PVideoFrame & frame, const char * filename, std::vector<BYTE> & row)
+{
+  const bool grey = vi.IsY();
+  const int component_size = vi.ComponentSize();
+  const int channels = grey ? 1 : 3;
+  const int src_step = grey ? 1 : vi.BytesFromPixels(1) / component_size;
+  const int width = vi.width;
+
+  char text[64];
+  snprintf(text, sizeof(text), "%s\n%d %d\n%d\n", grey ? "P5" : "P6", vi.width, vi.height, component_size == 1 ? 255 : 65535);
+  std::vector<BYTE> header(text, text + strlen(text));
+
+  return writeFile(filename, header, frame, /*flip*/ !grey, width * channels * component_size, row,
+    [=](const BYTE * src, BYTE * dst) {
+      packRow(src, dst, width, src_step, channels, component_size, true);
+    });
+}
+
+
+// Baseline little-endian TIFF: one uncompressed strip, chunky RGB(A) or greyscale, 8 or 16 bit
+std::string ImageWriter::writeTIFF(const PVideoFrame & frame, const char * filename, std::vector<BYTE> & row)
+{
+  const bool grey = vi.IsY();
+  const bool alpha = vi.IsRGB32() || vi.IsRGB64();
+  const int component_size = vi.ComponentSize();
+  const int channels = grey ? 1 : (alpha ? 4 : 3);
+  const int src_step = grey ? 1 : vi.BytesFromPixels(1) / component_size;
+  const int width = vi.width;
+  const int row_size = width * channels * component_size;
+
+  enum { TIFF_SHORT = 3, TIFF_LONG = 4 };
+  const int num_tags = alpha ? 11 : 10;
+  const uint32_t ifd_offset = 8;
+  const uint32_t bits_offset = ifd_offset + 2 + num_tags * 12 + 4; // BitsPerSample values if they do not fit the entry
+  const uint32_t data_offset = bits_offset + (channels > 2 ? channels * 2 : 0);
+
+  std::vector<BYTE> header;
+  auto tag = [&header](int id, int type, uint32_t count, uint32_t value) {
+    put16le(header, id);
+    put16le(header, type);
+    put32le(header, count);
+    if (type == TIFF_SHORT && count == 1) {
+      put16le(header, value);
+      put16le(header, 0);
+    }
+    else
+      put32le(header, value);
+  };
+
+  put16le(header, ('I' << 8) + 'I');
+  put16le(header, 42);
+  put32le(header, ifd_offset);
+  put16le(header, num_tags);
+  // tags in ascending order
+  tag(256, TIFF_LONG, 1, width);                                   // ImageWidth
+  tag(257, TIFF_LONG, 1, vi.height);                               // ImageLength
+  tag(258, TIFF_SHORT, channels, channels > 2 ? bits_offset : 8 * component_size); // BitsPerSample
+  tag(259, TIFF_SHORT, 1, 1);                                      // Compression: none
+  tag(262, TIFF_SHORT, 1, grey ? 1 : 2);                           // Photometric: BlackIsZero or RGB
+  tag(273, TIFF_LONG, 1, data_offset);                             // StripOffsets
+  tag(277, TIFF_SHORT, 1, channels);                               // SamplesPerPixel
+  tag(278, TIFF_LONG, 1, vi.height);                               // RowsPerStrip
+  tag(279, TIFF_LONG, 1, (uint32_t)row_size * vi.height);          // StripByteCounts
+  tag(284, TIFF_SHORT, 1, 1);                                      // PlanarConfiguration: chunky
+  if (alpha)
+    tag(338, TIFF_SHORT, 1, 2);                                    // ExtraSamples: unassociated alpha
+  put32le(header, 0); // no next IFD
+  if (channels > 2)
+    for (int c = 0; c < channels; c++)
+      put16le(header, 8 * component_size);
+
+  return writeFile(filename, header, frame, /*flip*/ !grey, row_size, row,
+    [=](const BYTE * src, BYTE * dst) {
+      packRow(src, dst, width, src_step, channels, component_size, false);
+    });
 }
 
 